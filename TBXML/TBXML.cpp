@@ -27,71 +27,655 @@
 //  THE SOFTWARE.
 // ================================================================================================
 #include "TBXML.h"
+#include "TBXMLScanner.h"
+#include "TBXMLProjection.h"
 #include <malloc.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
 #include <fstream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <charconv>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TBXML_HAS_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
+static_assert(sizeof(void*) != 8 || sizeof(TBXMLElement) == 88, "TBXMLElement is documented as 88 bytes");
+
 // ================================================================================================
-// Public Implementation
+// Child Index
 // ================================================================================================
 
-TBXML::~TBXML() {
-	if (bytes) {
-		free(bytes);
-		bytes = NULL;
+// first and last child with one name, the first names the slot
+typedef struct _TBXMLChildIndexSlot {
+	const TBXMLElement * first;
+	const TBXMLElement * last;
+} TBXMLChildIndexSlot;
+
+// next child with the same name as element
+typedef struct _TBXMLChildIndexLink {
+	const TBXMLElement * element;
+	const TBXMLElement * next;
+} TBXMLChildIndexLink;
+
+/** The TBXMLChildIndex structure holds two open addressing tables over the children of an element, one
+    from a name to the first child with that name and one from a child to the next child of the same
+    name. Both have at least twice as many slots as there are children.
+ */
+struct _TBXMLChildIndex {
+	size_t mask;
+	TBXMLChildIndexSlot * names;
+	TBXMLChildIndexLink * links;
+};
+typedef struct _TBXMLChildIndex TBXMLChildIndex;
+
+// the index of an element
+typedef struct _TBXMLChildIndexEntry {
+	const TBXMLElement * element;
+	TBXMLChildIndex * index;
+} TBXMLChildIndexEntry;
+
+/** The TBXMLChildIndexTable structure is an open addressing table from an element to its child index,
+    at most half full. It lives in the arena and is replaced by one twice the size when full, the one
+    replaced stays valid for readers still using it until the arena is reset.
+ */
+struct _TBXMLChildIndexTable {
+	size_t mask;
+	size_t count;
+	TBXMLChildIndexEntry * entries;
+};
+typedef struct _TBXMLChildIndexTable TBXMLChildIndexTable;
+
+// tables and entries are published once complete, readers see them whole or not at all
+template<typename T> static inline T* loadPointer(T* const* aPointer) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(aPointer, __ATOMIC_ACQUIRE);
+#else
+	T * pointer = *(T * const volatile *)aPointer;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return pointer;
+#endif
+}
+
+template<typename T> static inline void storePointer(T** aPointer, T* aValue) {
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_store_n(aPointer, aValue, __ATOMIC_RELEASE);
+#else
+	std::atomic_thread_fence(std::memory_order_release);
+	*(T * volatile *)aPointer = aValue;
+#endif
+}
+
+static inline size_t childIndexPointerSlot(const TBXMLElement* aXMLElement, size_t aMask) {
+	uint64_t hash = (uint64_t)(uintptr_t)aXMLElement * 0x9E3779B97F4A7C15ull;
+	return (size_t)(hash ^ (hash >> 29)) & aMask;
+}
+
+static TBXMLChildIndex* childIndexTableFind(const TBXMLChildIndexTable* aTable, const TBXMLElement* aXMLElement) {
+	if (!aTable) return NULL;
+	size_t slot = childIndexPointerSlot(aXMLElement, aTable->mask);
+	while (const TBXMLElement * element = loadPointer(&aTable->entries[slot].element)) {
+		if (element == aXMLElement) return aTable->entries[slot].index;
+		slot = (slot+1) & aTable->mask;
+	}
+	return NULL;
+}
+
+static const TBXMLElement* childIndexFind(const TBXMLChildIndex* aIndex, const TBXMLName &aName) {
+	size_t slot = (size_t)TBXMLSymbolTable::hash(aName.name, aName.length) & aIndex->mask;
+	while (const TBXMLElement * first = aIndex->names[slot].first) {
+		if (aName.matches(first->nameId, first->name, first->nameLength)) return first;
+		slot = (slot+1) & aIndex->mask;
+	}
+	return NULL;
+}
+
+static const TBXMLElement* childIndexNext(const TBXMLChildIndex* aIndex, const TBXMLElement* aXMLElement) {
+	size_t slot = childIndexPointerSlot(aXMLElement, aIndex->mask);
+	while (aIndex->links[slot].element) {
+		if (aIndex->links[slot].element == aXMLElement) return aIndex->links[slot].next;
+		slot = (slot+1) & aIndex->mask;
+	}
+	return NULL;
+}
+
+// ================================================================================================
+// Entities
+// ================================================================================================
+
+// the code point of the entity or character reference at aStart ('&'), returns the length of the
+// reference or 0 if it is none that is decoded
+static size_t decodeReference(const char* aStart, const char* aEnd, uint32_t* aCodePoint) {
+	const char * chr = aStart+1;
+
+	if (chr < aEnd && *chr == '#') {
+		bool hex = ++chr < aEnd && *chr == 'x';
+		if (hex) chr++;
+
+		const char * digits = chr;
+		uint32_t codePoint = 0;
+		for (; chr < aEnd && *chr != ';'; chr++) {
+			uint32_t digit;
+			if (*chr >= '0' && *chr <= '9') digit = *chr - '0';
+			else if (hex && *chr >= 'a' && *chr <= 'f') digit = *chr - 'a' + 10;
+			else if (hex && *chr >= 'A' && *chr <= 'F') digit = *chr - 'A' + 10;
+			else return 0;
+
+			codePoint = codePoint*(hex ? 16 : 10) + digit;
+			if (codePoint > 0x10FFFF) return 0;
+		}
+
+		// surrogates and 0 aren't characters
+		if (chr == aEnd || chr == digits || !codePoint || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) return 0;
+		*aCodePoint = codePoint;
+		return chr+1 - aStart;
 	}
 
-	while (currentElementBuffer) {
-		if (currentElementBuffer->elements)
-			free(currentElementBuffer->elements);
+	static const struct { const char * name; size_t length; char value; } predefined[] = {
+		{ "amp;", 4, '&' }, { "lt;", 3, '<' }, { "gt;", 3, '>' }, { "quot;", 5, '"' }, { "apos;", 5, '\'' }
+	};
+	for (size_t i=0; i < sizeof(predefined)/sizeof(predefined[0]); i++) {
+		if ((size_t)(aEnd - chr) >= predefined[i].length && memcmp(chr, predefined[i].name, predefined[i].length) == 0) {
+			*aCodePoint = (uint32_t)predefined[i].value;
+			return predefined[i].length+1;
+		}
+	}
+	return 0;
+}
+
+// copies [aStart, aEnd) to aWrite decoding references, returns the end of the copy. A reference is
+// never shorter than the UTF-8 of its character, so aWrite may be aStart or anywhere before it.
+static char* decodeEntities(char* aWrite, const char* aStart, const char* aEnd) {
+	while (aStart < aEnd) {
+		const char * reference = TBXMLScanner::findChar(aStart, aEnd, '&');
+		const char * runEnd = reference ? reference : aEnd;
+		if (aWrite != aStart) memmove(aWrite, aStart, runEnd - aStart);
+		aWrite += runEnd - aStart;
+		aStart = runEnd;
+		if (!reference) break;
 
-		if (currentElementBuffer->previous) {
-			currentElementBuffer = currentElementBuffer->previous;
-			free(currentElementBuffer->next);
+		uint32_t codePoint;
+		size_t length = decodeReference(reference, aEnd, &codePoint);
+		if (!length) {
+			*aWrite++ = *aStart++;
+			continue;
+		}
+		aStart += length;
+
+		if (codePoint < 0x80) {
+			*aWrite++ = (char)codePoint;
+		} else if (codePoint < 0x800) {
+			*aWrite++ = (char)(0xC0 | (codePoint >> 6));
+			*aWrite++ = (char)(0x80 | (codePoint & 0x3F));
+		} else if (codePoint < 0x10000) {
+			*aWrite++ = (char)(0xE0 | (codePoint >> 12));
+			*aWrite++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			*aWrite++ = (char)(0x80 | (codePoint & 0x3F));
 		} else {
-			free(currentElementBuffer);
-			currentElementBuffer = 0;
+			*aWrite++ = (char)(0xF0 | (codePoint >> 18));
+			*aWrite++ = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			*aWrite++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			*aWrite++ = (char)(0x80 | (codePoint & 0x3F));
 		}
 	}
+	return aWrite;
+}
+
+// flags are set once under the document lock in lazy mode, readers check them without it
+static inline uint32_t loadFlags(const uint32_t* aFlags) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __atomic_load_n(aFlags, __ATOMIC_ACQUIRE);
+#else
+	uint32_t flags = *(const volatile uint32_t *)aFlags;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return flags;
+#endif
+}
+
+static inline void storeFlags(const uint32_t* aFlags, uint32_t aValue) {
+	uint32_t * flags = const_cast<uint32_t*>(aFlags);
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_store_n(flags, aValue, __ATOMIC_RELEASE);
+#else
+	std::atomic_thread_fence(std::memory_order_release);
+	*(volatile uint32_t *)flags = aValue;
+#endif
+}
+
+// decodes the measured text of an element in place, once
+static void decodeText(TBXMLElement* aXMLElement) {
+	if (!aXMLElement->text || (aXMLElement->flags & TBXML_FLAG_DECODED)) return;
+	if (!TBXMLScanner::findChar(aXMLElement->text, aXMLElement->text + aXMLElement->textLength, '&')) return;
+
+	char * textEnd = decodeEntities(aXMLElement->text, aXMLElement->text, aXMLElement->text + aXMLElement->textLength);
+	*textEnd = 0;
+	aXMLElement->textLength = textEnd - aXMLElement->text;
+	aXMLElement->flags |= TBXML_FLAG_DECODED;
+}
+
+// ================================================================================================
+// Typed Values
+// ================================================================================================
+
+template<typename T> static TBXMLErrorCodes convertValue(const char* aStart, const char* aEnd, T &aValue) {
+	while (aStart < aEnd && TBXMLScanner::isWhitespace(*aStart)) aStart++;
+	while (aEnd > aStart && TBXMLScanner::isWhitespace(aEnd[-1])) aEnd--;
+
+	// from_chars takes a '-' only
+	if (aEnd - aStart > 1 && *aStart == '+' && aStart[1] != '-') aStart++;
+
+	T value;
+	std::from_chars_result result = std::from_chars(aStart, aEnd, value);
+	if (result.ec == std::errc::result_out_of_range) return D_TBXML_VALUE_OUT_OF_RANGE;
+	if (result.ec != std::errc() || result.ptr != aEnd) return D_TBXML_VALUE_NOT_A_NUMBER;
+
+	aValue = value;
+	return D_TBXML_SUCCESS;
+}
+
+template<> TBXMLErrorCodes convertValue<bool>(const char* aStart, const char* aEnd, bool &aValue) {
+	while (aStart < aEnd && TBXMLScanner::isWhitespace(*aStart)) aStart++;
+	while (aEnd > aStart && TBXMLScanner::isWhitespace(aEnd[-1])) aEnd--;
+
+	std::string_view value(aStart, aEnd - aStart);
+	if (value == "true" || value == "1")
+		aValue = true;
+	else if (value == "false" || value == "0")
+		aValue = false;
+	else
+		return D_TBXML_VALUE_NOT_A_BOOLEAN;
+	return D_TBXML_SUCCESS;
+}
+
+// converts aValue, a view with a NULL data() standing for aMissing
+template<typename T> static T typedValue(std::string_view aValue, TBXMLErrorCodes aMissing, T aDefault, TBXMLErrorCodes* aErrorCode) {
+	T value = aDefault;
+	TBXMLErrorCodes code = aValue.data() ? convertValue(aValue.data(), aValue.data() + aValue.length(), value) : aMissing;
+	if (aErrorCode) *aErrorCode = code;
+	return code == D_TBXML_SUCCESS ? value : aDefault;
+}
+
+template<typename Name, typename T> static T typedAttribute(const Name &aName, const TBXMLElement* aXMLElement, T aDefault, TBXMLErrorCodes* aErrorCode) {
+	if (NULL == aXMLElement) return typedValue(std::string_view(), D_TBXML_ELEMENT_IS_NIL, aDefault, aErrorCode);
+	return typedValue(TBXML::valueOfAttributeNamed(aName, aXMLElement), D_TBXML_ATTRIBUTE_NOT_FOUND, aDefault, aErrorCode);
+}
+
+template<typename T> static T typedText(const TBXMLElement* aXMLElement, T aDefault, TBXMLErrorCodes* aErrorCode) {
+	if (NULL == aXMLElement) return typedValue(std::string_view(), D_TBXML_ELEMENT_IS_NIL, aDefault, aErrorCode);
+
+	// like textForElement with an error, empty text counts as missing
+	std::string_view text = TBXML::textForElement(aXMLElement);
+	if (text.empty()) text = std::string_view();
+	return typedValue(text, D_TBXML_ELEMENT_TEXT_IS_NIL, aDefault, aErrorCode);
+}
+
+// ================================================================================================
+// Attributes
+// ================================================================================================
+
+// the attributes of an element are contiguous, so lookups run over them as an array, comparing lengths
+// or ids before any bytes
+static inline const TBXMLAttribute* findAttribute(const TBXMLElement* aXMLElement, const char* aName, size_t aLength) {
+	const TBXMLAttribute * attribute = aXMLElement->firstAttribute;
+	const TBXMLAttribute * attributesEnd = attribute + aXMLElement->attributeCount;
+	for (; attribute < attributesEnd; attribute++) {
+		if (attribute->nameLength == aLength && memcmp(attribute->name, aName, aLength) == 0) return attribute;
+	}
+	return NULL;
+}
+
+static inline const TBXMLAttribute* findAttribute(const TBXMLElement* aXMLElement, const TBXMLName &aName) {
+	const TBXMLAttribute * attribute = aXMLElement->firstAttribute;
+	const TBXMLAttribute * attributesEnd = attribute + aXMLElement->attributeCount;
+	for (; attribute < attributesEnd; attribute++) {
+		if (aName.matches(attribute->nameId, attribute->name, attribute->nameLength)) return attribute;
+	}
+	return NULL;
+}
+
+// ================================================================================================
+// Parallel Parsing
+// ================================================================================================
+
+// elements at the top of a part that are siblings, or with first NULL an end tag closing an element of
+// an earlier part
+typedef struct _TBXMLParseRun {
+	TBXMLElement * first;
+	TBXMLElement * last;
+	TBXMLElement * parent;
+	bool closed;	// an element of the run closed within the part, which clears the text of the parent
+
+	_TBXMLParseRun() : first(NULL), last(NULL), parent(NULL), closed(false) {}
+} TBXMLParseRun;
+
+typedef struct _TBXMLParseChunk {
+	char * start;
+	char * end;
+	char * exit;				// first tag at or after end when scanning from start
+	char * terminator;			// the null terminator at start, written once the previous part is done
+	TBXMLElement * openElement;	// innermost element left open at end
+	std::vector<TBXMLParseRun> runs;
+	long depth;					// elements opened less elements closed, relative to the start
+	long maxDepth;				// of the deepest element relative to the start
+	bool namespaces;			// an attribute may declare a namespace or use the xml prefix
+	long outerDepth;			// elements open around the part when known, for the depth limit
+
+	_TBXMLParseChunk() : start(NULL), end(NULL), exit(NULL), terminator(NULL), openElement(NULL), depth(0), maxDepth(0), namespaces(false), outerDepth(0) {}
+} TBXMLParseChunk;
+
+// trims the whitespace around the text of an element once it is closed and measures it, decoding its
+// references when aDecode is set
+static void trimText(TBXMLElement* aXMLElement, bool aDecode) {
+	if (!aXMLElement->text) return;
+
+	char * textEnd = aXMLElement->text + strlen(aXMLElement->text);
+
+	// trim whitespace from start of text
+	aXMLElement->text = TBXMLScanner::skipWhitespace(aXMLElement->text,textEnd);
+	if (!aXMLElement->text) aXMLElement->text = textEnd;
+
+	// trim whitespace from end of text
+	char * end = textEnd-1;
+	while (end > aXMLElement->text && TBXMLScanner::isWhitespace(*end))
+		*end--=0;
+
+	aXMLElement->textLength = end+1-aXMLElement->text;
+
+	if (aDecode) decodeText(aXMLElement);
+}
+
+// the first '<' at or after aFrom that starts a tag, never a comment or cdata section, which can be
+// mistaken for a tag boundary only from within an attribute value, comment or cdata section
+static char* findTagBoundary(char* aFrom, char* aEnd) {
+	while ((aFrom = TBXMLScanner::findChar(aFrom, aEnd, '<'))) {
+		char c = aFrom+1 < aEnd ? aFrom[1] : 0;
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || c == '/' || c == '?')
+			return aFrom;
+		aFrom++;
+	}
+	return NULL;
+}
 
-	while (currentAttributeBuffer) {
-		if (currentAttributeBuffer->attributes)
-			free(currentAttributeBuffer->attributes);
+// steps over the tokens decodeBytes would visit from aStart without changing any byte, returning the
+// first tag start at or after aStop. aEnd is returned when decodeBytes would stop or runs off the end.
+static char* skipTokens(char* aStart, char* aStop, char* aEnd) {
+	TBXMLScanner scanner(aStart, aEnd);
+	char * chr = aStart;
 
-		if (currentAttributeBuffer->previous) {
-			currentAttributeBuffer = currentAttributeBuffer->previous;
-			free(currentAttributeBuffer->next);
+	while ((chr = scanner.find(TBXML_CLASS(TBXML_CHAR_LT),chr,aEnd))) {
+		if (chr >= aStop) return chr;
+
+		char * tokenEnd;
+		if (strncmp(chr,"<!--",4) == 0) {
+			tokenEnd = scanner.findString(TBXML_CHAR_DASH,"-->",chr,aEnd);
+		} else if (strncmp(chr,"<![CDATA[",9) == 0) {
+			tokenEnd = scanner.findString(TBXML_CHAR_RBRACKET,"]]>",chr,aEnd);
 		} else {
-			free(currentAttributeBuffer);
-			currentAttributeBuffer = 0;
+			// tag end, skipping any cdata sections within attributes
+			tokenEnd = chr+1;
+			while ((tokenEnd = scanner.find(TBXML_CLASS(TBXML_CHAR_LT)|TBXML_CLASS(TBXML_CHAR_GT),tokenEnd,aEnd))) {
+				if (strncmp(tokenEnd,"<![CDATA[",9) != 0) break;
+				if (!(tokenEnd = scanner.findString(TBXML_CHAR_RBRACKET,"]]>",tokenEnd,aEnd))) break;
+				tokenEnd += 3;
+			}
+			if (!tokenEnd) return aEnd;
+			chr = tokenEnd+1;
+			continue;
+		}
+		if (!tokenEnd) return aEnd;
+		chr = tokenEnd+3;
+	}
+	return aEnd;
+}
+
+// steps over the content and end tag of an element whose start tag ends before aFrom, counting the tags
+// within it instead of decoding them. Returns the byte after its end tag, NULL when the document ends
+// first. aEndTag is set to the start of the end tag, aNested once a child of the element has an end tag.
+static char* skipElement(char* aFrom, char* aEnd, char** aEndTag = NULL, bool* aNested = NULL) {
+	size_t depth = 1;
+	char * chr = aFrom;
+
+	// only tags count, so the single character scanner runs from one '<' to the next without
+	// classifying the bytes in between
+	while ((chr = TBXMLScanner::findChar(chr,aEnd,'<'))) {
+		char * tokenEnd;
+		if (chr[1] == '!') {
+			if (strncmp(chr,"<!--",4) == 0) {
+				if (!(tokenEnd = TBXMLScanner::findString(chr,aEnd,"-->"))) return NULL;
+				chr = tokenEnd+3;
+				continue;
+			}
+			if (strncmp(chr,"<![CDATA[",9) == 0) {
+				if (!(tokenEnd = TBXMLScanner::findString(chr,aEnd,"]]>"))) return NULL;
+				chr = tokenEnd+3;
+				continue;
+			}
+		}
+
+		// tag end, skipping any cdata sections within attributes like decodeBytes
+		if (!(tokenEnd = TBXMLScanner::findChar(chr+1,aEnd,'>'))) return NULL;
+		for (char * section = chr+1; (section = TBXMLScanner::findChar(section,tokenEnd,'<')); ) {
+			if (strncmp(section,"<![CDATA[",9) == 0) {
+				if (!(section = TBXMLScanner::findString(section,aEnd,"]]>"))) return NULL;
+				if (!(tokenEnd = TBXMLScanner::findChar(section+3,aEnd,'>'))) return NULL;
+				section += 3;
+			} else {
+				// an unterminated tag ends where the next one starts
+				tokenEnd = section;
+				break;
+			}
+		}
+
+		if (chr[1] == '/') {
+			if (--depth == 0) {
+				if (aEndTag) *aEndTag = chr;
+				return tokenEnd+1;
+			}
+		} else if (chr[1] != '?' && chr[1] != '!' && tokenEnd[-1] != '/') {
+			if (depth++ == 1 && aNested) *aNested = true;
 		}
+		chr = tokenEnd+1;
 	}
+	return NULL;
+}
+
+// calls aWork(i) for every i below aCount, i = 0 on the calling thread
+template<typename Work> static void runInParallel(size_t aCount, Work aWork) {
+	std::vector<std::thread> threads;
+	threads.reserve(aCount);
+	for (size_t i=1; i < aCount; i++) threads.emplace_back(aWork, i);
+	aWork((size_t)0);
+	for (std::thread &thread : threads) thread.join();
+}
+
+// ================================================================================================
+// Namespaces
+// ================================================================================================
+
+// xmlns and xmlns:prefix attributes declare namespaces
+static inline bool isNamespaceDeclaration(const char* aName, size_t aLength) {
+	return aLength >= 5 && memcmp(aName, "xmlns", 5) == 0 && (aLength == 5 || aName[5] == ':');
+}
+
+// an attribute that may declare a namespace or use the xml prefix
+static inline bool isNamespaceAttribute(const char* aName, size_t aLength) {
+	return aLength > 3 && memcmp(aName, "xml", 3) == 0;
+}
+
+// the local part is the whole name or follows the prefix and its colon
+static inline std::string_view localPart(const char* aName, size_t aLength) {
+	const char * colon = (const char*)memchr(aName, ':', aLength);
+	if (!colon) return std::string_view(aName, aLength);
+	return std::string_view(colon+1, aLength-(colon+1-aName));
+}
+
+// the part after the prefix as localName gives it, so a qualified name never matches
+static inline bool matchesLocalName(const char* aName, size_t aLength, std::string_view aLocalName) {
+	return localPart(aName, aLength) == aLocalName;
+}
+
+// leaves the scope of the declarations of an element
+static inline void closeNamespaces(const TBXMLElement* aXMLElement, std::vector<TBXMLNamespaceBinding> &aScope) {
+	while (!aScope.empty() && aScope.back().element == aXMLElement) aScope.pop_back();
+}
+
+// ================================================================================================
+// Parse Statistics
+// ================================================================================================
+
+static inline uint64_t steadyNanoseconds() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXML::~TBXML() {
+	this->releaseBytes();
+	this->releaseBuffers();
+	delete namespaces;
 }
 
 TBXML::TBXML() {
 	rootXMLElement = NULL;
 
+	firstElementBuffer = 0;
+	firstAttributeBuffer = 0;
 	currentElementBuffer = 0;
 	currentAttributeBuffer = 0;
+	firstArenaBuffer = 0;
+	currentArenaBuffer = 0;
 
 	currentElement = 0;
 	currentAttribute = 0;
 
+	elementCapacityHint = 0;
+	attributeCapacityHint = 0;
+	allocations = 0;
+	memset(&parseStatistics, 0, sizeof(parseStatistics));
+
+	symbols = NULL;
+	childIndexThreshold = 0;
+	childIndices = NULL;
+	parseThreads = 1;
+	entities = D_TBXML_ENTITIES_NONE;
+
+	memset(&parseLimits, 0, sizeof(parseLimits));
+	elementBudget = SIZE_MAX;
+	parseError = D_TBXML_SUCCESS;
+
+	namespaceAware = false;
+	namespaces = NULL;
+
+	parseProjection = NULL;
+
+	lazyLevels = 0;
+	documentOrder = true;
+
 	bytes = 0;
 	bytesLength = 0;
+	bytesCapacity = 0;
+	bytesMappedLength = 0;
+}
+
+TBXML::TBXML(TBXML &&aOther) : TBXML() {
+	this->takeMembers(aOther);
+}
+
+TBXML& TBXML::operator=(TBXML &&aOther) {
+	if (this != &aOther) {
+		this->releaseBytes();
+		this->releaseBuffers();
+		this->takeMembers(aOther);
+	}
+	return *this;
+}
+
+void TBXML::setCapacityHint(size_t aElementCount, size_t aAttributeCount) {
+	elementCapacityHint = aElementCount;
+	attributeCapacityHint = aAttributeCount;
+}
+
+size_t TBXML::allocationCount() const {
+	return allocations;
+}
+
+const TBXMLParseStats& TBXML::parseStats() const {
+	return parseStatistics;
+}
+
+void TBXML::setSymbolTable(TBXMLSymbolTable *aSymbolTable) {
+	symbols = aSymbolTable;
+}
+
+TBXMLSymbolTable* TBXML::symbolTable() const {
+	return symbols;
+}
+
+void TBXML::reset() {
+	rootXMLElement = NULL;
+
+	// rewind to the first buffers, slots are initialised again as they are handed out
+	currentElementBuffer = firstElementBuffer;
+	currentAttributeBuffer = firstAttributeBuffer;
+
+	currentElement = -1;
+	currentAttribute = -1;
+	for (TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) buffer->length = 0;
+
+	currentArenaBuffer = firstArenaBuffer;
+	if (currentArenaBuffer) currentArenaBuffer->used = 0;
+	childIndices = NULL;
+
+	memset(&parseStatistics, 0, sizeof(parseStatistics));
+
+	elementBudget = parseLimits.maxElements ? parseLimits.maxElements : SIZE_MAX;
+	parseError = D_TBXML_SUCCESS;
+
+	// namespace ids belong to one document
+	if (namespaces) namespaces->clear();
+	this->releaseNamespaceIds();
+	unexpanded.clear();
+	documentOrder = true;
+
+	// a mapping belongs to one file, a heap buffer is kept for the next document
+	if (bytesMappedLength) this->releaseBytes();
+	bytesLength = 0;
 }
 
 bool TBXML::initWithXMLString(std::string &aXMLString, std::string &error) {
+	this->reset();
+
+	if (parseLimits.maxBytes && aXMLString.length() > parseLimits.maxBytes) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_LIMIT_BYTES));
+		return false;
+	}
+
 	// allocate memory for byte array
-	strcpy(bytes, aXMLString.c_str());
+	this->allocateBytesOfLength(aXMLString.length(), error);
+	if (!bytes) return false;
+	memcpy(bytes, aXMLString.c_str(), bytesLength);
 
 	// set null terminator at end of byte array
-	bytesLength = aXMLString.length();
     bytes[bytesLength] = 0;
 
     // decode xml data
     this->decodeBytes();
+    if (parseError != D_TBXML_SUCCESS) {
+    	error.clear();
+    	error.append(TBXML::errorWithCode(parseError));
+    }
     if (error.length() > 0) {
     	return false;
     }
@@ -99,28 +683,238 @@ bool TBXML::initWithXMLString(std::string &aXMLString, std::string &error) {
 }
 
 bool TBXML::initWithXMLFile(std::string &aXMLFile, std::string &error) {
+	return this->initWithXMLFile(aXMLFile, D_TBXML_LOAD_READ, error);
+}
+
+bool TBXML::initWithXMLFile(std::string &aXMLFile, TBXMLLoadMode aLoadMode, std::string &error) {
+	this->reset();
+
+	int rev = D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+#ifdef TBXML_HAS_MMAP
+	if (aLoadMode == D_TBXML_LOAD_MMAP)
+		rev = this->mapBytesOfFile(aXMLFile, error);
+	else
+#endif
+		rev = this->readBytesOfFile(aXMLFile, error);
+
+	if (rev != D_TBXML_SUCCESS) {
+		if (error.length() == 0) error.append(TBXML::errorWithCode(rev));
+		return false;
+	}
+
+	// decode xml data
+	this->decodeBytes();
+	if (parseError != D_TBXML_SUCCESS) {
+		error.clear();
+		error.append(TBXML::errorWithCode(parseError));
+	}
+	if (error.length() > 0) {
+		return false;
+	}
+	return true;
+}
+
+int TBXML::readBytesOfFile(std::string &aXMLFile, std::string &error) {
 	ifstream file (aXMLFile.c_str(), ios::in|ios::binary|ios::ate);
-	if (file.is_open())
-	{
-	    file.seekg(0, ios::end);
-	    int size = file.tellg();
-	    bytes = new char [size+1];
-	    file.seekg (0, ios::beg);
-	    file.read (bytes, size);
-	    file.close();
+	if (!file.is_open()) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+	// tellg returns a 64 bit streamoff, keep it that way so files over 2GB load
+	streamoff size = file.tellg();
+	if (size < 0) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+	if (parseLimits.maxBytes && (size_t)size > parseLimits.maxBytes) return D_TBXML_LIMIT_BYTES;
+
+	int rev = this->allocateBytesOfLength((size_t)size, error);
+	if (rev != D_TBXML_SUCCESS) return rev;
+
+	file.seekg (0, ios::beg);
+	file.read (bytes, size);
+	if (file.gcount() != size) return D_TBXML_DECODE_FAILURE;
+
+	// set null terminator at end of byte array
+	bytes[bytesLength] = 0;
+	return D_TBXML_SUCCESS;
+}
+
+#ifdef TBXML_HAS_MMAP
+int TBXML::mapBytesOfFile(std::string &aXMLFile, std::string &error) {
+	this->releaseBytes();
 
-		return true;
+	int fd = open(aXMLFile.c_str(), O_RDONLY);
+	if (fd < 0) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+		close(fd);
+		return D_TBXML_DATA_NIL;
+	}
+
+	size_t size = (size_t)fileStat.st_size;
+	if (parseLimits.maxBytes && size > parseLimits.maxBytes) {
+		close(fd);
+		return D_TBXML_LIMIT_BYTES;
+	}
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+	// reserve room for the file plus the null terminator, rounded up to whole pages. The file is then
+	// mapped over the start of this region; when the file ends exactly on a page boundary the terminator
+	// falls into the zero filled anonymous page behind it, otherwise into the zero filled tail of the
+	// last file page.
+	size_t mappedLength = (size + 1 + pageSize - 1) / pageSize * pageSize;
+	void * region = mmap(NULL, mappedLength, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANON, -1, 0);
+	if (region == MAP_FAILED) {
+		close(fd);
+		return D_TBXML_MEMORY_ALLOC_FAILURE;
+	}
+
+	// private copy-on-write mapping, only the pages decodeBytes writes to get copied
+	void * mapped = mmap(region, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		munmap(region, mappedLength);
+		return D_TBXML_MEMORY_ALLOC_FAILURE;
+	}
+
+	madvise(region, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	madvise(region, mappedLength, MADV_HUGEPAGE);
+#endif
+
+	bytes = (char*)region;
+	bytesLength = size;
+	bytesMappedLength = mappedLength;
+
+	error.clear();
+	return D_TBXML_SUCCESS;
+}
+#endif
+
+void TBXML::releaseBytes() {
+	if (!bytes) return;
+
+#ifdef TBXML_HAS_MMAP
+	if (bytesMappedLength) {
+		munmap(bytes, bytesMappedLength);
+	} else
+#endif
+		free(bytes);
+
+	bytes = NULL;
+	bytesLength = 0;
+	bytesCapacity = 0;
+	bytesMappedLength = 0;
+}
+
+void TBXML::releaseBuffers() {
+	// each buffer shares one allocation with its elements/attributes, not with their namespace ids
+	this->releaseNamespaceIds();
+	while (firstElementBuffer) {
+		TBXMLElementBuffer * next = firstElementBuffer->next;
+		free(firstElementBuffer);
+		firstElementBuffer = next;
+	}
+
+	while (firstAttributeBuffer) {
+		TBXMLAttributeBuffer * next = firstAttributeBuffer->next;
+		free(firstAttributeBuffer);
+		firstAttributeBuffer = next;
 	}
-	else {
-		bytes = NULL;
-	    error.clear();
-	    error.append(TBXML::errorWithCode(D_TBXML_FILE_NOT_FOUND_IN_BUNDLE));
 
-	    return false;
+	while (firstArenaBuffer) {
+		TBXMLArenaBuffer * next = firstArenaBuffer->next;
+		free(firstArenaBuffer);
+		firstArenaBuffer = next;
 	}
+
+	currentElementBuffer = 0;
+	currentAttributeBuffer = 0;
+	currentArenaBuffer = 0;
+	currentElement = 0;
+	currentAttribute = 0;
+	childIndices = NULL;
+	rootXMLElement = NULL;
+}
+
+void TBXML::takeMembers(TBXML &aOther) {
+	rootXMLElement = aOther.rootXMLElement;
+	firstElementBuffer = aOther.firstElementBuffer;
+	firstAttributeBuffer = aOther.firstAttributeBuffer;
+	currentElementBuffer = aOther.currentElementBuffer;
+	currentAttributeBuffer = aOther.currentAttributeBuffer;
+	firstArenaBuffer = aOther.firstArenaBuffer;
+	currentArenaBuffer = aOther.currentArenaBuffer;
+	currentElement = aOther.currentElement;
+	currentAttribute = aOther.currentAttribute;
+	elementCapacityHint = aOther.elementCapacityHint;
+	attributeCapacityHint = aOther.attributeCapacityHint;
+	allocations = aOther.allocations;
+	parseStatistics = aOther.parseStatistics;
+	symbols = aOther.symbols;
+	childIndexThreshold = aOther.childIndexThreshold;
+	childIndices = aOther.childIndices;
+	parseThreads = aOther.parseThreads;
+	entities = aOther.entities;
+	parseLimits = aOther.parseLimits;
+	elementBudget = aOther.elementBudget;
+	parseError = aOther.parseError;
+	namespaceAware = aOther.namespaceAware;
+	parseProjection = aOther.parseProjection;
+	lazyLevels = aOther.lazyLevels;
+	unexpanded = std::move(aOther.unexpanded);
+	documentOrder = aOther.documentOrder;
+	bytes = aOther.bytes;
+	bytesLength = aOther.bytesLength;
+	bytesCapacity = aOther.bytesCapacity;
+	bytesMappedLength = aOther.bytesMappedLength;
+
+	// the other document gets this one's namespace table, if any, to release
+	std::swap(namespaces, aOther.namespaces);
+
+	// leave the other document empty so its destructor releases nothing
+	aOther.rootXMLElement = NULL;
+	aOther.unexpanded.clear();
+	aOther.firstElementBuffer = 0;
+	aOther.firstAttributeBuffer = 0;
+	aOther.currentElementBuffer = 0;
+	aOther.currentAttributeBuffer = 0;
+	aOther.firstArenaBuffer = 0;
+	aOther.currentArenaBuffer = 0;
+	aOther.childIndices = NULL;
+	aOther.currentElement = 0;
+	aOther.currentAttribute = 0;
+	aOther.allocations = 0;
+	aOther.bytes = 0;
+	aOther.bytesLength = 0;
+	aOther.bytesCapacity = 0;
+	aOther.bytesMappedLength = 0;
+}
+
+size_t TBXML::elementCount() const {
+	// buffers before the current one may be partly used after a parallel parse, those after it are
+	// left from a previous document and hand out none
+	size_t count = 0;
+	for (TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) count += buffer->length;
+	return count;
 }
 
-int TBXML::allocateBytesOfLength(long length, std::string &error) {
+size_t TBXML::attributeCount() const {
+	// attributes moved along with their element leave gaps in the buffers, the elements know their own
+	size_t count = 0;
+	for (const TBXMLElement * xmlElement : this->elements()) count += xmlElement->attributeCount;
+	return count;
+}
+
+int TBXML::allocateBytesOfLength(size_t length, std::string &error) {
+	// reuse the heap buffer of a previous document when it is large enough
+	if (bytesMappedLength || bytesCapacity < length+1) {
+		this->releaseBytes();
+		bytes = (char*)malloc(length+1);
+		if (bytes) bytesCapacity = length+1;
+		allocations++;
+		TBXML_STAT(parseStatistics.bytesAllocated += length+1);
+	}
+
     bytesLength = length;
 
     int rev = D_TBXML_SUCCESS;
@@ -129,10 +923,10 @@ int TBXML::allocateBytesOfLength(long length, std::string &error) {
         localError = TBXML::errorWithCode(D_TBXML_DATA_NIL);
     }
 
-	bytes = (char*)malloc(bytesLength+1);
-
     if(!bytes) {
-    	localError = TBXML::errorWithCode(D_TBXML_DATA_NIL);
+    	bytesLength = 0;
+    	rev = D_TBXML_MEMORY_ALLOC_FAILURE;
+    	localError = TBXML::errorWithCode(D_TBXML_MEMORY_ALLOC_FAILURE);
     }
 
     error.clear();
@@ -141,7 +935,7 @@ int TBXML::allocateBytesOfLength(long length, std::string &error) {
     return rev;
 }
 
-char* TBXML::mallocateBytesOfLength(long length, std::string &error) {
+char* TBXML::mallocateBytesOfLength(size_t length, std::string &error) {
 	if (this->allocateBytesOfLength(length, error) == D_TBXML_SUCCESS) {
 		return bytes;
 	}
@@ -150,7 +944,7 @@ char* TBXML::mallocateBytesOfLength(long length, std::string &error) {
 
 std::string TBXML::elementName(TBXMLElement* aXMLElement) {
 	if (NULL == aXMLElement->name) return "";
-	std::string rev(aXMLElement->name);
+	std::string rev(aXMLElement->name, aXMLElement->nameLength);
 	return rev;
 }
 
@@ -163,19 +957,19 @@ std::string TBXML::elementName(TBXMLElement* aXMLElement, std::string &error) {
     }
     
     // check for nil element name
-    if (NULL == aXMLElement->name || strlen(aXMLElement->name) == 0) {
+    if (NULL == aXMLElement->name || aXMLElement->nameLength == 0) {
     	error.clear();
     	error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_NAME_IS_NIL));
         return "";
     }
     
-	std::string rev(aXMLElement->name);
+	std::string rev(aXMLElement->name, aXMLElement->nameLength);
 	return rev;
 }
 
 std::string TBXML::attributeName(TBXMLAttribute* aXMLAttribute) {
 	if (NULL == aXMLAttribute->name) return "";
-	std::string rev(aXMLAttribute->name);
+	std::string rev(aXMLAttribute->name, aXMLAttribute->nameLength);
 	return rev;
 }
 
@@ -194,14 +988,14 @@ std::string TBXML::attributeName(TBXMLAttribute* aXMLAttribute, std::string &err
         return "";
     }
     
-	std::string rev(aXMLAttribute->name);
+	std::string rev(aXMLAttribute->name, aXMLAttribute->nameLength);
 	return rev;
 }
 
 
 std::string TBXML::attributeValue(TBXMLAttribute* aXMLAttribute) {
 	if (NULL == aXMLAttribute->value) return "";
-	std::string rev(aXMLAttribute->value);
+	std::string rev(aXMLAttribute->value, aXMLAttribute->valueLength);
 	return rev;
 }
 
@@ -213,14 +1007,14 @@ std::string TBXML::attributeValue(TBXMLAttribute* aXMLAttribute, std::string &er
         return "";
     }
 
-	std::string rev(aXMLAttribute->value);
+	std::string rev(aXMLAttribute->value, aXMLAttribute->valueLength);
 	return rev;
 }
 
 std::string TBXML::textForElement(TBXMLElement* aXMLElement) {
 	if (NULL == aXMLElement->text) return "";
 
-	std::string rev(aXMLElement->text);
+	std::string rev(aXMLElement->text, aXMLElement->textLength);
 	return rev;
 }
 
@@ -233,30 +1027,23 @@ std::string TBXML::textForElement(TBXMLElement* aXMLElement, std::string &error)
     }
     
     // check for nil text value
-    if (NULL == aXMLElement->text || strlen(aXMLElement->text) == 0) {
+    if (NULL == aXMLElement->text || aXMLElement->textLength == 0) {
     	error.clear();
     	error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_TEXT_IS_NIL));
         return "";
     }
 
-	std::string rev(aXMLElement->text);
+	std::string rev(aXMLElement->text, aXMLElement->textLength);
 	return rev;
 }
 
 std::string TBXML::valueOfAttributeNamed(std::string &aName, TBXMLElement* aXMLElement) {
-	const char* name = aName.c_str();
-	char* value;
-	TBXMLAttribute * attribute = aXMLElement->firstAttribute;
-	while (attribute) {
-		if (strlen(attribute->name) == strlen(name) && memcmp(attribute->name,name,strlen(name)) == 0) {
-			value = attribute->value;
-			break;
-		}
-		attribute = attribute->next;
+	const TBXMLAttribute * attribute = findAttribute(aXMLElement, aName.c_str(), aName.length());
+	if (attribute) {
+		std::string rev(attribute->value, attribute->valueLength);
+		return rev;
 	}
-
-	std::string rev(value);
-	return rev;
+	return "";
 }
 
 std::string TBXML::valueOfAttributeNamed(std::string &aName, TBXMLElement* aXMLElement, std::string &error) {
@@ -274,38 +1061,26 @@ std::string TBXML::valueOfAttributeNamed(std::string &aName, TBXMLElement* aXMLE
         return "";
     }
     
-    const char* name = aName.c_str();
-    char* value;
-    
-	TBXMLAttribute * attribute = aXMLElement->firstAttribute;
-	while (attribute) {
-		if (strlen(attribute->name) == strlen(name) && memcmp(attribute->name,name,strlen(name)) == 0) {
-            if (attribute->value)
-    			value = attribute->value;
-            else
-                value = (char*)"";
-            
-			break;
-		}
-		attribute = attribute->next;
-	}
+	const TBXMLAttribute * attribute = findAttribute(aXMLElement, aName.c_str(), aName.length());
     
     // check for attribute not found
-    if (!value) {
+    if (!attribute) {
     	error.clear();
     	error.append(TBXML::errorWithCode(D_TBXML_ATTRIBUTE_NOT_FOUND));
         return "";
     }
 
-	std::string rev(value);
+	if (NULL == attribute->value) return "";
+	std::string rev(attribute->value, attribute->valueLength);
 	return rev;
 }
 
 TBXMLElement* TBXML::childElementNamed(std::string &aName, TBXMLElement* aParentXMLElement) {
 	TBXMLElement * xmlElement = aParentXMLElement->firstChild;
 	const char * name = aName.c_str();
+	size_t length = aName.length();
 	while (xmlElement) {
-		if (strlen(xmlElement->name) == strlen(name) && memcmp(xmlElement->name,name,strlen(name)) == 0) {
+		if (xmlElement->nameLength == length && memcmp(xmlElement->name,name,length) == 0) {
 			return xmlElement;
 		}
 		xmlElement = xmlElement->nextSibling;
@@ -330,8 +1105,9 @@ TBXMLElement* TBXML::childElementNamed(std::string &aName, TBXMLElement* aParent
     
 	TBXMLElement * xmlElement = aParentXMLElement->firstChild;
 	const char * name = aName.c_str();
+	size_t length = aName.length();
 	while (xmlElement) {
-		if (strlen(xmlElement->name) == strlen(name) && memcmp(xmlElement->name,name,strlen(name)) == 0) {
+		if (xmlElement->nameLength == length && memcmp(xmlElement->name,name,length) == 0) {
 			return xmlElement;
 		}
 		xmlElement = xmlElement->nextSibling;
@@ -345,8 +1121,9 @@ TBXMLElement* TBXML::childElementNamed(std::string &aName, TBXMLElement* aParent
 TBXMLElement* TBXML::nextSiblingNamed(std::string &aName, TBXMLElement* aXMLElement) {
 	TBXMLElement * xmlElement = aXMLElement->nextSibling;
 	const char * name = aName.c_str();
+	size_t length = aName.length();
 	while (xmlElement) {
-		if (strlen(xmlElement->name) == strlen(name) && memcmp(xmlElement->name,name,strlen(name)) == 0) {
+		if (xmlElement->nameLength == length && memcmp(xmlElement->name,name,length) == 0) {
 			return xmlElement;
 		}
 		xmlElement = xmlElement->nextSibling;
@@ -371,8 +1148,9 @@ TBXMLElement* TBXML::nextSiblingNamed(std::string &aName, TBXMLElement* aXMLElem
     
 	TBXMLElement * xmlElement = aXMLElement->nextSibling;
 	const char * name = aName.c_str();
+	size_t length = aName.length();
 	while (xmlElement) {
-		if (strlen(xmlElement->name) == strlen(name) && memcmp(xmlElement->name,name,strlen(name)) == 0) {
+		if (xmlElement->nameLength == length && memcmp(xmlElement->name,name,length) == 0) {
 			return xmlElement;
 		}
 		xmlElement = xmlElement->nextSibling;
@@ -383,12 +1161,422 @@ TBXMLElement* TBXML::nextSiblingNamed(std::string &aName, TBXMLElement* aXMLElem
 	return NULL;
 }
 
-std::string TBXML::errorWithCode(int code) {
-    std::string codeText = "";
-    
-    switch (code) {
-        case D_TBXML_DATA_NIL:                  codeText = "Data is nil";                          break;
-        case D_TBXML_DECODE_FAILURE:            codeText = "Decode failure";                       break;
+std::string_view TBXML::elementName(const TBXMLElement* aXMLElement) {
+	if (NULL == aXMLElement->name) return std::string_view();
+	return std::string_view(aXMLElement->name, aXMLElement->nameLength);
+}
+
+std::string_view TBXML::textForElement(const TBXMLElement* aXMLElement) {
+	if (NULL == aXMLElement->text) return std::string_view();
+	return std::string_view(aXMLElement->text, aXMLElement->textLength);
+}
+
+std::string_view TBXML::valueOfAttributeNamed(std::string_view aName, const TBXMLElement* aXMLElement) {
+	const TBXMLAttribute * attribute = findAttribute(aXMLElement, aName.data(), aName.length());
+	if (attribute) return std::string_view(attribute->value, attribute->valueLength);
+	return std::string_view();
+}
+
+std::string_view TBXML::attributeName(const TBXMLAttribute* aXMLAttribute) {
+	if (NULL == aXMLAttribute->name) return std::string_view();
+	return std::string_view(aXMLAttribute->name, aXMLAttribute->nameLength);
+}
+
+std::string_view TBXML::attributeValue(const TBXMLAttribute* aXMLAttribute) {
+	if (NULL == aXMLAttribute->value) return std::string_view();
+	return std::string_view(aXMLAttribute->value, aXMLAttribute->valueLength);
+}
+
+const TBXMLElement* TBXML::childElementNamed(std::string_view aName, const TBXMLElement* aParentXMLElement) {
+	const TBXMLElement * xmlElement = aParentXMLElement->firstChild;
+	while (xmlElement) {
+		if (xmlElement->nameLength == aName.length() && memcmp(xmlElement->name,aName.data(),aName.length()) == 0) {
+			return xmlElement;
+		}
+		xmlElement = xmlElement->nextSibling;
+	}
+	return NULL;
+}
+
+const TBXMLElement* TBXML::nextSiblingNamed(std::string_view aName, const TBXMLElement* aXMLElement) {
+	const TBXMLElement * xmlElement = aXMLElement->nextSibling;
+	while (xmlElement) {
+		if (xmlElement->nameLength == aName.length() && memcmp(xmlElement->name,aName.data(),aName.length()) == 0) {
+			return xmlElement;
+		}
+		xmlElement = xmlElement->nextSibling;
+	}
+	return NULL;
+}
+
+std::string_view TBXML::valueOfAttributeNamed(const TBXMLName &aName, const TBXMLElement* aXMLElement) {
+	const TBXMLAttribute * attribute = findAttribute(aXMLElement, aName);
+	if (attribute) return std::string_view(attribute->value, attribute->valueLength);
+	return std::string_view();
+}
+
+const TBXMLElement* TBXML::childElementNamed(const TBXMLName &aName, const TBXMLElement* aParentXMLElement) {
+	const TBXMLElement * xmlElement = aParentXMLElement->firstChild;
+	while (xmlElement) {
+		if (aName.matches(xmlElement->nameId, xmlElement->name, xmlElement->nameLength)) {
+			return xmlElement;
+		}
+		xmlElement = xmlElement->nextSibling;
+	}
+	return NULL;
+}
+
+const TBXMLElement* TBXML::nextSiblingNamed(const TBXMLName &aName, const TBXMLElement* aXMLElement) {
+	const TBXMLElement * xmlElement = aXMLElement->nextSibling;
+	while (xmlElement) {
+		if (aName.matches(xmlElement->nameId, xmlElement->name, xmlElement->nameLength)) {
+			return xmlElement;
+		}
+		xmlElement = xmlElement->nextSibling;
+	}
+	return NULL;
+}
+
+int TBXML::intAttribute(std::string_view aName, const TBXMLElement* aXMLElement, int aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+int64_t TBXML::int64Attribute(std::string_view aName, const TBXMLElement* aXMLElement, int64_t aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+double TBXML::doubleAttribute(std::string_view aName, const TBXMLElement* aXMLElement, double aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+bool TBXML::boolAttribute(std::string_view aName, const TBXMLElement* aXMLElement, bool aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+int TBXML::intAttribute(const TBXMLName &aName, const TBXMLElement* aXMLElement, int aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+int64_t TBXML::int64Attribute(const TBXMLName &aName, const TBXMLElement* aXMLElement, int64_t aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+double TBXML::doubleAttribute(const TBXMLName &aName, const TBXMLElement* aXMLElement, double aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+bool TBXML::boolAttribute(const TBXMLName &aName, const TBXMLElement* aXMLElement, bool aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedAttribute(aName, aXMLElement, aDefault, aErrorCode);
+}
+
+int TBXML::intText(const TBXMLElement* aXMLElement, int aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedText(aXMLElement, aDefault, aErrorCode);
+}
+
+int64_t TBXML::int64Text(const TBXMLElement* aXMLElement, int64_t aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedText(aXMLElement, aDefault, aErrorCode);
+}
+
+double TBXML::doubleText(const TBXMLElement* aXMLElement, double aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedText(aXMLElement, aDefault, aErrorCode);
+}
+
+bool TBXML::boolText(const TBXMLElement* aXMLElement, bool aDefault, TBXMLErrorCodes* aErrorCode) {
+	return typedText(aXMLElement, aDefault, aErrorCode);
+}
+
+void TBXML::setChildIndexThreshold(size_t aChildCount) {
+	childIndexThreshold = aChildCount;
+}
+
+void TBXML::setParseThreadCount(size_t aThreadCount) {
+	parseThreads = aThreadCount ? aThreadCount : 1;
+}
+
+size_t TBXML::parseThreadCount() const {
+	return parseThreads;
+}
+
+void TBXML::setEntityMode(TBXMLEntityMode aEntityMode) {
+	entities = aEntityMode;
+}
+
+TBXMLEntityMode TBXML::entityMode() const {
+	return entities;
+}
+
+void TBXML::setLimits(const TBXMLLimits &aLimits) {
+	parseLimits = aLimits;
+	elementBudget = parseLimits.maxElements ? parseLimits.maxElements : SIZE_MAX;
+}
+
+const TBXMLLimits& TBXML::limits() const {
+	return parseLimits;
+}
+
+void TBXML::setNamespaceAware(bool aNamespaceAware) {
+	namespaceAware = aNamespaceAware;
+}
+
+bool TBXML::isNamespaceAware() const {
+	return namespaceAware;
+}
+
+void TBXML::setProjection(const TBXMLProjection *aProjection) {
+	parseProjection = aProjection;
+}
+
+const TBXMLProjection* TBXML::projection() const {
+	return parseProjection;
+}
+
+void TBXML::setLazyDepth(size_t aDepth) {
+	lazyLevels = aDepth;
+}
+
+size_t TBXML::lazyDepth() const {
+	return lazyLevels;
+}
+
+const TBXMLElement* TBXML::firstChild(const TBXMLElement* aXMLElement) {
+	if (loadFlags(&aXMLElement->flags) & TBXML_FLAG_UNEXPANDED) {
+		std::lock_guard<std::mutex> lock(arenaLock);
+		if (aXMLElement->flags & TBXML_FLAG_UNEXPANDED) this->expandElement(const_cast<TBXMLElement*>(aXMLElement));
+	}
+	return aXMLElement->firstChild;
+}
+
+bool TBXML::expand(const TBXMLElement* aXMLElement, std::string &error) {
+	error.clear();
+	if (!(loadFlags(&aXMLElement->flags) & TBXML_FLAG_UNEXPANDED)) return true;
+
+	std::lock_guard<std::mutex> lock(arenaLock);
+	if (!(aXMLElement->flags & TBXML_FLAG_UNEXPANDED)) return true;
+	TBXMLErrorCodes code = this->expandElement(const_cast<TBXMLElement*>(aXMLElement));
+	if (code != D_TBXML_SUCCESS) error.append(TBXML::errorWithCode(code));
+	return code == D_TBXML_SUCCESS;
+}
+
+bool TBXML::expandAll(std::string &error) {
+	error.clear();
+
+	// expansions add the elements they leave unexpanded, so the first one left is taken until none is
+	std::lock_guard<std::mutex> lock(arenaLock);
+	while (!unexpanded.empty()) {
+		TBXMLErrorCodes code = this->expandElement(const_cast<TBXMLElement*>(unexpanded.begin()->first));
+		if (code != D_TBXML_SUCCESS && error.empty()) error.append(TBXML::errorWithCode(code));
+	}
+	return error.empty();
+}
+
+uint32_t TBXML::namespaceId(std::string_view aNamespaceURI) const {
+	if (!namespaces || aNamespaceURI.empty()) return TBXML_NAME_NONE;
+	return namespaces->lookup(aNamespaceURI);
+}
+
+std::string_view TBXML::namespaceURI(uint32_t aNamespaceId) const {
+	if (!namespaces) return std::string_view();
+	return namespaces->nameForId(aNamespaceId);
+}
+
+uint32_t TBXML::namespaceId(const TBXMLElement* aXMLElement) const {
+	if (!namespaces || !aXMLElement) return TBXML_NAME_NONE;
+	for (const TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) {
+		if (aXMLElement >= buffer->elements && aXMLElement < buffer->elements + buffer->capacity)
+			return buffer->namespaceIds ? buffer->namespaceIds[aXMLElement - buffer->elements] : TBXML_NAME_NONE;
+	}
+	return TBXML_NAME_NONE;
+}
+
+uint32_t TBXML::namespaceId(const TBXMLAttribute* aXMLAttribute) const {
+	if (!namespaces || !aXMLAttribute) return TBXML_NAME_NONE;
+	for (const TBXMLAttributeBuffer * buffer = firstAttributeBuffer; buffer; buffer = buffer->next) {
+		if (aXMLAttribute >= buffer->attributes && aXMLAttribute < buffer->attributes + buffer->capacity)
+			return buffer->namespaceIds ? buffer->namespaceIds[aXMLAttribute - buffer->attributes] : TBXML_NAME_NONE;
+	}
+	return TBXML_NAME_NONE;
+}
+
+std::string_view TBXML::localName(const TBXMLElement* aXMLElement) {
+	if (!aXMLElement || !aXMLElement->name) return std::string_view();
+	return localPart(aXMLElement->name, aXMLElement->nameLength);
+}
+
+std::string_view TBXML::localName(const TBXMLAttribute* aXMLAttribute) {
+	if (!aXMLAttribute || !aXMLAttribute->name) return std::string_view();
+	return localPart(aXMLAttribute->name, aXMLAttribute->nameLength);
+}
+
+const TBXMLElement* TBXML::childElementNamedNS(std::string_view aNamespaceURI, std::string_view aLocalName, const TBXMLElement* aParentXMLElement) const {
+	uint32_t namespaceId = this->namespaceId(aNamespaceURI);
+	if (namespaceId == TBXML_NAME_NONE && !aNamespaceURI.empty()) return NULL;
+	return this->childElementNamedNS(namespaceId, aLocalName, aParentXMLElement);
+}
+
+const TBXMLElement* TBXML::nextSiblingNamedNS(std::string_view aNamespaceURI, std::string_view aLocalName, const TBXMLElement* aXMLElement) const {
+	uint32_t namespaceId = this->namespaceId(aNamespaceURI);
+	if (namespaceId == TBXML_NAME_NONE && !aNamespaceURI.empty()) return NULL;
+	return this->nextSiblingNamedNS(namespaceId, aLocalName, aXMLElement);
+}
+
+std::string_view TBXML::valueOfAttributeNamedNS(std::string_view aNamespaceURI, std::string_view aLocalName, const TBXMLElement* aXMLElement) const {
+	uint32_t namespaceId = this->namespaceId(aNamespaceURI);
+	if (namespaceId == TBXML_NAME_NONE && !aNamespaceURI.empty()) return std::string_view();
+	return this->valueOfAttributeNamedNS(namespaceId, aLocalName, aXMLElement);
+}
+
+const TBXMLElement* TBXML::childElementNamedNS(uint32_t aNamespaceId, std::string_view aLocalName, const TBXMLElement* aParentXMLElement) const {
+	if (!aParentXMLElement) return NULL;
+	for (const TBXMLElement * xmlElement = aParentXMLElement->firstChild; xmlElement; xmlElement = xmlElement->nextSibling) {
+		if (matchesLocalName(xmlElement->name, xmlElement->nameLength, aLocalName) && this->namespaceId(xmlElement) == aNamespaceId)
+			return xmlElement;
+	}
+	return NULL;
+}
+
+const TBXMLElement* TBXML::nextSiblingNamedNS(uint32_t aNamespaceId, std::string_view aLocalName, const TBXMLElement* aXMLElement) const {
+	if (!aXMLElement) return NULL;
+	for (const TBXMLElement * xmlElement = aXMLElement->nextSibling; xmlElement; xmlElement = xmlElement->nextSibling) {
+		if (matchesLocalName(xmlElement->name, xmlElement->nameLength, aLocalName) && this->namespaceId(xmlElement) == aNamespaceId)
+			return xmlElement;
+	}
+	return NULL;
+}
+
+std::string_view TBXML::valueOfAttributeNamedNS(uint32_t aNamespaceId, std::string_view aLocalName, const TBXMLElement* aXMLElement) const {
+	if (!aXMLElement) return std::string_view();
+	const TBXMLAttribute * attributesEnd = aXMLElement->firstAttribute + aXMLElement->attributeCount;
+	for (const TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute < attributesEnd; xmlAttribute++) {
+		if (matchesLocalName(xmlAttribute->name, xmlAttribute->nameLength, aLocalName) && this->namespaceId(xmlAttribute) == aNamespaceId)
+			return std::string_view(xmlAttribute->value, xmlAttribute->valueLength);
+	}
+	return std::string_view();
+}
+
+std::string_view TBXML::decodedText(const TBXMLElement* aXMLElement) {
+	if (NULL == aXMLElement->text) return std::string_view();
+
+	if (entities == D_TBXML_ENTITIES_LAZY && !(loadFlags(&aXMLElement->flags) & TBXML_FLAG_DECODED)) {
+		std::lock_guard<std::mutex> lock(arenaLock);
+		if (!(aXMLElement->flags & TBXML_FLAG_DECODED)) {
+			TBXMLElement * xmlElement = const_cast<TBXMLElement*>(aXMLElement);
+			char * textEnd = decodeEntities(xmlElement->text, xmlElement->text, xmlElement->text + xmlElement->textLength);
+			*textEnd = 0;
+			xmlElement->textLength = textEnd - xmlElement->text;
+			storeFlags(&xmlElement->flags, xmlElement->flags | TBXML_FLAG_DECODED);
+		}
+	}
+	return std::string_view(aXMLElement->text, aXMLElement->textLength);
+}
+
+std::string_view TBXML::decodedValue(const TBXMLAttribute* aXMLAttribute) {
+	if (NULL == aXMLAttribute->value) return std::string_view();
+
+	if (entities == D_TBXML_ENTITIES_LAZY && !(loadFlags(&aXMLAttribute->flags) & TBXML_FLAG_DECODED)) {
+		std::lock_guard<std::mutex> lock(arenaLock);
+		if (!(aXMLAttribute->flags & TBXML_FLAG_DECODED)) {
+			TBXMLAttribute * xmlAttribute = const_cast<TBXMLAttribute*>(aXMLAttribute);
+			char * valueEnd = decodeEntities(xmlAttribute->value, xmlAttribute->value, xmlAttribute->value + xmlAttribute->valueLength);
+			*valueEnd = 0;
+			xmlAttribute->valueLength = (unsigned int)(valueEnd - xmlAttribute->value);
+			storeFlags(&xmlAttribute->flags, xmlAttribute->flags | TBXML_FLAG_DECODED);
+		}
+	}
+	return std::string_view(aXMLAttribute->value, aXMLAttribute->valueLength);
+}
+
+std::string_view TBXML::decodedValueOfAttributeNamed(std::string_view aName, const TBXMLElement* aXMLElement) {
+	const TBXMLAttribute * attribute = findAttribute(aXMLElement, aName.data(), aName.length());
+	if (attribute) return this->decodedValue(attribute);
+	return std::string_view();
+}
+
+const TBXMLElement* TBXML::indexedChildElementNamed(std::string_view aName, const TBXMLElement* aParentXMLElement) {
+	TBXMLName name = { TBXML_NAME_NONE, aName.data(), aName.length() };
+	return this->indexedChildElementNamed(name, aParentXMLElement);
+}
+
+const TBXMLElement* TBXML::indexedChildElementNamed(const TBXMLName &aName, const TBXMLElement* aParentXMLElement) {
+	// the children of an unexpanded element are parsed first
+	const TBXMLElement * firstXMLElement = this->firstChild(aParentXMLElement);
+	if (!childIndexThreshold) return TBXML::childElementNamed(aName, aParentXMLElement);
+
+	TBXMLChildIndex * index = this->childIndexOf(aParentXMLElement);
+	if (!index) {
+		// walk the first children, an element is only indexed once a lookup gets past the threshold
+		const TBXMLElement * xmlElement = firstXMLElement;
+		for (size_t count=0; xmlElement && count < childIndexThreshold; count++) {
+			if (aName.matches(xmlElement->nameId, xmlElement->name, xmlElement->nameLength)) return xmlElement;
+			xmlElement = xmlElement->nextSibling;
+		}
+		if (!xmlElement) return NULL;
+
+		index = this->buildChildIndex(aParentXMLElement);
+
+		// out of memory, finish the walk
+		if (!index) {
+			if (aName.matches(xmlElement->nameId, xmlElement->name, xmlElement->nameLength)) return xmlElement;
+			return TBXML::nextSiblingNamed(aName, xmlElement);
+		}
+	}
+	return childIndexFind(index, aName);
+}
+
+const TBXMLElement* TBXML::indexedNextSiblingNamed(std::string_view aName, const TBXMLElement* aXMLElement) {
+	TBXMLName name = { TBXML_NAME_NONE, aName.data(), aName.length() };
+	return this->indexedNextSiblingNamed(name, aXMLElement);
+}
+
+const TBXMLElement* TBXML::indexedNextSiblingNamed(const TBXMLName &aName, const TBXMLElement* aXMLElement) {
+	TBXMLChildIndex * index = aXMLElement->parentElement ? this->childIndexOf(aXMLElement->parentElement) : NULL;
+
+	// the index chains children of the same name, other names are found by walking
+	if (index && aName.matches(aXMLElement->nameId, aXMLElement->name, aXMLElement->nameLength))
+		return childIndexNext(index, aXMLElement);
+
+	return TBXML::nextSiblingNamed(aName, aXMLElement);
+}
+
+TBXMLChildRange TBXML::children(const TBXMLElement* aXMLElement) {
+	return TBXMLChildRange(TBXMLChildIterator(aXMLElement->firstChild), TBXMLChildIterator());
+}
+
+TBXMLAttributeRange TBXML::attributes(const TBXMLElement* aXMLElement) {
+	return TBXMLAttributeRange(aXMLElement->firstAttribute, aXMLElement->firstAttribute + aXMLElement->attributeCount);
+}
+
+TBXMLDescendantRange TBXML::descendants(const TBXMLElement* aXMLElement) {
+	return TBXMLDescendantRange(TBXMLDescendantIterator(aXMLElement->firstChild, aXMLElement), TBXMLDescendantIterator());
+}
+
+TBXMLArenaRange TBXML::elements() const {
+	return this->arenaRange(NULL, NULL);
+}
+
+TBXMLArenaRange TBXML::elementsNamed(std::string_view aName) const {
+	TBXMLName name = { TBXML_NAME_NONE, aName.data(), aName.length() };
+	return this->arenaRange(NULL, &name);
+}
+
+TBXMLArenaRange TBXML::elementsNamed(const TBXMLName &aName) const {
+	return this->arenaRange(NULL, &aName);
+}
+
+TBXMLArenaRange TBXML::descendantsNamed(std::string_view aName, const TBXMLElement* aXMLElement) const {
+	TBXMLName name = { TBXML_NAME_NONE, aName.data(), aName.length() };
+	return this->arenaRange(aXMLElement, &name);
+}
+
+TBXMLArenaRange TBXML::descendantsNamed(const TBXMLName &aName, const TBXMLElement* aXMLElement) const {
+	return this->arenaRange(aXMLElement, &aName);
+}
+
+std::string TBXML::errorWithCode(int code) {
+    std::string codeText = "";
+    
+    switch (code) {
+        case D_TBXML_DATA_NIL:                  codeText = "Data is nil";                          break;
+        case D_TBXML_DECODE_FAILURE:            codeText = "Decode failure";                       break;
         case D_TBXML_MEMORY_ALLOC_FAILURE:      codeText = "Unable to allocate memory";            break;
         case D_TBXML_FILE_NOT_FOUND_IN_BUNDLE:  codeText = "File not found in bundle";             break;
             
@@ -400,6 +1588,25 @@ std::string TBXML::errorWithCode(int code) {
         case D_TBXML_PARAM_NAME_IS_NIL:         codeText = "Parameter name is nil";                break;
         case D_TBXML_ATTRIBUTE_NOT_FOUND:       codeText = "Attribute not found";                  break;
         case D_TBXML_ELEMENT_NOT_FOUND:         codeText = "Element not found";                    break;
+        case D_TBXML_DOCUMENT_TOO_LARGE:        codeText = "Document too large";                   break;
+        case D_TBXML_TOKEN_TOO_LARGE:           codeText = "Token too large";                      break;
+        case D_TBXML_QUERY_INVALID:             codeText = "Invalid query";                        break;
+        case D_TBXML_VALUE_NOT_A_NUMBER:        codeText = "Value is not a number";                break;
+        case D_TBXML_VALUE_OUT_OF_RANGE:        codeText = "Value out of range";                   break;
+        case D_TBXML_VALUE_NOT_A_BOOLEAN:       codeText = "Value is not a boolean";               break;
+        case D_TBXML_WRITE_FAILURE:             codeText = "Write failure";                        break;
+        case D_TBXML_WRITE_OUT_OF_ORDER:        codeText = "Write out of order";                   break;
+        case D_TBXML_SNAPSHOT_INVALID:          codeText = "Snapshot invalid";                     break;
+        case D_TBXML_SNAPSHOT_VERSION:          codeText = "Snapshot version not supported";       break;
+        case D_TBXML_SNAPSHOT_CHECKSUM:         codeText = "Snapshot checksum mismatch";           break;
+        case D_TBXML_LIMIT_BYTES:               codeText = "Document exceeds the byte limit";      break;
+        case D_TBXML_LIMIT_DEPTH:               codeText = "Element exceeds the depth limit";      break;
+        case D_TBXML_LIMIT_ELEMENTS:            codeText = "Document exceeds the element limit";   break;
+        case D_TBXML_LIMIT_ATTRIBUTES:          codeText = "Element exceeds the attribute limit";  break;
+        case D_TBXML_LIMIT_NAME_LENGTH:         codeText = "Name exceeds the length limit";        break;
+        case D_TBXML_LIMIT_VALUE_LENGTH:        codeText = "Value exceeds the length limit";       break;
+        case D_TBXML_LIMIT_MEMORY:              codeText = "Document exceeds the memory limit";    break;
+        case D_TBXML_MARKUP_UNTERMINATED:       codeText = "Comment, cdata section or tag not terminated"; break;
             
         default: codeText = "No Error Description!"; break;
     }
@@ -408,23 +1615,105 @@ std::string TBXML::errorWithCode(int code) {
 }
 
 void TBXML::decodeBytes() {
+	TBXML_TRACE(D_TBXML_TRACE_PARSE_BEGIN, this, bytesLength);
+	TBXML_STAT(uint64_t startNanoseconds = steadyNanoseconds(), startTicks = TBXMLStats::ticks());
+
+	if (parseLimits.maxBytes && bytesLength > parseLimits.maxBytes)
+		parseError = D_TBXML_LIMIT_BYTES;
+	else if (parseThreads > 1 && bytesLength >= 2*TBXML_PARALLEL_MIN_BYTES && !parseProjection && !lazyLevels)
+		this->decodeBytesInParallel();
+	else {
+		this->decodeBytes(bytes, bytes+bytesLength, NULL);
+
+		// buffers kept from a previous document are reused without asking the limit for room
+		if (parseError == D_TBXML_SUCCESS && parseLimits.maxBufferBytes && this->bufferBytes() > parseLimits.maxBufferBytes)
+			parseError = D_TBXML_LIMIT_MEMORY;
+	}
+
+	// a parse stopped by a limit leaves no document
+	if (parseError != D_TBXML_SUCCESS) {
+		rootXMLElement = NULL;
+		unexpanded.clear();
+	}
+
+	TBXML_STAT(this->finishParseStats(startNanoseconds, startTicks));
+	TBXML_TRACE(D_TBXML_TRACE_PARSE_END, this, bytesLength);
+}
+
+void TBXML::decodeBuffer(char* &aBytes, size_t aLength, size_t &aCapacity) {
+	this->reset();
+
+	// the buffer read by the caller becomes the document's, the previous one goes back for the next read
+	char * previousBytes = bytes;
+	size_t previousCapacity = bytesCapacity;
+	bytes = aBytes;
+	bytesLength = aLength;
+	bytesCapacity = aCapacity;
+	aBytes = previousBytes;
+	aCapacity = previousCapacity;
+
+	this->decodeBytes();
+}
+
+void TBXML::decodeBytes(char* aStart, char* aEnd, TBXMLParseChunk* aChunk) {
 	
 	// -----------------------------------------------------------------------------
 	// Process xml
 	// -----------------------------------------------------------------------------
 	
-	// set elementStart pointer to the start of our xml
-	char * elementStart=bytes;
+	// set elementStart pointer to the start of our xml, or of the part a parallel parse gave this thread
+	char * elementStart=aStart;
+	
+	// every scan is bounded by the end of the byte array or of the part
+	char * bytesEnd=aEnd;
+	
+	// classifies the structural characters a block at a time as the parser moves forward, never looking
+	// outside the bytes of the part
+	TBXMLScanner scanner(aStart, aEnd);
 	
 	// set parent element to nil
 	TBXMLElement * parentXMLElement = NULL;
 	
+	// the part of the text of parentXMLElement not decoded yet while its first text run is being read,
+	// only tracked when decoding entities
+	char * textRun = NULL;
+	
+	// counted here rather than in parseStatistics so they stay in registers, the phase times are in ticks
+	// until finishParseStats converts them
+	TBXML_STAT(TBXMLParseStats stats; memset(&stats, 0, sizeof(stats)));
+	TBXML_STAT(uint64_t decodeTicks = TBXMLStats::ticks(), phaseTicks = 0);
+	// elements opened less elements closed and the deepest element, relative to the start of a part
+	long depth = 0, maxDepth = 0;
+	
+	// the limits checked while parsing, 0 becoming the largest value
+	long depthLimit = parseLimits.maxDepth ? (long)parseLimits.maxDepth - (aChunk ? aChunk->outerDepth : 0) : LONG_MAX;
+	size_t attributeLimit = parseLimits.maxAttributes ? parseLimits.maxAttributes : SIZE_MAX;
+	size_t nameLimit = parseLimits.maxNameLength ? parseLimits.maxNameLength : SIZE_MAX;
+	size_t valueLimit = parseLimits.maxValueLength ? parseLimits.maxValueLength : SIZE_MAX;
+	
+	// the namespace declarations in scope when namespace aware, allocated with the first one
+	std::vector<TBXMLNamespaceBinding> scope;
+	
+	// the projection nodes of the open elements when parsing for a projection
+	std::vector<const TBXMLProjectionNode*> projected;
+	
+	// the level whose elements a lazy parse leaves unexpanded, relative to the start like depth
+	long lazyLevel = lazyLevels && !parseProjection ? (long)lazyLevels : LONG_MAX;
+	
 	// find next element start
-	while ((elementStart = strstr(elementStart,"<"))) {
+	while ((elementStart = scanner.find(TBXML_CLASS(TBXML_CHAR_LT),elementStart,bytesEnd))) {
 		
 		// detect comment section
 		if (strncmp(elementStart,"<!--",4) == 0) {
-			elementStart = strstr(elementStart,"-->") + 3;
+			TBXML_STAT(stats.comments++);
+			
+			// an unterminated comment runs to the end of the document, which is malformed
+			char * commentEnd = scanner.findString(TBXML_CHAR_DASH,"-->",elementStart,bytesEnd);
+			if (!commentEnd) {
+				parseError = D_TBXML_MARKUP_UNTERMINATED;
+				break;
+			}
+			elementStart = commentEnd + 3;
 			continue;
 		}
 
@@ -433,61 +1722,106 @@ void TBXML::decodeBytes() {
 		
 		// if cdata section found, skip data within cdata section and remove cdata tags
 		if (isCDATA==0) {
+			TBXML_STAT(stats.CDATASections++);
 			
 			// find end of cdata section
-			char * CDATAEnd = strstr(elementStart,"]]>");
+			char * CDATAEnd = scanner.findString(TBXML_CHAR_RBRACKET,"]]>",elementStart,bytesEnd);
+			
+			// an unterminated cdata section runs to the end of the document, which is malformed
+			if (!CDATAEnd) {
+				parseError = D_TBXML_MARKUP_UNTERMINATED;
+				break;
+			}
 			
 			// find start of next element skipping any cdata sections within text
 			char * elementEnd = CDATAEnd;
 			
-			// find next open tag
-			elementEnd = strstr(elementEnd,"<");
+			// find next open tag, the text of a part runs up to the tag starting the next part
+			elementEnd = scanner.find(TBXML_CLASS(TBXML_CHAR_LT),elementEnd,bytesEnd);
+			if (!elementEnd) elementEnd = bytesEnd;
 			// if open tag is a cdata section
-			while (strncmp(elementEnd,"<![CDATA[",9) == 0) {
-				// find end of cdata section
-				elementEnd = strstr(elementEnd,"]]>");
+			while (elementEnd < bytesEnd && strncmp(elementEnd,"<![CDATA[",9) == 0) {
+				// find end of cdata section, the text runs to the end of the document without one
+				if (!(elementEnd = scanner.findString(TBXML_CHAR_RBRACKET,"]]>",elementEnd,bytesEnd))) {
+					elementEnd = bytesEnd;
+					break;
+				}
 				// find next open tag
-				elementEnd = strstr(elementEnd,"<");
+				elementEnd = scanner.find(TBXML_CLASS(TBXML_CHAR_LT),elementEnd,bytesEnd);
+				if (!elementEnd) elementEnd = bytesEnd;
 			}
 			
 			// calculate length of cdata content
-			long CDATALength = CDATAEnd-elementStart;
+			size_t CDATALength = CDATAEnd-elementStart;
 			
 			// calculate total length of text
-			long textLength = elementEnd-elementStart;
+			size_t textLength = elementEnd-elementStart;
+			
+			// the cdata content can't be told apart from the text once unwrapped, decode the text before
+			// it now and the rest of the element text when it ends. The text shrinks by the difference.
+			size_t decodedLength = 0;
+			if (textRun) {
+				decodedLength = elementStart - decodeEntities(textRun, textRun, elementStart);
+				parentXMLElement->flags |= TBXML_FLAG_DECODED;
+			}
 			
 			// remove begining cdata section tag
-			memcpy(elementStart, elementStart+9, CDATAEnd-elementStart-9);
+			memmove(elementStart-decodedLength, elementStart+9, CDATAEnd-elementStart-9);
 
 			// remove ending cdata section tag
-			memcpy(CDATAEnd-9, CDATAEnd+3, textLength-CDATALength-3);
+			memmove(CDATAEnd-9-decodedLength, CDATAEnd+3, textLength-CDATALength-3);
 			
 			// blank out end of text
-			memset(elementStart+textLength-12,' ',12);
+			memset(elementStart+textLength-12-decodedLength,' ',12+decodedLength);
+			
+			// the text was shifted, classify it again
+			scanner.invalidate();
 			
 			// set new search start position 
-			elementStart = CDATAEnd-9;
+			elementStart = CDATAEnd-9-decodedLength;
+			if (textRun) textRun = elementStart;
 			continue;
 		}
 		
 		
 		// find element end, skipping any cdata sections within attributes
 		char * elementEnd = elementStart+1;		
-		while ((elementEnd = strpbrk(elementEnd, "<>"))) {
+		while ((elementEnd = scanner.find(TBXML_CLASS(TBXML_CHAR_LT)|TBXML_CLASS(TBXML_CHAR_GT),elementEnd,bytesEnd))) {
 			if (strncmp(elementEnd,"<![CDATA[",9) == 0) {
-				elementEnd = strstr(elementEnd,"]]>")+3;
+				// a tag with an unterminated cdata section has no end
+				if (!(elementEnd = scanner.findString(TBXML_CHAR_RBRACKET,"]]>",elementEnd,bytesEnd))) break;
+				elementEnd += 3;
 			} else {
 				break;
 			}
 		}
 		
-        if (!elementEnd) break;
+		// a tag without an end, or with an unterminated cdata section, runs to the end of the document
+		if (!elementEnd) {
+			parseError = D_TBXML_MARKUP_UNTERMINATED;
+			break;
+		}
 		
 		// null terminate element end
-		if (elementEnd) *elementEnd = 0;
+		*elementEnd = 0;
 		
-		// null terminate element start so previous element text doesnt overrun
-		*elementStart = 0;
+		// null terminate element start so previous element text doesnt overrun. The text before the first
+		// tag of a part belongs to the previous part, which may still be reading it, the terminator is
+		// written once both are done.
+		if (aChunk && elementStart == aStart)
+			aChunk->terminator = elementStart;
+		else
+			*elementStart = 0;
+		
+		// the first text run of parentXMLElement ends here. The rest of text holding cdata is decoded now,
+		// text without references is marked so it isn't searched again once trimmed.
+		if (textRun) {
+			if (parentXMLElement->flags & TBXML_FLAG_DECODED)
+				*decodeEntities(textRun, textRun, elementStart) = 0;
+			else if (entities == D_TBXML_ENTITIES_EAGER && !scanner.find(TBXML_CLASS(TBXML_CHAR_AMP),textRun,elementStart))
+				parentXMLElement->flags |= TBXML_FLAG_DECODED;
+			textRun = NULL;
+		}
 		
 		// get element name start
 		char * elementNameStart = elementStart+1;
@@ -506,27 +1840,32 @@ void TBXML::decodeBytes() {
                 // Compare opening and closing strings
                 if( *(elementNameStart+1) != 0 && strcmp(parentXMLElement->name,(elementNameStart+1))  != 0 ){
                 	char e[100];
-                	sprintf(e, "XML Element doesn't have matching tags, : %s != %s", parentXMLElement->name, elementNameStart+1);
+                	snprintf(e, sizeof(e), "XML Element doesn't have matching tags, : %s != %s", parentXMLElement->name, elementNameStart+1);
                     assert(e);
                 }
                    
-				if (parentXMLElement->text) {
-					// trim whitespace from start of text
-					while (isspace(*parentXMLElement->text)) 
-						parentXMLElement->text++;
-					
-					// trim whitespace from end of text
-					char * end = parentXMLElement->text + strlen(parentXMLElement->text)-1;
-					while (end > parentXMLElement->text && isspace(*end)) 
-						*end--=0;
-				}
+				TBXML_STAT(phaseTicks = TBXMLStats::ticks());
+				trimText(parentXMLElement, entities == D_TBXML_ENTITIES_EAGER);
+				TBXML_STAT(stats.trimNanoseconds += TBXMLStats::ticks() - phaseTicks);
+				depth--;
+				closeNamespaces(parentXMLElement, scope);
+				if (parseProjection) projected.pop_back();
 				
 				parentXMLElement = parentXMLElement->parentElement;
 				
 				// if parent element has children clear text
-				if (parentXMLElement && parentXMLElement->firstChild)
+				if (parentXMLElement && parentXMLElement->firstChild) {
 					parentXMLElement->text = 0;
+					parentXMLElement->textLength = 0;
+				}
 				
+				// an element at the top of a part closed, its parent is in an earlier part
+				if (!parentXMLElement && aChunk) aChunk->runs.back().closed = true;
+				
+			} else if (aChunk) {
+				// closes an element of an earlier part
+				aChunk->runs.push_back(TBXMLParseRun());
+				depth--;
 			}
 			continue;
 		}
@@ -539,8 +1878,35 @@ void TBXML::decodeBytes() {
 		}
 		
 		
+		// a projection keeps the elements on its paths, any other element is stepped over with its subtree
+		const TBXMLProjectionNode * projectionNode = NULL;
+		if (parseProjection) {
+			char * nameEnd = scanner.find(TBXML_CLASS(TBXML_CHAR_NAME_END),elementNameStart,elementEnd);
+			projectionNode = parseProjection->match(projected.empty() ? NULL : projected.back(), elementNameStart, (nameEnd ? nameEnd : elementEnd) - elementNameStart);
+			if (!projectionNode) {
+				elementStart = selfClosingElement ? elementEnd+1 : skipElement(elementEnd+1, bytesEnd);
+				if (!elementStart) break;
+
+				// it closes like an element with children, which clears the text of its parent
+				if (!selfClosingElement && parentXMLElement) {
+					parentXMLElement->text = 0;
+					parentXMLElement->textLength = 0;
+				}
+				continue;
+			}
+		}
+		
+		// a part can't be deeper than the document, so it may stop at the limit too
+		if (depth >= depthLimit) {
+			parseError = D_TBXML_LIMIT_DEPTH;
+			break;
+		}
+		
 		// create new xmlElement struct
 		TBXMLElement * xmlElement = this->nextAvailableElement();
+		if (!xmlElement) break;
+		TBXML_STAT(stats.elements++);
+		if (depth+1 > maxDepth) maxDepth = depth+1;
 		
 		// set element name
 		xmlElement->name = elementNameStart;
@@ -564,6 +1930,17 @@ void TBXML::decodeBytes() {
 			}
 			
 			xmlElement->parentElement = parentXMLElement;
+		} else if (aChunk) {
+			// elements at the top of a part are children of an element of an earlier part. Siblings are
+			// linked here, the parent once the parts are put together.
+			if (aChunk->runs.empty() || !aChunk->runs.back().first) {
+				aChunk->runs.push_back(TBXMLParseRun());
+				aChunk->runs.back().first = xmlElement;
+			} else {
+				aChunk->runs.back().last->nextSibling = xmlElement;
+				xmlElement->previousSibling = aChunk->runs.back().last;
+			}
+			aChunk->runs.back().last = xmlElement;
 		}
 		
 		
@@ -571,9 +1948,21 @@ void TBXML::decodeBytes() {
 		// element may contain no atributes and would return nil while looking for element name end
 		// <tile> 
 		// find end of element name
-		char * elementNameEnd = strpbrk(xmlElement->name," /\n");
+		TBXML_STAT(phaseTicks = TBXMLStats::ticks());
+		char * elementNameEnd = scanner.find(TBXML_CLASS(TBXML_CHAR_NAME_END),xmlElement->name,elementEnd);
+		
+		// the name ends at the first space, '/' or newline, or at the null terminated element end
+		xmlElement->nameLength = (unsigned int)((elementNameEnd ? elementNameEnd : elementEnd) - xmlElement->name);
+		if (xmlElement->nameLength > nameLimit) {
+			parseError = D_TBXML_LIMIT_NAME_LENGTH;
+			break;
+		}
+		if (symbols) xmlElement->nameId = symbols->intern(xmlElement->name, xmlElement->nameLength);
 		
 		
+		// set when namespace aware and an attribute may declare a namespace
+		bool namespaceAttributes = false;
+		
 		// if end was found check for attributes
 		if (elementNameEnd) {
 			
@@ -581,79 +1970,150 @@ void TBXML::decodeBytes() {
 			*elementNameEnd = 0;
 			
 			char * chr = elementNameEnd;
+			char * attributesEnd = elementEnd+1;
+			
+			// the attributes of an element a projection only passes through are left out
+			if (projectionNode && !projectionNode->attributes) chr = elementEnd;
 			char * name = NULL;
 			char * value = NULL;
+			unsigned int nameLength = 0;
+			unsigned int valueLength = 0;
 			char * CDATAStart = NULL;
 			char * CDATAEnd = NULL;
-			TBXMLAttribute * lastXMLAttribute = NULL;
 			TBXMLAttribute * xmlAttribute = NULL;
+			size_t attributeCount = 0;
 			bool singleQuote = false;
 			
+			// decoding while parsing looks for references along with the end of a value
+			unsigned int referenceClass = entities == D_TBXML_ENTITIES_EAGER ? TBXML_CLASS(TBXML_CHAR_AMP) : 0;
+			bool valueReferences = false;
+			
 			int mode = TBXML_ATTRIBUTE_NAME_START;
 			
-			// loop through all characters within element
+			// loop through all characters within element, letting the scanner jump straight to the
+			// next character that can change the mode. chr is set to attributesEnd when nothing is
+			// left to find, which ends the loop.
 			while (chr++ < elementEnd) {
 				
 				switch (mode) {
 					// look for start of attribute name
 					case TBXML_ATTRIBUTE_NAME_START:
-						if (isspace(*chr)) continue;
+						if (!(chr = scanner.skip(TBXML_CLASS(TBXML_CHAR_SPACE),chr,attributesEnd))) {
+							chr = attributesEnd;
+							break;
+						}
 						name = chr;
 						mode = TBXML_ATTRIBUTE_NAME_END;
 						break;
 					// look for end of attribute name
 					case TBXML_ATTRIBUTE_NAME_END:
-						if (isspace(*chr) || *chr == '=') {
-							*chr = 0;
-							mode = TBXML_ATTRIBUTE_VALUE_START;
+						if (!(chr = scanner.find(TBXML_CLASS(TBXML_CHAR_SPACE)|TBXML_CLASS(TBXML_CHAR_EQ),chr,attributesEnd))) {
+							chr = attributesEnd;
+							break;
 						}
+						*chr = 0;
+						nameLength = (unsigned int)(chr - name);
+						mode = TBXML_ATTRIBUTE_VALUE_START;
 						break;
 					// look for start of attribute value
 					case TBXML_ATTRIBUTE_VALUE_START:
-						if (isspace(*chr)) continue;
-						if (*chr == '"' || *chr == '\'') {
-							value = chr+1;
-							mode = TBXML_ATTRIBUTE_VALUE_END;
-							if (*chr == '\'') 
-								singleQuote = true;
-							else
-								singleQuote = false;
+						if (!(chr = scanner.find(TBXML_CLASS(TBXML_CHAR_DQUOTE)|TBXML_CLASS(TBXML_CHAR_SQUOTE),chr,attributesEnd))) {
+							chr = attributesEnd;
+							break;
 						}
+						value = chr+1;
+						valueReferences = false;
+						mode = TBXML_ATTRIBUTE_VALUE_END;
+						if (*chr == '\'') 
+							singleQuote = true;
+						else
+							singleQuote = false;
 						break;
 					// look for end of attribute value
 					case TBXML_ATTRIBUTE_VALUE_END:
-						if (*chr == '<' && strncmp(chr, "<![CDATA[", 9) == 0) {
+						if (!(chr = scanner.find(TBXML_CLASS(TBXML_CHAR_LT)|referenceClass|(singleQuote ? TBXML_CLASS(TBXML_CHAR_SQUOTE) : TBXML_CLASS(TBXML_CHAR_DQUOTE)),chr,attributesEnd))) {
+							chr = attributesEnd;
+							break;
+						}
+						if (*chr == '&') {
+							valueReferences = true;
+						} else if (*chr == '<' && strncmp(chr, "<![CDATA[", 9) == 0) {
+							TBXML_STAT(stats.CDATASections++);
 							mode = TBXML_ATTRIBUTE_CDATA_END;
 						}else if ((*chr == '"' && !singleQuote) || (*chr == '\'' && singleQuote)) {
 							*chr = 0;
+							valueLength = (unsigned int)(chr - value);
+							uint32_t valueFlags = 0;
 							
-							// remove cdata section tags
-							while ((CDATAStart = strstr(value, "<![CDATA["))) {
-								
-								// remove begin cdata tag
-								memcpy(CDATAStart, CDATAStart+9, strlen(CDATAStart)-8);
+							// the limits stop the parse before the value is decoded
+							if (++attributeCount > attributeLimit || nameLength > nameLimit || valueLength > valueLimit) {
+								if (attributeCount > attributeLimit)
+									parseError = D_TBXML_LIMIT_ATTRIBUTES;
+								else if (nameLength > nameLimit)
+									parseError = D_TBXML_LIMIT_NAME_LENGTH;
+								else
+									parseError = D_TBXML_LIMIT_VALUE_LENGTH;
+								chr = attributesEnd;
+								break;
+							}
+							
+							if (entities != D_TBXML_ENTITIES_NONE && (CDATAStart = strstr(value, "<![CDATA["))) {
+								// decode the value around cdata sections as their tags are removed, the
+								// content is copied as it is
+								char * valueEnd = value;
+								char * read = value;
+								do {
+									valueEnd = decodeEntities(valueEnd, read, CDATAStart);
+									CDATAEnd = strstr(CDATAStart+9,"]]>");
+									memmove(valueEnd, CDATAStart+9, CDATAEnd-CDATAStart-9);
+									valueEnd += CDATAEnd-CDATAStart-9;
+									read = CDATAEnd+3;
+								} while ((CDATAStart = strstr(read, "<![CDATA[")));
 								
-								// search for end cdata
-								CDATAEnd = strstr(CDATAStart,"]]>");
+								valueEnd = decodeEntities(valueEnd, read, chr);
+								*valueEnd = 0;
+								valueLength = (unsigned int)(valueEnd - value);
+								valueFlags = TBXML_FLAG_DECODED;
+							} else {
+								// remove cdata section tags, each one shortens the value by 12
+								while ((CDATAStart = strstr(value, "<![CDATA["))) {
+									
+									// remove begin cdata tag
+									memmove(CDATAStart, CDATAStart+9, strlen(CDATAStart)-8);
+									
+									// search for end cdata
+									CDATAEnd = strstr(CDATAStart,"]]>");
+									
+									// remove end cdata tag
+									memmove(CDATAEnd, CDATAEnd+3, strlen(CDATAEnd)-2);
+									
+									valueLength -= 12;
+								}
 								
-								// remove end cdata tag
-								memcpy(CDATAEnd, CDATAEnd+3, strlen(CDATAEnd)-2);
+								if (valueReferences) {
+									char * valueEnd = decodeEntities(value, value, value+valueLength);
+									*valueEnd = 0;
+									valueLength = (unsigned int)(valueEnd - value);
+									valueFlags = TBXML_FLAG_DECODED;
+								}
 							}
 							
 							
-							// create new attribute
-							xmlAttribute = this->nextAvailableAttribute();
-							
-							// if this is the first attribute found, set pointer to this attribute on element
-							if (!xmlElement->firstAttribute) xmlElement->firstAttribute = xmlAttribute;
-							// if previous attribute found, link this attribute to previous one
-							if (lastXMLAttribute) lastXMLAttribute->next = xmlAttribute;
-							// set last attribute to this attribute
-							lastXMLAttribute = xmlAttribute;
+							// create new attribute, following the others of the element
+							if (!(xmlAttribute = this->nextAvailableAttribute(xmlElement))) {
+								chr = attributesEnd;
+								break;
+							}
+							TBXML_STAT(stats.attributes++);
 
 							// set attribute name & value
 							xmlAttribute->name = name;
 							xmlAttribute->value = value;
+							xmlAttribute->nameLength = nameLength;
+							xmlAttribute->valueLength = valueLength;
+							xmlAttribute->flags = valueFlags;
+							if (symbols) xmlAttribute->nameId = symbols->intern(name, nameLength);
+							if (namespaceAware && isNamespaceAttribute(name, nameLength)) namespaceAttributes = true;
 							
 							// clear name and value pointers
 							name = NULL;
@@ -665,10 +2125,12 @@ void TBXML::decodeBytes() {
 						break;
 						// look for end of cdata
 					case TBXML_ATTRIBUTE_CDATA_END:
-						if (*chr == ']') {
-							if (strncmp(chr, "]]>", 3) == 0) {
-								mode = TBXML_ATTRIBUTE_VALUE_END;
-							}
+						if (!(chr = scanner.find(TBXML_CLASS(TBXML_CHAR_RBRACKET),chr,attributesEnd))) {
+							chr = attributesEnd;
+							break;
+						}
+						if (strncmp(chr, "]]>", 3) == 0) {
+							mode = TBXML_ATTRIBUTE_VALUE_END;
 						}
 						break;						
 					default:
@@ -676,12 +2138,53 @@ void TBXML::decodeBytes() {
 				}
 			}
 		}
+		TBXML_STAT(stats.attributeNanoseconds += TBXMLStats::ticks() - phaseTicks);
+		if (parseError != D_TBXML_SUCCESS) break;
+		
+		// the attributes may declare the namespace of the element. A part of a parallel parse doesn't know
+		// the declarations in scope, it only notes whether it has any for them to be resolved afterwards.
+		if (namespaceAware) {
+			if (aChunk) {
+				if (namespaceAttributes) aChunk->namespaces = true;
+			} else if (namespaceAttributes || !scope.empty()) {
+				this->resolveNamespaces(xmlElement, scope);
+				if (selfClosingElement) closeNamespaces(xmlElement, scope);
+			}
+		}
+		
+		// an element at the lazy level whose children have content of their own is only located, its
+		// content is parsed when it is expanded
+		if (!selfClosingElement && depth+1 == lazyLevel) {
+			char * contentEnd = NULL;
+			bool nested = false;
+			char * next = skipElement(elementEnd+1, bytesEnd, &contentEnd, &nested);
+			if (next && nested) {
+				TBXMLLazyContent content = { elementEnd+1, contentEnd };
+				unexpanded[xmlElement] = content;
+				xmlElement->flags |= TBXML_FLAG_UNEXPANDED;
+				if (namespaceAware && !aChunk) closeNamespaces(xmlElement, scope);
+				
+				// it closes like an element with children, which clears the text of its parent
+				if (parentXMLElement) {
+					parentXMLElement->text = 0;
+					parentXMLElement->textLength = 0;
+				} else if (aChunk) {
+					aChunk->runs.back().closed = true;
+				}
+				elementStart = next;
+				continue;
+			}
+		}
 		
 		// if tag is not self closing, set parent to current element
 		if (!selfClosingElement) {
+			depth++;
 			// set text on element to element end+1
 			if (*(elementEnd+1) != '>')
 				xmlElement->text = elementEnd+1;
+			if (entities != D_TBXML_ENTITIES_NONE)
+				textRun = xmlElement->text;
+			if (parseProjection) projected.push_back(projectionNode);
 			
 			parentXMLElement = xmlElement;
 		}
@@ -689,41 +2192,870 @@ void TBXML::decodeBytes() {
 		// start looking for next element after end of current element
 		elementStart = elementEnd+1;
 	}
+	
+	// text holding cdata left open at the end, the tag after a part is terminated once the parts are done
+	if (textRun && (parentXMLElement->flags & TBXML_FLAG_DECODED)) {
+		char * textEnd = decodeEntities(textRun, textRun, aEnd);
+		if (textEnd < aEnd) *textEnd = 0;
+	}
+	
+	// the rest of the time went into scanning
+	TBXML_STAT(stats.bytesScanned = aEnd - aStart);
+	TBXML_STAT(stats.scanNanoseconds = TBXMLStats::ticks() - decodeTicks - stats.attributeNanoseconds - stats.trimNanoseconds);
+	TBXML_STAT(TBXMLStats::accumulate(parseStatistics, stats));
+	
+	// a part leaves its open elements to the next one
+	if (aChunk) {
+		aChunk->depth = depth;
+		aChunk->maxDepth = maxDepth;
+		aChunk->openElement = parentXMLElement;
+		return;
+	}
+	TBXML_STAT(parseStatistics.maxDepth = maxDepth);
+	
+	// elements left open by a truncated document never had their text trimmed and measured
+	for (TBXMLElement * xmlElement = parentXMLElement; xmlElement; xmlElement = xmlElement->parentElement) {
+		if (xmlElement->text) xmlElement->textLength = strlen(xmlElement->text);
+		if (entities == D_TBXML_ENTITIES_EAGER) decodeText(xmlElement);
+	}
+}
+
+void TBXML::decodeBytesInParallel() {
+	char * bytesEnd = bytes+bytesLength;
+
+	// split the document evenly, each part starting at a tag
+	size_t threadCount = bytesLength / TBXML_PARALLEL_MIN_BYTES;
+	if (threadCount > parseThreads) threadCount = parseThreads;
+
+	std::vector<TBXMLParseChunk> chunks(1);
+	chunks[0].start = bytes;
+	for (size_t i=1; i < threadCount; i++) {
+		char * boundary = findTagBoundary(bytes + bytesLength/threadCount*i, bytesEnd);
+		if (!boundary) break;
+		if (boundary <= chunks.back().start) continue;
+		chunks.emplace_back();
+		chunks.back().start = boundary;
+	}
+	for (size_t i=0; i < chunks.size(); i++)
+		chunks[i].end = i+1 < chunks.size() ? chunks[i+1].start : bytesEnd;
+
+	// the boundaries are a guess, a '<' within an attribute value, comment or cdata section looks like a
+	// tag too. Scan every part for the tag its tokens run up to without decoding anything yet.
+	runInParallel(chunks.size(), [&](size_t i) {
+		chunks[i].exit = chunks[i].end < bytesEnd ? skipTokens(chunks[i].start, chunks[i].end, bytesEnd) : bytesEnd;
+	});
+
+	// the first part starts where decodeBytes does, so its scan is right and tells whether the second
+	// boundary is a tag decodeBytes visits, and so on. A part whose boundary is not takes over the next.
+	size_t count = 1;
+	for (size_t i=1; i < chunks.size(); i++) {
+		TBXMLParseChunk &previous = chunks[count-1];
+		if (previous.exit == chunks[i].start) {
+			if (count != i) chunks[count] = std::move(chunks[i]);
+			count++;
+			continue;
+		}
+
+		previous.end = chunks[i].end;
+		if (previous.end == bytesEnd)
+			previous.exit = bytesEnd;
+		else if (previous.exit < previous.end)
+			previous.exit = skipTokens(previous.exit, previous.end, bytesEnd);
+	}
+	chunks.resize(count);
+
+	// every part is decoded into element and attribute buffers of its own, the buffers of the previous
+	// document are shared out between them
+	std::vector<TBXML> workers(count);
+
+	size_t worker = 0;
+	while (firstElementBuffer) {
+		TBXMLElementBuffer * buffer = firstElementBuffer;
+		firstElementBuffer = buffer->next;
+		TBXML &owner = workers[worker++ % count];
+		buffer->next = 0;
+		buffer->previous = owner.currentElementBuffer;
+		if (owner.currentElementBuffer)
+			owner.currentElementBuffer->next = buffer;
+		else
+			owner.firstElementBuffer = buffer;
+		owner.currentElementBuffer = buffer;
+	}
+	worker = 0;
+	while (firstAttributeBuffer) {
+		TBXMLAttributeBuffer * buffer = firstAttributeBuffer;
+		firstAttributeBuffer = buffer->next;
+		TBXML &owner = workers[worker++ % count];
+		buffer->next = 0;
+		buffer->previous = owner.currentAttributeBuffer;
+		if (owner.currentAttributeBuffer)
+			owner.currentAttributeBuffer->next = buffer;
+		else
+			owner.firstAttributeBuffer = buffer;
+		owner.currentAttributeBuffer = buffer;
+	}
+	currentElementBuffer = 0;
+	currentAttributeBuffer = 0;
+
+	// a frozen symbol table is only read and is shared, names are interned in document order afterwards
+	// otherwise
+	bool shareSymbols = symbols && symbols->isFrozen();
+
+	runInParallel(count, [&](size_t i) {
+		TBXML &xml = workers[i];
+		size_t length = chunks[i].end - chunks[i].start;
+
+		// rewind the buffers handed out like reset does
+		xml.currentElementBuffer = xml.firstElementBuffer;
+		xml.currentAttributeBuffer = xml.firstAttributeBuffer;
+		if (xml.currentElementBuffer) xml.currentElement = -1;
+		if (xml.currentAttributeBuffer) xml.currentAttribute = -1;
+		for (TBXMLElementBuffer * buffer = xml.firstElementBuffer; buffer; buffer = buffer->next) buffer->length = 0;
+		xml.elementCapacityHint = length / TBXML_BYTES_PER_ELEMENT;
+		xml.attributeCapacityHint = length / TBXML_BYTES_PER_ATTRIBUTE;
+		xml.symbols = shareSymbols ? symbols : NULL;
+		xml.entities = entities;
+		xml.setLimits(parseLimits);
+		xml.namespaceAware = namespaceAware;
+
+		TBXML_TRACE(D_TBXML_TRACE_PART_BEGIN, this, length);
+		xml.decodeBytes(chunks[i].start, chunks[i].end, &chunks[i]);
+		TBXML_TRACE(D_TBXML_TRACE_PART_END, this, length);
+	});
+
+	// a part stopped by a limit stops the parse, the buffers are kept for the next document
+	for (size_t i=0; i < count && parseError == D_TBXML_SUCCESS; i++)
+		parseError = workers[i].parseError;
+	if (parseError != D_TBXML_SUCCESS) {
+		for (size_t i=0; i < count; i++) this->adoptBuffers(workers[i]);
+		return;
+	}
+
+	for (size_t i=0; i < count; i++) {
+		if (chunks[i].terminator) *chunks[i].terminator = 0;
+		if (symbols && !shareSymbols) {
+			workers[i].symbols = symbols;
+			workers[i].internNames();
+		}
+		if (!rootXMLElement) rootXMLElement = workers[i].rootXMLElement;
+	}
+
+	// link the elements at the top of every part to the elements left open by the parts before, in the
+	// order decodeBytes would
+	TBXMLElement * parentXMLElement = NULL;
+	for (size_t i=0; i < count; i++) {
+		for (TBXMLParseRun &run : chunks[i].runs) {
+			if (!run.first) {
+				if (parentXMLElement) {
+					trimText(parentXMLElement, entities == D_TBXML_ENTITIES_EAGER);
+
+					parentXMLElement = parentXMLElement->parentElement;
+
+					// if parent element has children clear text
+					if (parentXMLElement && parentXMLElement->firstChild) {
+						parentXMLElement->text = 0;
+						parentXMLElement->textLength = 0;
+					}
+				}
+				continue;
+			}
+
+			// top level elements are not linked to each other
+			if (!parentXMLElement) {
+				for (TBXMLElement * xmlElement = run.first; xmlElement != run.last; ) {
+					TBXMLElement * nextXMLElement = xmlElement->nextSibling;
+					xmlElement->nextSibling = NULL;
+					nextXMLElement->previousSibling = NULL;
+					xmlElement = nextXMLElement;
+				}
+				continue;
+			}
+
+			if (parentXMLElement->currentChild) {
+				parentXMLElement->currentChild->nextSibling = run.first;
+				run.first->previousSibling = parentXMLElement->currentChild;
+			} else {
+				parentXMLElement->firstChild = run.first;
+			}
+			parentXMLElement->currentChild = run.last;
+
+			// the last element may be left open, the next part needs its parent now
+			run.parent = parentXMLElement;
+			run.last->parentElement = parentXMLElement;
+
+			if (run.closed) {
+				parentXMLElement->text = 0;
+				parentXMLElement->textLength = 0;
+			}
+		}
+
+		if (chunks[i].openElement) parentXMLElement = chunks[i].openElement;
+	}
+
+	runInParallel(count, [&](size_t i) {
+		for (TBXMLParseRun &run : chunks[i].runs) {
+			if (!run.parent) continue;
+			for (TBXMLElement * xmlElement = run.first; xmlElement != run.last; xmlElement = xmlElement->nextSibling)
+				xmlElement->parentElement = run.parent;
+		}
+	});
+
+	// elements left open by a truncated document never had their text trimmed and measured
+	for (TBXMLElement * xmlElement = parentXMLElement; xmlElement; xmlElement = xmlElement->parentElement) {
+		if (xmlElement->text) xmlElement->textLength = strlen(xmlElement->text);
+		if (entities == D_TBXML_ENTITIES_EAGER) decodeText(xmlElement);
+	}
+
+	// the parts add up, except for the depth: a part starts as deep as the elements left open before it
+	long depth = 0, maxDepth = 0;
+	size_t elements = 0;
+	for (size_t i=0; i < count; i++) {
+		TBXML_STAT(TBXMLStats::accumulate(parseStatistics, workers[i].parseStatistics));
+		if (depth + chunks[i].maxDepth > maxDepth) maxDepth = depth + chunks[i].maxDepth;
+		depth += chunks[i].depth;
+		elements += parseLimits.maxElements - workers[i].elementBudget;
+		this->adoptBuffers(workers[i]);
+	}
+	TBXML_STAT(parseStatistics.maxDepth = maxDepth);
+
+	// the scope of a declaration may span parts, it is followed through the linked tree once the parts'
+	// buffers, which the ids are kept beside, are the document's
+	if (namespaceAware) {
+		for (size_t i=0; i < count; i++) {
+			if (!chunks[i].namespaces) continue;
+			this->resolveNamespaces();
+			break;
+		}
+	}
+
+	// each part kept within the limits, the document may not
+	if (parseLimits.maxDepth && maxDepth > (long)parseLimits.maxDepth)
+		parseError = D_TBXML_LIMIT_DEPTH;
+	else if (parseLimits.maxElements && elements > parseLimits.maxElements)
+		parseError = D_TBXML_LIMIT_ELEMENTS;
+	else if (parseLimits.maxBufferBytes && this->bufferBytes() > parseLimits.maxBufferBytes)
+		parseError = D_TBXML_LIMIT_MEMORY;
 }
 
 TBXMLElement* TBXML::nextAvailableElement() {
-	currentElement++;
+	if (!elementBudget) {
+		parseError = D_TBXML_LIMIT_ELEMENTS;
+		return NULL;
+	}
 
 	if (!currentElementBuffer) {
-		currentElementBuffer = (TBXMLElementBuffer*)calloc(1, sizeof(TBXMLElementBuffer));
-		currentElementBuffer->elements = (TBXMLElement*)calloc(1,sizeof(TBXMLElement)*MAX_ELEMENTS);
+		// size the first buffer for the whole document if the estimate is right
+		size_t capacity = bytesLength / TBXML_BYTES_PER_ELEMENT;
+		if (capacity < elementCapacityHint) capacity = elementCapacityHint;
+		if (!(currentElementBuffer = this->allocateElementBuffer(capacity))) return NULL;
+		firstElementBuffer = currentElementBuffer;
 		currentElement = 0;
-		rootXMLElement = &currentElementBuffer->elements[currentElement];
-	} else if (currentElement >= MAX_ELEMENTS) {
-		currentElementBuffer->next = (TBXMLElementBuffer*)calloc(1, sizeof(TBXMLElementBuffer));
-		currentElementBuffer->next->previous = currentElementBuffer;
+	} else if ((size_t)(currentElement+1) >= currentElementBuffer->capacity) {
+		// reuse a buffer left over from a previous document, or grow geometrically
+		if (!currentElementBuffer->next) {
+			TBXMLElementBuffer * buffer = this->allocateElementBuffer(currentElementBuffer->capacity*2);
+			if (!buffer) return NULL;
+			currentElementBuffer->next = buffer;
+			buffer->previous = currentElementBuffer;
+		}
 		currentElementBuffer = currentElementBuffer->next;
-		currentElementBuffer->elements = (TBXMLElement*)calloc(1,sizeof(TBXMLElement)*MAX_ELEMENTS);
 		currentElement = 0;
+	} else {
+		currentElement++;
 	}
+	elementBudget--;
+
+	// buffers are not zeroed when allocated, each slot is cleared once as it is handed out
+	TBXMLElement * element = &currentElementBuffer->elements[currentElement];
+	memset(element, 0, sizeof(TBXMLElement));
+	currentElementBuffer->length = currentElement+1;
 
-	return &currentElementBuffer->elements[currentElement];
+	if (!rootXMLElement) rootXMLElement = element;
+	return element;
 }
 
-TBXMLAttribute* TBXML::nextAvailableAttribute() {
-	currentAttribute++;
+TBXMLAttribute* TBXML::nextAvailableAttribute(TBXMLElement* aXMLElement) {
+	// the attributes of aXMLElement so far, at the end of the current buffer
+	size_t count = aXMLElement->attributeCount;
 
 	if (!currentAttributeBuffer) {
-		currentAttributeBuffer = (TBXMLAttributeBuffer*)calloc(1, sizeof(TBXMLAttributeBuffer));
-		currentAttributeBuffer->attributes = (TBXMLAttribute*)calloc(MAX_ATTRIBUTES,sizeof(TBXMLAttribute));
-		currentAttribute = 0;
-	} else if (currentAttribute >= MAX_ATTRIBUTES) {
-		currentAttributeBuffer->next = (TBXMLAttributeBuffer*)calloc(1, sizeof(TBXMLAttributeBuffer));
-		currentAttributeBuffer->next->previous = currentAttributeBuffer;
-		currentAttributeBuffer = currentAttributeBuffer->next;
-		currentAttributeBuffer->attributes = (TBXMLAttribute*)calloc(MAX_ATTRIBUTES,sizeof(TBXMLAttribute));
+		size_t capacity = bytesLength / TBXML_BYTES_PER_ATTRIBUTE;
+		if (capacity < attributeCapacityHint) capacity = attributeCapacityHint;
+		if (!(currentAttributeBuffer = this->allocateAttributeBuffer(capacity))) return NULL;
+		firstAttributeBuffer = currentAttributeBuffer;
 		currentAttribute = 0;
+	} else if ((size_t)(currentAttribute+1) >= currentAttributeBuffer->capacity) {
+		// the next buffer takes the attributes of the element along with the new one, a buffer left by a
+		// previous document or another part may be too small for them
+		TBXMLAttributeBuffer * next = currentAttributeBuffer->next;
+		if (!next || next->capacity < count+1) {
+			size_t capacity = currentAttributeBuffer->capacity*2;
+			if (capacity < count+1) capacity = count+1;
+			TBXMLAttributeBuffer * buffer = this->allocateAttributeBuffer(capacity);
+			if (!buffer) return NULL;
+			buffer->next = next;
+			if (next) next->previous = buffer;
+			currentAttributeBuffer->next = buffer;
+			buffer->previous = currentAttributeBuffer;
+			next = buffer;
+
+			// cut down by the memory limit
+			if (buffer->capacity < count+1) {
+				parseError = D_TBXML_LIMIT_MEMORY;
+				return NULL;
+			}
+		}
+
+		if (count) {
+			memcpy(next->attributes, aXMLElement->firstAttribute, sizeof(TBXMLAttribute)*count);
+			for (size_t i=0; i+1 < count; i++) next->attributes[i].next = &next->attributes[i+1];
+			aXMLElement->firstAttribute = next->attributes;
+		}
+		currentAttributeBuffer = next;
+		currentAttribute = count;
+	} else {
+		currentAttribute++;
+	}
+
+	TBXMLAttribute * attribute = &currentAttributeBuffer->attributes[currentAttribute];
+	memset(attribute, 0, sizeof(TBXMLAttribute));
+
+	// linked after the previous one for the firstAttribute/next view
+	if (count)
+		attribute[-1].next = attribute;
+	else
+		aXMLElement->firstAttribute = attribute;
+	aXMLElement->attributeCount++;
+	return attribute;
+}
+
+TBXMLElementBuffer* TBXML::allocateElementBuffer(size_t capacity) {
+	if (capacity < MIN_ELEMENTS) capacity = MIN_ELEMENTS;
+
+	// under a memory limit the buffer gets the room left, if there is room for an element and the
+	// namespace id it may get
+	if (parseLimits.maxBufferBytes) {
+		size_t used = this->bufferBytes() + sizeof(TBXMLElementBuffer);
+		size_t size = sizeof(TBXMLElement) + (namespaceAware ? sizeof(uint32_t) : 0);
+		size_t room = used < parseLimits.maxBufferBytes ? (parseLimits.maxBufferBytes - used) / size : 0;
+		if (capacity > room) capacity = room;
+		if (!capacity) {
+			parseError = D_TBXML_LIMIT_MEMORY;
+			return NULL;
+		}
+	}
+
+	// one allocation holds the buffer header followed by its elements
+	TBXMLElementBuffer * buffer = (TBXMLElementBuffer*)malloc(sizeof(TBXMLElementBuffer) + sizeof(TBXMLElement)*capacity);
+	if (!buffer) {
+		parseError = D_TBXML_MEMORY_ALLOC_FAILURE;
+		return NULL;
+	}
+	buffer->elements = (TBXMLElement*)(buffer+1);
+	buffer->capacity = capacity;
+	buffer->length = 0;
+	buffer->namespaceIds = NULL;
+	buffer->next = 0;
+	buffer->previous = 0;
+
+	allocations++;
+	TBXML_STAT(parseStatistics.bytesAllocated += sizeof(TBXMLElementBuffer) + sizeof(TBXMLElement)*capacity);
+	TBXML_TRACE(D_TBXML_TRACE_ELEMENT_BUFFER, this, capacity);
+	return buffer;
+}
+
+TBXMLAttributeBuffer* TBXML::allocateAttributeBuffer(size_t capacity) {
+	if (capacity < MIN_ATTRIBUTES) capacity = MIN_ATTRIBUTES;
+
+	if (parseLimits.maxBufferBytes) {
+		size_t used = this->bufferBytes() + sizeof(TBXMLAttributeBuffer);
+		size_t size = sizeof(TBXMLAttribute) + (namespaceAware ? sizeof(uint32_t) : 0);
+		size_t room = used < parseLimits.maxBufferBytes ? (parseLimits.maxBufferBytes - used) / size : 0;
+		if (capacity > room) capacity = room;
+		if (!capacity) {
+			parseError = D_TBXML_LIMIT_MEMORY;
+			return NULL;
+		}
+	}
+
+	TBXMLAttributeBuffer * buffer = (TBXMLAttributeBuffer*)malloc(sizeof(TBXMLAttributeBuffer) + sizeof(TBXMLAttribute)*capacity);
+	if (!buffer) {
+		parseError = D_TBXML_MEMORY_ALLOC_FAILURE;
+		return NULL;
 	}
+	buffer->attributes = (TBXMLAttribute*)(buffer+1);
+	buffer->capacity = capacity;
+	buffer->namespaceIds = NULL;
+	buffer->next = 0;
+	buffer->previous = 0;
+
+	allocations++;
+	TBXML_STAT(parseStatistics.bytesAllocated += sizeof(TBXMLAttributeBuffer) + sizeof(TBXMLAttribute)*capacity);
+	TBXML_TRACE(D_TBXML_TRACE_ATTRIBUTE_BUFFER, this, capacity);
+	return buffer;
+}
+
+void* TBXML::allocateArenaBytes(size_t length) {
+	// keep pointers stored in the arena aligned
+	length = (length + 7) & ~(size_t)7;
+
+	// use the rest of the current block, a block left over from a previous document, or a new one
+	while (!currentArenaBuffer || currentArenaBuffer->used + length > currentArenaBuffer->capacity) {
+		if (currentArenaBuffer && currentArenaBuffer->next) {
+			currentArenaBuffer = currentArenaBuffer->next;
+			currentArenaBuffer->used = 0;
+			continue;
+		}
+
+		size_t capacity = currentArenaBuffer ? currentArenaBuffer->capacity*2 : MIN_ARENA_BYTES;
+		if (capacity < length) capacity = length;
+
+		// under a memory limit the block gets the room left, if the bytes asked for fit
+		if (parseLimits.maxBufferBytes) {
+			size_t used = this->bufferBytes() + sizeof(TBXMLArenaBuffer);
+			size_t room = used < parseLimits.maxBufferBytes ? parseLimits.maxBufferBytes - used : 0;
+			if (capacity > room) capacity = room;
+			if (capacity < length) {
+				parseError = D_TBXML_LIMIT_MEMORY;
+				return NULL;
+			}
+		}
+
+		TBXMLArenaBuffer * buffer = (TBXMLArenaBuffer*)malloc(sizeof(TBXMLArenaBuffer) + capacity);
+		if (!buffer) return NULL;
+		buffer->capacity = capacity;
+		buffer->used = 0;
+		buffer->next = 0;
+		allocations++;
+		TBXML_STAT(parseStatistics.bytesAllocated += sizeof(TBXMLArenaBuffer) + capacity);
+		TBXML_TRACE(D_TBXML_TRACE_ARENA_BUFFER, this, capacity);
+
+		if (currentArenaBuffer)
+			currentArenaBuffer->next = buffer;
+		else
+			firstArenaBuffer = buffer;
+		currentArenaBuffer = buffer;
+	}
+
+	void * rev = (char*)(currentArenaBuffer+1) + currentArenaBuffer->used;
+	currentArenaBuffer->used += length;
+	return rev;
+}
+
+size_t TBXML::bufferBytes() const {
+	// every buffer shares one allocation with its elements, attributes or bytes, namespace ids have their own
+	size_t rev = 0;
+	for (TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) {
+		rev += sizeof(TBXMLElementBuffer) + sizeof(TBXMLElement)*buffer->capacity;
+		if (buffer->namespaceIds) rev += sizeof(uint32_t)*buffer->capacity;
+	}
+	for (TBXMLAttributeBuffer * buffer = firstAttributeBuffer; buffer; buffer = buffer->next) {
+		rev += sizeof(TBXMLAttributeBuffer) + sizeof(TBXMLAttribute)*buffer->capacity;
+		if (buffer->namespaceIds) rev += sizeof(uint32_t)*buffer->capacity;
+	}
+	for (TBXMLArenaBuffer * buffer = firstArenaBuffer; buffer; buffer = buffer->next)
+		rev += sizeof(TBXMLArenaBuffer) + buffer->capacity;
+	return rev;
+}
+
+TBXMLChildIndex* TBXML::buildChildIndex(const TBXMLElement* aXMLElement) {
+	std::lock_guard<std::mutex> lock(arenaLock);
+
+	// another reader may have built it while this one waited
+	TBXMLChildIndex * index = this->childIndexOf(aXMLElement);
+	if (index) return index;
+
+	size_t count = 0;
+	for (const TBXMLElement * child = aXMLElement->firstChild; child; child = child->nextSibling) count++;
+	TBXML_TRACE(D_TBXML_TRACE_CHILD_INDEX, this, count);
+
+	// at most half full, there are never more names than children
+	size_t slots = 16;
+	while (slots < count*2) slots *= 2;
+
+	index = (TBXMLChildIndex*)this->allocateArenaBytes(sizeof(TBXMLChildIndex));
+	if (!index) return NULL;
+	index->mask = slots-1;
+	index->names = (TBXMLChildIndexSlot*)this->allocateArenaBytes(sizeof(TBXMLChildIndexSlot)*slots);
+	index->links = (TBXMLChildIndexLink*)this->allocateArenaBytes(sizeof(TBXMLChildIndexLink)*slots);
+	if (!index->names || !index->links) return NULL;
+	memset(index->names, 0, sizeof(TBXMLChildIndexSlot)*slots);
+	memset(index->links, 0, sizeof(TBXMLChildIndexLink)*slots);
+
+	for (const TBXMLElement * child = aXMLElement->firstChild; child; child = child->nextSibling) {
+		// find the slot of the name, or the empty slot where it goes
+		size_t slot = (size_t)TBXMLSymbolTable::hash(child->name, child->nameLength) & index->mask;
+		const TBXMLElement * first;
+		while ((first = index->names[slot].first)) {
+			if (first->nameLength == child->nameLength && memcmp(first->name, child->name, child->nameLength) == 0) break;
+			slot = (slot+1) & index->mask;
+		}
+
+		if (!first) {
+			index->names[slot].first = child;
+			index->names[slot].last = child;
+			continue;
+		}
+
+		// chain the child behind the last one of the same name
+		size_t link = childIndexPointerSlot(index->names[slot].last, index->mask);
+		while (index->links[link].element) link = (link+1) & index->mask;
+		index->links[link].element = index->names[slot].last;
+		index->links[link].next = child;
+		index->names[slot].last = child;
+	}
+
+	if (!this->addChildIndex(aXMLElement, index)) return NULL;
+	return index;
+}
+
+TBXMLChildIndex* TBXML::childIndexOf(const TBXMLElement* aXMLElement) const {
+	return childIndexTableFind(loadPointer(&childIndices), aXMLElement);
+}
+
+bool TBXML::addChildIndex(const TBXMLElement* aXMLElement, TBXMLChildIndex* aIndex) {
+	// called with arenaLock held, readers may be looking up other elements meanwhile
+	TBXMLChildIndexTable * table = childIndices;
+	if (!table || (table->count+1)*2 > table->mask+1) {
+		size_t slots = table ? (table->mask+1)*2 : 16;
+		TBXMLChildIndexTable * grown = (TBXMLChildIndexTable*)this->allocateArenaBytes(sizeof(TBXMLChildIndexTable));
+		if (!grown) return false;
+		grown->entries = (TBXMLChildIndexEntry*)this->allocateArenaBytes(sizeof(TBXMLChildIndexEntry)*slots);
+		if (!grown->entries) return false;
+		memset(grown->entries, 0, sizeof(TBXMLChildIndexEntry)*slots);
+		grown->mask = slots-1;
+		grown->count = 0;
+
+		// the new table is filled before it is published
+		for (size_t i=0; table && i <= table->mask; i++) {
+			if (!table->entries[i].element) continue;
+			size_t slot = childIndexPointerSlot(table->entries[i].element, grown->mask);
+			while (grown->entries[slot].element) slot = (slot+1) & grown->mask;
+			grown->entries[slot] = table->entries[i];
+			grown->count++;
+		}
+		storePointer(&childIndices, grown);
+		table = grown;
+	}
+
+	size_t slot = childIndexPointerSlot(aXMLElement, table->mask);
+	while (table->entries[slot].element) slot = (slot+1) & table->mask;
+	table->entries[slot].index = aIndex;
+	storePointer(&table->entries[slot].element, aXMLElement);
+	table->count++;
+	return true;
+}
+
+void TBXML::internNames() {
+	// every element handed out, in the order the buffers were used
+	for (TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) {
+		for (size_t i=0; i < buffer->length; i++) {
+			TBXMLElement * xmlElement = &buffer->elements[i];
+			xmlElement->nameId = symbols->intern(xmlElement->name, xmlElement->nameLength);
+			for (TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next)
+				xmlAttribute->nameId = symbols->intern(xmlAttribute->name, xmlAttribute->nameLength);
+		}
+		if (buffer == currentElementBuffer) break;
+	}
+}
+
+uint32_t TBXML::internNamespace(const char* aNamespaceURI, size_t aLength) {
+	if (!namespaces) namespaces = new TBXMLSymbolTable();
+	return namespaces->intern(aNamespaceURI, aLength);
+}
+
+void TBXML::bindNamespaces(const TBXMLElement* aXMLElement, std::vector<TBXMLNamespaceBinding> &aScope) {
+	for (const TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+		if (!isNamespaceDeclaration(xmlAttribute->name, xmlAttribute->nameLength)) continue;
+
+		TBXMLNamespaceBinding binding;
+		binding.prefix = xmlAttribute->name + (xmlAttribute->nameLength > 5 ? 6 : 5);
+		binding.prefixLength = xmlAttribute->nameLength > 5 ? xmlAttribute->nameLength - 6 : 0;
+		binding.namespaceId = xmlAttribute->valueLength ? this->internNamespace(xmlAttribute->value, xmlAttribute->valueLength) : TBXML_NAME_NONE;
+		binding.element = aXMLElement;
+		aScope.push_back(binding);
+	}
+}
+
+void TBXML::resolveNamespaces(TBXMLElement* aXMLElement, std::vector<TBXMLNamespaceBinding> &aScope) {
+	// declarations apply to the element and all of its attributes, so they are taken first
+	this->bindNamespaces(aXMLElement, aScope);
+
+	// nothing declared, only the xml prefix is bound
+	if (aScope.empty()) {
+		for (TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+			if (xmlAttribute->nameLength > 4 && memcmp(xmlAttribute->name, "xml:", 4) == 0)
+				this->setNamespaceId(xmlAttribute, this->internNamespace(TBXML_XML_NAMESPACE, sizeof(TBXML_XML_NAMESPACE)-1));
+		}
+		return;
+	}
+
+	// the innermost declaration of a prefix is in effect, names without one are in the default
+	// namespace for elements and in none for attributes
+	auto resolve = [&](const char* aName, size_t aLength, bool aDefault) -> uint32_t {
+		const char * colon = (const char*)memchr(aName, ':', aLength);
+		size_t length = colon ? colon - aName : 0;
+		if (!length && !aDefault) return TBXML_NAME_NONE;
+		if (length == 3 && memcmp(aName, "xml", 3) == 0)
+			return this->internNamespace(TBXML_XML_NAMESPACE, sizeof(TBXML_XML_NAMESPACE)-1);
+		for (size_t i = aScope.size(); i-- > 0; ) {
+			if (aScope[i].prefixLength == length && memcmp(aScope[i].prefix, aName, length) == 0)
+				return aScope[i].namespaceId;
+		}
+		return TBXML_NAME_NONE;
+	};
+
+	this->setNamespaceId(aXMLElement, resolve(aXMLElement->name, aXMLElement->nameLength, true));
+	for (TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+		if (isNamespaceDeclaration(xmlAttribute->name, xmlAttribute->nameLength))
+			this->setNamespaceId(xmlAttribute, this->internNamespace(TBXML_XMLNS_NAMESPACE, sizeof(TBXML_XMLNS_NAMESPACE)-1));
+		else
+			this->setNamespaceId(xmlAttribute, resolve(xmlAttribute->name, xmlAttribute->nameLength, false));
+	}
+}
+
+bool TBXML::setNamespaceId(const TBXMLElement* aXMLElement, uint32_t aNamespaceId) {
+	// the element is most likely in the current buffer, the ids array of a buffer is allocated with
+	// its first namespace and left out while there is none
+	TBXMLElementBuffer * buffer = currentElementBuffer;
+	if (!buffer || aXMLElement < buffer->elements || aXMLElement >= buffer->elements + buffer->capacity) {
+		for (buffer = firstElementBuffer; buffer; buffer = buffer->next) {
+			if (aXMLElement >= buffer->elements && aXMLElement < buffer->elements + buffer->capacity) break;
+		}
+		if (!buffer) return false;
+	}
+	if (!buffer->namespaceIds) {
+		if (aNamespaceId == TBXML_NAME_NONE) return true;
+		buffer->namespaceIds = (uint32_t*)calloc(buffer->capacity, sizeof(uint32_t));
+		if (!buffer->namespaceIds) {
+			parseError = D_TBXML_MEMORY_ALLOC_FAILURE;
+			return false;
+		}
+		TBXML_STAT(parseStatistics.bytesAllocated += sizeof(uint32_t)*buffer->capacity);
+	}
+	buffer->namespaceIds[aXMLElement - buffer->elements] = aNamespaceId;
+	return true;
+}
+
+bool TBXML::setNamespaceId(const TBXMLAttribute* aXMLAttribute, uint32_t aNamespaceId) {
+	TBXMLAttributeBuffer * buffer = currentAttributeBuffer;
+	if (!buffer || aXMLAttribute < buffer->attributes || aXMLAttribute >= buffer->attributes + buffer->capacity) {
+		for (buffer = firstAttributeBuffer; buffer; buffer = buffer->next) {
+			if (aXMLAttribute >= buffer->attributes && aXMLAttribute < buffer->attributes + buffer->capacity) break;
+		}
+		if (!buffer) return false;
+	}
+	if (!buffer->namespaceIds) {
+		if (aNamespaceId == TBXML_NAME_NONE) return true;
+		buffer->namespaceIds = (uint32_t*)calloc(buffer->capacity, sizeof(uint32_t));
+		if (!buffer->namespaceIds) {
+			parseError = D_TBXML_MEMORY_ALLOC_FAILURE;
+			return false;
+		}
+		TBXML_STAT(parseStatistics.bytesAllocated += sizeof(uint32_t)*buffer->capacity);
+	}
+	buffer->namespaceIds[aXMLAttribute - buffer->attributes] = aNamespaceId;
+	return true;
+}
+
+void TBXML::releaseNamespaceIds() {
+	// the ids belong to the document in the buffers, slots handed out again start without a namespace
+	for (TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) {
+		free(buffer->namespaceIds);
+		buffer->namespaceIds = NULL;
+	}
+	for (TBXMLAttributeBuffer * buffer = firstAttributeBuffer; buffer; buffer = buffer->next) {
+		free(buffer->namespaceIds);
+		buffer->namespaceIds = NULL;
+	}
+}
+
+void TBXML::resolveNamespacesFrom(TBXMLElement* aFirstXMLElement, std::vector<TBXMLNamespaceBinding> &aScope) {
+	// visits aFirstXMLElement, its siblings and their descendants in document order like decodeBytes,
+	// leaving the scope of an element once its children are done
+	const TBXMLElement * parentXMLElement = aFirstXMLElement->parentElement;
+	TBXMLElement * xmlElement = aFirstXMLElement;
+	while (xmlElement) {
+		if (xmlElement->firstAttribute || !aScope.empty()) this->resolveNamespaces(xmlElement, aScope);
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			continue;
+		}
+		while (xmlElement) {
+			closeNamespaces(xmlElement, aScope);
+			if (xmlElement->nextSibling) {
+				xmlElement = xmlElement->nextSibling;
+				break;
+			}
+			xmlElement = xmlElement->parentElement;
+			if (xmlElement == parentXMLElement) xmlElement = NULL;
+		}
+	}
+}
+
+void TBXML::resolveNamespaces() {
+	std::vector<TBXMLNamespaceBinding> scope;
+	if (rootXMLElement) this->resolveNamespacesFrom(rootXMLElement, scope);
+}
+
+TBXMLErrorCodes TBXML::expandElement(TBXMLElement* aXMLElement) {
+	// the element is expanded once whatever the outcome, the caller holds the document lock
+	TBXMLLazyContent content = unexpanded[aXMLElement];
+	unexpanded.erase(aXMLElement);
+
+	// the content is decoded like a part of a parallel parse, its top elements becoming the children
+	TBXMLParseChunk chunk;
+	chunk.start = content.start;
+	chunk.end = content.end;
+	for (const TBXMLElement * xmlElement = aXMLElement; xmlElement; xmlElement = xmlElement->parentElement) chunk.outerDepth++;
+
+	// the buffers are rewound here if the expansion fails
+	TBXMLElementBuffer * elementBuffer = currentElementBuffer;
+	long element = currentElement;
+
+	TBXML_TRACE(D_TBXML_TRACE_PART_BEGIN, this, content.end - content.start);
+	this->decodeBytes(content.start, content.end, &chunk);
+	TBXML_TRACE(D_TBXML_TRACE_PART_END, this, content.end - content.start);
+	if (chunk.terminator) *chunk.terminator = 0;
+
+	TBXMLErrorCodes code = parseError;
+	parseError = D_TBXML_SUCCESS;
+	if (code == D_TBXML_SUCCESS) {
+		TBXMLElement * lastXMLElement = NULL;
+		for (TBXMLParseRun &run : chunk.runs) {
+			if (!run.first) continue;
+			if (lastXMLElement) {
+				lastXMLElement->nextSibling = run.first;
+				run.first->previousSibling = lastXMLElement;
+			} else {
+				aXMLElement->firstChild = run.first;
+			}
+			for (TBXMLElement * xmlElement = run.first; xmlElement; xmlElement = xmlElement->nextSibling) xmlElement->parentElement = aXMLElement;
+			lastXMLElement = run.last;
+		}
+		aXMLElement->currentChild = lastXMLElement;
+		if (aXMLElement->firstChild) documentOrder = false;
+
+		// the declarations of the element and its ancestors are in scope of the new elements
+		if (namespaceAware && aXMLElement->firstChild) {
+			std::vector<const TBXMLElement*> ancestors;
+			for (const TBXMLElement * xmlElement = aXMLElement; xmlElement; xmlElement = xmlElement->parentElement) ancestors.push_back(xmlElement);
+			std::vector<TBXMLNamespaceBinding> scope;
+			for (size_t i = ancestors.size(); i-- > 0; ) this->bindNamespaces(ancestors[i], scope);
+			if (chunk.namespaces || !scope.empty()) this->resolveNamespacesFrom(aXMLElement->firstChild, scope);
+		}
+	} else {
+		// the elements decoded are dropped, with those of them left unexpanded
+		std::vector<const TBXMLElement*> dropped;
+		for (TBXMLParseRun &run : chunk.runs) {
+			if (run.first) dropped.push_back(run.first);
+		}
+		while (!dropped.empty()) {
+			const TBXMLElement * xmlElement = dropped.back();
+			dropped.pop_back();
+			for (; xmlElement; xmlElement = xmlElement->nextSibling) {
+				if (xmlElement->flags & TBXML_FLAG_UNEXPANDED) unexpanded.erase(xmlElement);
+				if (xmlElement->firstChild) dropped.push_back(xmlElement->firstChild);
+			}
+		}
+
+		// and given back, so walks over the buffers don't see them
+		if (currentElementBuffer != elementBuffer) {
+			for (TBXMLElementBuffer * buffer = elementBuffer->next; buffer; buffer = buffer->next) {
+				buffer->length = 0;
+				if (buffer == currentElementBuffer) break;
+			}
+		}
+		currentElementBuffer = elementBuffer;
+		currentElement = element;
+		elementBuffer->length = element+1;
+	}
+
+	// readers seeing the flag cleared see the children
+	storeFlags(&aXMLElement->flags, aXMLElement->flags & ~TBXML_FLAG_UNEXPANDED);
+	return code;
+}
+
+void TBXML::finishParseStats(uint64_t aStartNanoseconds, uint64_t aStartTicks) {
+	// the buffers in use are those up to the current ones, the ones after them are left from a previous
+	// document
+	for (TBXMLElementBuffer * buffer = firstElementBuffer; buffer; buffer = buffer->next) {
+		parseStatistics.elementBuffers++;
+		if (buffer == currentElementBuffer) break;
+	}
+	for (TBXMLAttributeBuffer * buffer = firstAttributeBuffer; buffer; buffer = buffer->next) {
+		parseStatistics.attributeBuffers++;
+		if (buffer == currentAttributeBuffer) break;
+	}
+
+	// convert the phase times from ticks at the rate the ticks went at over the whole parse
+	uint64_t nanoseconds = steadyNanoseconds() - aStartNanoseconds;
+	uint64_t ticks = TBXMLStats::ticks() - aStartTicks;
+	double nanosecondsPerTick = ticks ? (double)nanoseconds / (double)ticks : 1.0;
+	parseStatistics.scanNanoseconds = (uint64_t)(parseStatistics.scanNanoseconds * nanosecondsPerTick);
+	parseStatistics.attributeNanoseconds = (uint64_t)(parseStatistics.attributeNanoseconds * nanosecondsPerTick);
+	parseStatistics.trimNanoseconds = (uint64_t)(parseStatistics.trimNanoseconds * nanosecondsPerTick);
+	parseStatistics.parseNanoseconds = nanoseconds;
+	parseStatistics.parses = 1;
+
+	TBXMLStats::add(parseStatistics);
+}
+
+TBXMLArenaRange TBXML::arenaRange(const TBXMLElement* aXMLElement, const TBXMLName* aName) const {
+	if (!rootXMLElement) return TBXMLArenaRange(TBXMLArenaIterator(), TBXMLArenaIterator());
+	if (!aXMLElement) {
+		TBXMLArenaIterator first(firstElementBuffer, firstElementBuffer->elements, currentElementBuffer, NULL, aName, NULL);
+		return TBXMLArenaRange(first, TBXMLArenaIterator());
+	}
+
+	// the descendants start after the element, in the buffer holding it
+	const TBXMLElementBuffer * buffer = firstElementBuffer;
+	while (buffer != currentElementBuffer && (aXMLElement < buffer->elements || aXMLElement >= buffer->elements + buffer->length)) buffer = buffer->next;
+
+	// and end at the element following it in document order, unless an expansion built some of them later
+	const TBXMLElement * stop = NULL;
+	if (documentOrder) {
+		for (const TBXMLElement * xmlElement = aXMLElement; xmlElement && !stop; xmlElement = xmlElement->parentElement) stop = xmlElement->nextSibling;
+	}
+
+	TBXMLArenaIterator first(buffer, aXMLElement+1, currentElementBuffer, stop, aName, documentOrder ? NULL : aXMLElement);
+	return TBXMLArenaRange(first, TBXMLArenaIterator(stop));
+}
+
+void TBXML::adoptBuffers(TBXML &aOther) {
+	// the other document's buffers go behind this one's and its current buffers become the current ones,
+	// buffers before them may be partly used
+	if (aOther.firstElementBuffer) {
+		TBXMLElementBuffer * last = firstElementBuffer;
+		while (last && last->next) last = last->next;
+		if (last) {
+			last->next = aOther.firstElementBuffer;
+			aOther.firstElementBuffer->previous = last;
+		} else {
+			firstElementBuffer = aOther.firstElementBuffer;
+		}
+		currentElementBuffer = aOther.currentElementBuffer;
+		currentElement = aOther.currentElement;
+	}
+
+	if (aOther.firstAttributeBuffer) {
+		TBXMLAttributeBuffer * last = firstAttributeBuffer;
+		while (last && last->next) last = last->next;
+		if (last) {
+			last->next = aOther.firstAttributeBuffer;
+			aOther.firstAttributeBuffer->previous = last;
+		} else {
+			firstAttributeBuffer = aOther.firstAttributeBuffer;
+		}
+		currentAttributeBuffer = aOther.currentAttributeBuffer;
+		currentAttribute = aOther.currentAttribute;
+	}
+
+	allocations += aOther.allocations;
 
-	return &currentAttributeBuffer->attributes[currentAttribute];
+	aOther.firstElementBuffer = 0;
+	aOther.currentElementBuffer = 0;
+	aOther.firstAttributeBuffer = 0;
+	aOther.currentAttributeBuffer = 0;
+	aOther.allocations = 0;
 }
@@ -32,6 +32,13 @@
 #define _TBXML_H_
 
 #include <string>
+#include <string_view>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <iterator>
+#include "TBXMLSymbolTable.h"
+#include "TBXMLStats.h"
 using namespace std;
 
 // ================================================================================================
@@ -52,7 +59,43 @@ enum TBXMLErrorCodes {
     D_TBXML_ATTRIBUTE_IS_NIL,
     D_TBXML_ATTRIBUTE_NAME_IS_NIL,
     D_TBXML_ATTRIBUTE_NOT_FOUND,
-    D_TBXML_PARAM_NAME_IS_NIL
+    D_TBXML_PARAM_NAME_IS_NIL,
+    D_TBXML_DOCUMENT_TOO_LARGE,
+    D_TBXML_TOKEN_TOO_LARGE,
+    D_TBXML_QUERY_INVALID,
+    D_TBXML_VALUE_NOT_A_NUMBER,
+    D_TBXML_VALUE_OUT_OF_RANGE,
+    D_TBXML_VALUE_NOT_A_BOOLEAN,
+    D_TBXML_WRITE_FAILURE,
+    D_TBXML_WRITE_OUT_OF_ORDER,
+    D_TBXML_SNAPSHOT_INVALID,
+    D_TBXML_SNAPSHOT_VERSION,
+    D_TBXML_SNAPSHOT_CHECKSUM,
+    D_TBXML_LIMIT_BYTES,
+    D_TBXML_LIMIT_DEPTH,
+    D_TBXML_LIMIT_ELEMENTS,
+    D_TBXML_LIMIT_ATTRIBUTES,
+    D_TBXML_LIMIT_NAME_LENGTH,
+    D_TBXML_LIMIT_VALUE_LENGTH,
+    D_TBXML_LIMIT_MEMORY,
+    D_TBXML_MARKUP_UNTERMINATED
+};
+
+// ================================================================================================
+//  File Load Modes
+// ================================================================================================
+enum TBXMLLoadMode {
+	D_TBXML_LOAD_READ = 0,		// read the file into a heap buffer
+	D_TBXML_LOAD_MMAP			// parse a private copy-on-write mapping of the file in place
+};
+
+// ================================================================================================
+//  Entity Modes
+// ================================================================================================
+enum TBXMLEntityMode {
+	D_TBXML_ENTITIES_NONE = 0,	// text and values hold the references of the document as they are
+	D_TBXML_ENTITIES_EAGER,		// references are decoded in place while parsing
+	D_TBXML_ENTITIES_LAZY		// references are decoded in place by decodedText/decodedValue on first use
 };
 
 
@@ -61,8 +104,37 @@ enum TBXMLErrorCodes {
 // ================================================================================================
 #define D_TBXML_DOMAIN "com.71squared.tbxml"
 
-#define MAX_ELEMENTS 100
-#define MAX_ATTRIBUTES 100
+// smallest number of elements/attributes in a buffer, later buffers double in size
+#define MIN_ELEMENTS 100
+#define MIN_ATTRIBUTES 100
+
+// average number of document bytes per element/attribute, used to size the first buffers
+#define TBXML_BYTES_PER_ELEMENT 32
+#define TBXML_BYTES_PER_ATTRIBUTE 64
+
+// smallest block of the document arena holding child indices
+#define MIN_ARENA_BYTES 4096
+
+// suggested setChildIndexThreshold, above it an index beats walking the children (see bench/)
+#define TBXML_CHILD_INDEX_THRESHOLD 16
+
+// smallest part of a document given to a thread by setParseThreadCount, smaller documents use fewer threads
+#define TBXML_PARALLEL_MIN_BYTES (1024*1024)
+
+// set in TBXMLElement/TBXMLAttribute flags once the references in the text or value were decoded
+#define TBXML_FLAG_DECODED 1
+
+// set in TBXMLElement flags while the content of an element of a lazy document is not parsed yet
+#define TBXML_FLAG_UNEXPANDED 2
+
+// elements ahead of the one a TBXMLArenaIterator reads that it prefetches, 0 to leave it to the hardware
+#ifndef TBXML_PREFETCH_ELEMENTS
+#define TBXML_PREFETCH_ELEMENTS 16
+#endif
+
+// namespaces bound without a declaration, to the xml prefix and to xmlns attributes
+#define TBXML_XML_NAMESPACE "http://www.w3.org/XML/1998/namespace"
+#define TBXML_XMLNS_NAMESPACE "http://www.w3.org/2000/xmlns/"
 
 #define TBXML_ATTRIBUTE_NAME_START 0
 #define TBXML_ATTRIBUTE_NAME_END 1
@@ -74,23 +146,46 @@ enum TBXMLErrorCodes {
 //  Structures
 // ================================================================================================
 
-/** The TBXMLAttribute structure holds information about a single XML attribute. The structure holds the attribute name, value and next sibling attribute. This structure allows us to create a linked list of attributes belonging to a specific element.
+// name lookup index of a wide element, built by TBXML::indexedChildElementNamed
+struct _TBXMLChildIndex;
+
+// the child indices of a document by element
+struct _TBXMLChildIndexTable;
+
+// part of a document decoded by one thread of a parallel parse
+struct _TBXMLParseChunk;
+
+// the paths a document is parsed for, see TBXMLProjection.h
+class TBXMLProjection;
+
+/** The TBXMLAttribute structure holds information about a single XML attribute. The structure holds the attribute name, value and next sibling attribute. This structure allows us to create a linked list of attributes belonging to a specific element. The name and value lengths are recorded by the parser, so lookups don't need strlen. flags holds TBXML_FLAG_DECODED once the references in the value were decoded. The namespace of a prefixed name in a namespace aware document is given by TBXML::namespaceId.
  */
 typedef struct _TBXMLAttribute {
 	char * name;
 	char * value;
 	struct _TBXMLAttribute * next;
+
+	unsigned int nameLength;
+	unsigned int valueLength;
+	uint32_t nameId;
+	uint32_t flags;
 } TBXMLAttribute;
 
 
 
-/** The TBXMLElement structure holds information about a single XML element. The structure holds the element name & text along with pointers to the first attribute, parent element, first child element and first sibling element. Using this structure, we can create a linked list of TBXMLElements to map out an entire XML file.
+/** The TBXMLElement structure holds information about a single XML element. The structure holds the element name & text along with pointers to the first attribute, parent element, first child element and first sibling element. Using this structure, we can create a linked list of TBXMLElements to map out an entire XML file. The name and text lengths are recorded by the parser (textLength is 0 when text is nil), nameId when it interns names into a TBXMLSymbolTable. flags holds TBXML_FLAG_DECODED once the references in the text were decoded. The namespace of the element in a namespace aware document is given by TBXML::namespaceId. The attributes of an element are contiguous, firstAttribute[0] to firstAttribute[attributeCount-1], and also linked through next. On 64 bit platforms the structure takes 88 bytes (64 before the lengths, ids, flags and attribute count were added); child indices and namespace ids are kept by the document; TBXMLCompact holds a parsed tree in 24 bytes per element.
  */
 typedef struct _TBXMLElement {
 	char * name;
 	char * text;
+
+	unsigned int nameLength;
+	uint32_t nameId;
+	size_t textLength;
 	
 	TBXMLAttribute * firstAttribute;
+	uint32_t attributeCount;
+	uint32_t flags;
 	
 	struct _TBXMLElement * parentElement;
 	
@@ -102,33 +197,267 @@ typedef struct _TBXMLElement {
 	
 } TBXMLElement;
 
-/** The TBXMLElementBuffer is a structure that holds a buffer of TBXMLElements. When the buffer of elements is used, an additional buffer is created and linked to the previous one. This allows for efficient memory allocation/deallocation elements.
+/** The TBXMLElementBuffer is a structure that holds a buffer of TBXMLElements. When the buffer of elements is used, an additional buffer twice the size is created and linked to the previous one. This allows for efficient memory allocation/deallocation elements.
  */
 typedef struct _TBXMLElementBuffer {
 	TBXMLElement * elements;
+	size_t capacity;
+	size_t length;					// elements handed out, buffers before the current one may be partly used
+	uint32_t * namespaceIds;		// of the elements, allocated with the first id that isn't TBXML_NAME_NONE
 	struct _TBXMLElementBuffer * next;
 	struct _TBXMLElementBuffer * previous;
 } TBXMLElementBuffer;
 
 
 
-/** The TBXMLAttributeBuffer is a structure that holds a buffer of TBXMLAttributes. When the buffer of attributes is used, an additional buffer is created and linked to the previous one. This allows for efficient memeory allocation/deallocation of attributes.
+/** The TBXMLAttributeBuffer is a structure that holds a buffer of TBXMLAttributes. When the buffer of attributes is used, an additional buffer is created and linked to the previous one. This allows for efficient memeory allocation/deallocation of attributes. The attributes of an element are never split between buffers, those it has move to the next buffer with it.
  */
 typedef struct _TBXMLAttributeBuffer {
 	TBXMLAttribute * attributes;
+	size_t capacity;
+	uint32_t * namespaceIds;		// of the attributes, allocated with the first id that isn't TBXML_NAME_NONE
 	struct _TBXMLAttributeBuffer * next;
 	struct _TBXMLAttributeBuffer * previous;
 } TBXMLAttributeBuffer;
 
+
+
+/** The TBXMLArenaBuffer is a structure that holds a block of bytes handed out in pieces for data belonging to the document that is neither an element nor an attribute, such as child indices. The bytes follow the structure in the same allocation.
+ */
+typedef struct _TBXMLArenaBuffer {
+	size_t capacity;
+	size_t used;
+	struct _TBXMLArenaBuffer * next;
+} TBXMLArenaBuffer;
+
+/** The TBXMLLimits structure holds the resources a single parse may use, see TBXML::setLimits. A limit of 0
+    is no limit.
+ */
+typedef struct _TBXMLLimits {
+	size_t maxBytes;				// length of the document
+	size_t maxDepth;				// elements open at once
+	size_t maxElements;				// elements of the document
+	size_t maxAttributes;			// attributes of an element
+	size_t maxNameLength;			// length of an element or attribute name
+	size_t maxValueLength;			// length of an attribute value as written in the document
+	size_t maxBufferBytes;			// bytes of the element, attribute and arena buffers of the document and its namespace ids
+} TBXMLLimits;
+
+// a prefix in scope while a namespace aware document is parsed, bound by an attribute of element
+typedef struct _TBXMLNamespaceBinding {
+	const char * prefix;
+	size_t prefixLength;			// 0 for the default namespace
+	uint32_t namespaceId;			// TBXML_NAME_NONE once the default namespace is undeclared
+	const TBXMLElement * element;
+} TBXMLNamespaceBinding;
+
+// the content of an element left unexpanded by a lazy parse, from the end of its start tag to the start of
+// its end tag
+typedef struct _TBXMLLazyContent {
+	char * start;
+	char * end;
+} TBXMLLazyContent;
+
+// ================================================================================================
+//  Iterators
+// ================================================================================================
+
+/** TBXMLRange is a pair of iterators for range based for and the standard algorithms. The iterators over
+    a document follow its links or buffers without allocating and are invalid once it is reset.
+ */
+template<typename Iterator> class TBXMLRange {
+public:
+	TBXMLRange(Iterator aBegin, Iterator aEnd) : first(aBegin), last(aEnd) {}
+
+	Iterator begin() const { return first; }
+	Iterator end() const { return last; }
+	bool empty() const { return first == last; }
+
+private:
+	Iterator first;
+	Iterator last;
+};
+
+// the children of an element, following nextSibling
+class TBXMLChildIterator {
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef const TBXMLElement* value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const TBXMLElement* const* pointer;
+	typedef const TBXMLElement* const& reference;
+
+	TBXMLChildIterator(const TBXMLElement* aXMLElement = NULL) : element(aXMLElement) {}
+
+	reference operator*() const { return element; }
+	pointer operator->() const { return &element; }
+	TBXMLChildIterator& operator++() { element = element->nextSibling; return *this; }
+	TBXMLChildIterator operator++(int) { TBXMLChildIterator rev = *this; ++*this; return rev; }
+	bool operator==(const TBXMLChildIterator &aOther) const { return element == aOther.element; }
+	bool operator!=(const TBXMLChildIterator &aOther) const { return element != aOther.element; }
+
+private:
+	const TBXMLElement * element;
+};
+
+// the elements below an element in document order, going down firstChild and back up parentElement
+class TBXMLDescendantIterator {
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef const TBXMLElement* value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const TBXMLElement* const* pointer;
+	typedef const TBXMLElement* const& reference;
+
+	TBXMLDescendantIterator(const TBXMLElement* aXMLElement = NULL, const TBXMLElement* aRootXMLElement = NULL) : element(aXMLElement), root(aRootXMLElement) {}
+
+	reference operator*() const { return element; }
+	pointer operator->() const { return &element; }
+	TBXMLDescendantIterator& operator++() {
+		if (element->firstChild) {
+			element = element->firstChild;
+			return *this;
+		}
+		while (element != root && !element->nextSibling) element = element->parentElement;
+		element = element != root ? element->nextSibling : NULL;
+		return *this;
+	}
+	TBXMLDescendantIterator operator++(int) { TBXMLDescendantIterator rev = *this; ++*this; return rev; }
+	bool operator==(const TBXMLDescendantIterator &aOther) const { return element == aOther.element; }
+	bool operator!=(const TBXMLDescendantIterator &aOther) const { return element != aOther.element; }
+
+private:
+	const TBXMLElement * element;
+	const TBXMLElement * root;
+};
+
+/** TBXMLArenaIterator reads the elements of a document from its element buffers in memory order, the
+    order they were built in, instead of following the links, see TBXML::elements. It selects the
+    elements with a name, and below an ancestor when given one, and ends at the element stop or after
+    the last buffer.
+ */
+class TBXMLArenaIterator {
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef const TBXMLElement* value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const TBXMLElement* const* pointer;
+	typedef const TBXMLElement* const& reference;
+
+	TBXMLArenaIterator(const TBXMLElement* aStop = NULL) : element(aStop), bufferEnd(NULL), buffer(NULL), lastBuffer(NULL), stop(aStop), name(), anyName(true), ancestor(NULL) {}
+
+	TBXMLArenaIterator(const TBXMLElementBuffer* aBuffer, const TBXMLElement* aXMLElement, const TBXMLElementBuffer* aLastBuffer, const TBXMLElement* aStop, const TBXMLName* aName, const TBXMLElement* aAncestor)
+		: element(aXMLElement), bufferEnd(aBuffer->elements + aBuffer->length), buffer(aBuffer), lastBuffer(aLastBuffer), stop(aStop), name(), anyName(!aName), ancestor(aAncestor) {
+		if (aName) name = *aName;
+		this->settle();
+	}
+
+	reference operator*() const { return element; }
+	pointer operator->() const { return &element; }
+	TBXMLArenaIterator& operator++() { element++; this->settle(); return *this; }
+	TBXMLArenaIterator operator++(int) { TBXMLArenaIterator rev = *this; ++*this; return rev; }
+	bool operator==(const TBXMLArenaIterator &aOther) const { return element == aOther.element; }
+	bool operator!=(const TBXMLArenaIterator &aOther) const { return element != aOther.element; }
+
+private:
+	const TBXMLElement * element;
+	const TBXMLElement * bufferEnd;
+	const TBXMLElementBuffer * buffer;
+	const TBXMLElementBuffer * lastBuffer;
+	const TBXMLElement * stop;
+	TBXMLName name;
+	bool anyName;
+	const TBXMLElement * ancestor;
+
+	// moves on to the first element from here that is selected, or to the end
+	inline void settle() {
+		while (element != stop) {
+			if (element == bufferEnd) {
+				if (buffer == lastBuffer) {
+					element = stop;
+					return;
+				}
+				buffer = buffer->next;
+				element = buffer->elements;
+				bufferEnd = element + buffer->length;
+				continue;
+			}
+#if TBXML_PREFETCH_ELEMENTS && (defined(__GNUC__) || defined(__clang__))
+			if (bufferEnd - element > TBXML_PREFETCH_ELEMENTS) __builtin_prefetch(element + TBXML_PREFETCH_ELEMENTS);
+#endif
+			if ((anyName || name.matches(element->nameId, element->name, element->nameLength)) && (!ancestor || this->descends())) return;
+			element++;
+		}
+	}
+
+	inline bool descends() const {
+		for (const TBXMLElement * xmlElement = element->parentElement; xmlElement; xmlElement = xmlElement->parentElement) {
+			if (xmlElement == ancestor) return true;
+		}
+		return false;
+	}
+};
+
+typedef TBXMLRange<TBXMLChildIterator> TBXMLChildRange;
+typedef TBXMLRange<TBXMLDescendantIterator> TBXMLDescendantRange;
+typedef TBXMLRange<const TBXMLAttribute*> TBXMLAttributeRange;
+typedef TBXMLRange<TBXMLArenaIterator> TBXMLArenaRange;
+
 class TBXML {
+	friend class TBXMLCompact;
+	friend class TBXMLStreamParser;
+	friend class TBXMLPushParser;
+	friend class TBXMLBatch;
+	friend class TBXMLQuery;
+	friend class TBXMLWriter;
+	friend class TBXMLProjection;
+
 public:
 	TBXML();
 	~TBXML();
 
+	// documents own their buffers, they can be moved (e.g. out of a pool into another thread) but not copied
+	TBXML(TBXML &&aOther);
+	TBXML& operator=(TBXML &&aOther);
+	TBXML(const TBXML &) = delete;
+	TBXML& operator=(const TBXML &) = delete;
+
+	/** Forgets the current document but keeps the element, attribute and byte buffers allocated, so the
+	    next initWithXMLString/initWithXMLFile parses without going back to the allocator. Called by the
+	    init methods, elements returned for the previous document are invalid afterwards.
+	 */
+	void reset();
+
+	/** Sizes the first element/attribute buffers for documents parsed from now on, overriding the estimate
+	    made from the document length when larger. Pass 0 to only use the estimate.
+	 */
+	void setCapacityHint(size_t aElementCount, size_t aAttributeCount);
+
+	/** Number of heap allocations made for this document's byte, element and attribute buffers since it
+	    was created. Buffers grow geometrically, so a document of n nodes needs O(log n) allocations.
+	 */
+	size_t allocationCount() const;
+
+	/** Statistics of the last parse, see TBXMLParseStats. All zero unless the library was built with
+	    TBXML_STATS=1.
+	 */
+	const TBXMLParseStats& parseStats() const;
+
+	/** Interns element and attribute names into aSymbolTable while parsing, storing their ids in nameId so
+	    the TBXMLName lookups compare integers. The table is owned by the caller and may be shared by
+	    documents (see TBXMLSymbolTable). Pass NULL, the default, to parse without interning.
+	 */
+	void setSymbolTable(TBXMLSymbolTable *aSymbolTable);
+	TBXMLSymbolTable* symbolTable() const;
+
 	TBXMLElement * rootXMLElement;
 
+	/** Parse a document, returning false with the error of the code that stopped the parse. A comment,
+	    cdata section or tag running to the end of the document fails with D_TBXML_MARKUP_UNTERMINATED.
+	 */
 	bool initWithXMLString(std::string &aXMLString, std::string &error);
 	bool initWithXMLFile(std::string &aXMLFile, std::string &error);
+	bool initWithXMLFile(std::string &aXMLFile, TBXMLLoadMode aLoadMode, std::string &error);
 
 	static std::string elementName(TBXMLElement* aXMLElement);
 	static std::string elementName(TBXMLElement* aXMLElement, std::string &error);
@@ -147,23 +476,292 @@ public:
 	static TBXMLElement* nextSiblingNamed(std::string &aName, TBXMLElement* searchFromElement);
 	static TBXMLElement* nextSiblingNamed(std::string &aName, TBXMLElement* searchFromElement, std::string &error);
 
+	// allocation free overloads for const elements, the views point into the document and are valid
+	// until it is reset or destroyed. Missing text, attributes and elements come back as an empty view
+	// with a NULL data() or a NULL element.
+	static std::string_view elementName(const TBXMLElement* aXMLElement);
+	static std::string_view textForElement(const TBXMLElement* aXMLElement);
+	static std::string_view valueOfAttributeNamed(std::string_view aName, const TBXMLElement* forElement);
+
+	static std::string_view attributeName(const TBXMLAttribute* aXMLAttribute);
+	static std::string_view attributeValue(const TBXMLAttribute* aXMLAttribute);
+
+	static const TBXMLElement* childElementNamed(std::string_view aName, const TBXMLElement* parentElement);
+	static const TBXMLElement* nextSiblingNamed(std::string_view aName, const TBXMLElement* searchFromElement);
+
+	// lookups by a name resolved once with TBXMLSymbolTable::name, comparing ids when the document was
+	// parsed with the same table
+	static std::string_view valueOfAttributeNamed(const TBXMLName &aName, const TBXMLElement* forElement);
+	static const TBXMLElement* childElementNamed(const TBXMLName &aName, const TBXMLElement* parentElement);
+	static const TBXMLElement* nextSiblingNamed(const TBXMLName &aName, const TBXMLElement* searchFromElement);
+
+	// typed values converted with std::from_chars where they are in the document, without allocating or
+	// consulting the locale. Whitespace around a value is ignored, numbers may start with '+' and booleans
+	// are true, false, 1 or 0. aDefault is returned when the element, attribute or text is missing or
+	// isn't a value of the type, aErrorCode tells which when given.
+	static int intAttribute(std::string_view aName, const TBXMLElement* forElement, int aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static int64_t int64Attribute(std::string_view aName, const TBXMLElement* forElement, int64_t aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static double doubleAttribute(std::string_view aName, const TBXMLElement* forElement, double aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static bool boolAttribute(std::string_view aName, const TBXMLElement* forElement, bool aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+
+	static int intAttribute(const TBXMLName &aName, const TBXMLElement* forElement, int aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static int64_t int64Attribute(const TBXMLName &aName, const TBXMLElement* forElement, int64_t aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static double doubleAttribute(const TBXMLName &aName, const TBXMLElement* forElement, double aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static bool boolAttribute(const TBXMLName &aName, const TBXMLElement* forElement, bool aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+
+	static int intText(const TBXMLElement* aXMLElement, int aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static int64_t int64Text(const TBXMLElement* aXMLElement, int64_t aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static double doubleText(const TBXMLElement* aXMLElement, double aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+	static bool boolText(const TBXMLElement* aXMLElement, bool aDefault, TBXMLErrorCodes* aErrorCode = NULL);
+
+	/** Parses documents with up to aThreadCount threads, each decoding at least TBXML_PARALLEL_MIN_BYTES.
+	    The document is split at tags, the threads build the elements of their part into buffers of
+	    their own and the parts are linked afterwards; the tree is the one a serial parse builds. 1, the
+	    default, parses on the calling thread only.
+	 */
+	void setParseThreadCount(size_t aThreadCount);
+	size_t parseThreadCount() const;
+
+	/** Decodes the predefined entities (&amp; &lt; &gt; &quot; &apos;) and character references (&#38;
+	    &#x26;, written as UTF-8) in text and attribute values, in place as the result is never longer.
+	    Text and values without a '&' are only searched for one. CDATA sections are left as they are, so
+	    text and values holding one are decoded while parsing in both modes. Unknown entities and
+	    malformed references are kept. D_TBXML_ENTITIES_NONE, the default, leaves the references alone.
+	 */
+	void setEntityMode(TBXMLEntityMode aEntityMode);
+	TBXMLEntityMode entityMode() const;
+
+	/** Limits the resources of the documents parsed from now on, see TBXMLLimits. A parse stops at the
+	    first limit it reaches: the init methods return false with the D_TBXML_LIMIT_* error and leave
+	    rootXMLElement NULL. Documents over maxBytes are refused before they are read. Buffers kept from
+	    a previous document count against maxBufferBytes, later buffers are cut down to fit. The parts of
+	    a parallel parse are checked as they are decoded and the totals once they are linked, so up to
+	    parseThreadCount() times maxBufferBytes may be held before it fails. All zero, the default, is
+	    unlimited.
+	 */
+	void setLimits(const TBXMLLimits &aLimits);
+	const TBXMLLimits& limits() const;
+
+	/** Resolves the namespaces of the documents parsed from now on: the xmlns declarations in scope are
+	    kept while parsing and every element, and every attribute with a prefix, gets the id of its
+	    namespace URI, see namespaceId. Ids are given out by the document as URIs are declared and are
+	    valid until it is reset; the local name is the part of the name after the prefix. Elements
+	    without a namespace, undeclared prefixes and attributes without a prefix get TBXML_NAME_NONE.
+	    A document without declarations costs only a look at the first bytes of its attribute names.
+	    The ids are kept in arrays beside the element and attribute buffers, which only documents with
+	    a namespace allocate. Off by default.
+	 */
+	void setNamespaceAware(bool aNamespaceAware);
+	bool isNamespaceAware() const;
+
+	/** Parses only the elements on the paths of aProjection, stepping over every other subtree by counting
+	    its tags, without allocating or decoding it (see TBXMLProjection). The projection is owned by the
+	    caller and must outlive the parses using it. A projected document is parsed on the calling thread
+	    whatever setParseThreadCount says. Pass NULL, the default, to parse the whole document.
+	 */
+	void setProjection(const TBXMLProjection *aProjection);
+	const TBXMLProjection* projection() const;
+
+	/** Parses documents lazily: the elements aDepth levels down (the root element is level 1) are built
+	    with their name, attributes and text, but the content of those with a child that isn't self
+	    closing is only stepped over and located, and the element is flagged TBXML_FLAG_UNEXPANDED.
+	    firstChild parses that content on first use, building the next aDepth levels the same way, so
+	    the time to the first answer follows what is read rather than the size of the document. Several
+	    threads may read a lazy document and expand its elements at once, each element is expanded once.
+	    Expansions count against the limits of the parse.
+
+	    Code following the firstChild field, like the static lookups, TBXMLQuery, TBXMLWriter and
+	    TBXMLCompact, sees unexpanded elements without children; expandAll first to hand them the whole
+	    document. Lazy documents are parsed on the calling thread and a projection, which builds only what
+	    it keeps anyway, takes precedence. An expansion may add to the namespaces of a namespace aware
+	    document, so namespaceId and namespaceURI must not run during one. 0, the default, parses the
+	    whole document.
+	 */
+	void setLazyDepth(size_t aDepth);
+	size_t lazyDepth() const;
+
+	/** The first child of an element of this document, expanding the element first when it is flagged
+	    TBXML_FLAG_UNEXPANDED.
+	 */
+	const TBXMLElement* firstChild(const TBXMLElement* aXMLElement);
+
+	/** Expands aXMLElement if it is unexpanded, or every element until none is left. Returns false with
+	    the D_TBXML_LIMIT_* error when an expansion reached a limit, the element is left without children.
+	 */
+	bool expand(const TBXMLElement* aXMLElement, std::string &error);
+	bool expandAll(std::string &error);
+
+	/** The id of aNamespaceURI in this document or TBXML_NAME_NONE when it wasn't declared, and the URI of
+	    an id.
+	 */
+	uint32_t namespaceId(std::string_view aNamespaceURI) const;
+	std::string_view namespaceURI(uint32_t aNamespaceId) const;
+
+	/** The id of the namespace of an element or attribute of this document, TBXML_NAME_NONE when it has
+	    none or the document isn't namespace aware.
+	 */
+	uint32_t namespaceId(const TBXMLElement* aXMLElement) const;
+	uint32_t namespaceId(const TBXMLAttribute* aXMLAttribute) const;
+
+	static std::string_view localName(const TBXMLElement* aXMLElement);
+	static std::string_view localName(const TBXMLAttribute* aXMLAttribute);
+
+	/** Lookups by namespace and local name, comparing ids and then the local part of the names. An empty
+	    aNamespaceURI, or TBXML_NAME_NONE, matches names without a namespace; a URI the document didn't
+	    declare matches nothing.
+	 */
+	const TBXMLElement* childElementNamedNS(std::string_view aNamespaceURI, std::string_view aLocalName, const TBXMLElement* parentElement) const;
+	const TBXMLElement* nextSiblingNamedNS(std::string_view aNamespaceURI, std::string_view aLocalName, const TBXMLElement* searchFromElement) const;
+	std::string_view valueOfAttributeNamedNS(std::string_view aNamespaceURI, std::string_view aLocalName, const TBXMLElement* forElement) const;
+
+	const TBXMLElement* childElementNamedNS(uint32_t aNamespaceId, std::string_view aLocalName, const TBXMLElement* parentElement) const;
+	const TBXMLElement* nextSiblingNamedNS(uint32_t aNamespaceId, std::string_view aLocalName, const TBXMLElement* searchFromElement) const;
+	std::string_view valueOfAttributeNamedNS(uint32_t aNamespaceId, std::string_view aLocalName, const TBXMLElement* forElement) const;
+
+	/** The text of an element or value of an attribute of this document with its references decoded. In
+	    D_TBXML_ENTITIES_LAZY mode the first call decodes it in place and later calls, and the fields of
+	    the structure, see the decoded bytes; several threads may call them at once. In the other modes
+	    they return the text or value as it is.
+	 */
+	std::string_view decodedText(const TBXMLElement* aXMLElement);
+	std::string_view decodedValue(const TBXMLAttribute* aXMLAttribute);
+	std::string_view decodedValueOfAttributeNamed(std::string_view aName, const TBXMLElement* forElement);
+
+	/** Enables child indices: the first indexedChildElementNamed lookup that walks past aChildCount
+	    children of an element builds a hash index of that element's children in the document arena, and
+	    later lookups against it take constant time. The indices are kept in a table of the document keyed
+	    by element, elements carry nothing for them. 0, the default, disables indexing and the indexed
+	    lookups walk the children like childElementNamed.
+	 */
+	void setChildIndexThreshold(size_t aChildCount);
+
+	/** childElementNamed/nextSiblingNamed for elements of this document using child indices. Several
+	    threads may look up elements of a parsed document at the same time, an index is built once.
+	    indexedNextSiblingNamed uses the index of the parent when it exists and aName is the name of
+	    searchFromElement, the case of iterating over the children with one name. indexedChildElementNamed
+	    expands an unexpanded parentElement like firstChild.
+	 */
+	const TBXMLElement* indexedChildElementNamed(std::string_view aName, const TBXMLElement* parentElement);
+	const TBXMLElement* indexedChildElementNamed(const TBXMLName &aName, const TBXMLElement* parentElement);
+	const TBXMLElement* indexedNextSiblingNamed(std::string_view aName, const TBXMLElement* searchFromElement);
+	const TBXMLElement* indexedNextSiblingNamed(const TBXMLName &aName, const TBXMLElement* searchFromElement);
+
+	/** Ranges over the children, the attributes and the descendants (in document order, without the
+	    element itself) of an element, following the links. A lazy element sees the children it has.
+	 */
+	static TBXMLChildRange children(const TBXMLElement* aXMLElement);
+	static TBXMLAttributeRange attributes(const TBXMLElement* aXMLElement);
+	static TBXMLDescendantRange descendants(const TBXMLElement* aXMLElement);
+
+	/** The elements of this document read from its element buffers one after another, without following
+	    the links, which keeps "find all" walks over large documents to sequential memory. Elements are
+	    built in document order, so the descendants of an element are the elements built after it up to
+	    the one following it; the elements an expansion of a lazy document builds come after those built
+	    before, and descendantsNamed then reads all of them and checks their ancestors. The ranges refer
+	    to the bytes of aName and must not be used while the document is being expanded or parsed.
+	 */
+	TBXMLArenaRange elements() const;
+	TBXMLArenaRange elementsNamed(std::string_view aName) const;
+	TBXMLArenaRange elementsNamed(const TBXMLName &aName) const;
+	TBXMLArenaRange descendantsNamed(std::string_view aName, const TBXMLElement* aXMLElement) const;
+	TBXMLArenaRange descendantsNamed(const TBXMLName &aName, const TBXMLElement* aXMLElement) const;
+
+	/** Calls aFunction with every element named aName, see elementsNamed.
+	 */
+	template<typename Function> void forEachElementNamed(std::string_view aName, Function aFunction) const {
+		for (const TBXMLElement * xmlElement : this->elementsNamed(aName)) aFunction(xmlElement);
+	}
+	template<typename Function> void forEachElementNamed(const TBXMLName &aName, Function aFunction) const {
+		for (const TBXMLElement * xmlElement : this->elementsNamed(aName)) aFunction(xmlElement);
+	}
+
 private:
 	
+	TBXMLElementBuffer * firstElementBuffer;
+	TBXMLAttributeBuffer * firstAttributeBuffer;
 	TBXMLElementBuffer * currentElementBuffer;
 	TBXMLAttributeBuffer * currentAttributeBuffer;
+	TBXMLArenaBuffer * firstArenaBuffer;
+	TBXMLArenaBuffer * currentArenaBuffer;
+
+	// serialises additions to the arena and lazy decoding by readers of a parsed document
+	std::mutex arenaLock;
 	
 	long currentElement;
 	long currentAttribute;
+
+	size_t elementCapacityHint;
+	size_t attributeCapacityHint;
+	size_t allocations;
+	TBXMLParseStats parseStatistics;
+
+	TBXMLSymbolTable * symbols;
+	size_t childIndexThreshold;
+
+	// the child indices built, in the arena; readers find them without arenaLock
+	struct _TBXMLChildIndexTable * childIndices;
+	size_t parseThreads;
+	TBXMLEntityMode entities;
+
+	// the limits of a parse, the elements it may still create and the limit it reached
+	TBXMLLimits parseLimits;
+	size_t elementBudget;
+	TBXMLErrorCodes parseError;
+
+	// the namespace URIs declared by the document, created with the first one
+	bool namespaceAware;
+	TBXMLSymbolTable * namespaces;
+
+	const TBXMLProjection * parseProjection;
+
+	// the levels a lazy parse builds and the content of the elements it left unexpanded
+	size_t lazyLevels;
+	std::unordered_map<const TBXMLElement*, TBXMLLazyContent> unexpanded;
+
+	// the element buffers hold the document in document order, until an expansion adds to them
+	bool documentOrder;
 	
 	char* bytes;
-	long bytesLength;
+	size_t bytesLength;
+	size_t bytesCapacity;
+	size_t bytesMappedLength;
 
 	static std::string errorWithCode(int code);
 	void decodeBytes();
-	int allocateBytesOfLength(long length, std::string &error);
-	char* mallocateBytesOfLength(long length, std::string &error);
+	void decodeBytes(char* aStart, char* aEnd, struct _TBXMLParseChunk* aChunk);
+	void decodeBytesInParallel();
+	void decodeBuffer(char* &aBytes, size_t aLength, size_t &aCapacity);
+	int allocateBytesOfLength(size_t length, std::string &error);
+	char* mallocateBytesOfLength(size_t length, std::string &error);
+	int readBytesOfFile(std::string &aXMLFile, std::string &error);
+	int mapBytesOfFile(std::string &aXMLFile, std::string &error);
+	void releaseBytes();
+	void releaseBuffers();
+	void takeMembers(TBXML &aOther);
+	size_t elementCount() const;
+	size_t attributeCount() const;
 	TBXMLElement* nextAvailableElement();
-	TBXMLAttribute* nextAvailableAttribute();
+	TBXMLAttribute* nextAvailableAttribute(TBXMLElement* aXMLElement);
+	TBXMLElementBuffer* allocateElementBuffer(size_t capacity);
+	TBXMLAttributeBuffer* allocateAttributeBuffer(size_t capacity);
+	void* allocateArenaBytes(size_t length);
+	size_t bufferBytes() const;
+	struct _TBXMLChildIndex* buildChildIndex(const TBXMLElement* aXMLElement);
+	struct _TBXMLChildIndex* childIndexOf(const TBXMLElement* aXMLElement) const;
+	bool addChildIndex(const TBXMLElement* aXMLElement, struct _TBXMLChildIndex* aIndex);
+	void internNames();
+	uint32_t internNamespace(const char* aNamespaceURI, size_t aLength);
+	void bindNamespaces(const TBXMLElement* aXMLElement, std::vector<TBXMLNamespaceBinding> &aScope);
+	void resolveNamespaces(TBXMLElement* aXMLElement, std::vector<TBXMLNamespaceBinding> &aScope);
+	void resolveNamespacesFrom(TBXMLElement* aFirstXMLElement, std::vector<TBXMLNamespaceBinding> &aScope);
+	void resolveNamespaces();
+	bool setNamespaceId(const TBXMLElement* aXMLElement, uint32_t aNamespaceId);
+	bool setNamespaceId(const TBXMLAttribute* aXMLAttribute, uint32_t aNamespaceId);
+	void releaseNamespaceIds();
+	TBXMLErrorCodes expandElement(TBXMLElement* aXMLElement);
+	void finishParseStats(uint64_t aStartNanoseconds, uint64_t aStartTicks);
+	void adoptBuffers(TBXML &aOther);
+	TBXMLArenaRange arenaRange(const TBXMLElement* aXMLElement, const TBXMLName* aName) const;
 };
 
 #endif	//_TBXML_H_
\ No newline at end of file
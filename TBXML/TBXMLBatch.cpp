@@ -0,0 +1,473 @@
+// ================================================================================================
+//  TBXMLBatch.cpp
+//  Parsing many files with overlapped reads and reused buffers
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLBatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TBXML_BATCH_POSIX_IO 1
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// a file read into a buffer from the pool, null terminated, waiting to be parsed
+typedef struct _TBXMLBatchFile {
+	size_t index;
+	char * bytes;
+	size_t length;
+	size_t capacity;
+} TBXMLBatchFile;
+
+// the files handed to one parse thread, it takes them from the front and others steal from the back
+typedef struct _TBXMLBatchQueue {
+	std::mutex lock;
+	std::deque<TBXMLBatchFile> files;
+} TBXMLBatchQueue;
+
+// state shared by the threads of one TBXMLBatch::parse
+typedef struct _TBXMLBatchRun {
+	_TBXMLBatchRun(TBXMLBatchHandler &aHandler, size_t aParseThreads, size_t aReadAhead, size_t aFileCount)
+		: handler(aHandler), queues(aParseThreads), nextRead(0), readAhead(aReadAhead), inFlight(0), queued(0),
+		  remaining(aFileCount), parsedFiles(0), failedFiles(0), parsedBytes(0) {
+		for (size_t i=0; i < queues.size(); i++) queues[i].reset(new TBXMLBatchQueue());
+	}
+
+	~_TBXMLBatchRun() {
+		for (size_t i=0; i < buffers.size(); i++) free(buffers[i].first);
+	}
+
+	TBXMLBatchHandler &handler;
+	std::vector<std::unique_ptr<TBXMLBatchQueue> > queues;
+
+	std::atomic<size_t> nextRead;
+
+	// files read but not parsed, bounded by readAhead, and files not finished
+	std::mutex stateLock;
+	std::condition_variable readable;
+	std::condition_variable parsable;
+	size_t readAhead;
+	size_t inFlight;
+	size_t queued;
+	size_t remaining;
+
+	// buffers of parsed files waiting to be read into again
+	std::mutex bufferLock;
+	std::vector<std::pair<char*, size_t> > buffers;
+
+	std::mutex errorLock;
+	std::string firstError;
+
+	std::atomic<size_t> parsedFiles;
+	std::atomic<size_t> failedFiles;
+	std::atomic<size_t> parsedBytes;
+} TBXMLBatchRun;
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLBatch::TBXMLBatch() {
+	parseThreads = 0;
+	readThreads = 0;
+	readAhead = TBXML_BATCH_READ_AHEAD;
+	symbols = NULL;
+	entities = D_TBXML_ENTITIES_NONE;
+	memset(&limits, 0, sizeof(limits));
+	namespaceAware = false;
+	projection = NULL;
+	lazyDepth = 0;
+
+	parsedFiles = 0;
+	failedFiles = 0;
+	parsedBytes = 0;
+	elapsed = 0;
+}
+
+void TBXMLBatch::addFile(const std::string &aPath) {
+	paths.push_back(aPath);
+}
+
+bool TBXMLBatch::addDirectory(const std::string &aDirectory, const std::string &aExtension, std::string &error) {
+	std::vector<std::string> found;
+	std::error_code code;
+
+	for (std::filesystem::recursive_directory_iterator entry(aDirectory, code), end; !code && entry != end; entry.increment(code)) {
+		if (!entry->is_regular_file(code)) continue;
+		std::string path = entry->path().string();
+		if (path.length() >= aExtension.length() && path.compare(path.length()-aExtension.length(), aExtension.length(), aExtension) == 0)
+			found.push_back(path);
+	}
+
+	if (code) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_FILE_NOT_FOUND_IN_BUNDLE));
+		return false;
+	}
+
+	std::sort(found.begin(), found.end());
+	paths.insert(paths.end(), found.begin(), found.end());
+	return true;
+}
+
+const std::vector<std::string>& TBXMLBatch::files() const {
+	return paths;
+}
+
+void TBXMLBatch::clear() {
+	paths.clear();
+}
+
+void TBXMLBatch::setParseThreadCount(size_t aThreadCount) {
+	parseThreads = aThreadCount;
+}
+
+void TBXMLBatch::setReadThreadCount(size_t aThreadCount) {
+	readThreads = aThreadCount;
+}
+
+void TBXMLBatch::setReadAhead(size_t aFileCount) {
+	readAhead = aFileCount ? aFileCount : 1;
+}
+
+void TBXMLBatch::setSymbolTable(TBXMLSymbolTable *aSymbolTable) {
+	symbols = aSymbolTable;
+}
+
+void TBXMLBatch::setEntityMode(TBXMLEntityMode aEntityMode) {
+	entities = aEntityMode;
+}
+
+void TBXMLBatch::setLimits(const TBXMLLimits &aLimits) {
+	limits = aLimits;
+}
+
+void TBXMLBatch::setNamespaceAware(bool aNamespaceAware) {
+	namespaceAware = aNamespaceAware;
+}
+
+void TBXMLBatch::setProjection(const TBXMLProjection *aProjection) {
+	projection = aProjection;
+}
+
+void TBXMLBatch::setLazyDepth(size_t aDepth) {
+	lazyDepth = aDepth;
+}
+
+bool TBXMLBatch::parse(TBXMLBatchHandler &aHandler, std::string &error) {
+	size_t hardwareThreads = std::thread::hardware_concurrency();
+	if (!hardwareThreads) hardwareThreads = 1;
+
+	size_t parsers = parseThreads ? parseThreads : hardwareThreads;
+	size_t readers = readThreads ? readThreads : (hardwareThreads+3)/4;
+
+	auto start = std::chrono::steady_clock::now();
+
+	TBXMLBatchRun run(aHandler, parsers, readAhead*parsers, paths.size());
+	std::vector<std::thread> threads;
+	for (size_t i=0; i < readers; i++) threads.emplace_back(&TBXMLBatch::readFiles, this, &run);
+	for (size_t i=1; i < parsers; i++) threads.emplace_back(&TBXMLBatch::parseFiles, this, &run, i);
+	this->parseFiles(&run, 0);
+	for (std::thread &thread : threads) thread.join();
+
+	elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	parsedFiles = run.parsedFiles;
+	failedFiles = run.failedFiles;
+	parsedBytes = run.parsedBytes;
+
+	if (failedFiles) {
+		error.clear();
+		error.append(run.firstError);
+		return false;
+	}
+	return true;
+}
+
+bool TBXMLBatch::parse(std::vector<TBXML> &aDocuments, std::vector<std::string> &aErrors, std::string &error) {
+	// every file has a slot of its own, the handler needs no lock
+	class Collector : public TBXMLBatchHandler {
+	public:
+		Collector(std::vector<TBXML> &aDocuments, std::vector<std::string> &aErrors) : documents(aDocuments), errors(aErrors) {}
+
+		void document(size_t aIndex, const std::string &, TBXML &aDocument) {
+			documents[aIndex] = std::move(aDocument);
+		}
+
+		void error(size_t aIndex, const std::string &, const std::string &aError) {
+			errors[aIndex] = aError;
+		}
+
+	private:
+		std::vector<TBXML> &documents;
+		std::vector<std::string> &errors;
+	};
+
+	aDocuments.clear();
+	aDocuments.resize(paths.size());
+	aErrors.assign(paths.size(), std::string());
+
+	Collector collector(aDocuments, aErrors);
+	return this->parse(collector, error);
+}
+
+size_t TBXMLBatch::parsedFileCount() const {
+	return parsedFiles;
+}
+
+size_t TBXMLBatch::failedFileCount() const {
+	return failedFiles;
+}
+
+size_t TBXMLBatch::parsedByteCount() const {
+	return parsedBytes;
+}
+
+double TBXMLBatch::seconds() const {
+	return elapsed;
+}
+
+double TBXMLBatch::filesPerSecond() const {
+	return elapsed > 0 ? (double)parsedFiles / elapsed : 0;
+}
+
+double TBXMLBatch::megabytesPerSecond() const {
+	return elapsed > 0 ? (double)parsedBytes / (1024.0*1024.0) / elapsed : 0;
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+void TBXMLBatch::readFiles(TBXMLBatchRun* aRun) {
+	size_t index;
+	while ((index = aRun->nextRead++) < paths.size()) {
+		// wait for a parser to catch up when enough files are held in memory
+		{
+			std::unique_lock<std::mutex> lock(aRun->stateLock);
+			aRun->readable.wait(lock, [aRun] { return aRun->inFlight < aRun->readAhead; });
+			aRun->inFlight++;
+		}
+
+		TBXMLBatchFile file;
+		file.index = index;
+		{
+			std::lock_guard<std::mutex> lock(aRun->bufferLock);
+			if (aRun->buffers.empty()) {
+				file.bytes = NULL;
+				file.capacity = 0;
+			} else {
+				file.bytes = aRun->buffers.back().first;
+				file.capacity = aRun->buffers.back().second;
+				aRun->buffers.pop_back();
+			}
+		}
+
+		int rev = this->readFile(paths[index], file);
+		if (rev != D_TBXML_SUCCESS) {
+			this->recycle(aRun, file.bytes, file.capacity);
+			this->fail(aRun, index, TBXML::errorWithCode(rev));
+			continue;
+		}
+
+		// hand the files out in turn, idle parsers steal from busy ones
+		TBXMLBatchQueue &queue = *aRun->queues[index % aRun->queues.size()];
+		{
+			std::lock_guard<std::mutex> lock(queue.lock);
+			queue.files.push_back(file);
+		}
+		{
+			std::lock_guard<std::mutex> lock(aRun->stateLock);
+			aRun->queued++;
+		}
+		aRun->parsable.notify_one();
+	}
+}
+
+void TBXMLBatch::parseFiles(TBXMLBatchRun* aRun, size_t aWorker) {
+	// one document per thread, its buffers are reused for every file it parses
+	TBXML xml;
+	xml.setSymbolTable(symbols);
+	xml.setEntityMode(entities);
+	xml.setLimits(limits);
+	xml.setNamespaceAware(namespaceAware);
+	xml.setProjection(projection);
+	xml.setLazyDepth(lazyDepth);
+
+	TBXMLBatchFile file;
+	while (true) {
+		if (!this->takeFile(aRun, aWorker, file)) {
+			std::unique_lock<std::mutex> lock(aRun->stateLock);
+			if (!aRun->remaining) return;
+			aRun->parsable.wait(lock, [aRun] { return aRun->queued || !aRun->remaining; });
+			continue;
+		}
+
+		// the document takes the buffer read, its previous buffer goes back to the readers
+		size_t length = file.length;
+		xml.decodeBuffer(file.bytes, length, file.capacity);
+		this->recycle(aRun, file.bytes, file.capacity);
+
+		if (!length) {
+			this->fail(aRun, file.index, TBXML::errorWithCode(D_TBXML_DATA_NIL));
+			continue;
+		}
+		if (xml.parseError != D_TBXML_SUCCESS) {
+			this->fail(aRun, file.index, TBXML::errorWithCode(xml.parseError));
+			continue;
+		}
+
+		aRun->handler.document(file.index, paths[file.index], xml);
+		aRun->parsedFiles++;
+		aRun->parsedBytes += length;
+		this->finish(aRun);
+	}
+}
+
+int TBXMLBatch::readFile(const std::string &aPath, TBXMLBatchFile &aFile) {
+#ifdef TBXML_BATCH_POSIX_IO
+	int fd = open(aPath.c_str(), O_RDONLY);
+	if (fd < 0) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+	}
+	size_t size = (size_t)info.st_size;
+#else
+	FILE * fp = fopen(aPath.c_str(), "rb");
+	if (!fp) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+	fseek(fp, 0, SEEK_END);
+	long end = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (end < 0) {
+		fclose(fp);
+		return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+	}
+	size_t size = (size_t)end;
+#endif
+
+	if (limits.maxBytes && size > limits.maxBytes) {
+#ifdef TBXML_BATCH_POSIX_IO
+		close(fd);
+#else
+		fclose(fp);
+#endif
+		return D_TBXML_LIMIT_BYTES;
+	}
+
+	// grow a pooled buffer that is too small, its contents don't matter
+	if (aFile.capacity < size+1) {
+		free(aFile.bytes);
+		aFile.bytes = (char*)malloc(size+1);
+		aFile.capacity = aFile.bytes ? size+1 : 0;
+	}
+
+	size_t length = 0;
+	if (aFile.bytes) {
+#ifdef TBXML_BATCH_POSIX_IO
+		while (length < size) {
+			ssize_t count = ::read(fd, aFile.bytes + length, size - length);
+			if (count <= 0) break;
+			length += (size_t)count;
+		}
+		close(fd);
+#else
+		length = fread(aFile.bytes, 1, size, fp);
+		fclose(fp);
+#endif
+	} else {
+#ifdef TBXML_BATCH_POSIX_IO
+		close(fd);
+#else
+		fclose(fp);
+#endif
+		return D_TBXML_MEMORY_ALLOC_FAILURE;
+	}
+
+	if (length != size) return D_TBXML_DECODE_FAILURE;
+
+	// set null terminator at end of byte array
+	aFile.bytes[length] = 0;
+	aFile.length = length;
+	return D_TBXML_SUCCESS;
+}
+
+bool TBXMLBatch::takeFile(TBXMLBatchRun* aRun, size_t aWorker, TBXMLBatchFile &aFile) {
+	for (size_t i=0; i < aRun->queues.size(); i++) {
+		TBXMLBatchQueue &queue = *aRun->queues[(aWorker + i) % aRun->queues.size()];
+		std::lock_guard<std::mutex> lock(queue.lock);
+		if (queue.files.empty()) continue;
+
+		if (i == 0) {
+			aFile = queue.files.front();
+			queue.files.pop_front();
+		} else {
+			aFile = queue.files.back();
+			queue.files.pop_back();
+		}
+
+		std::lock_guard<std::mutex> state(aRun->stateLock);
+		aRun->queued--;
+		return true;
+	}
+	return false;
+}
+
+void TBXMLBatch::recycle(TBXMLBatchRun* aRun, char* aBytes, size_t aCapacity) {
+	if (!aBytes) return;
+	std::lock_guard<std::mutex> lock(aRun->bufferLock);
+	aRun->buffers.push_back(std::make_pair(aBytes, aCapacity));
+}
+
+void TBXMLBatch::fail(TBXMLBatchRun* aRun, size_t aIndex, const std::string &aError) {
+	aRun->handler.error(aIndex, paths[aIndex], aError);
+	aRun->failedFiles++;
+	{
+		std::lock_guard<std::mutex> lock(aRun->errorLock);
+		if (aRun->firstError.empty()) aRun->firstError = paths[aIndex] + ": " + aError;
+	}
+	this->finish(aRun);
+}
+
+void TBXMLBatch::finish(TBXMLBatchRun* aRun) {
+	bool done;
+	{
+		std::lock_guard<std::mutex> lock(aRun->stateLock);
+		aRun->inFlight--;
+		done = --aRun->remaining == 0;
+	}
+	aRun->readable.notify_one();
+	if (done) aRun->parsable.notify_all();
+}
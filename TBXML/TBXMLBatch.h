@@ -0,0 +1,161 @@
+// ================================================================================================
+//  TBXMLBatch.h
+//  Parsing many files with overlapped reads and reused buffers
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+
+#ifndef _TBXML_BATCH_H_
+#define _TBXML_BATCH_H_
+
+#include "TBXML.h"
+#include <vector>
+
+struct _TBXMLBatchFile;
+struct _TBXMLBatchRun;
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// files read but not parsed yet, per parse thread
+#define TBXML_BATCH_READ_AHEAD 8
+
+/** TBXMLBatchHandler receives the results of TBXMLBatch::parse. Its methods are called from several
+    threads at once, for files in no particular order; aIndex is the position of the file in the batch.
+ */
+class TBXMLBatchHandler {
+public:
+	virtual ~TBXMLBatchHandler() {}
+
+	/** Called with every document parsed. aDocument is reused for another file once this returns, move
+	    it out to keep it (its buffers are then not reused).
+	 */
+	virtual void document(size_t /*aIndex*/, const std::string & /*aPath*/, TBXML & /*aDocument*/) {}
+
+	/** Called for every file that could not be read or parsed.
+	 */
+	virtual void error(size_t /*aIndex*/, const std::string & /*aPath*/, const std::string & /*aError*/) {}
+};
+
+/** TBXMLBatch parses a list of files, such as the contents of a directory, with two pools of threads:
+    readers load upcoming files into reused buffers while parsers decode the files already read. Each
+    parse thread keeps one TBXML whose element and attribute buffers serve all of its files and a queue
+    of files handed to it, taking work from the other queues when its own runs dry.
+
+    Reads use plain blocking I/O on the read threads, which overlaps them with parsing on every platform;
+    at most TBXML_BATCH_READ_AHEAD files per parse thread are held in memory at once.
+ */
+class TBXMLBatch {
+public:
+	TBXMLBatch();
+
+	TBXMLBatch(const TBXMLBatch &) = delete;
+	TBXMLBatch& operator=(const TBXMLBatch &) = delete;
+
+	void addFile(const std::string &aPath);
+
+	/** Adds the files ending in aExtension in aDirectory and its subdirectories, sorted by path.
+	 */
+	bool addDirectory(const std::string &aDirectory, const std::string &aExtension, std::string &error);
+
+	const std::vector<std::string>& files() const;
+	void clear();
+
+	/** Thread counts, 0 picks the number of hardware threads for parsing and a quarter of it for reading.
+	 */
+	void setParseThreadCount(size_t aThreadCount);
+	void setReadThreadCount(size_t aThreadCount);
+
+	/** Files read ahead per parse thread.
+	 */
+	void setReadAhead(size_t aFileCount);
+
+	/** Interns names into aSymbolTable, which has to be frozen as it is shared by the parse threads.
+	 */
+	void setSymbolTable(TBXMLSymbolTable *aSymbolTable);
+
+	/** Entity mode of the documents parsed, see TBXML::setEntityMode.
+	 */
+	void setEntityMode(TBXMLEntityMode aEntityMode);
+
+	/** Limits of the documents parsed, see TBXML::setLimits. Files over maxBytes fail without being read.
+	 */
+	void setLimits(const TBXMLLimits &aLimits);
+
+	/** Resolves namespaces in the documents parsed, see TBXML::setNamespaceAware.
+	 */
+	void setNamespaceAware(bool aNamespaceAware);
+
+	/** Parses only the elements on the paths of aProjection, see TBXML::setProjection.
+	 */
+	void setProjection(const TBXMLProjection *aProjection);
+
+	/** Parses the documents lazily below aDepth levels, see TBXML::setLazyDepth.
+	 */
+	void setLazyDepth(size_t aDepth);
+
+	/** Reads and parses every file, passing the results to aHandler. Returns false if any file failed,
+	    error holds the first failure.
+	 */
+	bool parse(TBXMLBatchHandler &aHandler, std::string &error);
+
+	/** Parses every file into aDocuments, in the order of files(). The documents of failed files are
+	    empty and their errors are in aErrors.
+	 */
+	bool parse(std::vector<TBXML> &aDocuments, std::vector<std::string> &aErrors, std::string &error);
+
+	// throughput of the last parse
+	size_t parsedFileCount() const;
+	size_t failedFileCount() const;
+	size_t parsedByteCount() const;
+	double seconds() const;
+	double filesPerSecond() const;
+	double megabytesPerSecond() const;
+
+private:
+	std::vector<std::string> paths;
+
+	size_t parseThreads;
+	size_t readThreads;
+	size_t readAhead;
+	TBXMLSymbolTable * symbols;
+	TBXMLEntityMode entities;
+	TBXMLLimits limits;
+	bool namespaceAware;
+	const TBXMLProjection * projection;
+	size_t lazyDepth;
+
+	size_t parsedFiles;
+	size_t failedFiles;
+	size_t parsedBytes;
+	double elapsed;
+
+	void readFiles(struct _TBXMLBatchRun* aRun);
+	void parseFiles(struct _TBXMLBatchRun* aRun, size_t aWorker);
+	int readFile(const std::string &aPath, struct _TBXMLBatchFile &aFile);
+	bool takeFile(struct _TBXMLBatchRun* aRun, size_t aWorker, struct _TBXMLBatchFile &aFile);
+	void recycle(struct _TBXMLBatchRun* aRun, char* aBytes, size_t aCapacity);
+	void fail(struct _TBXMLBatchRun* aRun, size_t aIndex, const std::string &aError);
+	void finish(struct _TBXMLBatchRun* aRun);
+};
+
+#endif	//_TBXML_BATCH_H_
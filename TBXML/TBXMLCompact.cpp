@@ -0,0 +1,791 @@
+// ================================================================================================
+//  TBXMLCompact.cpp
+//  Compact, index based representation of a parsed TBXML document
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLCompact.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TBXML_HAS_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(TBXMLCompactElement) <= 24, "TBXMLCompactElement must stay within 24 bytes");
+static_assert(sizeof(TBXMLCompactAttribute) == 16, "TBXMLCompactAttribute must stay 16 bytes");
+static_assert(sizeof(TBXMLCompactLengths) == 16, "TBXMLCompactLengths must stay 16 bytes");
+
+// ================================================================================================
+// Snapshots
+// ================================================================================================
+
+#define TBXML_SNAPSHOT_MAGIC "TBXMLSNP"
+
+// written as a native integer, reads back differently on a machine of the other byte order
+#define TBXML_SNAPSHOT_BYTE_ORDER 0x01020304u
+
+// the header is followed by the element array, the attribute array, the lengths array and bytesLength+1
+// bytes, the last one the terminator. Each section starts 8 byte aligned since the header and the entry
+// sizes are multiples of 8.
+typedef struct _TBXMLSnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t elementCount;
+	uint64_t attributeCount;
+	uint64_t bytesLength;
+	uint64_t checksum;
+	uint64_t lengthsCount;
+	uint64_t reserved;
+} TBXMLSnapshotHeader;
+
+static_assert(sizeof(TBXMLSnapshotHeader) == 64, "TBXMLSnapshotHeader must stay 64 bytes");
+
+// hashes 8 bytes at a time, a section is continued from the checksum of the one before it
+static uint64_t snapshotChecksum(uint64_t aChecksum, const void* aData, size_t aLength) {
+	const unsigned char * data = (const unsigned char*)aData;
+	uint64_t checksum = aChecksum;
+
+	size_t words = aLength / 8;
+	for (size_t i=0; i < words; i++) {
+		uint64_t word;
+		memcpy(&word, data + i*8, 8);
+		checksum = (checksum ^ word) * 0x9E3779B97F4A7C15ull;
+		checksum ^= checksum >> 32;
+	}
+
+	uint64_t tail = aLength;
+	for (size_t i=words*8; i < aLength; i++) tail = (tail << 8) | data[i];
+	checksum = (checksum ^ tail) * 0x9E3779B97F4A7C15ull;
+	return checksum ^ (checksum >> 32);
+}
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLCompact::TBXMLCompact() {
+	rootXMLElement = NULL;
+
+	bytes = NULL;
+	bytesLength = 0;
+	snapshot = NULL;
+	snapshotLength = 0;
+
+	elements = NULL;
+	attributes = NULL;
+	lengths = NULL;
+
+	elementsLength = 0;
+	elementsCapacity = 0;
+	attributesLength = 0;
+	attributesCapacity = 0;
+	lengthsLength = 0;
+	lengthsCapacity = 0;
+}
+
+TBXMLCompact::~TBXMLCompact() {
+	this->releaseArrays();
+}
+
+TBXMLCompact::TBXMLCompact(TBXMLCompact &&aOther) : TBXMLCompact() {
+	this->takeMembers(aOther);
+}
+
+TBXMLCompact& TBXMLCompact::operator=(TBXMLCompact &&aOther) {
+	if (this != &aOther) {
+		this->releaseArrays();
+		this->takeMembers(aOther);
+	}
+	return *this;
+}
+
+bool TBXMLCompact::initWithXMLString(std::string &aXMLString, std::string &error) {
+	rootXMLElement = NULL;
+	if (!document.initWithXMLString(aXMLString, error)) return false;
+	return this->compactDocument(error);
+}
+
+bool TBXMLCompact::initWithXMLFile(std::string &aXMLFile, std::string &error) {
+	return this->initWithXMLFile(aXMLFile, D_TBXML_LOAD_READ, error);
+}
+
+bool TBXMLCompact::initWithXMLFile(std::string &aXMLFile, TBXMLLoadMode aLoadMode, std::string &error) {
+	rootXMLElement = NULL;
+	if (!document.initWithXMLFile(aXMLFile, aLoadMode, error)) return false;
+	return this->compactDocument(error);
+}
+
+bool TBXMLCompact::initWithDocument(TBXML &&aDocument, std::string &error) {
+	rootXMLElement = NULL;
+	document = std::move(aDocument);
+	return this->compactDocument(error);
+}
+
+bool TBXMLCompact::saveSnapshot(std::string &aFile, std::string &error) const {
+	if (!rootXMLElement) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return false;
+	}
+
+	TBXMLSnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TBXML_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = TBXML_SNAPSHOT_VERSION;
+	header.byteOrder = TBXML_SNAPSHOT_BYTE_ORDER;
+	header.elementCount = elementsLength;
+	header.attributeCount = attributesLength;
+	header.bytesLength = bytesLength;
+	header.lengthsCount = lengthsLength;
+
+	size_t elementsSize = sizeof(TBXMLCompactElement)*elementsLength;
+	size_t attributesSize = sizeof(TBXMLCompactAttribute)*attributesLength;
+	size_t lengthsSize = sizeof(TBXMLCompactLengths)*lengthsLength;
+	header.checksum = snapshotChecksum(0, elements, elementsSize);
+	header.checksum = snapshotChecksum(header.checksum, attributes, attributesSize);
+	header.checksum = snapshotChecksum(header.checksum, lengths, lengthsSize);
+	header.checksum = snapshotChecksum(header.checksum, bytes, bytesLength+1);
+
+	FILE * file = fopen(aFile.c_str(), "wb");
+	if (!file) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_FILE_NOT_FOUND_IN_BUNDLE));
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(elements, 1, elementsSize, file) == elementsSize &&
+		(attributesSize == 0 || fwrite(attributes, 1, attributesSize, file) == attributesSize) &&
+		(lengthsSize == 0 || fwrite(lengths, 1, lengthsSize, file) == lengthsSize) &&
+		fwrite(bytes, 1, bytesLength+1, file) == bytesLength+1;
+	if (fclose(file) != 0) written = false;
+
+	if (!written) {
+		remove(aFile.c_str());
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_WRITE_FAILURE));
+		return false;
+	}
+	return true;
+}
+
+bool TBXMLCompact::initWithSnapshotFile(std::string &aFile, std::string &error) {
+	return this->initWithSnapshotFile(aFile, false, error);
+}
+
+bool TBXMLCompact::initWithSnapshotFile(std::string &aFile, bool aVerifyChecksum, std::string &error) {
+	// the arrays and bytes of the previous document, and the document it was parsed into, go first
+	this->releaseArrays();
+	document = TBXML();
+
+	int rev = this->loadSnapshot(aFile, aVerifyChecksum);
+	if (rev != D_TBXML_SUCCESS) {
+		this->releaseArrays();
+		error.clear();
+		error.append(TBXML::errorWithCode(rev));
+		return false;
+	}
+	return true;
+}
+
+size_t TBXMLCompact::elementCount() const {
+	return elementsLength;
+}
+
+size_t TBXMLCompact::attributeCount() const {
+	return attributesLength;
+}
+
+const TBXMLCompactElement* TBXMLCompact::parentElement(const TBXMLCompactElement* aXMLElement) {
+	return this->elementAtIndex(aXMLElement->parentElement);
+}
+
+const TBXMLCompactElement* TBXMLCompact::firstChild(const TBXMLCompactElement* aXMLElement) {
+	return this->elementAtIndex(this->firstChildIndex(aXMLElement));
+}
+
+const TBXMLCompactElement* TBXMLCompact::nextSibling(const TBXMLCompactElement* aXMLElement) {
+	return this->elementAtIndex(aXMLElement->nextSibling);
+}
+
+const TBXMLCompactAttribute* TBXMLCompact::firstAttribute(const TBXMLCompactElement* aXMLElement) {
+	if (this->attributeCountForElement(aXMLElement) == 0) return NULL;
+	return &attributes[aXMLElement->firstAttribute];
+}
+
+const TBXMLCompactAttribute* TBXMLCompact::nextAttribute(const TBXMLCompactAttribute* aXMLAttribute, const TBXMLCompactElement* aXMLElement) {
+	const TBXMLCompactAttribute * next = aXMLAttribute+1;
+	if (next >= &attributes[aXMLElement->firstAttribute] + this->attributeCountForElement(aXMLElement)) return NULL;
+	return next;
+}
+
+size_t TBXMLCompact::attributeCountForElement(const TBXMLCompactElement* aXMLElement) {
+	// the attributes of an element end where those of the next element in document order start
+	const TBXMLCompactElement * next = aXMLElement+1;
+	uint32_t end = next < elements + elementsLength ? next->firstAttribute : (uint32_t)attributesLength;
+	return end - aXMLElement->firstAttribute;
+}
+
+std::string TBXMLCompact::elementName(const TBXMLCompactElement* aXMLElement) {
+	return this->stringAt(aXMLElement->name, this->nameLengthOf(aXMLElement));
+}
+
+std::string TBXMLCompact::elementName(const TBXMLCompactElement* aXMLElement, std::string &error) {
+	// check for nil element
+	if (NULL == aXMLElement) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return "";
+	}
+
+	// check for nil element name
+	if (aXMLElement->nameLength == 0) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_NAME_IS_NIL));
+		return "";
+	}
+
+	return this->stringAt(aXMLElement->name, this->nameLengthOf(aXMLElement));
+}
+
+std::string TBXMLCompact::textForElement(const TBXMLCompactElement* aXMLElement) {
+	return this->stringAt(aXMLElement->text, this->textLengthOf(aXMLElement));
+}
+
+std::string TBXMLCompact::textForElement(const TBXMLCompactElement* aXMLElement, std::string &error) {
+	// check for nil element
+	if (NULL == aXMLElement) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return "";
+	}
+
+	// check for nil text value
+	if (TBXML_COMPACT_NONE == aXMLElement->text || aXMLElement->textLength == 0) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_TEXT_IS_NIL));
+		return "";
+	}
+
+	return this->stringAt(aXMLElement->text, this->textLengthOf(aXMLElement));
+}
+
+std::string TBXMLCompact::valueOfAttributeNamed(std::string &aName, const TBXMLCompactElement* aXMLElement) {
+	const TBXMLCompactAttribute * attribute = this->firstAttribute(aXMLElement);
+	size_t count = this->attributeCountForElement(aXMLElement);
+	for (size_t i=0; i < count; i++) {
+		if (this->nameMatches(attribute[i].name, attribute[i].nameLength, aName.c_str(), aName.length()))
+			return this->stringAt(attribute[i].value, attribute[i].valueLength);
+	}
+	return "";
+}
+
+std::string TBXMLCompact::valueOfAttributeNamed(std::string &aName, const TBXMLCompactElement* aXMLElement, std::string &error) {
+	// check for nil element
+	if (NULL == aXMLElement) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return "";
+	}
+
+	// check for nil name parameter
+	if (aName.length() == 0) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ATTRIBUTE_NAME_IS_NIL));
+		return "";
+	}
+
+	const TBXMLCompactAttribute * attribute = this->firstAttribute(aXMLElement);
+	size_t count = this->attributeCountForElement(aXMLElement);
+	for (size_t i=0; i < count; i++) {
+		if (this->nameMatches(attribute[i].name, attribute[i].nameLength, aName.c_str(), aName.length()))
+			return this->stringAt(attribute[i].value, attribute[i].valueLength);
+	}
+
+	// attribute not found
+	error.clear();
+	error.append(TBXML::errorWithCode(D_TBXML_ATTRIBUTE_NOT_FOUND));
+	return "";
+}
+
+std::string TBXMLCompact::attributeName(const TBXMLCompactAttribute* aXMLAttribute) {
+	return this->stringAt(aXMLAttribute->name, aXMLAttribute->nameLength);
+}
+
+std::string TBXMLCompact::attributeName(const TBXMLCompactAttribute* aXMLAttribute, std::string &error) {
+	// check for nil attribute
+	if (NULL == aXMLAttribute) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ATTRIBUTE_IS_NIL));
+		return "";
+	}
+
+	return this->stringAt(aXMLAttribute->name, aXMLAttribute->nameLength);
+}
+
+std::string TBXMLCompact::attributeValue(const TBXMLCompactAttribute* aXMLAttribute) {
+	return this->stringAt(aXMLAttribute->value, aXMLAttribute->valueLength);
+}
+
+std::string TBXMLCompact::attributeValue(const TBXMLCompactAttribute* aXMLAttribute, std::string &error) {
+	// check for nil attribute
+	if (NULL == aXMLAttribute) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ATTRIBUTE_IS_NIL));
+		return "";
+	}
+
+	return this->stringAt(aXMLAttribute->value, aXMLAttribute->valueLength);
+}
+
+const TBXMLCompactElement* TBXMLCompact::childElementNamed(std::string &aName, const TBXMLCompactElement* aParentXMLElement) {
+	uint32_t index = this->firstChildIndex(aParentXMLElement);
+	while (index != TBXML_COMPACT_NONE) {
+		if (this->nameMatches(elements[index].name, this->nameLengthOf(&elements[index]), aName.c_str(), aName.length())) return &elements[index];
+		index = elements[index].nextSibling;
+	}
+	return NULL;
+}
+
+const TBXMLCompactElement* TBXMLCompact::childElementNamed(std::string &aName, const TBXMLCompactElement* aParentXMLElement, std::string &error) {
+	// check for nil element
+	if (NULL == aParentXMLElement) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return NULL;
+	}
+
+	// check for nil name parameter
+	if (aName.length() == 0) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_PARAM_NAME_IS_NIL));
+		return NULL;
+	}
+
+	const TBXMLCompactElement * xmlElement = this->childElementNamed(aName, aParentXMLElement);
+	if (xmlElement) return xmlElement;
+
+	error.clear();
+	error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_NOT_FOUND));
+	return NULL;
+}
+
+const TBXMLCompactElement* TBXMLCompact::nextSiblingNamed(std::string &aName, const TBXMLCompactElement* aXMLElement) {
+	uint32_t index = aXMLElement->nextSibling;
+	while (index != TBXML_COMPACT_NONE) {
+		if (this->nameMatches(elements[index].name, this->nameLengthOf(&elements[index]), aName.c_str(), aName.length())) return &elements[index];
+		index = elements[index].nextSibling;
+	}
+	return NULL;
+}
+
+const TBXMLCompactElement* TBXMLCompact::nextSiblingNamed(std::string &aName, const TBXMLCompactElement* aXMLElement, std::string &error) {
+	// check for nil element
+	if (NULL == aXMLElement) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return NULL;
+	}
+
+	// check for nil name parameter
+	if (aName.length() == 0) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_PARAM_NAME_IS_NIL));
+		return NULL;
+	}
+
+	const TBXMLCompactElement * xmlElement = this->nextSiblingNamed(aName, aXMLElement);
+	if (xmlElement) return xmlElement;
+
+	error.clear();
+	error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_NOT_FOUND));
+	return NULL;
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+bool TBXMLCompact::compactDocument(std::string &error) {
+	// arrays pointing into a snapshot can't be reused
+	if (snapshot) this->releaseArrays();
+
+	TBXMLElement * root = document.rootXMLElement;
+	if (!root) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_ELEMENT_IS_NIL));
+		return false;
+	}
+
+	// offsets and indices are 32 bit, TBXML_COMPACT_NONE is reserved
+	size_t elementSlots = document.elementCount();
+	size_t attributeSlots = document.attributeCount();
+	if (document.bytesLength >= TBXML_COMPACT_NONE || elementSlots >= TBXML_COMPACT_NONE || attributeSlots >= TBXML_COMPACT_NONE) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_DOCUMENT_TOO_LARGE));
+		return false;
+	}
+
+	// the arrays of a previous document are reused when large enough
+	if (elementsCapacity < elementSlots) {
+		free(elements);
+		elements = (TBXMLCompactElement*)malloc(sizeof(TBXMLCompactElement)*elementSlots);
+		elementsCapacity = elements ? elementSlots : 0;
+	}
+	if (attributesCapacity < attributeSlots) {
+		free(attributes);
+		attributes = (TBXMLCompactAttribute*)malloc(sizeof(TBXMLCompactAttribute)*attributeSlots);
+		attributesCapacity = attributes ? attributeSlots : 0;
+	}
+	if (elementsCapacity < elementSlots || attributesCapacity < attributeSlots) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_MEMORY_ALLOC_FAILURE));
+		return false;
+	}
+
+	bytes = document.bytes;
+	bytesLength = document.bytesLength;
+	elementsLength = 0;
+	attributesLength = 0;
+	lengthsLength = 0;
+
+	// walk the tree in document order without a stack: the parent indices already written to the array
+	// lead back up. Elements outside the root element (a second top level element) are not reachable
+	// from rootXMLElement and are dropped, as they are for TBXML callers.
+	TBXMLElement * xmlElement = root;
+	uint32_t parent = TBXML_COMPACT_NONE;
+	uint32_t previous = TBXML_COMPACT_NONE;
+
+	while (xmlElement) {
+		uint32_t index = (uint32_t)elementsLength++;
+		TBXMLCompactElement * element = &elements[index];
+
+		size_t textLength = xmlElement->text ? xmlElement->textLength : 0;
+		element->name = (uint32_t)(xmlElement->name - bytes);
+		element->nameLength = (uint16_t)(xmlElement->nameLength < TBXML_COMPACT_LONG ? xmlElement->nameLength : TBXML_COMPACT_LONG);
+		element->text = xmlElement->text ? (uint32_t)(xmlElement->text - bytes) : TBXML_COMPACT_NONE;
+		element->textLength = (uint16_t)(textLength < TBXML_COMPACT_LONG ? textLength : TBXML_COMPACT_LONG);
+		element->firstAttribute = (uint32_t)attributesLength;
+		element->parentElement = parent;
+		element->nextSibling = TBXML_COMPACT_NONE;
+
+		if ((element->nameLength == TBXML_COMPACT_LONG || element->textLength == TBXML_COMPACT_LONG) && !this->addLengths(index, xmlElement->nameLength, textLength)) {
+			error.clear();
+			error.append(TBXML::errorWithCode(D_TBXML_MEMORY_ALLOC_FAILURE));
+			return false;
+		}
+
+		for (TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+			TBXMLCompactAttribute * attribute = &attributes[attributesLength++];
+			attribute->name = (uint32_t)(xmlAttribute->name - bytes);
+			attribute->nameLength = xmlAttribute->nameLength;
+			attribute->value = xmlAttribute->value ? (uint32_t)(xmlAttribute->value - bytes) : TBXML_COMPACT_NONE;
+			attribute->valueLength = xmlAttribute->value ? xmlAttribute->valueLength : 0;
+		}
+
+		// link to the previous sibling, a first child follows its parent
+		if (previous != TBXML_COMPACT_NONE) elements[previous].nextSibling = index;
+
+		// descend into the children first
+		if (xmlElement->firstChild) {
+			parent = index;
+			previous = TBXML_COMPACT_NONE;
+			xmlElement = xmlElement->firstChild;
+			continue;
+		}
+
+		// otherwise move on to the next sibling, climbing up until one is found
+		previous = index;
+		while (xmlElement && !xmlElement->nextSibling) {
+			xmlElement = xmlElement->parentElement;
+			previous = parent;
+			if (parent != TBXML_COMPACT_NONE) parent = elements[parent].parentElement;
+		}
+		if (xmlElement) xmlElement = xmlElement->nextSibling;
+	}
+
+	rootXMLElement = elements;
+
+	// the tree is no longer needed, only the byte buffer is
+	document.releaseBuffers();
+	return true;
+}
+
+int TBXMLCompact::loadSnapshot(std::string &aFile, bool aVerifyChecksum) {
+	size_t length = 0;
+
+#ifdef TBXML_HAS_MMAP
+	int fd = open(aFile.c_str(), O_RDONLY);
+	if (fd < 0) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(TBXMLSnapshotHeader)) {
+		close(fd);
+		return D_TBXML_SNAPSHOT_INVALID;
+	}
+	length = (size_t)fileStat.st_size;
+
+	// a shared read-only mapping, every process mapping the snapshot uses the same page cache pages
+	void * mapped = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) return D_TBXML_MEMORY_ALLOC_FAILURE;
+#else
+	FILE * file = fopen(aFile.c_str(), "rb");
+	if (!file) return D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size < (long)sizeof(TBXMLSnapshotHeader)) {
+		fclose(file);
+		return D_TBXML_SNAPSHOT_INVALID;
+	}
+	length = (size_t)size;
+
+	void * mapped = malloc(length);
+	if (!mapped) {
+		fclose(file);
+		return D_TBXML_MEMORY_ALLOC_FAILURE;
+	}
+	size_t read = fread(mapped, 1, length, file);
+	fclose(file);
+	if (read != length) {
+		free(mapped);
+		return D_TBXML_SNAPSHOT_INVALID;
+	}
+#endif
+
+	// released by releaseArrays from here on, also when the checks below fail
+	snapshot = mapped;
+	snapshotLength = length;
+
+	const TBXMLSnapshotHeader * header = (const TBXMLSnapshotHeader*)mapped;
+	if (memcmp(header->magic, TBXML_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return D_TBXML_SNAPSHOT_INVALID;
+	if (header->version != TBXML_SNAPSHOT_VERSION || header->byteOrder != TBXML_SNAPSHOT_BYTE_ORDER) return D_TBXML_SNAPSHOT_VERSION;
+
+	// the sections must fill the file exactly, checked in steps that can't overflow
+	size_t available = length - sizeof(TBXMLSnapshotHeader);
+	if (header->elementCount == 0 || header->elementCount > available / sizeof(TBXMLCompactElement)) return D_TBXML_SNAPSHOT_INVALID;
+	size_t elementsSize = sizeof(TBXMLCompactElement)*(size_t)header->elementCount;
+	available -= elementsSize;
+	if (header->attributeCount > available / sizeof(TBXMLCompactAttribute)) return D_TBXML_SNAPSHOT_INVALID;
+	size_t attributesSize = sizeof(TBXMLCompactAttribute)*(size_t)header->attributeCount;
+	available -= attributesSize;
+	if (header->lengthsCount > available / sizeof(TBXMLCompactLengths)) return D_TBXML_SNAPSHOT_INVALID;
+	size_t lengthsSize = sizeof(TBXMLCompactLengths)*(size_t)header->lengthsCount;
+	available -= lengthsSize;
+	if (header->bytesLength >= TBXML_COMPACT_NONE || header->bytesLength + 1 != available) return D_TBXML_SNAPSHOT_INVALID;
+
+	const char * sections = (const char*)mapped + sizeof(TBXMLSnapshotHeader);
+	const char * snapshotBytes = sections + elementsSize + attributesSize + lengthsSize;
+	if (snapshotBytes[header->bytesLength] != 0) return D_TBXML_SNAPSHOT_INVALID;
+
+	if (aVerifyChecksum) {
+		uint64_t checksum = snapshotChecksum(0, sections, elementsSize);
+		checksum = snapshotChecksum(checksum, sections + elementsSize, attributesSize);
+		checksum = snapshotChecksum(checksum, sections + elementsSize + attributesSize, lengthsSize);
+		checksum = snapshotChecksum(checksum, snapshotBytes, available);
+		if (checksum != header->checksum) return D_TBXML_SNAPSHOT_CHECKSUM;
+	}
+
+	// the arrays are used in place, their capacities stay 0 so nothing is freed or reused
+	elements = (TBXMLCompactElement*)sections;
+	attributes = header->attributeCount ? (TBXMLCompactAttribute*)(sections + elementsSize) : NULL;
+	lengths = header->lengthsCount ? (TBXMLCompactLengths*)(sections + elementsSize + attributesSize) : NULL;
+	elementsLength = (size_t)header->elementCount;
+	attributesLength = (size_t)header->attributeCount;
+	lengthsLength = (size_t)header->lengthsCount;
+	bytes = snapshotBytes;
+	bytesLength = (size_t)header->bytesLength;
+	if (!this->checkArrays()) return D_TBXML_SNAPSHOT_INVALID;
+
+	rootXMLElement = elements;
+	return D_TBXML_SUCCESS;
+}
+
+bool TBXMLCompact::checkArrays() const {
+	// every string lies in the byte buffer and every index in its array. The elements are in document
+	// order, so parents come before and siblings after an element, which also rules out cycles, and the
+	// attribute ranges follow one another. The lengths table holds exactly the elements with a long
+	// length, in order.
+	uint64_t length = bytesLength;
+	uint32_t attribute = 0;
+	size_t lengthsIndex = 0;
+	for (size_t i=0; i < elementsLength; i++) {
+		const TBXMLCompactElement * element = &elements[i];
+		uint64_t nameLength = element->nameLength;
+		uint64_t textLength = element->textLength;
+		if (element->nameLength == TBXML_COMPACT_LONG || element->textLength == TBXML_COMPACT_LONG) {
+			if (lengthsIndex == lengthsLength || lengths[lengthsIndex].element != i) return false;
+			nameLength = lengths[lengthsIndex].nameLength;
+			textLength = lengths[lengthsIndex].textLength;
+			lengthsIndex++;
+		}
+
+		if ((uint64_t)element->name + nameLength > length) return false;
+		if (element->text != TBXML_COMPACT_NONE && (uint64_t)element->text + textLength > length) return false;
+		if (element->firstAttribute < attribute || element->firstAttribute > attributesLength) return false;
+		attribute = element->firstAttribute;
+
+		if (element->parentElement != TBXML_COMPACT_NONE && element->parentElement >= i) return false;
+		if (element->nextSibling != TBXML_COMPACT_NONE && (element->nextSibling <= i || element->nextSibling >= elementsLength)) return false;
+	}
+	if (lengthsIndex != lengthsLength) return false;
+
+	for (size_t i=0; i < attributesLength; i++) {
+		const TBXMLCompactAttribute * xmlAttribute = &attributes[i];
+		if ((uint64_t)xmlAttribute->name + xmlAttribute->nameLength > length) return false;
+		if (xmlAttribute->value != TBXML_COMPACT_NONE && (uint64_t)xmlAttribute->value + xmlAttribute->valueLength > length) return false;
+	}
+	return true;
+}
+
+void TBXMLCompact::releaseArrays() {
+	if (snapshot) {
+#ifdef TBXML_HAS_MMAP
+		munmap(snapshot, snapshotLength);
+#else
+		free(snapshot);
+#endif
+		snapshot = NULL;
+		snapshotLength = 0;
+		bytes = NULL;
+		bytesLength = 0;
+	} else {
+		free(elements);
+		free(attributes);
+		free(lengths);
+	}
+
+	rootXMLElement = NULL;
+	elements = NULL;
+	attributes = NULL;
+	lengths = NULL;
+	elementsLength = 0;
+	elementsCapacity = 0;
+	attributesLength = 0;
+	attributesCapacity = 0;
+	lengthsLength = 0;
+	lengthsCapacity = 0;
+}
+
+void TBXMLCompact::takeMembers(TBXMLCompact &aOther) {
+	document = std::move(aOther.document);
+
+	rootXMLElement = aOther.rootXMLElement;
+	bytes = aOther.bytes;
+	bytesLength = aOther.bytesLength;
+	snapshot = aOther.snapshot;
+	snapshotLength = aOther.snapshotLength;
+	elements = aOther.elements;
+	attributes = aOther.attributes;
+	elementsLength = aOther.elementsLength;
+	elementsCapacity = aOther.elementsCapacity;
+	attributesLength = aOther.attributesLength;
+	attributesCapacity = aOther.attributesCapacity;
+	lengths = aOther.lengths;
+	lengthsLength = aOther.lengthsLength;
+	lengthsCapacity = aOther.lengthsCapacity;
+
+	// leave the other document empty so its destructor releases nothing
+	aOther.rootXMLElement = NULL;
+	aOther.bytes = NULL;
+	aOther.bytesLength = 0;
+	aOther.snapshot = NULL;
+	aOther.snapshotLength = 0;
+	aOther.elements = NULL;
+	aOther.attributes = NULL;
+	aOther.elementsLength = 0;
+	aOther.elementsCapacity = 0;
+	aOther.attributesLength = 0;
+	aOther.attributesCapacity = 0;
+	aOther.lengths = NULL;
+	aOther.lengthsLength = 0;
+	aOther.lengthsCapacity = 0;
+}
+
+const TBXMLCompactElement* TBXMLCompact::elementAtIndex(uint32_t aIndex) const {
+	if (aIndex == TBXML_COMPACT_NONE) return NULL;
+	return &elements[aIndex];
+}
+
+uint32_t TBXMLCompact::firstChildIndex(const TBXMLCompactElement* aXMLElement) const {
+	// in document order the first child of an element is the element after it
+	size_t index = aXMLElement - elements;
+	if (index+1 < elementsLength && elements[index+1].parentElement == index) return (uint32_t)(index+1);
+	return TBXML_COMPACT_NONE;
+}
+
+uint32_t TBXMLCompact::nameLengthOf(const TBXMLCompactElement* aXMLElement) const {
+	if (aXMLElement->nameLength != TBXML_COMPACT_LONG) return aXMLElement->nameLength;
+	return this->lengthsOf(aXMLElement)->nameLength;
+}
+
+uint32_t TBXMLCompact::textLengthOf(const TBXMLCompactElement* aXMLElement) const {
+	if (aXMLElement->textLength != TBXML_COMPACT_LONG) return aXMLElement->textLength;
+	return this->lengthsOf(aXMLElement)->textLength;
+}
+
+const TBXMLCompactLengths* TBXMLCompact::lengthsOf(const TBXMLCompactElement* aXMLElement) const {
+	// checkArrays and compactDocument make sure every element with a long length has its entry
+	uint32_t index = (uint32_t)(aXMLElement - elements);
+	size_t low = 0;
+	size_t high = lengthsLength;
+	while (low < high) {
+		size_t middle = low + (high - low)/2;
+		if (lengths[middle].element < index) low = middle+1;
+		else high = middle;
+	}
+	return &lengths[low];
+}
+
+bool TBXMLCompact::addLengths(uint32_t aIndex, size_t aNameLength, size_t aTextLength) {
+	if (lengthsLength == lengthsCapacity) {
+		size_t capacity = lengthsCapacity ? lengthsCapacity*2 : 16;
+		TBXMLCompactLengths * grown = (TBXMLCompactLengths*)realloc(lengths, sizeof(TBXMLCompactLengths)*capacity);
+		if (!grown) return false;
+		lengths = grown;
+		lengthsCapacity = capacity;
+	}
+
+	TBXMLCompactLengths * entry = &lengths[lengthsLength++];
+	entry->element = aIndex;
+	entry->nameLength = (uint32_t)aNameLength;
+	entry->textLength = (uint32_t)aTextLength;
+	entry->reserved = 0;
+	return true;
+}
+
+bool TBXMLCompact::nameMatches(uint32_t aName, uint32_t aNameLength, const char* name, size_t length) {
+	return aNameLength == length && memcmp(bytes + aName, name, length) == 0;
+}
+
+std::string TBXMLCompact::stringAt(uint32_t aOffset, uint32_t aLength) {
+	if (TBXML_COMPACT_NONE == aOffset) return "";
+	return std::string(bytes + aOffset, aLength);
+}
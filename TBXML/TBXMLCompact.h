@@ -0,0 +1,210 @@
+// ================================================================================================
+//  TBXMLCompact.h
+//  Compact, index based representation of a parsed TBXML document
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_COMPACT_H_
+#define _TBXML_COMPACT_H_
+
+#include "TBXML.h"
+#include <stdint.h>
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// offset or index of something that does not exist (no text, no parent, no child, no sibling)
+#define TBXML_COMPACT_NONE 0xFFFFFFFFu
+
+// name or text length of an element held in the TBXMLCompactLengths table instead
+#define TBXML_COMPACT_LONG 0xFFFFu
+
+// version of the snapshot format written by saveSnapshot, snapshots of other versions are rejected
+#define TBXML_SNAPSHOT_VERSION 3
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+/** The TBXMLCompactAttribute structure holds the byte buffer offsets and lengths of an attribute name
+    and value. The attributes of an element are stored next to each other, so no link to the next one is
+    needed.
+ */
+typedef struct _TBXMLCompactAttribute {
+	uint32_t name;
+	uint32_t nameLength;
+	uint32_t value;
+	uint32_t valueLength;
+} TBXMLCompactAttribute;
+
+/** The TBXMLCompactElement structure is the 24 byte counterpart of TBXMLElement. Name and text are
+    offsets into the byte buffer with their lengths, so nothing is measured with strlen; a length of
+    TBXML_COMPACT_LONG or more is stored as TBXML_COMPACT_LONG and looked up in the TBXMLCompactLengths
+    table. The links are indices into the element array, which is in document order, so no first child
+    is stored: it is the next element when that element's parent is this one. The attributes of element
+    i are [firstAttribute of i, firstAttribute of i+1).
+ */
+typedef struct _TBXMLCompactElement {
+	uint32_t name;
+	uint32_t text;
+	uint16_t nameLength;
+	uint16_t textLength;
+
+	uint32_t firstAttribute;
+
+	uint32_t parentElement;
+	uint32_t nextSibling;
+} TBXMLCompactElement;
+
+/** The TBXMLCompactLengths structure holds the name and text lengths of an element with a name or text
+    of TBXML_COMPACT_LONG bytes or more. The table is sorted by element index and rarely holds anything.
+ */
+typedef struct _TBXMLCompactLengths {
+	uint32_t element;
+	uint32_t nameLength;
+	uint32_t textLength;
+	uint32_t reserved;
+} TBXMLCompactLengths;
+
+/** TBXMLCompact holds a parsed document as two contiguous arrays of TBXMLCompactElement and
+    TBXMLCompactAttribute, about a third of the memory of the TBXMLElement tree and without pointers
+    to chase across buffers. The document is parsed by TBXML, converted, and the TBXMLElement buffers
+    are released; the byte buffer is kept since names and text still live there.
+
+    The navigation and accessor methods mirror the static TBXML ones, so code written against
+    TBXML::childElementNamed(name, element) only needs TBXML:: replaced by the compact document.
+    Documents of 4GB or more can not be addressed with 32 bit offsets and fail with
+    D_TBXML_DOCUMENT_TOO_LARGE.
+    Since nothing in the arrays is a pointer, saveSnapshot writes them and the byte buffer to a file
+    that initWithSnapshotFile maps back read-only, without parsing: loading takes the same time for any
+    document size and processes mapping one snapshot share its pages in the page cache.
+ */
+class TBXMLCompact {
+public:
+	TBXMLCompact();
+	~TBXMLCompact();
+
+	TBXMLCompact(TBXMLCompact &&aOther);
+	TBXMLCompact& operator=(TBXMLCompact &&aOther);
+	TBXMLCompact(const TBXMLCompact &) = delete;
+	TBXMLCompact& operator=(const TBXMLCompact &) = delete;
+
+	const TBXMLCompactElement * rootXMLElement;
+
+	bool initWithXMLString(std::string &aXMLString, std::string &error);
+	bool initWithXMLFile(std::string &aXMLFile, std::string &error);
+	bool initWithXMLFile(std::string &aXMLFile, TBXMLLoadMode aLoadMode, std::string &error);
+
+	/** Converts a document parsed by TBXML, taking over its byte buffer. aDocument is left empty.
+	 */
+	bool initWithDocument(TBXML &&aDocument, std::string &error);
+
+	/** Writes the document to aFile as a snapshot: a header with the format version, the array lengths
+	    and a checksum, followed by the element, attribute and lengths arrays and the byte buffer as they
+	    are held in memory. Snapshots are read by machines of the same byte order.
+	 */
+	bool saveSnapshot(std::string &aFile, std::string &error) const;
+
+	/** Maps a snapshot written by saveSnapshot. The header and the lengths are checked against the file
+	    size, and every offset and index in the arrays against the byte buffer and the arrays in one pass
+	    over them, so a damaged snapshot can't send the accessors outside the file; the byte buffer itself
+	    is not read. The arrays are used where they are mapped, read only, which is why the accessors hand
+	    out const elements and attributes. Fails with D_TBXML_SNAPSHOT_INVALID, or
+	    D_TBXML_SNAPSHOT_VERSION for a snapshot of another format version or byte order.
+	 */
+	bool initWithSnapshotFile(std::string &aFile, std::string &error);
+
+	/** Also compares the checksum of the whole file when aVerifyChecksum is set, reading every page of
+	    it, and fails with D_TBXML_SNAPSHOT_CHECKSUM when it does not match.
+	 */
+	bool initWithSnapshotFile(std::string &aFile, bool aVerifyChecksum, std::string &error);
+
+	size_t elementCount() const;
+	size_t attributeCount() const;
+
+	const TBXMLCompactElement* parentElement(const TBXMLCompactElement* aXMLElement);
+	const TBXMLCompactElement* firstChild(const TBXMLCompactElement* aXMLElement);
+	const TBXMLCompactElement* nextSibling(const TBXMLCompactElement* aXMLElement);
+
+	/** The attributes of an element are the attributeCountForElement entries starting at firstAttribute.
+	    nextAttribute walks them like the TBXMLAttribute list and returns NULL after the last one.
+	 */
+	const TBXMLCompactAttribute* firstAttribute(const TBXMLCompactElement* aXMLElement);
+	const TBXMLCompactAttribute* nextAttribute(const TBXMLCompactAttribute* aXMLAttribute, const TBXMLCompactElement* aXMLElement);
+	size_t attributeCountForElement(const TBXMLCompactElement* aXMLElement);
+
+	std::string elementName(const TBXMLCompactElement* aXMLElement);
+	std::string elementName(const TBXMLCompactElement* aXMLElement, std::string &error);
+	std::string textForElement(const TBXMLCompactElement* aXMLElement);
+	std::string textForElement(const TBXMLCompactElement* aXMLElement, std::string &error);
+	std::string valueOfAttributeNamed(std::string &aName, const TBXMLCompactElement* forElement);
+	std::string valueOfAttributeNamed(std::string &aName, const TBXMLCompactElement* forElement, std::string &error);
+
+	std::string attributeName(const TBXMLCompactAttribute* aXMLAttribute);
+	std::string attributeName(const TBXMLCompactAttribute* aXMLAttribute, std::string &error);
+	std::string attributeValue(const TBXMLCompactAttribute* aXMLAttribute);
+	std::string attributeValue(const TBXMLCompactAttribute* aXMLAttribute, std::string &error);
+
+	const TBXMLCompactElement* childElementNamed(std::string &aName, const TBXMLCompactElement* parentElement);
+	const TBXMLCompactElement* childElementNamed(std::string &aName, const TBXMLCompactElement* parentElement, std::string &error);
+	const TBXMLCompactElement* nextSiblingNamed(std::string &aName, const TBXMLCompactElement* searchFromElement);
+	const TBXMLCompactElement* nextSiblingNamed(std::string &aName, const TBXMLCompactElement* searchFromElement, std::string &error);
+
+private:
+
+	// owns the byte buffer (heap or mapping); its element/attribute buffers are released after conversion
+	TBXML document;
+
+	const char * bytes;
+	size_t bytesLength;
+
+	// the mapping (or, without mmap, the heap copy) of a snapshot the arrays and bytes point into
+	void * snapshot;
+	size_t snapshotLength;
+
+	TBXMLCompactElement * elements;
+	TBXMLCompactAttribute * attributes;
+	TBXMLCompactLengths * lengths;
+
+	size_t elementsLength;
+	size_t elementsCapacity;
+	size_t attributesLength;
+	size_t attributesCapacity;
+	size_t lengthsLength;
+	size_t lengthsCapacity;
+
+	bool compactDocument(std::string &error);
+	int loadSnapshot(std::string &aFile, bool aVerifyChecksum);
+	void releaseArrays();
+	void takeMembers(TBXMLCompact &aOther);
+	const TBXMLCompactElement* elementAtIndex(uint32_t aIndex) const;
+	uint32_t firstChildIndex(const TBXMLCompactElement* aXMLElement) const;
+	uint32_t nameLengthOf(const TBXMLCompactElement* aXMLElement) const;
+	uint32_t textLengthOf(const TBXMLCompactElement* aXMLElement) const;
+	const TBXMLCompactLengths* lengthsOf(const TBXMLCompactElement* aXMLElement) const;
+	bool addLengths(uint32_t aIndex, size_t aNameLength, size_t aTextLength);
+	bool checkArrays() const;
+	bool nameMatches(uint32_t aName, uint32_t aNameLength, const char* name, size_t length);
+	std::string stringAt(uint32_t aOffset, uint32_t aLength);
+};
+
+#endif	//_TBXML_COMPACT_H_
@@ -0,0 +1,143 @@
+// ================================================================================================
+//  TBXMLProjection.cpp
+//  Path sets limiting the elements a parse materialises
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLProjection.h"
+#include <string.h>
+
+// the end of a name in a path
+static size_t nameEnd(const char* aPath, size_t aStart, size_t aLength) {
+	while (aStart < aLength && !strchr("/@[]=*()'\" \t\r\n", aPath[aStart])) aStart++;
+	return aStart;
+}
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLProjection::TBXMLProjection() {
+	this->clear();
+}
+
+bool TBXMLProjection::addPath(std::string_view aPath, std::string &error) {
+	const char * path = aPath.data();
+	size_t length = aPath.length();
+	size_t position = 0;
+	size_t node = 0;
+
+	// the path is checked before any node is added, so an invalid path leaves the projection as it was
+	std::vector<std::string_view> steps;
+	bool attributes = false;
+	bool valid = length > 0;
+
+	while (valid && position < length) {
+		if (path[position] != '/' || ++position == length) {
+			valid = false;
+			break;
+		}
+
+		// @name can only end the path
+		if (path[position] == '@') {
+			size_t end = nameEnd(path, position+1, length);
+			valid = !steps.empty() && end > position+1 && end == length;
+			attributes = true;
+			break;
+		}
+
+		size_t end = nameEnd(path, position, length);
+		if (end == position) {
+			valid = false;
+			break;
+		}
+		steps.push_back(aPath.substr(position, end-position));
+		position = end;
+	}
+
+	if (!valid || steps.empty()) {
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_QUERY_INVALID));
+		return false;
+	}
+
+	for (std::string_view step : steps) node = this->addNode(node, step);
+	if (attributes)
+		nodes[node].attributes = true;
+	else
+		nodes[node].subtree = nodes[node].attributes = true;
+
+	paths++;
+	return true;
+}
+
+void TBXMLProjection::clear() {
+	nodes.clear();
+	names.clear();
+	paths = 0;
+
+	TBXMLProjectionNode document;
+	memset(&document, 0, sizeof(document));
+	nodes.push_back(document);
+}
+
+size_t TBXMLProjection::pathCount() const {
+	return paths;
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+size_t TBXMLProjection::addNode(size_t aParent, std::string_view aName) {
+	size_t last = 0;
+	for (size_t i = nodes[aParent].firstChild; i; i = nodes[i].nextSibling) {
+		if (nodes[i].nameLength == aName.length() && memcmp(&names[nodes[i].name], aName.data(), aName.length()) == 0)
+			return i;
+		last = i;
+	}
+
+	TBXMLProjectionNode node;
+	memset(&node, 0, sizeof(node));
+	node.name = names.size();
+	node.nameLength = aName.length();
+	names.insert(names.end(), aName.begin(), aName.end());
+
+	size_t index = nodes.size();
+	nodes.push_back(node);
+	if (last)
+		nodes[last].nextSibling = index;
+	else
+		nodes[aParent].firstChild = index;
+	return index;
+}
+
+const TBXMLProjectionNode* TBXMLProjection::match(const TBXMLProjectionNode* aParent, const char* aName, size_t aLength) const {
+	if (!aParent) aParent = &nodes[0];
+
+	// everything below the end of a path is parsed
+	if (aParent->subtree) return aParent;
+
+	for (size_t i = aParent->firstChild; i; i = nodes[i].nextSibling) {
+		const TBXMLProjectionNode &node = nodes[i];
+		if (node.nameLength == aLength && memcmp(&names[node.name], aName, aLength) == 0) return &node;
+	}
+	return NULL;
+}
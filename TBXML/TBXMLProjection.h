@@ -0,0 +1,87 @@
+// ================================================================================================
+//  TBXMLProjection.h
+//  Path sets limiting the elements a parse materialises
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+
+#ifndef _TBXML_PROJECTION_H_
+#define _TBXML_PROJECTION_H_
+
+#include "TBXML.h"
+#include <vector>
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+/** The TBXMLProjectionNode structure is one element name of the paths of a TBXMLProjection, the paths
+    sharing a prefix share its nodes. The children of a node are linked through nextSibling by index,
+    node 0 is the document and 0 ends a list.
+ */
+typedef struct _TBXMLProjectionNode {
+	size_t name;				// offset of the name in the names of the projection
+	size_t nameLength;
+	size_t firstChild;
+	size_t nextSibling;
+	bool subtree;				// a path ends at the element, everything below it is parsed
+	bool attributes;			// the attributes of the element are parsed
+} TBXMLProjectionNode;
+
+/** TBXMLProjection is the set of paths a document is parsed for, see TBXML::setProjection:
+
+        /feed/entry/id          the id elements of the entries of the feed, with everything below them
+        /feed/entry/@updated    the entries of the feed with their attributes, but not their children
+
+    Paths are absolute and made of element names. Elements on a path are kept with their name and text
+    (cleared like any text once they have a child that isn't self closing), their attributes only for
+    paths ending in @name, where all attributes of the element are kept. A path ending in an element keeps
+    the element and its whole subtree. Any other element is stepped over with its subtree without
+    decoding anything. Names are compared as written, with any prefix.
+
+    Add all paths before parsing with it; a projection is never modified by a parse and can be used by
+    any number of documents and threads at once.
+ */
+class TBXMLProjection {
+	friend class TBXML;
+
+public:
+	TBXMLProjection();
+
+	bool addPath(std::string_view aPath, std::string &error);
+	void clear();
+
+	size_t pathCount() const;
+
+private:
+	std::vector<TBXMLProjectionNode> nodes;
+	std::vector<char> names;
+	size_t paths;
+
+	size_t addNode(size_t aParent, std::string_view aName);
+
+	/** The node of an element named aName whose parent has node aParent, NULL for the document element,
+	    or NULL when the element is not on any path.
+	 */
+	const TBXMLProjectionNode* match(const TBXMLProjectionNode* aParent, const char* aName, size_t aLength) const;
+};
+
+#endif	//_TBXML_PROJECTION_H_
@@ -0,0 +1,221 @@
+// ================================================================================================
+//  TBXMLPush.cpp
+//  Incremental TBXML documents built from input arriving in pieces
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLPush.h"
+#include <string.h>
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLPushParser::TBXMLPushParser() {
+	this->reset();
+}
+
+void TBXMLPushParser::reset() {
+	xml.reset();
+	stream.reset();
+	parentXMLElement = NULL;
+	scope.clear();
+	finished = false;
+	errorValue = D_TBXML_SUCCESS;
+}
+
+bool TBXMLPushParser::feed(const char* aData, size_t aLength) {
+	if (!stream.feed(aData, aLength)) return false;
+	return this->build();
+}
+
+bool TBXMLPushParser::finish() {
+	stream.finish();
+	return this->build();
+}
+
+void TBXMLPushParser::setMaxTokenSize(size_t aMaxTokenSize) {
+	stream.setMaxTokenSize(aMaxTokenSize);
+}
+
+TBXML& TBXMLPushParser::document() {
+	return xml;
+}
+
+TBXMLElement* TBXMLPushParser::openElement() const {
+	return parentXMLElement;
+}
+
+bool TBXMLPushParser::isFinished() const {
+	return finished;
+}
+
+TBXMLErrorCodes TBXMLPushParser::errorCode() const {
+	if (errorValue != D_TBXML_SUCCESS) return errorValue;
+	return stream.errorCode();
+}
+
+std::string TBXMLPushParser::error() const {
+	if (this->errorCode() == D_TBXML_SUCCESS) return "";
+	return TBXML::errorWithCode(this->errorCode());
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+bool TBXMLPushParser::build() {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+
+	// the arena is shared with readers building child indices of the elements parsed so far
+	std::lock_guard<std::mutex> lock(xml.arenaLock);
+
+	while (true) {
+		switch (stream.next()) {
+			case D_TBXML_STREAM_START_ELEMENT: {
+				std::string_view name = stream.name();
+				if (!this->withinLimits()) return false;
+
+				// create new xmlElement struct
+				TBXMLElement * xmlElement = xml.nextAvailableElement();
+				if (!xmlElement) {
+					errorValue = xml.parseError;
+					return false;
+				}
+				if (!(xmlElement->name = this->copyBytes(name, std::string_view()))) return false;
+				xmlElement->nameLength = (unsigned int)name.length();
+				if (xml.symbols) xmlElement->nameId = xml.symbols->intern(name);
+
+				// link it to its parent and previous sibling like decodeBytes
+				if (parentXMLElement) {
+					if (parentXMLElement->currentChild) {
+						parentXMLElement->currentChild->nextSibling = xmlElement;
+						xmlElement->previousSibling = parentXMLElement->currentChild;
+						parentXMLElement->currentChild = xmlElement;
+					} else {
+						parentXMLElement->currentChild = xmlElement;
+						parentXMLElement->firstChild = xmlElement;
+					}
+					xmlElement->parentElement = parentXMLElement;
+				}
+
+				const TBXMLStreamAttribute * attributes = stream.attributes();
+				for (size_t i=0; i < stream.attributeCount(); i++) {
+					// name and value share one copy, each null terminated
+					char * copy = this->copyBytes(attributes[i].name, attributes[i].value);
+					if (!copy) return false;
+
+					TBXMLAttribute * xmlAttribute = xml.nextAvailableAttribute(xmlElement);
+					if (!xmlAttribute) {
+						errorValue = xml.parseError;
+						return false;
+					}
+
+					xmlAttribute->name = copy;
+					xmlAttribute->value = copy + attributes[i].name.length() + 1;
+					xmlAttribute->nameLength = (unsigned int)attributes[i].name.length();
+					xmlAttribute->valueLength = (unsigned int)attributes[i].value.length();
+					if (xml.symbols) xmlAttribute->nameId = xml.symbols->intern(attributes[i].name);
+				}
+
+				if (xml.namespaceAware && (xmlElement->firstAttribute || !scope.empty())) {
+					xml.resolveNamespaces(xmlElement, scope);
+					if (stream.isEmptyElement()) closeNamespaces(xmlElement);
+				}
+
+				// an element with an end tag has empty text until its text arrives, the terminator of its
+				// name serves as the empty string
+				if (!stream.isEmptyElement()) {
+					xmlElement->text = xmlElement->name + xmlElement->nameLength;
+					parentXMLElement = xmlElement;
+				}
+				break;
+			}
+			case D_TBXML_STREAM_END_ELEMENT:
+				if (stream.isEmptyElement() || !parentXMLElement) break;
+
+				closeNamespaces(parentXMLElement);
+				parentXMLElement = parentXMLElement->parentElement;
+
+				// if parent element has children clear text
+				if (parentXMLElement && parentXMLElement->firstChild) {
+					parentXMLElement->text = 0;
+					parentXMLElement->textLength = 0;
+				}
+				break;
+			case D_TBXML_STREAM_TEXT:
+				// only the text before the first child is kept, as decodeBytes terminates it there
+				if (parentXMLElement && !parentXMLElement->firstChild) {
+					std::string_view text = stream.text();
+					if (!(parentXMLElement->text = this->copyBytes(text, std::string_view()))) return false;
+					parentXMLElement->textLength = text.length();
+				}
+				break;
+			case D_TBXML_STREAM_NEED_DATA:
+				return true;
+			case D_TBXML_STREAM_END_DOCUMENT:
+				finished = true;
+				return true;
+			default:
+				return false;
+		}
+	}
+}
+
+void TBXMLPushParser::closeNamespaces(const TBXMLElement* aXMLElement) {
+	while (!scope.empty() && scope.back().element == aXMLElement) scope.pop_back();
+}
+
+bool TBXMLPushParser::withinLimits() {
+	// the limits decodeBytes checks for the start tag the stream returned, the others are checked as the
+	// document allocates
+	const TBXMLLimits &limits = xml.limits();
+	if (limits.maxDepth && stream.depth() > limits.maxDepth)
+		errorValue = D_TBXML_LIMIT_DEPTH;
+	else if (limits.maxAttributes && stream.attributeCount() > limits.maxAttributes)
+		errorValue = D_TBXML_LIMIT_ATTRIBUTES;
+	else if (limits.maxNameLength && stream.name().length() > limits.maxNameLength)
+		errorValue = D_TBXML_LIMIT_NAME_LENGTH;
+
+	const TBXMLStreamAttribute * attributes = stream.attributes();
+	for (size_t i=0; i < stream.attributeCount() && errorValue == D_TBXML_SUCCESS; i++) {
+		if (limits.maxNameLength && attributes[i].name.length() > limits.maxNameLength)
+			errorValue = D_TBXML_LIMIT_NAME_LENGTH;
+		else if (limits.maxValueLength && attributes[i].value.length() > limits.maxValueLength)
+			errorValue = D_TBXML_LIMIT_VALUE_LENGTH;
+	}
+	return errorValue == D_TBXML_SUCCESS;
+}
+
+char* TBXMLPushParser::copyBytes(std::string_view aFirst, std::string_view aSecond) {
+	char * rev = (char*)xml.allocateArenaBytes(aFirst.length() + aSecond.length() + 2);
+	if (!rev) {
+		errorValue = xml.parseError != D_TBXML_SUCCESS ? xml.parseError : D_TBXML_MEMORY_ALLOC_FAILURE;
+		return NULL;
+	}
+
+	if (aFirst.length()) memcpy(rev, aFirst.data(), aFirst.length());
+	rev[aFirst.length()] = 0;
+
+	char * second = rev + aFirst.length() + 1;
+	if (aSecond.length()) memcpy(second, aSecond.data(), aSecond.length());
+	second[aSecond.length()] = 0;
+	return rev;
+}
@@ -0,0 +1,102 @@
+// ================================================================================================
+//  TBXMLPush.h
+//  Incremental TBXML documents built from input arriving in pieces
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+
+#ifndef _TBXML_PUSH_H_
+#define _TBXML_PUSH_H_
+
+#include "TBXML.h"
+#include "TBXMLStream.h"
+
+/** TBXMLPushParser builds a TBXML document from input passed to feed() as it arrives, e.g. read from a
+    pipe or socket, instead of waiting for the whole message. Elements are added to document() as their
+    start tags complete, so the tree parsed so far can be read between calls to feed(); an element is
+    complete once it is no longer openElement() or one of its parents.
+
+    Tags, attribute values, CDATA sections and comments may be split anywhere, the TBXMLStreamParser
+    underneath keeps the partial token until the rest arrives. Names, text and attribute values are
+    copied into the document arena as each token completes, the fed input is not kept.
+
+    The tree matches the one initWithXMLString builds: text is the first run of an element, trimmed,
+    and is cleared when the element gets a child that isn't self closing; self closing elements have no
+    text. Comments are removed from text. It differs where decodeBytes reads start tags more loosely
+    than the stream: names also end at tabs and carriage returns, and a '>' in a quoted attribute value
+    belongs to the value. <r b='x>y'>hello</r> gives r the attribute b "x>y" and the text "hello",
+    where decodeBytes ends the tag at the first '>', drops b and takes "y'>hello" as the text.
+
+    The limits set on document() apply as the tree grows, except maxBytes as the input has no length
+    up front (see setMaxTokenSize); a limit reached is an error like a malformed token. A namespace
+    aware document() resolves the namespaces of each element as its start tag completes.
+ */
+class TBXMLPushParser {
+public:
+	TBXMLPushParser();
+
+	TBXMLPushParser(const TBXMLPushParser &) = delete;
+	TBXMLPushParser& operator=(const TBXMLPushParser &) = delete;
+
+	/** Starts a new document, resetting document() and keeping its buffers. Called by the constructor.
+	 */
+	void reset();
+
+	/** Parses aLength more bytes of the document. Returns false on an error and after finish().
+	 */
+	bool feed(const char* aData, size_t aLength);
+
+	/** Marks the end of the input and parses what is left. Returns false if an error occurred.
+	 */
+	bool finish();
+
+	void setMaxTokenSize(size_t aMaxTokenSize);
+
+	/** The document built so far. It may be moved out after finish(), reset() starts the next one.
+	 */
+	TBXML& document();
+
+	/** The innermost element whose end tag hasn't arrived yet, NULL outside the root element.
+	 */
+	TBXMLElement* openElement() const;
+
+	/** True after finish() once the whole input was parsed.
+	 */
+	bool isFinished() const;
+
+	TBXMLErrorCodes errorCode() const;
+	std::string error() const;
+
+private:
+	TBXML xml;
+	TBXMLStreamParser stream;
+	TBXMLElement * parentXMLElement;
+	std::vector<TBXMLNamespaceBinding> scope;
+	bool finished;
+	TBXMLErrorCodes errorValue;
+
+	bool build();
+	bool withinLimits();
+	void closeNamespaces(const TBXMLElement* aXMLElement);
+	char* copyBytes(std::string_view aFirst, std::string_view aSecond);
+};
+
+#endif	//_TBXML_PUSH_H_
@@ -0,0 +1,414 @@
+// ================================================================================================
+//  TBXMLQuery.cpp
+//  Compiled path queries over the TBXML tree
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLQuery.h"
+#include <string.h>
+
+// the end of a name in a path, names stop at the characters the path syntax uses
+static size_t nameEnd(const char* aPath, size_t aStart, size_t aLength) {
+	while (aStart < aLength && !strchr("/[]@=*()'\" \t\r\n", aPath[aStart])) aStart++;
+	return aStart;
+}
+
+static const TBXMLAttribute* attributeNamed(const TBXMLElement* aXMLElement, const TBXMLName &aName) {
+	const TBXMLAttribute * attributesEnd = aXMLElement->firstAttribute + aXMLElement->attributeCount;
+	for (const TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute < attributesEnd; xmlAttribute++) {
+		if (aName.matches(xmlAttribute->nameId, xmlAttribute->name, xmlAttribute->nameLength)) return xmlAttribute;
+	}
+	return NULL;
+}
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLQuery::TBXMLQuery() {
+	absolute = false;
+	result = D_TBXML_QUERY_ELEMENTS;
+	resultAttribute = TBXMLName();
+}
+
+bool TBXMLQuery::initWithPath(std::string_view aPath, std::string &error) {
+	return this->initWithPath(aPath, NULL, error);
+}
+
+bool TBXMLQuery::initWithPath(std::string_view aPath, const TBXMLSymbolTable *aSymbolTable, std::string &error) {
+	absolute = false;
+	result = D_TBXML_QUERY_ELEMENTS;
+	resultAttribute = TBXMLName();
+	steps.clear();
+	predicates.clear();
+
+	// names and values are never longer than the path, reserving it keeps the views into names valid
+	names.clear();
+	names.reserve(aPath.length());
+
+	const char * path = aPath.data();
+	size_t length = aPath.length();
+	size_t position = 0;
+	bool valid = length > 0;
+
+	if (valid && path[0] == '/') absolute = true;
+
+	while (valid && position < length) {
+		// every step but a relative first one follows / or //
+		bool descendant = false;
+		if (path[position] == '/') {
+			position++;
+			if (position < length && path[position] == '/') {
+				descendant = true;
+				position++;
+			}
+		} else if (position != 0) {
+			valid = false;
+			break;
+		}
+
+		if (position == length) {
+			valid = false;
+			break;
+		}
+
+		// text() and @name can only end the path
+		if (aPath.compare(position, 6, "text()") == 0) {
+			valid = !descendant && position+6 == length;
+			result = D_TBXML_QUERY_TEXT;
+			break;
+		}
+		if (path[position] == '@') {
+			size_t end = nameEnd(path, position+1, length);
+			valid = !descendant && end > position+1 && end == length;
+			result = D_TBXML_QUERY_ATTRIBUTE;
+			resultAttribute = this->addName(aPath.substr(position+1, end-position-1), aSymbolTable);
+			break;
+		}
+
+		TBXMLQueryStep step;
+		step.descendant = descendant;
+		step.anyName = false;
+		step.name = TBXMLName();
+		step.positional = false;
+		step.firstPredicate = predicates.size();
+		step.predicateCount = 0;
+
+		if (path[position] == '*') {
+			step.anyName = true;
+			position++;
+		} else {
+			size_t end = nameEnd(path, position, length);
+			if (end == position) {
+				valid = false;
+				break;
+			}
+			step.name = this->addName(aPath.substr(position, end-position), aSymbolTable);
+			position = end;
+		}
+
+		while (valid && position < length && path[position] == '[') {
+			position++;
+
+			TBXMLQueryPredicate predicate;
+			predicate.type = D_TBXML_QUERY_POSITION;
+			predicate.attribute = TBXMLName();
+			predicate.value = std::string_view();
+			predicate.position = 0;
+
+			if (position < length && path[position] == '@') {
+				size_t end = nameEnd(path, position+1, length);
+				if (end == position+1) {
+					valid = false;
+					break;
+				}
+				predicate.type = D_TBXML_QUERY_HAS_ATTRIBUTE;
+				predicate.attribute = this->addName(aPath.substr(position+1, end-position-1), aSymbolTable);
+				position = end;
+
+				if (position < length && path[position] == '=') {
+					position++;
+					size_t close = std::string_view::npos;
+					if (position < length && (path[position] == '\'' || path[position] == '"'))
+						close = aPath.find(path[position], position+1);
+					if (close == std::string_view::npos) {
+						valid = false;
+						break;
+					}
+					predicate.type = D_TBXML_QUERY_ATTRIBUTE_EQUALS;
+					TBXMLName value = this->addName(aPath.substr(position+1, close-position-1), NULL);
+					predicate.value = std::string_view(value.name, value.length);
+					position = close+1;
+				}
+			} else {
+				size_t start = position;
+				while (position < length && path[position] >= '0' && path[position] <= '9')
+					predicate.position = predicate.position*10 + (size_t)(path[position++] - '0');
+				if (position == start || !predicate.position) {
+					valid = false;
+					break;
+				}
+				step.positional = true;
+			}
+
+			if (position == length || path[position] != ']' || step.predicateCount == TBXML_QUERY_MAX_PREDICATES) {
+				valid = false;
+				break;
+			}
+			position++;
+
+			predicates.push_back(predicate);
+			step.predicateCount++;
+		}
+
+		steps.push_back(step);
+	}
+
+	// an absolute path selects at least the root element
+	if (absolute && steps.empty()) valid = false;
+
+	if (!valid) {
+		steps.clear();
+		predicates.clear();
+		names.clear();
+		result = D_TBXML_QUERY_ELEMENTS;
+		error.clear();
+		error.append(TBXML::errorWithCode(D_TBXML_QUERY_INVALID));
+		return false;
+	}
+	return true;
+}
+
+TBXMLQueryResultType TBXMLQuery::resultType() const {
+	return result;
+}
+
+size_t TBXMLQuery::evaluate(const TBXMLElement* aXMLElement, TBXMLQueryHandler &aHandler) const {
+	size_t count = 0;
+	if (!aXMLElement || (steps.empty() && result == D_TBXML_QUERY_ELEMENTS)) return 0;
+
+	if (!absolute) {
+		this->select(0, aXMLElement, aHandler, count);
+		return count;
+	}
+
+	// the root element is the only child of the document, stand in for it with an element on the stack
+	while (aXMLElement->parentElement) aXMLElement = aXMLElement->parentElement;
+	TBXMLElement document;
+	memset(&document, 0, sizeof(TBXMLElement));
+	document.firstChild = (TBXMLElement*)aXMLElement;
+
+	this->select(0, &document, aHandler, count);
+	return count;
+}
+
+const TBXMLElement* TBXMLQuery::first(const TBXMLElement* aXMLElement) const {
+	class First : public TBXMLQueryHandler {
+	public:
+		const TBXMLElement * found = NULL;
+		bool element(const TBXMLElement* aXMLElement) { found = aXMLElement; return false; }
+	} first;
+	this->evaluate(aXMLElement, first);
+	return first.found;
+}
+
+std::string_view TBXMLQuery::firstValue(const TBXMLElement* aXMLElement) const {
+	class First : public TBXMLQueryHandler {
+	public:
+		std::string_view found;
+		bool value(std::string_view aValue, const TBXMLElement*) { found = aValue; return false; }
+	} first;
+	this->evaluate(aXMLElement, first);
+	return first.found;
+}
+
+size_t TBXMLQuery::count(const TBXMLElement* aXMLElement) const {
+	TBXMLQueryHandler all;
+	return this->evaluate(aXMLElement, all);
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+TBXMLName TBXMLQuery::addName(std::string_view aName, const TBXMLSymbolTable *aSymbolTable) {
+	TBXMLName rev;
+	rev.id = aSymbolTable ? aSymbolTable->lookup(aName) : TBXML_NAME_NONE;
+	rev.name = names.data() + names.size();
+	rev.length = aName.length();
+	names.insert(names.end(), aName.begin(), aName.end());
+	return rev;
+}
+
+bool TBXMLQuery::matches(const TBXMLQueryStep &aStep, const TBXMLElement* aXMLElement, size_t* aPositions) const {
+	if (!aStep.anyName && !aStep.name.matches(aXMLElement->nameId, aXMLElement->name, aXMLElement->nameLength)) return false;
+
+	// a position counts the elements that passed the predicates before it
+	for (size_t i=0; i < aStep.predicateCount; i++) {
+		const TBXMLQueryPredicate &predicate = predicates[aStep.firstPredicate+i];
+		const TBXMLAttribute * xmlAttribute;
+
+		switch (predicate.type) {
+			case D_TBXML_QUERY_POSITION:
+				if (++aPositions[i] != predicate.position) return false;
+				break;
+			case D_TBXML_QUERY_HAS_ATTRIBUTE:
+				if (!attributeNamed(aXMLElement, predicate.attribute)) return false;
+				break;
+			case D_TBXML_QUERY_ATTRIBUTE_EQUALS:
+				xmlAttribute = attributeNamed(aXMLElement, predicate.attribute);
+				if (!xmlAttribute || xmlAttribute->valueLength != predicate.value.length()) return false;
+				if (memcmp(xmlAttribute->value, predicate.value.data(), predicate.value.length()) != 0) return false;
+				break;
+		}
+	}
+	return true;
+}
+
+bool TBXMLQuery::selectChildren(size_t aStep, const TBXMLElement* aParentXMLElement, TBXMLQueryHandler &aHandler, size_t &aCount) const {
+	const TBXMLQueryStep &step = steps[aStep];
+	size_t positions[TBXML_QUERY_MAX_PREDICATES] = { 0 };
+
+	for (const TBXMLElement * xmlElement = aParentXMLElement->firstChild; xmlElement; xmlElement = xmlElement->nextSibling) {
+		if (this->matches(step, xmlElement, positions) && !this->select(aStep+1, xmlElement, aHandler, aCount)) return false;
+	}
+	return true;
+}
+
+bool TBXMLQuery::matchesAt(size_t aStep, const TBXMLElement* aXMLElement) const {
+	const TBXMLQueryStep &step = steps[aStep];
+	size_t positions[TBXML_QUERY_MAX_PREDICATES] = { 0 };
+
+	// a position depends on the siblings before the element
+	if (step.positional && aXMLElement->parentElement) {
+		for (const TBXMLElement * sibling = aXMLElement->parentElement->firstChild; sibling != aXMLElement; sibling = sibling->nextSibling)
+			this->matches(step, sibling, positions);
+	}
+	return this->matches(step, aXMLElement, positions);
+}
+
+bool TBXMLQuery::matchesAbove(size_t aFirstStep, size_t aStep, const TBXMLElement* aXMLElement, const TBXMLElement* aContextXMLElement) const {
+	// aXMLElement passed step aStep and lies below aContextXMLElement, which steps from aFirstStep on start at.
+	// The steps split into runs of / steps each following a // step, a run is placed at the nearest
+	// ancestor it matches at: anything the runs above match over a higher one they match over it too.
+	// Top level elements have no parent, the stand in for their document is the context then
+	size_t step = aStep;
+	const TBXMLElement * xmlElement = aXMLElement;
+	while (true) {
+		size_t runStep = step;
+		const TBXMLElement * runXMLElement = xmlElement;
+
+		// the parents of the element pass the / steps before step
+		bool placed = true;
+		while (!steps[step].descendant) {
+			const TBXMLElement * parent = xmlElement->parentElement ? xmlElement->parentElement : aContextXMLElement;
+			if (parent == aContextXMLElement || !this->matchesAt(step-1, parent)) {
+				placed = false;
+				break;
+			}
+			xmlElement = parent;
+			step--;
+		}
+
+		// the run above ends at an ancestor of the run placed, a run that isn't placed is tried higher
+		// unless it starts at aXMLElement
+		const TBXMLElement * ancestor;
+		if (placed) {
+			if (step == aFirstStep) return true;
+			step--;
+			ancestor = xmlElement;
+		} else {
+			if (runStep == aStep) return false;
+			step = runStep;
+			ancestor = runXMLElement;
+		}
+
+		do {
+			ancestor = ancestor->parentElement ? ancestor->parentElement : aContextXMLElement;
+			if (ancestor == aContextXMLElement) return false;
+		} while (!this->matchesAt(step, ancestor));
+		xmlElement = ancestor;
+	}
+}
+
+bool TBXMLQuery::selectDescendants(size_t aFirstStep, const TBXMLElement* aContextXMLElement, TBXMLQueryHandler &aHandler, size_t &aCount) const {
+	const TBXMLQueryStep &step = steps[steps.size()-1];
+
+	// the last step is tested while walking, its positions count along with the siblings of a level and
+	// are kept for the levels above when it has a [n] predicate
+	size_t positions[TBXML_QUERY_MAX_PREDICATES] = { 0 };
+	std::vector<size_t> levels;
+
+	// walk the subtree in document order without recursing, deep documents don't exhaust the stack
+	const TBXMLElement * xmlElement = aContextXMLElement->firstChild;
+	while (xmlElement) {
+		if (this->matches(step, xmlElement, positions) && this->matchesAbove(aFirstStep, steps.size()-1, xmlElement, aContextXMLElement)) {
+			if (!this->select(steps.size(), xmlElement, aHandler, aCount)) return false;
+		}
+
+		if (xmlElement->firstChild) {
+			if (step.positional) {
+				levels.insert(levels.end(), positions, positions + step.predicateCount);
+				memset(positions, 0, sizeof(positions));
+			}
+			xmlElement = xmlElement->firstChild;
+			continue;
+		}
+
+		// move on to the next sibling of the element or of the first parent that has one
+		while (!xmlElement->nextSibling) {
+			xmlElement = xmlElement->parentElement ? xmlElement->parentElement : aContextXMLElement;
+			if (xmlElement == aContextXMLElement) return true;
+			if (step.positional) {
+				memcpy(positions, levels.data() + levels.size() - step.predicateCount, sizeof(size_t)*step.predicateCount);
+				levels.resize(levels.size() - step.predicateCount);
+			}
+		}
+		xmlElement = xmlElement->nextSibling;
+	}
+	return true;
+}
+
+bool TBXMLQuery::select(size_t aStep, const TBXMLElement* aXMLElement, TBXMLQueryHandler &aHandler, size_t &aCount) const {
+	if (aStep < steps.size()) {
+		if (!steps[aStep].descendant) return this->selectChildren(aStep, aXMLElement, aHandler, aCount);
+
+		// following // steps from every element they select could reach an element more than once
+		return this->selectDescendants(aStep, aXMLElement, aHandler, aCount);
+	}
+
+	// aXMLElement was selected by the last step
+	switch (result) {
+		case D_TBXML_QUERY_ELEMENTS:
+			aCount++;
+			return aHandler.element(aXMLElement);
+		case D_TBXML_QUERY_TEXT:
+			if (!aXMLElement->text || !aXMLElement->textLength) return true;
+			aCount++;
+			return aHandler.value(std::string_view(aXMLElement->text, aXMLElement->textLength), aXMLElement);
+		case D_TBXML_QUERY_ATTRIBUTE: {
+			const TBXMLAttribute * xmlAttribute = attributeNamed(aXMLElement, resultAttribute);
+			if (!xmlAttribute) return true;
+			aCount++;
+			return aHandler.value(std::string_view(xmlAttribute->value, xmlAttribute->valueLength), aXMLElement);
+		}
+	}
+	return true;
+}
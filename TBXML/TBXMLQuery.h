@@ -0,0 +1,188 @@
+// ================================================================================================
+//  TBXMLQuery.h
+//  Compiled path queries over the TBXML tree
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+
+#ifndef _TBXML_QUERY_H_
+#define _TBXML_QUERY_H_
+
+#include "TBXML.h"
+#include <vector>
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// predicates a single step of a query may have
+#define TBXML_QUERY_MAX_PREDICATES 8
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+enum TBXMLQueryPredicateType {
+	D_TBXML_QUERY_POSITION = 0,			// [n]
+	D_TBXML_QUERY_HAS_ATTRIBUTE,		// [@name]
+	D_TBXML_QUERY_ATTRIBUTE_EQUALS		// [@name='value']
+};
+
+enum TBXMLQueryResultType {
+	D_TBXML_QUERY_ELEMENTS = 0,			// the elements selected by the last step
+	D_TBXML_QUERY_TEXT,					// .../text()
+	D_TBXML_QUERY_ATTRIBUTE				// .../@name
+};
+
+typedef struct _TBXMLQueryPredicate {
+	TBXMLQueryPredicateType type;
+	TBXMLName attribute;
+	std::string_view value;
+	size_t position;
+} TBXMLQueryPredicate;
+
+typedef struct _TBXMLQueryStep {
+	bool descendant;		// reached with //, any element below the context rather than its children
+	bool anyName;			// *
+	TBXMLName name;
+	bool positional;		// has a [n] predicate
+	size_t firstPredicate;
+	size_t predicateCount;
+} TBXMLQueryStep;
+
+/** TBXMLQueryHandler receives the results of TBXMLQuery::evaluate. Return false to stop the evaluation.
+ */
+class TBXMLQueryHandler {
+public:
+	virtual ~TBXMLQueryHandler() {}
+
+	/** Called for every element selected by a query without text() or @name at its end.
+	 */
+	virtual bool element(const TBXMLElement* /*aXMLElement*/) { return true; }
+
+	/** Called with the text or attribute value selected by a query ending in text() or @name, and the
+	    element it belongs to.
+	 */
+	virtual bool value(std::string_view /*aValue*/, const TBXMLElement* /*aXMLElement*/) { return true; }
+};
+
+/** TBXMLQuery compiles a path in a subset of XPath once and evaluates it against any number of
+    elements and documents:
+
+        /a/b        the b children of the root element a
+        //c         every c element of the document
+        a//c        every c element below the a children of the context element
+        *           an element of any name
+        [@id]       elements with an id attribute, [@id='v'] (or "v") with that value
+        [n]         the nth element of those the step selects from one parent, counting from 1
+        text()      the text of the elements selected, as the last step
+        @name       the value of an attribute of the elements selected, as the last step
+
+    Paths without a leading / start at the context element passed to evaluate, absolute paths at the
+    root of its document. Predicates apply in order, so [@type='a'][2] is the second child with that
+    type. Names are compared by length before their bytes, or by id when the query was compiled with the
+    symbol table the document was parsed with.
+
+    Evaluation follows the child steps of a path from the context element. From its first // step on,
+    the subtree reached is walked once and each element that passes the last step is matched upwards
+    through its ancestors, so results are reported once each and in document order. Neither recurses
+    per level, so deep documents don't exhaust the stack, and only a // walk whose last step has a [n]
+    predicate allocates, for the positions of the levels above.
+    A compiled query is never modified by evaluate and can be used by any number of threads at once.
+ */
+class TBXMLQuery {
+public:
+	TBXMLQuery();
+
+	TBXMLQuery(const TBXMLQuery &) = delete;
+	TBXMLQuery& operator=(const TBXMLQuery &) = delete;
+	TBXMLQuery(TBXMLQuery &&) = default;
+	TBXMLQuery& operator=(TBXMLQuery &&) = default;
+
+	bool initWithPath(std::string_view aPath, std::string &error);
+
+	/** Compiles aPath resolving its names against aSymbolTable, which must not change while the query is
+	    in use (freeze it), so matching elements of documents parsed with it compares ids.
+	 */
+	bool initWithPath(std::string_view aPath, const TBXMLSymbolTable *aSymbolTable, std::string &error);
+
+	TBXMLQueryResultType resultType() const;
+
+	/** Passes every result for the context element aXMLElement to aHandler, returns the number passed.
+	 */
+	size_t evaluate(const TBXMLElement* aXMLElement, TBXMLQueryHandler &aHandler) const;
+
+	/** The first element selected, or NULL.
+	 */
+	const TBXMLElement* first(const TBXMLElement* aXMLElement) const;
+
+	/** The first text or attribute value selected, an empty view with a NULL data() if there is none.
+	 */
+	std::string_view firstValue(const TBXMLElement* aXMLElement) const;
+
+	size_t count(const TBXMLElement* aXMLElement) const;
+
+	/** Writes the elements selected to aOutput, e.g. a std::back_inserter.
+	 */
+	template<typename OutputIterator> OutputIterator elements(const TBXMLElement* aXMLElement, OutputIterator aOutput) const {
+		class Output : public TBXMLQueryHandler {
+		public:
+			OutputIterator &output;
+			Output(OutputIterator &aOutput) : output(aOutput) {}
+			bool element(const TBXMLElement* aXMLElement) { *output++ = aXMLElement; return true; }
+		} output(aOutput);
+		this->evaluate(aXMLElement, output);
+		return aOutput;
+	}
+
+	/** Writes the text or attribute values selected to aOutput as std::string_view.
+	 */
+	template<typename OutputIterator> OutputIterator values(const TBXMLElement* aXMLElement, OutputIterator aOutput) const {
+		class Output : public TBXMLQueryHandler {
+		public:
+			OutputIterator &output;
+			Output(OutputIterator &aOutput) : output(aOutput) {}
+			bool value(std::string_view aValue, const TBXMLElement*) { *output++ = aValue; return true; }
+		} output(aOutput);
+		this->evaluate(aXMLElement, output);
+		return aOutput;
+	}
+
+private:
+	bool absolute;
+	TBXMLQueryResultType result;
+	TBXMLName resultAttribute;
+	std::vector<TBXMLQueryStep> steps;
+	std::vector<TBXMLQueryPredicate> predicates;
+
+	// the names and values of the path, referred to by steps and predicates
+	std::vector<char> names;
+
+	TBXMLName addName(std::string_view aName, const TBXMLSymbolTable *aSymbolTable);
+	bool matches(const TBXMLQueryStep &aStep, const TBXMLElement* aXMLElement, size_t* aPositions) const;
+	bool selectChildren(size_t aStep, const TBXMLElement* aParentXMLElement, TBXMLQueryHandler &aHandler, size_t &aCount) const;
+	bool matchesAt(size_t aStep, const TBXMLElement* aXMLElement) const;
+	bool matchesAbove(size_t aFirstStep, size_t aStep, const TBXMLElement* aXMLElement, const TBXMLElement* aContextXMLElement) const;
+	bool selectDescendants(size_t aFirstStep, const TBXMLElement* aContextXMLElement, TBXMLQueryHandler &aHandler, size_t &aCount) const;
+	bool select(size_t aStep, const TBXMLElement* aXMLElement, TBXMLQueryHandler &aHandler, size_t &aCount) const;
+};
+
+#endif	//_TBXML_QUERY_H_
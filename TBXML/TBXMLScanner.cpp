@@ -0,0 +1,378 @@
+// ================================================================================================
+//  TBXMLScanner.cpp
+//  Vectorized structural character scanning for TBXML
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLScanner.h"
+#include <string.h>
+
+#if !defined(TBXML_DISABLE_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TBXML_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+// ================================================================================================
+// Dispatch Table
+// ================================================================================================
+
+typedef struct _TBXMLScanFunctions {
+	TBXMLScanMode mode;
+	char* (*findChar)(const char* start, const char* end, char c);
+	char* (*findFirstOf)(const char* start, const char* end, const char* set, int count);
+	char* (*skipWhitespace)(const char* start, const char* end);
+	void (*classifyBlock)(const char* block, TBXMLBlockMasks* masks);
+} TBXMLScanFunctions;
+
+// ================================================================================================
+// Scalar Implementation
+// ================================================================================================
+
+static char* scalarFindChar(const char* start, const char* end, char c) {
+	const void * found = memchr(start, c, end - start);
+	return (char*)found;
+}
+
+static char* scalarFindFirstOf(const char* start, const char* end, const char* set, int count) {
+	for (const char * chr = start; chr < end; chr++) {
+		for (int i = 0; i < count; i++) {
+			if (*chr == set[i]) return (char*)chr;
+		}
+	}
+	return NULL;
+}
+
+static char* scalarSkipWhitespace(const char* start, const char* end) {
+	for (const char * chr = start; chr < end; chr++) {
+		if (!TBXMLScanner::isWhitespace(*chr)) return (char*)chr;
+	}
+	return NULL;
+}
+
+static unsigned int classesOfChar(unsigned char c) {
+	unsigned int classes = 0;
+	switch (c) {
+		case '<':	classes |= TBXML_CLASS(TBXML_CHAR_LT);			break;
+		case '>':	classes |= TBXML_CLASS(TBXML_CHAR_GT);			break;
+		case '"':	classes |= TBXML_CLASS(TBXML_CHAR_DQUOTE);		break;
+		case '\'':	classes |= TBXML_CLASS(TBXML_CHAR_SQUOTE);		break;
+		case '=':	classes |= TBXML_CLASS(TBXML_CHAR_EQ);			break;
+		case '&':	classes |= TBXML_CLASS(TBXML_CHAR_AMP);			break;
+		case ']':	classes |= TBXML_CLASS(TBXML_CHAR_RBRACKET);	break;
+		case '-':	classes |= TBXML_CLASS(TBXML_CHAR_DASH);		break;
+		case '/':	classes |= TBXML_CLASS(TBXML_CHAR_NAME_END);	break;
+		default:	break;
+	}
+	if (c == ' ' || c == '\n') classes |= TBXML_CLASS(TBXML_CHAR_NAME_END);
+	if (TBXMLScanner::isWhitespace((char)c)) classes |= TBXML_CLASS(TBXML_CHAR_SPACE);
+	return classes;
+}
+
+typedef struct _TBXMLClassTable {
+	unsigned short classes[256];
+
+	_TBXMLClassTable() {
+		for (int c = 0; c < 256; c++)
+			classes[c] = (unsigned short)classesOfChar((unsigned char)c);
+	}
+} TBXMLClassTable;
+
+static void scalarClassifyBlock(const char* block, TBXMLBlockMasks* masks) {
+	static const TBXMLClassTable table;
+
+	memset(masks, 0, sizeof(TBXMLBlockMasks));
+	for (int i = 0; i < TBXML_SCANNER_BLOCK; i++) {
+		unsigned int classes = table.classes[(unsigned char)block[i]];
+		while (classes) {
+			masks->masks[tbxmlTrailingZeros(classes)] |= (uint64_t)1 << i;
+			classes &= classes - 1;
+		}
+	}
+}
+
+static const TBXMLScanFunctions scalarFunctions = {
+	D_TBXML_SCAN_SCALAR, scalarFindChar, scalarFindFirstOf, scalarSkipWhitespace, scalarClassifyBlock
+};
+
+#ifdef TBXML_SCANNER_X86
+
+// Vectors are only loaded while a whole one is left in the range, the bytes after the last one are
+// finished by the scalar functions so nothing past the end is read.
+
+// ================================================================================================
+// SSE2 Implementation (16 byte blocks)
+// ================================================================================================
+
+__attribute__((target("sse2")))
+static inline unsigned int sse2SetMask(__m128i block, const __m128i * set, int count) {
+	__m128i hits = _mm_cmpeq_epi8(block, set[0]);
+	for (int i = 1; i < count; i++)
+		hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, set[i]));
+	return (unsigned int)_mm_movemask_epi8(hits);
+}
+
+__attribute__((target("sse2")))
+static inline unsigned int sse2WhitespaceMask(__m128i block) {
+	// whitespace is ' ' or the range '\t'..'\r', tested as an unsigned (c - '\t') <= 4
+	__m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+	__m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+	__m128i space = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+	return (unsigned int)_mm_movemask_epi8(_mm_or_si128(inRange, space));
+}
+
+__attribute__((target("sse2")))
+static char* sse2FindChar(const char* start, const char* end, char c) {
+	const __m128i needle = _mm_set1_epi8(c);
+	const char * chr = start;
+	for (; end - chr >= 16; chr += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)chr);
+		unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+		if (mask) return (char*)chr + __builtin_ctz(mask);
+	}
+	return scalarFindChar(chr, end, c);
+}
+
+__attribute__((target("sse2")))
+static char* sse2FindFirstOf(const char* start, const char* end, const char* set, int count) {
+	__m128i needles[TBXML_SCANNER_MAX_SET];
+	for (int i = 0; i < count; i++)
+		needles[i] = _mm_set1_epi8(set[i]);
+
+	const char * chr = start;
+	for (; end - chr >= 16; chr += 16) {
+		unsigned int mask = sse2SetMask(_mm_loadu_si128((const __m128i*)chr), needles, count);
+		if (mask) return (char*)chr + __builtin_ctz(mask);
+	}
+	return scalarFindFirstOf(chr, end, set, count);
+}
+
+__attribute__((target("sse2")))
+static char* sse2SkipWhitespace(const char* start, const char* end) {
+	const char * chr = start;
+	for (; end - chr >= 16; chr += 16) {
+		unsigned int mask = ~sse2WhitespaceMask(_mm_loadu_si128((const __m128i*)chr)) & 0xFFFF;
+		if (mask) return (char*)chr + __builtin_ctz(mask);
+	}
+	return scalarSkipWhitespace(chr, end);
+}
+
+__attribute__((target("sse2")))
+static void sse2ClassifyBlock(const char* block, TBXMLBlockMasks* masks) {
+	memset(masks, 0, sizeof(TBXMLBlockMasks));
+
+	static const char classChars[TBXML_CHAR_NAME_END] = { '<', '>', '"', '\'', '=', '&', ']', '-' };
+	for (int offset = 0; offset < TBXML_SCANNER_BLOCK; offset += 16) {
+		__m128i bytes = _mm_load_si128((const __m128i*)(block + offset));
+		for (int c = 0; c < TBXML_CHAR_NAME_END; c++) {
+			uint64_t mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(classChars[c])));
+			masks->masks[c] |= mask << offset;
+		}
+
+		__m128i nameEnd = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+			_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('/')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))));
+		masks->masks[TBXML_CHAR_NAME_END] |= (uint64_t)(unsigned int)_mm_movemask_epi8(nameEnd) << offset;
+		masks->masks[TBXML_CHAR_SPACE] |= (uint64_t)sse2WhitespaceMask(bytes) << offset;
+	}
+}
+
+static const TBXMLScanFunctions sse2Functions = {
+	D_TBXML_SCAN_SSE2, sse2FindChar, sse2FindFirstOf, sse2SkipWhitespace, sse2ClassifyBlock
+};
+
+// ================================================================================================
+// AVX2 Implementation (32 byte blocks)
+// ================================================================================================
+
+__attribute__((target("avx2")))
+static inline unsigned int avx2SetMask(__m256i block, const __m256i * set, int count) {
+	__m256i hits = _mm256_cmpeq_epi8(block, set[0]);
+	for (int i = 1; i < count; i++)
+		hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, set[i]));
+	return (unsigned int)_mm256_movemask_epi8(hits);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int avx2WhitespaceMask(__m256i block) {
+	__m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+	__m256i inRange = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+	__m256i space = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+	return (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(inRange, space));
+}
+
+__attribute__((target("avx2")))
+static char* avx2FindChar(const char* start, const char* end, char c) {
+	const __m256i needle = _mm256_set1_epi8(c);
+	const char * chr = start;
+	for (; end - chr >= 32; chr += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i*)chr);
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+		if (mask) return (char*)chr + __builtin_ctz(mask);
+	}
+	return scalarFindChar(chr, end, c);
+}
+
+__attribute__((target("avx2")))
+static char* avx2FindFirstOf(const char* start, const char* end, const char* set, int count) {
+	__m256i needles[TBXML_SCANNER_MAX_SET];
+	for (int i = 0; i < count; i++)
+		needles[i] = _mm256_set1_epi8(set[i]);
+
+	const char * chr = start;
+	for (; end - chr >= 32; chr += 32) {
+		unsigned int mask = avx2SetMask(_mm256_loadu_si256((const __m256i*)chr), needles, count);
+		if (mask) return (char*)chr + __builtin_ctz(mask);
+	}
+	return scalarFindFirstOf(chr, end, set, count);
+}
+
+__attribute__((target("avx2")))
+static char* avx2SkipWhitespace(const char* start, const char* end) {
+	const char * chr = start;
+	for (; end - chr >= 32; chr += 32) {
+		unsigned int mask = ~avx2WhitespaceMask(_mm256_loadu_si256((const __m256i*)chr));
+		if (mask) return (char*)chr + __builtin_ctz(mask);
+	}
+	return scalarSkipWhitespace(chr, end);
+}
+
+__attribute__((target("avx2")))
+static void avx2ClassifyBlock(const char* block, TBXMLBlockMasks* masks) {
+	__m256i low = _mm256_load_si256((const __m256i*)block);
+	__m256i high = _mm256_load_si256((const __m256i*)(block + 32));
+
+	static const char classChars[TBXML_CHAR_NAME_END] = { '<', '>', '"', '\'', '=', '&', ']', '-' };
+	for (int c = 0; c < TBXML_CHAR_NAME_END; c++) {
+		__m256i needle = _mm256_set1_epi8(classChars[c]);
+		uint64_t lowMask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, needle));
+		uint64_t highMask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, needle));
+		masks->masks[c] = lowMask | (highMask << 32);
+	}
+
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i slash = _mm256_set1_epi8('/');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	uint64_t lowNameEnd = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(low, space),
+		_mm256_or_si256(_mm256_cmpeq_epi8(low, slash), _mm256_cmpeq_epi8(low, newline))));
+	uint64_t highNameEnd = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(high, space),
+		_mm256_or_si256(_mm256_cmpeq_epi8(high, slash), _mm256_cmpeq_epi8(high, newline))));
+	masks->masks[TBXML_CHAR_NAME_END] = lowNameEnd | (highNameEnd << 32);
+	masks->masks[TBXML_CHAR_SPACE] = (uint64_t)avx2WhitespaceMask(low) | ((uint64_t)avx2WhitespaceMask(high) << 32);
+}
+
+static const TBXMLScanFunctions avx2Functions = {
+	D_TBXML_SCAN_AVX2, avx2FindChar, avx2FindFirstOf, avx2SkipWhitespace, avx2ClassifyBlock
+};
+
+#endif // TBXML_SCANNER_X86
+
+// ================================================================================================
+// Mode Selection
+// ================================================================================================
+
+static const TBXMLScanFunctions * functionsForMode(TBXMLScanMode aMode) {
+#ifdef TBXML_SCANNER_X86
+	__builtin_cpu_init();
+	bool hasAVX2 = __builtin_cpu_supports("avx2");
+	bool hasSSE2 = __builtin_cpu_supports("sse2");
+
+	switch (aMode) {
+		case D_TBXML_SCAN_AUTO:
+			if (hasAVX2) return &avx2Functions;
+			if (hasSSE2) return &sse2Functions;
+			break;
+		case D_TBXML_SCAN_AVX2:
+			if (hasAVX2) return &avx2Functions;
+			break;
+		case D_TBXML_SCAN_SSE2:
+			if (hasSSE2) return &sse2Functions;
+			break;
+		default:
+			break;
+	}
+#else
+	(void)aMode;
+#endif
+	return &scalarFunctions;
+}
+
+// starts out scalar so that parses running during static initialization are still correct
+static const TBXMLScanFunctions * activeFunctions = &scalarFunctions;
+static const bool activeFunctionsSelected = (activeFunctions = functionsForMode(D_TBXML_SCAN_AUTO), true);
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+void TBXMLScanner::setScanMode(TBXMLScanMode aMode) {
+	activeFunctions = functionsForMode(aMode);
+}
+
+TBXMLScanMode TBXMLScanner::scanMode() {
+	return activeFunctions->mode;
+}
+
+char* TBXMLScanner::findChar(const char* start, const char* end, char c) {
+	if (start >= end) return NULL;
+	return activeFunctions->findChar(start, end, c);
+}
+
+char* TBXMLScanner::findFirstOf(const char* start, const char* end, const char* set) {
+	if (start >= end) return NULL;
+
+	int count = (int)strlen(set);
+	if (count == 1) return activeFunctions->findChar(start, end, *set);
+	if (count > TBXML_SCANNER_MAX_SET) return scalarFindFirstOf(start, end, set, count);
+	return activeFunctions->findFirstOf(start, end, set, count);
+}
+
+char* TBXMLScanner::findString(const char* start, const char* end, const char* needle) {
+	if (start >= end) return NULL;
+
+	size_t needleLength = strlen(needle);
+	const char * chr = start;
+	while ((chr = activeFunctions->findChar(chr, end, *needle))) {
+		if ((size_t)(end - chr) < needleLength) return NULL;
+		if (memcmp(chr, needle, needleLength) == 0) return (char*)chr;
+		if (++chr >= end) break;
+	}
+	return NULL;
+}
+
+char* TBXMLScanner::skipWhitespace(const char* start, const char* end) {
+	if (start >= end) return NULL;
+	return activeFunctions->skipWhitespace(start, end);
+}
+
+void TBXMLScanner::classifyBlock(const char* aBlock, TBXMLBlockMasks* aMasks) {
+	activeFunctions->classifyBlock(aBlock, aMasks);
+}
+
+void TBXMLScanner::classifyPartialBlock(const char* aBlock) {
+	// the bytes of the block outside the buffer are left 0, which belongs to no class
+	alignas(TBXML_SCANNER_BLOCK) char bytes[TBXML_SCANNER_BLOCK];
+	memset(bytes, 0, sizeof(bytes));
+
+	uintptr_t block = (uintptr_t)aBlock;
+	uintptr_t from = block > bufferStart ? block : bufferStart;
+	uintptr_t to = block + TBXML_SCANNER_BLOCK < bufferEnd ? block + TBXML_SCANNER_BLOCK : bufferEnd;
+	if (from < to) memcpy(bytes + (from - block), (const char*)from, to - from);
+
+	activeFunctions->classifyBlock(bytes, &this->block);
+}
@@ -0,0 +1,233 @@
+// ================================================================================================
+//  TBXMLScanner.h
+//  Vectorized structural character scanning for TBXML
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_SCANNER_H_
+#define _TBXML_SCANNER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ================================================================================================
+//  Scan Modes
+// ================================================================================================
+enum TBXMLScanMode {
+	D_TBXML_SCAN_AUTO = 0,
+	D_TBXML_SCAN_SCALAR,
+	D_TBXML_SCAN_SSE2,
+	D_TBXML_SCAN_AVX2
+};
+
+// ================================================================================================
+//  Character Classes
+// ================================================================================================
+enum TBXMLCharClass {
+	TBXML_CHAR_LT = 0,			// <
+	TBXML_CHAR_GT,				// >
+	TBXML_CHAR_DQUOTE,			// "
+	TBXML_CHAR_SQUOTE,			// '
+	TBXML_CHAR_EQ,				// =
+	TBXML_CHAR_AMP,				// &
+	TBXML_CHAR_RBRACKET,		// ]
+	TBXML_CHAR_DASH,			// -
+	TBXML_CHAR_NAME_END,		// ' ', '/' or '\n', the characters that end an element name
+	TBXML_CHAR_SPACE,			// ' ', '\t', '\n', '\v', '\f' or '\r'
+	TBXML_CHAR_CLASS_COUNT
+};
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+/** Builds the class set argument of TBXMLScanner::find/skip from TBXMLCharClass values.
+ */
+#define TBXML_CLASS(charClass) (1u << (charClass))
+
+/** Number of bytes summarised by one TBXMLBlockMasks.
+ */
+#define TBXML_SCANNER_BLOCK 64
+
+/** Maximum number of characters in a set passed to TBXMLScanner::findFirstOf.
+ */
+#define TBXML_SCANNER_MAX_SET 8
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static inline int tbxmlTrailingZeros(uint64_t aBits) { unsigned long index; _BitScanForward64(&index, aBits); return (int)index; }
+static inline int tbxmlTrailingZeros(unsigned int aBits) { unsigned long index; _BitScanForward(&index, aBits); return (int)index; }
+#else
+static inline int tbxmlTrailingZeros(uint64_t aBits) { return __builtin_ctzll(aBits); }
+static inline int tbxmlTrailingZeros(unsigned int aBits) { return __builtin_ctz(aBits); }
+#endif
+
+/** The TBXMLBlockMasks structure holds one bit per byte of a 64 byte block for every TBXMLCharClass.
+ */
+typedef struct _TBXMLBlockMasks {
+	uint64_t masks[TBXML_CHAR_CLASS_COUNT];
+} TBXMLBlockMasks;
+
+/** TBXMLScanner locates the structural characters of an XML document ('<', '>', quotes, '=', '&' and
+    whitespace). Blocks of 16 (SSE2) or 32 (AVX2) bytes are compared against the wanted characters and
+    reduced to bitmasks, so the position of the next match is found with a single bit scan instead of
+    testing every byte. The implementation is selected at runtime from the CPU features; a portable
+    scalar implementation is always available and returns exactly the same positions.
+
+    The static functions scan the half open range [start, end) and return NULL when nothing was found.
+
+    A TBXMLScanner instance is a cursor for a parser walking forward through one buffer. It classifies a
+    whole 64 byte block at once and answers the following queries in that block with bit operations
+    only, so the many short scans within a tag cost one classification per block. The caller must
+    invalidate() the cursor after rewriting bytes ahead of its last query.
+
+    Neither the static functions nor the cursor read outside the range or buffer they are given.
+ */
+class TBXMLScanner {
+public:
+	/** A cursor over the buffer [aStart, aEnd), the queries must stay within it.
+	 */
+	TBXMLScanner(const char* aStart, const char* aEnd) : bufferStart((uintptr_t)aStart), bufferEnd((uintptr_t)aEnd), blockStart(NULL) {}
+
+	/** Returns the first character in [from, to) belonging to any class in aClasses (see TBXML_CLASS).
+	 */
+	inline char* find(unsigned int aClasses, const char* from, const char* to) {
+		while (from < to) {
+			const char * base = this->blockFor(from);
+			uint64_t hits = this->combine(aClasses) >> (from - base);
+			if (hits) {
+				const char * hit = from + tbxmlTrailingZeros(hits);
+				return hit < to ? (char*)hit : NULL;
+			}
+			from = base + TBXML_SCANNER_BLOCK;
+
+			// long runs without a hit, such as text looking for '<', are left to the single character
+			// scanner rather than classifying every block
+			if (from < to && TBXMLScanner::charOfClass(aClasses))
+				return this->findChar(from, to, TBXMLScanner::charOfClass(aClasses));
+		}
+		return NULL;
+	}
+
+	/** Returns the first character in [from, to) not belonging to any class in aClasses.
+	 */
+	inline char* skip(unsigned int aClasses, const char* from, const char* to) {
+		while (from < to) {
+			const char * base = this->blockFor(from);
+			uint64_t misses = ~this->combine(aClasses) >> (from - base);
+			if (misses) {
+				const char * miss = from + tbxmlTrailingZeros(misses);
+				return miss < to ? (char*)miss : NULL;
+			}
+			from = base + TBXML_SCANNER_BLOCK;
+		}
+		return NULL;
+	}
+
+	/** Returns the first occurrence of aNeedle in [from, to). aFirstClass is the class of its first character.
+	 */
+	inline char* findString(TBXMLCharClass aFirstClass, const char* aNeedle, const char* from, const char* to) {
+		size_t needleLength = strlen(aNeedle);
+		char * chr;
+		while ((chr = this->find(TBXML_CLASS(aFirstClass), from, to))) {
+			if ((size_t)(to - chr) < needleLength) return NULL;
+			if (memcmp(chr, aNeedle, needleLength) == 0) return chr;
+			from = chr + 1;
+		}
+		return NULL;
+	}
+
+	/** Forgets the classified block, required after bytes ahead of the cursor were rewritten.
+	 */
+	inline void invalidate() {
+		blockStart = NULL;
+	}
+
+	/** Forces a scanner implementation. D_TBXML_SCAN_AUTO picks the widest one supported by the CPU,
+	    an unsupported mode falls back to the scalar scanner. Not safe to call while other threads parse.
+	 */
+	static void setScanMode(TBXMLScanMode aMode);
+
+	/** Returns the implementation currently in use (never D_TBXML_SCAN_AUTO).
+	 */
+	static TBXMLScanMode scanMode();
+
+	static char* findChar(const char* start, const char* end, char c);
+	static char* findFirstOf(const char* start, const char* end, const char* set);
+	static char* findString(const char* start, const char* end, const char* needle);
+	static char* skipWhitespace(const char* start, const char* end);
+
+	static inline bool isWhitespace(char c) {
+		return c == ' ' || (unsigned char)(c - '\t') <= (unsigned char)('\r' - '\t');
+	}
+
+	/** Classifies the 64 bytes starting at aBlock, which must be 64 byte aligned.
+	 */
+	static void classifyBlock(const char* aBlock, TBXMLBlockMasks* aMasks);
+
+private:
+	uintptr_t bufferStart;
+	uintptr_t bufferEnd;
+	const char * blockStart;
+	TBXMLBlockMasks block;
+
+	// the first and last blocks of the buffer stick out of it and are classified from a copy
+	void classifyPartialBlock(const char* aBlock);
+
+	inline const char* blockFor(const char* aPosition) {
+		uintptr_t base = (uintptr_t)aPosition & ~(uintptr_t)(TBXML_SCANNER_BLOCK-1);
+		if ((const char*)base != blockStart) {
+			if (base >= bufferStart && base + TBXML_SCANNER_BLOCK <= bufferEnd)
+				TBXMLScanner::classifyBlock((const char*)base, &block);
+			else
+				this->classifyPartialBlock((const char*)base);
+			blockStart = (const char*)base;
+		}
+		return (const char*)base;
+	}
+
+	inline uint64_t combine(unsigned int aClasses) const {
+		uint64_t bits = 0;
+		while (aClasses) {
+			bits |= block.masks[tbxmlTrailingZeros(aClasses)];
+			aClasses &= aClasses - 1;
+		}
+		return bits;
+	}
+
+	// the character of a single character class, 0 for sets and multi character classes
+	static inline char charOfClass(unsigned int aClasses) {
+		switch (aClasses) {
+			case TBXML_CLASS(TBXML_CHAR_LT):		return '<';
+			case TBXML_CLASS(TBXML_CHAR_GT):		return '>';
+			case TBXML_CLASS(TBXML_CHAR_DQUOTE):	return '"';
+			case TBXML_CLASS(TBXML_CHAR_SQUOTE):	return '\'';
+			case TBXML_CLASS(TBXML_CHAR_EQ):		return '=';
+			case TBXML_CLASS(TBXML_CHAR_AMP):		return '&';
+			case TBXML_CLASS(TBXML_CHAR_RBRACKET):	return ']';
+			case TBXML_CLASS(TBXML_CHAR_DASH):		return '-';
+			default:								return 0;
+		}
+	}
+};
+
+#endif	//_TBXML_SCANNER_H_
@@ -0,0 +1,70 @@
+// ================================================================================================
+//  TBXMLStats.cpp
+//  Parse statistics, trace hooks and process wide totals
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLStats.h"
+#include <string.h>
+#include <mutex>
+
+// totals of the process, added to once per parse
+static std::mutex totalsLock;
+static TBXMLParseStats totalStats;
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+bool TBXMLStats::enabled() {
+	return TBXML_STATS != 0;
+}
+
+TBXMLParseStats TBXMLStats::totals() {
+	std::lock_guard<std::mutex> lock(totalsLock);
+	return totalStats;
+}
+
+void TBXMLStats::reset() {
+	std::lock_guard<std::mutex> lock(totalsLock);
+	memset(&totalStats, 0, sizeof(totalStats));
+}
+
+void TBXMLStats::add(const TBXMLParseStats &aStats) {
+	std::lock_guard<std::mutex> lock(totalsLock);
+	TBXMLStats::accumulate(totalStats, aStats);
+}
+
+void TBXMLStats::accumulate(TBXMLParseStats &aTotal, const TBXMLParseStats &aStats) {
+	aTotal.parses += aStats.parses;
+	aTotal.bytesScanned += aStats.bytesScanned;
+	aTotal.elements += aStats.elements;
+	aTotal.attributes += aStats.attributes;
+	aTotal.CDATASections += aStats.CDATASections;
+	aTotal.comments += aStats.comments;
+	if (aStats.maxDepth > aTotal.maxDepth) aTotal.maxDepth = aStats.maxDepth;
+	aTotal.elementBuffers += aStats.elementBuffers;
+	aTotal.attributeBuffers += aStats.attributeBuffers;
+	aTotal.bytesAllocated += aStats.bytesAllocated;
+	aTotal.scanNanoseconds += aStats.scanNanoseconds;
+	aTotal.attributeNanoseconds += aStats.attributeNanoseconds;
+	aTotal.trimNanoseconds += aStats.trimNanoseconds;
+	aTotal.parseNanoseconds += aStats.parseNanoseconds;
+}
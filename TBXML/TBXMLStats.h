@@ -0,0 +1,135 @@
+// ================================================================================================
+//  TBXMLStats.h
+//  Parse statistics, trace hooks and process wide totals
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_STATS_H_
+#define _TBXML_STATS_H_
+
+#include <stdint.h>
+#include <chrono>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define TBXML_STATS_TSC 1
+#endif
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// build the library with -DTBXML_STATS=1 to collect parse statistics, without it the statements below
+// are compiled out and parseStats() stays zero
+#ifndef TBXML_STATS
+#define TBXML_STATS 0
+#endif
+
+#if TBXML_STATS
+#define TBXML_STAT(...) __VA_ARGS__
+#else
+#define TBXML_STAT(...)
+#endif
+
+// ================================================================================================
+//  Trace Events
+// ================================================================================================
+enum TBXMLTraceEvent {
+	D_TBXML_TRACE_PARSE_BEGIN = 0,		// value: bytes of the document
+	D_TBXML_TRACE_PARSE_END,			// value: bytes of the document
+	D_TBXML_TRACE_PART_BEGIN,			// value: bytes of a part of a parallel parse, on its thread
+	D_TBXML_TRACE_PART_END,				// value: bytes of the part
+	D_TBXML_TRACE_ELEMENT_BUFFER,		// value: capacity of a new TBXMLElementBuffer
+	D_TBXML_TRACE_ATTRIBUTE_BUFFER,		// value: capacity of a new TBXMLAttributeBuffer
+	D_TBXML_TRACE_ARENA_BUFFER,			// value: bytes of a new TBXMLArenaBuffer
+	D_TBXML_TRACE_CHILD_INDEX			// value: children of the element a child index is built for
+};
+
+// build the library with -DTBXML_TRACE_HOOK=function to have the function called on every event, e.g. to
+// forward them to a tracer. Without it the hooks are compiled out.
+#ifdef TBXML_TRACE_HOOK
+extern void TBXML_TRACE_HOOK(TBXMLTraceEvent aEvent, const void* aDocument, uint64_t aValue);
+#define TBXML_TRACE(event, document, value) TBXML_TRACE_HOOK(event, document, (uint64_t)(value))
+#else
+#define TBXML_TRACE(event, document, value) ((void)0)
+#endif
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+/** The TBXMLParseStats structure describes a parse made by TBXML::decodeBytes. The phase times of a
+    parallel parse add up the time of all threads, parseNanoseconds is wall clock time.
+ */
+typedef struct _TBXMLParseStats {
+	uint64_t parses;				// 1 for the stats of a document, the number of parses for totals
+	uint64_t bytesScanned;
+	uint64_t elements;
+	uint64_t attributes;
+	uint64_t CDATASections;			// in text and in attribute values
+	uint64_t comments;
+	uint64_t maxDepth;				// the root element is at depth 1
+	uint64_t elementBuffers;		// TBXMLElementBuffer chunks holding the elements
+	uint64_t attributeBuffers;		// TBXMLAttributeBuffer chunks holding the attributes
+	uint64_t bytesAllocated;		// heap bytes allocated by the parse, buffers kept from a previous document are free
+
+	uint64_t scanNanoseconds;		// finding tags, comments and cdata sections and linking elements
+	uint64_t attributeNanoseconds;	// parsing element names and attributes
+	uint64_t trimNanoseconds;		// trimming and measuring (and decoding) the text of closed elements
+	uint64_t parseNanoseconds;
+} TBXMLParseStats;
+
+/** TBXMLStats adds up the statistics of every parse of the process, so a long running process can
+    export totals (e.g. as counters of its metrics endpoint) without keeping the documents.
+ */
+class TBXMLStats {
+public:
+	/** True when the library was built with TBXML_STATS=1.
+	 */
+	static bool enabled();
+
+	/** The sums of all parses since the start or the last reset, maxDepth is the largest.
+	 */
+	static TBXMLParseStats totals();
+
+	static void reset();
+
+	/** Called by TBXML at the end of every parse.
+	 */
+	static void add(const TBXMLParseStats &aStats);
+
+	/** Adds aStats to aTotal field by field, keeping the larger maxDepth.
+	 */
+	static void accumulate(TBXMLParseStats &aTotal, const TBXMLParseStats &aStats);
+
+	/** A cheap timestamp for the phase timings, the time stamp counter where there is one and
+	    nanoseconds otherwise. Converted to nanoseconds against the clock over the whole parse.
+	 */
+	static inline uint64_t ticks() {
+#ifdef TBXML_STATS_TSC
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+};
+
+#endif	//_TBXML_STATS_H_
@@ -0,0 +1,539 @@
+// ================================================================================================
+//  TBXMLStream.cpp
+//  Streaming pull and SAX style parsing with bounded memory
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLStream.h"
+#include "TBXMLScanner.h"
+#include <stdlib.h>
+#include <string.h>
+
+// a token that produced no event (comment, processing instruction, whitespace only text)
+#define TBXML_STREAM_SKIPPED ((TBXMLStreamEvent)-1)
+
+// 1 when [aStart, aEnd) starts with aLiteral, 0 when it doesn't, -1 when it is too short to tell yet
+static inline int startsWith(const char* aStart, const char* aEnd, const char* aLiteral, size_t aLength) {
+	size_t available = (size_t)(aEnd - aStart);
+	if (available >= aLength) return memcmp(aStart, aLiteral, aLength) == 0 ? 1 : 0;
+	return memcmp(aStart, aLiteral, available) == 0 ? -1 : 0;
+}
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLStreamParser::TBXMLStreamParser() {
+	file = NULL;
+
+	buffer = NULL;
+	bufferCapacity = 0;
+
+	chunkSize = TBXML_STREAM_CHUNK_SIZE;
+	maxTokenSize = TBXML_STREAM_MAX_TOKEN_SIZE;
+
+	eventAttributes = NULL;
+	eventAttributesLength = 0;
+	eventAttributesCapacity = 0;
+
+	this->reset();
+}
+
+TBXMLStreamParser::~TBXMLStreamParser() {
+	if (file) fclose(file);
+	free(buffer);
+	free(eventAttributes);
+}
+
+bool TBXMLStreamParser::initWithXMLFile(std::string &aXMLFile, std::string &error) {
+	this->reset();
+
+	file = fopen(aXMLFile.c_str(), "rb");
+	if (!file) {
+		errorValue = D_TBXML_FILE_NOT_FOUND_IN_BUNDLE;
+		error.clear();
+		error.append(this->error());
+		return false;
+	}
+	return true;
+}
+
+void TBXMLStreamParser::reset() {
+	if (file) fclose(file);
+	file = NULL;
+
+	// the buffer is kept for the next document
+	start = 0;
+	length = 0;
+	consumed = 0;
+	resume = 0;
+	tagQuote = 0;
+	finished = false;
+
+	event = D_TBXML_STREAM_END_DOCUMENT;
+	eventName = std::string_view();
+	eventText = std::string_view();
+	emptyElement = false;
+	pendingEnd = false;
+	openElements = 0;
+	eventAttributesLength = 0;
+
+	errorValue = D_TBXML_SUCCESS;
+}
+
+bool TBXMLStreamParser::feed(const char* aData, size_t aLength) {
+	if (finished || errorValue != D_TBXML_SUCCESS) return false;
+	if (!aLength) return true;
+	if (!this->reserve(aLength)) {
+		this->fail(D_TBXML_MEMORY_ALLOC_FAILURE);
+		return false;
+	}
+	memcpy(buffer + length, aData, aLength);
+	length += aLength;
+	return true;
+}
+
+void TBXMLStreamParser::finish() {
+	finished = true;
+}
+
+void TBXMLStreamParser::setChunkSize(size_t aChunkSize) {
+	if (aChunkSize) chunkSize = aChunkSize;
+}
+
+void TBXMLStreamParser::setMaxTokenSize(size_t aMaxTokenSize) {
+	if (aMaxTokenSize) maxTokenSize = aMaxTokenSize;
+}
+
+TBXMLStreamEvent TBXMLStreamParser::next() {
+	if (errorValue != D_TBXML_SUCCESS) return event = D_TBXML_STREAM_ERROR;
+
+	eventAttributesLength = 0;
+	eventText = std::string_view();
+
+	// a self closing tag stays in the buffer until its end event was returned, so its name is still there
+	if (pendingEnd) {
+		pendingEnd = false;
+		eventName = std::string_view(buffer + start + pendingNameOffset, pendingNameLength);
+		emptyElement = true;
+		openElements--;
+		this->consume(buffer + start + pendingTagLength);
+		return event = D_TBXML_STREAM_END_ELEMENT;
+	}
+
+	emptyElement = false;
+
+	while (true) {
+		TBXMLStreamEvent scanned = this->scanToken();
+		if (scanned != D_TBXML_STREAM_NEED_DATA) return event = scanned;
+
+		// the unconsumed input is one token that doesn't end yet
+		if (length - start > maxTokenSize) return this->fail(D_TBXML_TOKEN_TOO_LARGE);
+
+		if (finished) {
+			if (start == length) return event = D_TBXML_STREAM_END_DOCUMENT;
+			return this->fail(D_TBXML_DECODE_FAILURE);
+		}
+
+		if (!file) return event = D_TBXML_STREAM_NEED_DATA;
+		if (!this->readChunk()) return event;
+	}
+}
+
+bool TBXMLStreamParser::parse(TBXMLStreamHandler &aHandler, std::string &error) {
+	while (true) {
+		switch (this->next()) {
+			case D_TBXML_STREAM_START_ELEMENT:
+				aHandler.startElement(eventName, eventAttributes, eventAttributesLength);
+				break;
+			case D_TBXML_STREAM_END_ELEMENT:
+				aHandler.endElement(eventName);
+				break;
+			case D_TBXML_STREAM_TEXT:
+				aHandler.text(eventText);
+				break;
+			case D_TBXML_STREAM_ERROR:
+				error.clear();
+				error.append(this->error());
+				return false;
+			default:
+				// end of the document or of the input fed so far
+				return true;
+		}
+	}
+}
+
+std::string_view TBXMLStreamParser::name() const {
+	return eventName;
+}
+
+std::string_view TBXMLStreamParser::text() const {
+	return eventText;
+}
+
+size_t TBXMLStreamParser::attributeCount() const {
+	return eventAttributesLength;
+}
+
+const TBXMLStreamAttribute* TBXMLStreamParser::attributes() const {
+	return eventAttributes;
+}
+
+std::string_view TBXMLStreamParser::valueOfAttributeNamed(std::string_view aName) const {
+	for (size_t i=0; i < eventAttributesLength; i++) {
+		if (eventAttributes[i].name == aName) return eventAttributes[i].value;
+	}
+	return std::string_view();
+}
+
+bool TBXMLStreamParser::isEmptyElement() const {
+	return emptyElement;
+}
+
+size_t TBXMLStreamParser::depth() const {
+	return openElements;
+}
+
+size_t TBXMLStreamParser::offset() const {
+	return consumed;
+}
+
+TBXMLErrorCodes TBXMLStreamParser::errorCode() const {
+	return errorValue;
+}
+
+std::string TBXMLStreamParser::error() const {
+	if (errorValue == D_TBXML_SUCCESS) return "";
+	return TBXML::errorWithCode(errorValue);
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+TBXMLStreamEvent TBXMLStreamParser::scanToken() {
+	while (true) {
+		char * tokenStart = buffer + start;
+		char * end = buffer + length;
+		if (tokenStart == end) return D_TBXML_STREAM_NEED_DATA;
+
+		TBXMLStreamEvent scanned;
+		if (*tokenStart != '<') {
+			scanned = this->scanText(tokenStart, end);
+		} else {
+			// a cdata section starts a text run, anything else starting with '<' is markup
+			int isCDATA = startsWith(tokenStart, end, "<![CDATA[", 9);
+			if (isCDATA < 0 && !finished) return D_TBXML_STREAM_NEED_DATA;
+			scanned = isCDATA == 1 ? this->scanText(tokenStart, end) : this->scanTag(tokenStart, end);
+		}
+
+		if (scanned != TBXML_STREAM_SKIPPED) return scanned;
+	}
+}
+
+TBXMLStreamEvent TBXMLStreamParser::scanText(char* aStart, char* aEnd) {
+	// find the '<' ending the run, stepping over cdata sections and comments within it
+	char * from = buffer + (resume > start ? resume : start);
+	char * runEnd;
+	while (true) {
+		runEnd = TBXMLScanner::findChar(from, aEnd, '<');
+		if (!runEnd) {
+			if (!finished) {
+				resume = length;
+				return D_TBXML_STREAM_NEED_DATA;
+			}
+			runEnd = aEnd;
+			break;
+		}
+
+		int isCDATA = startsWith(runEnd, aEnd, "<![CDATA[", 9);
+		int isComment = startsWith(runEnd, aEnd, "<!--", 4);
+		if (isCDATA == 1 || isComment == 1) {
+			const char * close = isCDATA == 1 ? "]]>" : "-->";
+			char * sectionEnd = TBXMLScanner::findString(runEnd + (isCDATA == 1 ? 9 : 4), aEnd, close);
+			if (!sectionEnd) {
+				resume = runEnd - buffer;
+				return D_TBXML_STREAM_NEED_DATA;
+			}
+			from = sectionEnd + 3;
+			continue;
+		}
+		if ((isCDATA < 0 || isComment < 0) && !finished) {
+			resume = runEnd - buffer;
+			return D_TBXML_STREAM_NEED_DATA;
+		}
+		break;
+	}
+
+	// unwrap cdata sections and drop comments in place, the run only gets shorter
+	char * write = aStart;
+	char * read = aStart;
+	while (read < runEnd) {
+		char * markup = TBXMLScanner::findChar(read, runEnd, '<');
+		if (!markup) markup = runEnd;
+		memmove(write, read, markup - read);
+		write += markup - read;
+		read = markup;
+		if (read == runEnd) break;
+
+		if (startsWith(read, runEnd, "<![CDATA[", 9) == 1) {
+			char * sectionEnd = TBXMLScanner::findString(read + 9, runEnd, "]]>");
+			memmove(write, read + 9, sectionEnd - (read + 9));
+			write += sectionEnd - (read + 9);
+			read = sectionEnd + 3;
+		} else {
+			read = TBXMLScanner::findString(read + 4, runEnd, "-->") + 3;
+		}
+	}
+
+	this->consume(runEnd);
+
+	// trim whitespace like decodeBytes, runs of whitespace alone are not reported
+	char * textStart = TBXMLScanner::skipWhitespace(aStart, write);
+	if (!textStart) return TBXML_STREAM_SKIPPED;
+	while (write > textStart && TBXMLScanner::isWhitespace(write[-1])) write--;
+
+	eventText = std::string_view(textStart, write - textStart);
+	return D_TBXML_STREAM_TEXT;
+}
+
+TBXMLStreamEvent TBXMLStreamParser::scanTag(char* aStart, char* aEnd) {
+	char * from = buffer + (resume > start ? resume : start);
+
+	// comments
+	int isComment = startsWith(aStart, aEnd, "<!--", 4);
+	if (isComment < 0) return D_TBXML_STREAM_NEED_DATA;
+	if (isComment == 1) {
+		if (from < aStart + 4) from = aStart + 4;
+		char * commentEnd = TBXMLScanner::findString(from, aEnd, "-->");
+		if (!commentEnd) {
+			// the terminator may be split, look at its first two characters again
+			resume = (aEnd - 2 > from ? aEnd - 2 : from) - buffer;
+			return D_TBXML_STREAM_NEED_DATA;
+		}
+		this->consume(commentEnd + 3);
+		return TBXML_STREAM_SKIPPED;
+	}
+
+	if (aStart + 1 >= aEnd) return D_TBXML_STREAM_NEED_DATA;
+
+	// processing instructions and declarations, a doctype may hold an internal subset in brackets
+	if (aStart[1] == '?' || aStart[1] == '!') {
+		char * chr = aStart + 2;
+		while ((chr = TBXMLScanner::findFirstOf(chr, aEnd, "[>")) && *chr == '[') {
+			chr = TBXMLScanner::findChar(chr, aEnd, ']');
+			if (!chr) break;
+		}
+		if (!chr) return D_TBXML_STREAM_NEED_DATA;
+		this->consume(chr + 1);
+		return TBXML_STREAM_SKIPPED;
+	}
+
+	// end tags
+	if (aStart[1] == '/') {
+		char * tagEnd = TBXMLScanner::findChar(from > aStart ? from : aStart, aEnd, '>');
+		if (!tagEnd) {
+			resume = length;
+			return D_TBXML_STREAM_NEED_DATA;
+		}
+
+		char * nameStart = TBXMLScanner::skipWhitespace(aStart + 2, tagEnd);
+		if (!nameStart) nameStart = tagEnd;
+		char * nameEnd = tagEnd;
+		while (nameEnd > nameStart && TBXMLScanner::isWhitespace(nameEnd[-1])) nameEnd--;
+
+		eventName = std::string_view(nameStart, nameEnd - nameStart);
+		if (openElements) openElements--;
+		this->consume(tagEnd + 1);
+		return D_TBXML_STREAM_END_ELEMENT;
+	}
+
+	// start tags end at the first '>' outside a quoted value; a value may hold cdata sections
+	char * chr = from > aStart ? from : aStart + 1;
+	char quote = tagQuote;
+	while (true) {
+		if (!quote) {
+			chr = TBXMLScanner::findFirstOf(chr, aEnd, "\"'>");
+			if (!chr) break;
+			if (*chr == '>') break;
+			quote = *chr++;
+			continue;
+		}
+
+		char set[3] = { quote, '<', 0 };
+		chr = TBXMLScanner::findFirstOf(chr, aEnd, set);
+		if (!chr) break;
+		if (*chr == quote) {
+			quote = 0;
+			chr++;
+			continue;
+		}
+
+		int isCDATA = startsWith(chr, aEnd, "<![CDATA[", 9);
+		if (isCDATA < 0) break;
+		if (isCDATA == 0) {
+			chr++;
+			continue;
+		}
+		char * sectionEnd = TBXMLScanner::findString(chr + 9, aEnd, "]]>");
+		if (!sectionEnd) break;
+		chr = sectionEnd + 3;
+	}
+
+	if (!chr || *chr != '>') {
+		// carry on from the unfinished part once more input arrived
+		resume = (chr ? chr : aEnd) - buffer;
+		tagQuote = quote;
+		return D_TBXML_STREAM_NEED_DATA;
+	}
+	tagQuote = 0;
+
+	char * tagEnd = chr;
+	emptyElement = tagEnd[-1] == '/' && tagEnd - 1 > aStart;
+	char * attributesEnd = emptyElement ? tagEnd - 1 : tagEnd;
+
+	// element name
+	char * nameStart = aStart + 1;
+	char * nameEnd = nameStart;
+	while (nameEnd < attributesEnd && !TBXMLScanner::isWhitespace(*nameEnd)) nameEnd++;
+	eventName = std::string_view(nameStart, nameEnd - nameStart);
+
+	// attributes, name = "value" or name = 'value'; anything malformed ends the list
+	chr = nameEnd;
+	while ((chr = TBXMLScanner::skipWhitespace(chr, attributesEnd))) {
+		char * attributeName = chr;
+		while (chr < attributesEnd && *chr != '=' && !TBXMLScanner::isWhitespace(*chr)) chr++;
+		char * attributeNameEnd = chr;
+
+		chr = TBXMLScanner::skipWhitespace(chr, attributesEnd);
+		if (!chr || *chr != '=') break;
+		chr = TBXMLScanner::skipWhitespace(chr + 1, attributesEnd);
+		if (!chr || (*chr != '"' && *chr != '\'')) break;
+
+		// unwrap cdata sections in the value in place
+		char set[3] = { *chr, '<', 0 };
+		char * value = ++chr;
+		char * write = value;
+		while (true) {
+			char * markup = TBXMLScanner::findFirstOf(chr, attributesEnd, set);
+			if (!markup) markup = attributesEnd;
+			memmove(write, chr, markup - chr);
+			write += markup - chr;
+			chr = markup;
+			if (chr == attributesEnd) break;
+			if (*chr == set[0]) {
+				chr++;
+				break;
+			}
+			if (startsWith(chr, attributesEnd, "<![CDATA[", 9) == 1) {
+				char * sectionEnd = TBXMLScanner::findString(chr + 9, attributesEnd, "]]>");
+				memmove(write, chr + 9, sectionEnd - (chr + 9));
+				write += sectionEnd - (chr + 9);
+				chr = sectionEnd + 3;
+			} else {
+				*write++ = *chr++;
+			}
+		}
+
+		if (!this->addAttribute(std::string_view(attributeName, attributeNameEnd - attributeName), std::string_view(value, write - value)))
+			return this->fail(D_TBXML_MEMORY_ALLOC_FAILURE);
+	}
+
+	openElements++;
+
+	if (emptyElement) {
+		// consumed with the end event that follows
+		pendingEnd = true;
+		pendingNameOffset = nameStart - aStart;
+		pendingNameLength = nameEnd - nameStart;
+		pendingTagLength = tagEnd + 1 - aStart;
+		resume = start;
+	} else {
+		this->consume(tagEnd + 1);
+	}
+	return D_TBXML_STREAM_START_ELEMENT;
+}
+
+bool TBXMLStreamParser::readChunk() {
+	if (!this->reserve(chunkSize)) {
+		this->fail(D_TBXML_MEMORY_ALLOC_FAILURE);
+		return false;
+	}
+
+	size_t read = fread(buffer + length, 1, chunkSize, file);
+	length += read;
+
+	if (read == 0) {
+		if (ferror(file)) {
+			this->fail(D_TBXML_DECODE_FAILURE);
+			return false;
+		}
+		finished = true;
+	}
+	return true;
+}
+
+bool TBXMLStreamParser::reserve(size_t aLength) {
+	// move the unconsumed input to the front, then grow the buffer if that isn't enough
+	if (start) {
+		memmove(buffer, buffer + start, length - start);
+		length -= start;
+		resume = resume > start ? resume - start : 0;
+		start = 0;
+	}
+
+	if (length + aLength <= bufferCapacity) return true;
+
+	size_t capacity = bufferCapacity ? bufferCapacity : chunkSize;
+	while (capacity < length + aLength) capacity *= 2;
+
+	char * grown = (char*)realloc(buffer, capacity);
+	if (!grown) return false;
+	buffer = grown;
+	bufferCapacity = capacity;
+	return true;
+}
+
+bool TBXMLStreamParser::addAttribute(std::string_view aName, std::string_view aValue) {
+	if (eventAttributesLength == eventAttributesCapacity) {
+		size_t capacity = eventAttributesCapacity ? eventAttributesCapacity*2 : 16;
+		TBXMLStreamAttribute * grown = (TBXMLStreamAttribute*)realloc((void*)eventAttributes, sizeof(TBXMLStreamAttribute)*capacity);
+		if (!grown) return false;
+		eventAttributes = grown;
+		eventAttributesCapacity = capacity;
+	}
+
+	eventAttributes[eventAttributesLength].name = aName;
+	eventAttributes[eventAttributesLength].value = aValue;
+	eventAttributesLength++;
+	return true;
+}
+
+void TBXMLStreamParser::consume(char* aEnd) {
+	size_t offset = aEnd - buffer;
+	consumed += offset - start;
+	start = offset;
+	resume = offset;
+}
+
+TBXMLStreamEvent TBXMLStreamParser::fail(TBXMLErrorCodes aCode) {
+	errorValue = aCode;
+	return event = D_TBXML_STREAM_ERROR;
+}
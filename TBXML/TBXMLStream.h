@@ -0,0 +1,188 @@
+// ================================================================================================
+//  TBXMLStream.h
+//  Streaming pull and SAX style parsing with bounded memory
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_STREAM_H_
+#define _TBXML_STREAM_H_
+
+#include "TBXML.h"
+#include <stdio.h>
+
+// ================================================================================================
+//  Stream Events
+// ================================================================================================
+enum TBXMLStreamEvent {
+	D_TBXML_STREAM_END_DOCUMENT = 0,	// all input was consumed
+	D_TBXML_STREAM_START_ELEMENT,		// name() and the attributes of a start tag
+	D_TBXML_STREAM_END_ELEMENT,			// name() of an end tag, also sent after a self closing start tag
+	D_TBXML_STREAM_TEXT,				// text() between two tags
+	D_TBXML_STREAM_NEED_DATA,			// fed input ends within a token, feed more or finish()
+	D_TBXML_STREAM_ERROR				// see errorCode()/error(), the parser stops
+};
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// bytes read from a file at a time
+#define TBXML_STREAM_CHUNK_SIZE (64*1024)
+
+// largest token (tag, text run including its CDATA sections, comment) held in memory
+#define TBXML_STREAM_MAX_TOKEN_SIZE (16*1024*1024)
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+/** The TBXMLStreamAttribute structure holds the name and value of an attribute of the current start tag.
+ */
+typedef struct _TBXMLStreamAttribute {
+	std::string_view name;
+	std::string_view value;
+} TBXMLStreamAttribute;
+
+/** TBXMLStreamHandler receives the events of TBXMLStreamParser::parse. The views are valid until the
+    callback returns.
+ */
+class TBXMLStreamHandler {
+public:
+	virtual ~TBXMLStreamHandler() {}
+
+	virtual void startElement(std::string_view /*aName*/, const TBXMLStreamAttribute* /*aAttributes*/, size_t /*aAttributeCount*/) {}
+	virtual void endElement(std::string_view /*aName*/) {}
+	virtual void text(std::string_view /*aText*/) {}
+};
+
+/** TBXMLStreamParser reads a document token by token without building a tree, holding only the
+    unconsumed input: one chunk plus the token being parsed, at most TBXML_STREAM_MAX_TOKEN_SIZE (see
+    setMaxTokenSize). It uses the TBXMLScanner functions decodeBytes uses, so tags, comments, CDATA
+    sections and text split across chunks are found the same way.
+
+    Input is pulled from a file (initWithXMLFile) or pushed with feed()/finish(). next() returns one
+    event at a time, parse() passes all events to a TBXMLStreamHandler.
+
+    Text is reported like TBXML stores it: CDATA sections are unwrapped, comments removed, leading and
+    trailing whitespace trimmed and whitespace only runs skipped. Comments, processing instructions and
+    declarations produce no events. Views returned by the accessors are valid until the next call to
+    next() or feed().
+ */
+class TBXMLStreamParser {
+public:
+	TBXMLStreamParser();
+	~TBXMLStreamParser();
+
+	TBXMLStreamParser(const TBXMLStreamParser &) = delete;
+	TBXMLStreamParser& operator=(const TBXMLStreamParser &) = delete;
+
+	/** Starts reading aXMLFile, the parser can be reused for another file or for fed input afterwards.
+	 */
+	bool initWithXMLFile(std::string &aXMLFile, std::string &error);
+
+	/** Starts a document whose input is passed to feed() as it arrives. Called by the constructor.
+	 */
+	void reset();
+
+	/** Appends input to a document started with reset(). Returns false when out of memory, after
+	    finish() or after an error.
+	 */
+	bool feed(const char* aData, size_t aLength);
+
+	/** Marks the end of fed input, the events left are returned by next().
+	 */
+	void finish();
+
+	void setChunkSize(size_t aChunkSize);
+	void setMaxTokenSize(size_t aMaxTokenSize);
+
+	TBXMLStreamEvent next();
+
+	/** Calls aHandler for every event up to the end of the document, returns false on error.
+	 */
+	bool parse(TBXMLStreamHandler &aHandler, std::string &error);
+
+	std::string_view name() const;
+	std::string_view text() const;
+	size_t attributeCount() const;
+	const TBXMLStreamAttribute* attributes() const;
+	std::string_view valueOfAttributeNamed(std::string_view aName) const;
+
+	/** True for the start and end events of a self closing element.
+	 */
+	bool isEmptyElement() const;
+
+	/** Number of open elements, including the one just started.
+	 */
+	size_t depth() const;
+
+	/** Bytes of input consumed so far.
+	 */
+	size_t offset() const;
+
+	TBXMLErrorCodes errorCode() const;
+	std::string error() const;
+
+private:
+	FILE * file;
+
+	char * buffer;
+	size_t bufferCapacity;
+	size_t start;
+	size_t length;
+	size_t consumed;
+
+	// where the search for the end of the current token resumes once more input arrived, and the quote
+	// a start tag was left in
+	size_t resume;
+	char tagQuote;
+
+	size_t chunkSize;
+	size_t maxTokenSize;
+	bool finished;
+
+	TBXMLStreamEvent event;
+	std::string_view eventName;
+	std::string_view eventText;
+	bool emptyElement;
+	bool pendingEnd;
+	size_t pendingNameOffset;
+	size_t pendingNameLength;
+	size_t pendingTagLength;
+	size_t openElements;
+
+	TBXMLStreamAttribute * eventAttributes;
+	size_t eventAttributesLength;
+	size_t eventAttributesCapacity;
+
+	TBXMLErrorCodes errorValue;
+
+	TBXMLStreamEvent scanToken();
+	TBXMLStreamEvent scanText(char* aStart, char* aEnd);
+	TBXMLStreamEvent scanTag(char* aStart, char* aEnd);
+	bool readChunk();
+	bool reserve(size_t aLength);
+	bool addAttribute(std::string_view aName, std::string_view aValue);
+	void consume(char* aEnd);
+	TBXMLStreamEvent fail(TBXMLErrorCodes aCode);
+};
+
+#endif	//_TBXML_STREAM_H_
@@ -0,0 +1,203 @@
+// ================================================================================================
+//  TBXMLSymbolTable.cpp
+//  Interned element and attribute names for TBXML
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLSymbolTable.h"
+#include <stdlib.h>
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLSymbolTable::TBXMLSymbolTable() {
+	slots = NULL;
+	slotsCapacity = 0;
+
+	symbols = NULL;
+	symbolsLength = 0;
+	symbolsCapacity = 0;
+
+	names = NULL;
+	namesLength = 0;
+	namesCapacity = 0;
+
+	frozen = false;
+}
+
+TBXMLSymbolTable::~TBXMLSymbolTable() {
+	free(slots);
+	free(symbols);
+	free(names);
+}
+
+uint32_t TBXMLSymbolTable::intern(const char* aName, size_t aLength) {
+	uint64_t nameHash = TBXMLSymbolTable::hash(aName, aLength);
+	size_t slot = 0;
+
+	uint32_t id = this->find(aName, aLength, nameHash, &slot);
+	if (id != TBXML_NAME_NONE || frozen) return id;
+
+	// keep the table at most three quarters full so probe sequences stay short
+	if ((symbolsLength+1)*4 > slotsCapacity*3) {
+		if (!this->grow()) return TBXML_NAME_NONE;
+		this->find(aName, aLength, nameHash, &slot);
+	}
+
+	// copy the name, null terminated so nameForId views can be passed on as C strings
+	if (namesLength + aLength + 1 > namesCapacity) {
+		size_t capacity = namesCapacity ? namesCapacity*2 : 1024;
+		while (capacity < namesLength + aLength + 1) capacity *= 2;
+		char * grown = (char*)realloc(names, capacity);
+		if (!grown) return TBXML_NAME_NONE;
+		names = grown;
+		namesCapacity = capacity;
+	}
+
+	if (symbolsLength == symbolsCapacity) {
+		size_t capacity = symbolsCapacity ? symbolsCapacity*2 : TBXML_SYMBOL_TABLE_MIN_SLOTS;
+		TBXMLSymbol * grown = (TBXMLSymbol*)realloc(symbols, sizeof(TBXMLSymbol)*capacity);
+		if (!grown) return TBXML_NAME_NONE;
+		symbols = grown;
+		symbolsCapacity = capacity;
+	}
+
+	if (aLength) memcpy(names + namesLength, aName, aLength);
+	names[namesLength + aLength] = 0;
+
+	symbols[symbolsLength].offset = namesLength;
+	symbols[symbolsLength].length = aLength;
+	namesLength += aLength + 1;
+
+	// ids start at 1, TBXML_NAME_NONE is never handed out
+	id = (uint32_t)++symbolsLength;
+	slots[slot].hash = (uint32_t)(nameHash >> 32);
+	slots[slot].id = id;
+	return id;
+}
+
+uint32_t TBXMLSymbolTable::lookup(std::string_view aName) const {
+	size_t slot;
+	return this->find(aName.data(), aName.length(), TBXMLSymbolTable::hash(aName.data(), aName.length()), &slot);
+}
+
+TBXMLName TBXMLSymbolTable::name(std::string_view aName) const {
+	TBXMLName rev;
+	rev.id = this->lookup(aName);
+	rev.name = aName.data();
+	rev.length = aName.length();
+	return rev;
+}
+
+std::string_view TBXMLSymbolTable::nameForId(uint32_t aNameId) const {
+	if (aNameId == TBXML_NAME_NONE || aNameId > symbolsLength) return std::string_view();
+	TBXMLSymbol * symbol = &symbols[aNameId-1];
+	return std::string_view(names + symbol->offset, symbol->length);
+}
+
+size_t TBXMLSymbolTable::count() const {
+	return symbolsLength;
+}
+
+void TBXMLSymbolTable::freeze() {
+	frozen = true;
+}
+
+bool TBXMLSymbolTable::isFrozen() const {
+	return frozen;
+}
+
+void TBXMLSymbolTable::clear() {
+	if (slots) memset(slots, 0, sizeof(TBXMLSymbolSlot)*slotsCapacity);
+	symbolsLength = 0;
+	namesLength = 0;
+	frozen = false;
+}
+
+uint64_t TBXMLSymbolTable::hash(const char* aName, size_t aLength) {
+	// mix a word at a time, names are short so there is no need for anything stronger
+	uint64_t rev = 0x9E3779B97F4A7C15ull ^ aLength;
+	uint64_t word;
+
+	while (aLength >= 8) {
+		memcpy(&word, aName, 8);
+		rev = (rev ^ word) * 0xFF51AFD7ED558CCDull;
+		rev ^= rev >> 32;
+		aName += 8;
+		aLength -= 8;
+	}
+
+	word = 0;
+	if (aLength) memcpy(&word, aName, aLength);
+	rev = (rev ^ word) * 0xC4CEB9FE1A85EC53ull;
+
+	// a multiply only carries low bits upwards, fold the high bits back so the slot index (low bits)
+	// depends on every byte of the name
+	rev ^= rev >> 33;
+	rev *= 0xFF51AFD7ED558CCDull;
+	rev ^= rev >> 33;
+	return rev;
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+uint32_t TBXMLSymbolTable::find(const char* aName, size_t aLength, uint64_t aHash, size_t* aSlot) const {
+	if (!slotsCapacity) return TBXML_NAME_NONE;
+
+	// linear probing on the low bits, the high 32 bits kept in the slot skip most compares of colliding names
+	size_t mask = slotsCapacity-1;
+	size_t slot = (size_t)aHash & mask;
+	while (slots[slot].id != TBXML_NAME_NONE) {
+		if (slots[slot].hash == (uint32_t)(aHash >> 32)) {
+			TBXMLSymbol * symbol = &symbols[slots[slot].id-1];
+			if (symbol->length == aLength && memcmp(names + symbol->offset, aName, aLength) == 0) {
+				*aSlot = slot;
+				return slots[slot].id;
+			}
+		}
+		slot = (slot+1) & mask;
+	}
+
+	*aSlot = slot;
+	return TBXML_NAME_NONE;
+}
+
+bool TBXMLSymbolTable::grow() {
+	size_t capacity = slotsCapacity ? slotsCapacity*2 : TBXML_SYMBOL_TABLE_MIN_SLOTS;
+	TBXMLSymbolSlot * grown = (TBXMLSymbolSlot*)calloc(capacity, sizeof(TBXMLSymbolSlot));
+	if (!grown) return false;
+
+	// rehash every symbol into the new slots
+	for (size_t i=0; i < symbolsLength; i++) {
+		uint64_t symbolHash = TBXMLSymbolTable::hash(names + symbols[i].offset, symbols[i].length);
+		size_t slot = (size_t)symbolHash & (capacity-1);
+		while (grown[slot].id != TBXML_NAME_NONE) slot = (slot+1) & (capacity-1);
+		grown[slot].hash = (uint32_t)(symbolHash >> 32);
+		grown[slot].id = (uint32_t)(i+1);
+	}
+
+	free(slots);
+	slots = grown;
+	slotsCapacity = capacity;
+	return true;
+}
@@ -0,0 +1,143 @@
+// ================================================================================================
+//  TBXMLSymbolTable.h
+//  Interned element and attribute names for TBXML
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_SYMBOL_TABLE_H_
+#define _TBXML_SYMBOL_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// name id of a name that was not interned, the value elements and attributes get without a symbol table
+#define TBXML_NAME_NONE 0
+
+// smallest number of slots in the hash table, always a power of two
+#define TBXML_SYMBOL_TABLE_MIN_SLOTS 64
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+/** The TBXMLName structure is a name resolved against a TBXMLSymbolTable once, so lookups against
+    elements and attributes interned by the same table compare integers. A name the table doesn't know
+    has id TBXML_NAME_NONE and is compared byte by byte, which keeps lookups correct for names added
+    after it was resolved and for documents parsed without interning.
+ */
+typedef struct _TBXMLName {
+	uint32_t id;
+	const char * name;
+	size_t length;
+
+	/** Returns true if the name matches an element or attribute name with the given id and bytes.
+	 */
+	inline bool matches(uint32_t aNameId, const char* aName, size_t aLength) const {
+		if (id != TBXML_NAME_NONE && aNameId != TBXML_NAME_NONE) return id == aNameId;
+		return length == aLength && memcmp(name, aName, aLength) == 0;
+	}
+} TBXMLName;
+
+/** TBXMLSymbolTable assigns a small integer id to every distinct element and attribute name. Pass it to
+    TBXML::setSymbolTable before parsing and decodeBytes stores the id of each name in nameId; the table
+    keeps its names between parses, so one table can serve many documents and ids stay the same.
+
+    The table copies the names it interns and is an open addressing hash keyed by a word at a time
+    hash. Interning is not thread safe. A table that is filled (by parsing a first document or with
+    intern) and then frozen is never written to again and can be shared by documents parsed on other
+    threads; names it doesn't know get TBXML_NAME_NONE.
+ */
+class TBXMLSymbolTable {
+public:
+	TBXMLSymbolTable();
+	~TBXMLSymbolTable();
+
+	TBXMLSymbolTable(const TBXMLSymbolTable &) = delete;
+	TBXMLSymbolTable& operator=(const TBXMLSymbolTable &) = delete;
+
+	/** Returns the id of aName, adding it unless the table is frozen (then TBXML_NAME_NONE is returned
+	    for an unknown name).
+	 */
+	uint32_t intern(const char* aName, size_t aLength);
+	inline uint32_t intern(std::string_view aName) { return this->intern(aName.data(), aName.length()); }
+
+	/** Returns the id of aName or TBXML_NAME_NONE, never adds it.
+	 */
+	uint32_t lookup(std::string_view aName) const;
+
+	/** Resolves aName into a token for the TBXML lookups. The token refers to the bytes of aName.
+	 */
+	TBXMLName name(std::string_view aName) const;
+
+	/** Returns the interned name with id aNameId, an empty view for TBXML_NAME_NONE or an unknown id.
+	 */
+	std::string_view nameForId(uint32_t aNameId) const;
+
+	/** Number of names interned, ids run from 1 to count().
+	 */
+	size_t count() const;
+
+	/** Stops adding names, making the table safe to share between threads.
+	 */
+	void freeze();
+	bool isFrozen() const;
+
+	/** Forgets all names and unfreezes the table, keeping its memory.
+	 */
+	void clear();
+
+	static uint64_t hash(const char* aName, size_t aLength);
+
+private:
+	typedef struct _TBXMLSymbolSlot {
+		uint32_t hash;
+		uint32_t id;
+	} TBXMLSymbolSlot;
+
+	typedef struct _TBXMLSymbol {
+		size_t offset;
+		size_t length;
+	} TBXMLSymbol;
+
+	TBXMLSymbolSlot * slots;
+	size_t slotsCapacity;
+
+	TBXMLSymbol * symbols;
+	size_t symbolsLength;
+	size_t symbolsCapacity;
+
+	char * names;
+	size_t namesLength;
+	size_t namesCapacity;
+
+	bool frozen;
+
+	uint32_t find(const char* aName, size_t aLength, uint64_t aHash, size_t* aSlot) const;
+	bool grow();
+};
+
+#endif	//_TBXML_SYMBOL_TABLE_H_
@@ -0,0 +1,385 @@
+// ================================================================================================
+//  TBXMLWriter.cpp
+//  Serializing element trees and generated documents
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLWriter.h"
+#include "TBXMLScanner.h"
+#include <stdlib.h>
+#include <string.h>
+
+// the characters replaced by references, text and values of parsed trees that weren't decoded keep '&'
+#define TBXML_WRITER_ESCAPE_TEXT "&<>"
+#define TBXML_WRITER_ESCAPE_VALUE "&<>\""
+#define TBXML_WRITER_ESCAPE_RAW_TEXT "<>"
+#define TBXML_WRITER_ESCAPE_RAW_VALUE "<>\""
+
+typedef struct _TBXMLWriterElement {
+	size_t nameOffset;
+	size_t nameLength;
+	bool content;		// has text or children, ends with an end tag
+	bool children;		// has children, the end tag goes on a line of its own in pretty format
+} TBXMLWriterElement;
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+TBXMLWriter::TBXMLWriter() {
+	file = NULL;
+	string = NULL;
+	sink = NULL;
+
+	buffer = NULL;
+	bufferCapacity = 0;
+	bufferSize = TBXML_WRITER_BUFFER_SIZE;
+
+	format = D_TBXML_WRITE_COMPACT;
+	indent = "  ";
+
+	openElements = NULL;
+	openElementsCapacity = 0;
+	names = NULL;
+	namesCapacity = 0;
+
+	this->reset();
+}
+
+TBXMLWriter::~TBXMLWriter() {
+	// output written but not flushed still goes out, a file is closed with or without finish()
+	this->flush();
+	if (file) fclose(file);
+	free(buffer);
+	free(openElements);
+	free(names);
+}
+
+bool TBXMLWriter::initWithFile(std::string &aFile, std::string &error) {
+	this->reset();
+
+	file = fopen(aFile.c_str(), "wb");
+	if (!file) {
+		errorValue = D_TBXML_WRITE_FAILURE;
+		error.clear();
+		error.append(this->error());
+		return false;
+	}
+	return true;
+}
+
+void TBXMLWriter::initWithString(std::string *aString) {
+	this->reset();
+	string = aString;
+}
+
+void TBXMLWriter::initWithSink(TBXMLWriterSink *aSink) {
+	this->reset();
+	sink = aSink;
+}
+
+void TBXMLWriter::reset() {
+	if (file) fclose(file);
+	file = NULL;
+	string = NULL;
+	sink = NULL;
+
+	// the buffer is kept for the next document unless its size changed
+	if (buffer && bufferCapacity != bufferSize) {
+		free(buffer);
+		buffer = NULL;
+		bufferCapacity = 0;
+	}
+	bufferLength = 0;
+	written = 0;
+
+	openElementsLength = 0;
+	namesLength = 0;
+	startTagOpen = false;
+
+	errorValue = D_TBXML_SUCCESS;
+}
+
+void TBXMLWriter::setFormat(TBXMLWriterFormat aFormat) {
+	format = aFormat;
+}
+
+void TBXMLWriter::setIndent(std::string_view aIndent) {
+	indent = aIndent;
+}
+
+void TBXMLWriter::setBufferSize(size_t aBufferSize) {
+	if (aBufferSize) bufferSize = aBufferSize;
+}
+
+bool TBXMLWriter::declaration() {
+	static const char xmlDeclaration[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+	return this->closeStartTag() && this->write(xmlDeclaration, sizeof(xmlDeclaration)-1);
+}
+
+bool TBXMLWriter::startElement(std::string_view aName) {
+	if (!this->closeStartTag()) return false;
+
+	if (openElementsLength) {
+		openElements[openElementsLength-1].content = true;
+		openElements[openElementsLength-1].children = true;
+	}
+
+	// start tags go on a line of their own, except the first thing written
+	if (format == D_TBXML_WRITE_PRETTY && this->bytesWritten()) {
+		if (!this->write("\n", 1) || !this->writeIndent(openElementsLength)) return false;
+	}
+	if (!this->write("<", 1) || !this->write(aName.data(), aName.length())) return false;
+
+	// the name is kept for the end tag, the stack grows like the buffers of TBXML
+	if (openElementsLength == openElementsCapacity) {
+		size_t capacity = openElementsCapacity ? openElementsCapacity*2 : 16;
+		TBXMLWriterElement * grown = (TBXMLWriterElement*)realloc(openElements, sizeof(TBXMLWriterElement)*capacity);
+		if (!grown) return this->fail(D_TBXML_MEMORY_ALLOC_FAILURE);
+		openElements = grown;
+		openElementsCapacity = capacity;
+	}
+	if (namesLength + aName.length() > namesCapacity) {
+		size_t capacity = namesCapacity ? namesCapacity*2 : 256;
+		while (capacity < namesLength + aName.length()) capacity *= 2;
+		char * grown = (char*)realloc(names, capacity);
+		if (!grown) return this->fail(D_TBXML_MEMORY_ALLOC_FAILURE);
+		names = grown;
+		namesCapacity = capacity;
+	}
+
+	TBXMLWriterElement * openElement = &openElements[openElementsLength++];
+	openElement->nameOffset = namesLength;
+	openElement->nameLength = aName.length();
+	openElement->content = false;
+	openElement->children = false;
+	if (aName.length()) memcpy(names + namesLength, aName.data(), aName.length());
+	namesLength += aName.length();
+
+	startTagOpen = true;
+	return true;
+}
+
+bool TBXMLWriter::attribute(std::string_view aName, std::string_view aValue) {
+	return this->writeAttribute(aName, aValue, TBXML_WRITER_ESCAPE_VALUE);
+}
+
+bool TBXMLWriter::text(std::string_view aText) {
+	return this->writeText(aText, TBXML_WRITER_ESCAPE_TEXT);
+}
+
+bool TBXMLWriter::endElement() {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+	if (!openElementsLength) return this->fail(D_TBXML_WRITE_OUT_OF_ORDER);
+
+	TBXMLWriterElement * openElement = &openElements[openElementsLength-1];
+	if (startTagOpen) {
+		startTagOpen = false;
+		if (!this->write("/>", 2)) return false;
+	} else {
+		if (format == D_TBXML_WRITE_PRETTY && openElement->children) {
+			if (!this->write("\n", 1) || !this->writeIndent(openElementsLength-1)) return false;
+		}
+		if (!this->write("</", 2) || !this->write(names + openElement->nameOffset, openElement->nameLength) || !this->write(">", 1)) return false;
+	}
+
+	namesLength = openElement->nameOffset;
+	openElementsLength--;
+	return true;
+}
+
+bool TBXMLWriter::element(const TBXMLElement* aXMLElement) {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+	if (NULL == aXMLElement) return this->fail(D_TBXML_ELEMENT_IS_NIL);
+
+	// walk the subtree in document order without recursing, deep documents don't exhaust the stack
+	const TBXMLElement * xmlElement = aXMLElement;
+	while (true) {
+		if (!this->startElement(std::string_view(xmlElement->name, xmlElement->nameLength))) return false;
+
+		for (const TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+			const char * escape = (xmlAttribute->flags & TBXML_FLAG_DECODED) ? TBXML_WRITER_ESCAPE_VALUE : TBXML_WRITER_ESCAPE_RAW_VALUE;
+			std::string_view value = xmlAttribute->value ? std::string_view(xmlAttribute->value, xmlAttribute->valueLength) : std::string_view();
+			if (!this->writeAttribute(std::string_view(xmlAttribute->name, xmlAttribute->nameLength), value, escape)) return false;
+		}
+
+		// empty text is kept as <name></name>, missing text as <name/> when there are no children either
+		if (xmlElement->text) {
+			const char * escape = (xmlElement->flags & TBXML_FLAG_DECODED) ? TBXML_WRITER_ESCAPE_TEXT : TBXML_WRITER_ESCAPE_RAW_TEXT;
+			if (!this->writeText(std::string_view(xmlElement->text, xmlElement->textLength), escape)) return false;
+		}
+
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			continue;
+		}
+
+		// end the element and every parent it is the last child of
+		while (true) {
+			if (!this->endElement()) return false;
+			if (xmlElement == aXMLElement) return true;
+			if (xmlElement->nextSibling) {
+				xmlElement = xmlElement->nextSibling;
+				break;
+			}
+			xmlElement = xmlElement->parentElement;
+		}
+	}
+}
+
+bool TBXMLWriter::flush() {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+
+	size_t length = bufferLength;
+	bufferLength = 0;
+	if (!this->pass(buffer, length)) return false;
+
+	if (file && fflush(file) != 0) return this->fail(D_TBXML_WRITE_FAILURE);
+	return true;
+}
+
+bool TBXMLWriter::finish() {
+	while (openElementsLength && this->endElement());
+	if (format == D_TBXML_WRITE_PRETTY && this->bytesWritten()) this->write("\n", 1);
+
+	bool flushed = this->flush();
+	if (file) {
+		if (fclose(file) != 0 && flushed) flushed = this->fail(D_TBXML_WRITE_FAILURE);
+		file = NULL;
+	}
+	return flushed;
+}
+
+size_t TBXMLWriter::depth() const {
+	return openElementsLength;
+}
+
+size_t TBXMLWriter::bytesWritten() const {
+	return written + bufferLength;
+}
+
+TBXMLErrorCodes TBXMLWriter::errorCode() const {
+	return errorValue;
+}
+
+std::string TBXMLWriter::error() const {
+	if (errorValue == D_TBXML_SUCCESS) return "";
+	return TBXML::errorWithCode(errorValue);
+}
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+bool TBXMLWriter::write(const char* aData, size_t aLength) {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+	if (!aLength) return true;
+
+	if (!buffer) {
+		if (!(buffer = (char*)malloc(bufferSize))) return this->fail(D_TBXML_MEMORY_ALLOC_FAILURE);
+		bufferCapacity = bufferSize;
+	}
+
+	if (aLength > bufferCapacity - bufferLength) {
+		size_t length = bufferLength;
+		bufferLength = 0;
+		if (!this->pass(buffer, length)) return false;
+
+		// a string as large as the buffer goes out without being copied
+		if (aLength >= bufferCapacity) return this->pass(aData, aLength);
+	}
+
+	memcpy(buffer + bufferLength, aData, aLength);
+	bufferLength += aLength;
+	return true;
+}
+
+bool TBXMLWriter::writeEscaped(std::string_view aValue, const char* aSet) {
+	const char * chr = aValue.data();
+	const char * end = chr + aValue.length();
+
+	while (chr < end) {
+		const char * special = TBXMLScanner::findFirstOf(chr, end, aSet);
+		const char * runEnd = special ? special : end;
+		if (runEnd > chr && !this->write(chr, runEnd - chr)) return false;
+		if (!special) break;
+
+		switch (*special) {
+			case '&': if (!this->write("&amp;", 5)) return false; break;
+			case '<': if (!this->write("&lt;", 4)) return false; break;
+			case '>': if (!this->write("&gt;", 4)) return false; break;
+			case '"': if (!this->write("&quot;", 6)) return false; break;
+		}
+		chr = special+1;
+	}
+	return true;
+}
+
+bool TBXMLWriter::writeAttribute(std::string_view aName, std::string_view aValue, const char* aSet) {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+	if (!startTagOpen) return this->fail(D_TBXML_WRITE_OUT_OF_ORDER);
+
+	return this->write(" ", 1) && this->write(aName.data(), aName.length()) && this->write("=\"", 2) &&
+		this->writeEscaped(aValue, aSet) && this->write("\"", 1);
+}
+
+bool TBXMLWriter::writeText(std::string_view aText, const char* aSet) {
+	if (!this->closeStartTag()) return false;
+	if (!openElementsLength) return this->fail(D_TBXML_WRITE_OUT_OF_ORDER);
+
+	openElements[openElementsLength-1].content = true;
+	return this->writeEscaped(aText, aSet);
+}
+
+bool TBXMLWriter::writeIndent(size_t aDepth) {
+	for (size_t i=0; i < aDepth; i++) {
+		if (!this->write(indent.data(), indent.length())) return false;
+	}
+	return true;
+}
+
+bool TBXMLWriter::closeStartTag() {
+	if (errorValue != D_TBXML_SUCCESS) return false;
+	if (!startTagOpen) return true;
+
+	startTagOpen = false;
+	return this->write(">", 1);
+}
+
+bool TBXMLWriter::pass(const char* aData, size_t aLength) {
+	if (!aLength) return true;
+
+	bool passed = false;
+	if (file)
+		passed = fwrite(aData, 1, aLength, file) == aLength;
+	else if (string)
+		passed = (string->append(aData, aLength), true);
+	else if (sink)
+		passed = sink->write(aData, aLength);
+
+	if (!passed) return this->fail(D_TBXML_WRITE_FAILURE);
+	written += aLength;
+	return true;
+}
+
+bool TBXMLWriter::fail(TBXMLErrorCodes aCode) {
+	errorValue = aCode;
+	return false;
+}
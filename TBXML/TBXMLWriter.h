@@ -0,0 +1,182 @@
+// ================================================================================================
+//  TBXMLWriter.h
+//  Serializing element trees and generated documents
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_WRITER_H_
+#define _TBXML_WRITER_H_
+
+#include "TBXML.h"
+#include <stdio.h>
+
+// ================================================================================================
+//  Writer Formats
+// ================================================================================================
+enum TBXMLWriterFormat {
+	D_TBXML_WRITE_COMPACT = 0,		// nothing between the tags but the text of the elements
+	D_TBXML_WRITE_PRETTY			// every start tag on a line of its own, indented by its depth
+};
+
+// ================================================================================================
+//  Defines
+// ================================================================================================
+
+// bytes collected before they are passed on to the file, string or sink
+#define TBXML_WRITER_BUFFER_SIZE (64*1024)
+
+// ================================================================================================
+//  Structures
+// ================================================================================================
+
+// an element started and not yet ended
+struct _TBXMLWriterElement;
+
+/** TBXMLWriterSink receives the output of a TBXMLWriter in blocks of up to the writer's buffer size.
+ */
+class TBXMLWriterSink {
+public:
+	virtual ~TBXMLWriterSink() {}
+
+	/** Called with the next aLength bytes of the document, return false to fail the writer.
+	 */
+	virtual bool write(const char* aData, size_t aLength) = 0;
+};
+
+/** TBXMLWriter serializes TBXMLElement trees, or documents generated with startElement/attribute/text/
+    endElement, into a buffer that is passed on to a file, a std::string or a TBXMLWriterSink whenever it
+    is full. The buffer and the stack of open elements are kept by reset(), so a writer can be reused
+    without allocating.
+
+    Text and values are escaped with the vectorized TBXMLScanner::findFirstOf, strings without a
+    character to escape are copied as they are. Strings passed to text/attribute are escaped completely
+    (& < > and " in values). element() writes text and values of a parsed tree as they are stored: decoded
+    ones (TBXML_FLAG_DECODED) are escaped completely, the others still hold the references of the
+    document and keep their '&'. A tree parsed with D_TBXML_ENTITIES_EAGER is written back to a document
+    that parses into the same tree. Other trees are when their text holds no CDATA section, whose '&'
+    is kept as well, and no value holds the quote it was not quoted with, which is written as &quot;.
+ */
+class TBXMLWriter {
+public:
+	TBXMLWriter();
+	~TBXMLWriter();
+
+	TBXMLWriter(const TBXMLWriter &) = delete;
+	TBXMLWriter& operator=(const TBXMLWriter &) = delete;
+
+	/** Writes to aFile, which is created or truncated and closed by finish().
+	 */
+	bool initWithFile(std::string &aFile, std::string &error);
+
+	/** Appends to aString, which must outlive the writer or the next init.
+	 */
+	void initWithString(std::string *aString);
+
+	void initWithSink(TBXMLWriterSink *aSink);
+
+	/** Forgets the destination and the open elements, without flushing. Called by the init methods.
+	 */
+	void reset();
+
+	void setFormat(TBXMLWriterFormat aFormat);
+
+	/** Indentation of one level in D_TBXML_WRITE_PRETTY, two spaces by default.
+	 */
+	void setIndent(std::string_view aIndent);
+
+	/** Size of the buffer, used from the next init method on.
+	 */
+	void setBufferSize(size_t aBufferSize);
+
+	/** Writes the <?xml version="1.0" encoding="UTF-8"?> declaration.
+	 */
+	bool declaration();
+
+	bool startElement(std::string_view aName);
+
+	/** Adds an attribute to the element just started, before any text or child.
+	 */
+	bool attribute(std::string_view aName, std::string_view aValue);
+
+	bool text(std::string_view aText);
+
+	/** Ends the innermost open element, as <name/> when it has no content.
+	 */
+	bool endElement();
+
+	/** Writes aXMLElement with its attributes, text and children, inside the open element if any.
+	 */
+	bool element(const TBXMLElement* aXMLElement);
+
+	/** Passes the buffered output on, the file is flushed too.
+	 */
+	bool flush();
+
+	/** Ends the open elements, flushes and closes the file. Returns false if anything failed.
+	 */
+	bool finish();
+
+	/** Number of open elements.
+	 */
+	size_t depth() const;
+
+	/** Bytes of output so far, including those still buffered.
+	 */
+	size_t bytesWritten() const;
+
+	TBXMLErrorCodes errorCode() const;
+	std::string error() const;
+
+private:
+	FILE * file;
+	std::string * string;
+	TBXMLWriterSink * sink;
+
+	char * buffer;
+	size_t bufferCapacity;
+	size_t bufferLength;
+	size_t bufferSize;
+	size_t written;
+
+	TBXMLWriterFormat format;
+	std::string indent;
+
+	struct _TBXMLWriterElement * openElements;
+	size_t openElementsLength;
+	size_t openElementsCapacity;
+	char * names;
+	size_t namesLength;
+	size_t namesCapacity;
+	bool startTagOpen;
+
+	TBXMLErrorCodes errorValue;
+
+	bool write(const char* aData, size_t aLength);
+	bool writeEscaped(std::string_view aValue, const char* aSet);
+	bool writeAttribute(std::string_view aName, std::string_view aValue, const char* aSet);
+	bool writeText(std::string_view aText, const char* aSet);
+	bool writeIndent(size_t aDepth);
+	bool closeStartTag();
+	bool pass(const char* aData, size_t aLength);
+	bool fail(TBXMLErrorCodes aCode);
+};
+
+#endif	//_TBXML_WRITER_H_
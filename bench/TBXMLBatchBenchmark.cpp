@@ -0,0 +1,104 @@
+// ================================================================================================
+//  TBXMLBatchBenchmark.cpp
+//  Files per second of TBXMLBatch against one TBXML per file
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Writes n small documents (the first argument, 20000 by default) to a directory under the temporary
+//  directory, then reads them back with a new TBXML and initWithXMLFile per file, the way a loop over
+//  the files would, and with TBXMLBatch at several thread counts. Prints files/s and MB/s; run it twice
+//  to compare with the files in the page cache.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML TBXMLBatchBenchmark.cpp ../TBXML/*.cpp -o batch
+// ================================================================================================
+#include "TBXMLBatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+int main(int argc, char** argv) {
+	size_t fileCount = argc > 1 ? (size_t)atol(argv[1]) : 20000;
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "tbxml-batch-benchmark";
+	std::filesystem::create_directories(directory);
+
+	size_t totalBytes = 0;
+	for (size_t i=0; i < fileCount; i++) {
+		std::string id = std::to_string(i);
+		std::string xml = "<?xml version=\"1.0\"?>\n<order id=\"" + id + "\">\n";
+		for (size_t line=0; line < 8 + i % 24; line++) {
+			xml += "  <line sku=\"SKU-" + std::to_string(line) + "\" quantity='" + std::to_string(1 + (i+line) % 9) + "'>\n";
+			xml += "    <description>Item " + std::to_string(line) + " of order " + id + "</description>\n";
+			xml += "  </line>\n";
+		}
+		xml += "</order>\n";
+
+		std::ofstream file(directory / ("order" + id + ".xml"), std::ios::binary);
+		file << xml;
+		totalBytes += xml.length();
+	}
+
+	printf("%zu files, %.1f MB, %u hardware threads\n", fileCount, (double)totalBytes / 1048576.0, std::thread::hardware_concurrency());
+	printf("%-24s %12s %10s\n", "", "files/s", "MB/s");
+
+	std::string error;
+	TBXMLBatch batch;
+	if (!batch.addDirectory(directory.string(), ".xml", error)) {
+		fprintf(stderr, "listing failed: %s\n", error.c_str());
+		return 1;
+	}
+
+	// one document per file with a blocking read
+	auto start = std::chrono::steady_clock::now();
+	size_t elements = 0;
+	for (const std::string &path : batch.files()) {
+		TBXML document;
+		std::string file = path;
+		if (!document.initWithXMLFile(file, error)) {
+			fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+			return 1;
+		}
+		if (document.rootXMLElement) elements++;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-24s %12.0f %10.1f\n", "TBXML per file", (double)fileCount / seconds, (double)totalBytes / 1048576.0 / seconds);
+
+	static const size_t threadCounts[][2] = { {1, 1}, {2, 1}, {4, 1}, {8, 2}, {16, 4} };
+	for (size_t t=0; t < sizeof(threadCounts)/sizeof(threadCounts[0]); t++) {
+		batch.setParseThreadCount(threadCounts[t][0]);
+		batch.setReadThreadCount(threadCounts[t][1]);
+
+		TBXMLBatchHandler handler;
+		if (!batch.parse(handler, error)) {
+			fprintf(stderr, "batch failed: %s\n", error.c_str());
+			return 1;
+		}
+
+		char label[64];
+		snprintf(label, sizeof(label), "batch %zu parse, %zu read", threadCounts[t][0], threadCounts[t][1]);
+		printf("%-24s %12.0f %10.1f\n", label, batch.filesPerSecond(), batch.megabytesPerSecond());
+	}
+
+	std::filesystem::remove_all(directory);
+	return 0;
+}
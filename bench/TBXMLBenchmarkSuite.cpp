@@ -0,0 +1,431 @@
+// ================================================================================================
+//  TBXMLBenchmarkSuite.cpp
+//  Parser throughput, memory and lookup latency over the synthetic corpus, as a table and JSON
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Generates a document of every corpus shape (TBXMLCorpus) and reports for each: parse throughput in
+//  MB/s and elements/s (best of --rounds parses), the peak resident set size while parsing, the
+//  allocations a parse makes, and the latency of childElementNamed and valueOfAttributeNamed lookups.
+//
+//      tbxml_bench [--size MB] [--rounds n] [--seed n] [--shape name]... [--json file|-] [--corpus dir]
+//
+//  --json writes the results as JSON (to stdout with -, the table then goes to stderr) so runs of
+//  different builds can be compared; --corpus writes the documents to dir instead of parsing them.
+//  Built by the CMake build as tbxml_bench, or:
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML TBXMLBenchmarkSuite.cpp TBXMLCorpus.cpp ../TBXML/*.cpp -o tbxml_bench
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLScanner.h"
+#include "TBXMLCorpus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// lookups timed per shape and kind
+#define TBXML_BENCH_LOOKUPS 200000
+
+// ================================================================================================
+// Allocation Counting
+// ================================================================================================
+
+// calls to the global operator new, TBXML itself allocates with malloc and counts that in
+// allocationCount()
+static std::atomic<size_t> newCalls(0);
+
+void* operator new(size_t aSize) {
+	newCalls.fetch_add(1, std::memory_order_relaxed);
+	void * rev = malloc(aSize ? aSize : 1);
+	if (!rev) throw std::bad_alloc();
+	return rev;
+}
+
+void operator delete(void* aPointer) noexcept {
+	free(aPointer);
+}
+
+void operator delete(void* aPointer, size_t) noexcept {
+	free(aPointer);
+}
+
+// ================================================================================================
+// Measurements
+// ================================================================================================
+
+typedef struct _TBXMLBenchResult {
+	const char * shape;
+	size_t bytes;
+	size_t elements;
+	size_t attributes;
+	size_t maxDepth;
+	double parseSeconds;
+	size_t peakRSS;
+	size_t documentAllocations;
+	size_t newCalls;
+	double childLookup;
+	double childLookupView;
+	double attributeLookup;
+	double attributeLookupView;
+	TBXMLParseStats stats;
+} TBXMLBenchResult;
+
+// keeps the compiler from dropping lookups whose result is unused
+static volatile size_t sink;
+
+static double secondsSince(std::chrono::steady_clock::time_point aStart) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+/** Resets the peak resident set size where the kernel allows it (Linux), so the peak of one shape is
+    not hidden by a larger one measured before it. Returns false when the peak can't be reset.
+ */
+static bool resetPeakRSS() {
+	FILE * file = fopen("/proc/self/clear_refs", "w");
+	if (!file) return false;
+	bool reset = fputs("5", file) >= 0;
+	return fclose(file) == 0 && reset;
+}
+
+// peak resident set size in KB
+static size_t peakRSS() {
+	FILE * file = fopen("/proc/self/status", "r");
+	if (file) {
+		char line[256];
+		size_t peak = 0;
+		while (fgets(line, sizeof(line), file)) {
+			if (strncmp(line, "VmHWM:", 6) == 0) peak = strtoull(line + 6, NULL, 10);
+		}
+		fclose(file);
+		if (peak) return peak;
+	}
+
+#if defined(__unix__) || defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		return (size_t)usage.ru_maxrss / 1024;
+#else
+		return (size_t)usage.ru_maxrss;
+#endif
+	}
+#endif
+	return 0;
+}
+
+// counts the tree without recursing, the deep shape nests 1024 levels
+static void countElements(const TBXMLElement* aRoot, TBXMLBenchResult &aResult) {
+	size_t depth = 0;
+	const TBXMLElement * xmlElement = aRoot;
+	while (xmlElement) {
+		aResult.elements++;
+		if (depth + 1 > aResult.maxDepth) aResult.maxDepth = depth + 1;
+		for (const TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) aResult.attributes++;
+
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			depth++;
+			continue;
+		}
+		while (xmlElement && xmlElement != aRoot && !xmlElement->nextSibling) {
+			xmlElement = xmlElement->parentElement;
+			depth--;
+		}
+		xmlElement = (xmlElement && xmlElement != aRoot) ? xmlElement->nextSibling : NULL;
+	}
+}
+
+typedef struct _TBXMLBenchLookup {
+	TBXMLElement * element;
+	std::string name;
+} TBXMLBenchLookup;
+
+/** Picks TBXML_BENCH_LOOKUPS (element, name) pairs: the parent and name of a random element for
+    aChildren, otherwise an element with attributes and the name of a random one of them. The same seed
+    gives the same pairs.
+ */
+static std::vector<TBXMLBenchLookup> lookups(TBXMLElement* aRoot, bool aChildren, uint64_t aSeed) {
+	std::vector<TBXMLElement*> candidates;
+	TBXMLElement * xmlElement = aRoot;
+	while (xmlElement) {
+		if (aChildren ? xmlElement != aRoot : xmlElement->firstAttribute != NULL) candidates.push_back(xmlElement);
+
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			continue;
+		}
+		while (xmlElement && xmlElement != aRoot && !xmlElement->nextSibling) xmlElement = xmlElement->parentElement;
+		xmlElement = (xmlElement && xmlElement != aRoot) ? xmlElement->nextSibling : NULL;
+	}
+
+	std::vector<TBXMLBenchLookup> rev;
+	if (candidates.empty()) return rev;
+
+	uint64_t state = aSeed * 0x9E3779B97F4A7C15ull + 1;
+	auto random = [&state](size_t aLimit) {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (size_t)((state * 0x2545F4914F6CDD1Dull) % aLimit);
+	};
+
+	rev.reserve(TBXML_BENCH_LOOKUPS);
+	for (size_t i=0; i < TBXML_BENCH_LOOKUPS; i++) {
+		TBXMLElement * candidate = candidates[random(candidates.size())];
+		TBXMLBenchLookup lookup;
+		if (aChildren) {
+			lookup.element = candidate->parentElement;
+			lookup.name.assign(candidate->name, candidate->nameLength);
+		} else {
+			size_t count = 0;
+			for (TBXMLAttribute * xmlAttribute = candidate->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) count++;
+			TBXMLAttribute * xmlAttribute = candidate->firstAttribute;
+			for (size_t position = random(count); position; position--) xmlAttribute = xmlAttribute->next;
+			lookup.element = candidate;
+			lookup.name.assign(xmlAttribute->name, xmlAttribute->nameLength);
+		}
+		rev.push_back(lookup);
+	}
+	return rev;
+}
+
+static double nanosecondsPerLookup(std::vector<TBXMLBenchLookup> &aLookups, bool aChildren, bool aView) {
+	if (aLookups.empty()) return 0;
+
+	size_t found = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (TBXMLBenchLookup &lookup : aLookups) {
+		if (aChildren) {
+			if (aView)
+				found += TBXML::childElementNamed(std::string_view(lookup.name), (const TBXMLElement*)lookup.element) != NULL;
+			else
+				found += TBXML::childElementNamed(lookup.name, lookup.element) != NULL;
+		} else {
+			if (aView)
+				found += TBXML::valueOfAttributeNamed(std::string_view(lookup.name), (const TBXMLElement*)lookup.element).length();
+			else
+				found += TBXML::valueOfAttributeNamed(lookup.name, lookup.element).length();
+		}
+	}
+	double seconds = secondsSince(start);
+
+	sink = found;
+	return seconds * 1e9 / (double)aLookups.size();
+}
+
+static bool measure(TBXMLCorpusShape aShape, std::string &aXML, size_t aRounds, uint64_t aSeed, TBXMLBenchResult &aResult) {
+	memset(&aResult, 0, sizeof(aResult));
+	aResult.shape = TBXMLCorpus::shapeName(aShape);
+	aResult.bytes = aXML.length();
+
+	// the first parse is measured for memory and allocations, then each round parses into a new document
+	std::string error;
+	resetPeakRSS();
+	size_t calls = newCalls.load();
+	TBXML document;
+	auto start = std::chrono::steady_clock::now();
+	if (!document.initWithXMLString(aXML, error)) {
+		fprintf(stderr, "%s: parse failed: %s\n", aResult.shape, error.c_str());
+		return false;
+	}
+	aResult.parseSeconds = secondsSince(start);
+	aResult.newCalls = newCalls.load() - calls;
+	aResult.documentAllocations = document.allocationCount();
+	aResult.peakRSS = peakRSS();
+	aResult.stats = document.parseStats();
+
+	for (size_t round=1; round < aRounds; round++) {
+		TBXML parsed;
+		start = std::chrono::steady_clock::now();
+		parsed.initWithXMLString(aXML, error);
+		double seconds = secondsSince(start);
+		if (seconds < aResult.parseSeconds) aResult.parseSeconds = seconds;
+	}
+
+	countElements(document.rootXMLElement, aResult);
+
+	std::vector<TBXMLBenchLookup> children = lookups(document.rootXMLElement, true, aSeed);
+	aResult.childLookup = nanosecondsPerLookup(children, true, false);
+	aResult.childLookupView = nanosecondsPerLookup(children, true, true);
+
+	std::vector<TBXMLBenchLookup> attributes = lookups(document.rootXMLElement, false, aSeed);
+	aResult.attributeLookup = nanosecondsPerLookup(attributes, false, false);
+	aResult.attributeLookupView = nanosecondsPerLookup(attributes, false, true);
+	return true;
+}
+
+// ================================================================================================
+// Output
+// ================================================================================================
+
+static const char* scanModeName() {
+	switch (TBXMLScanner::scanMode()) {
+		case D_TBXML_SCAN_SSE2: return "sse2";
+		case D_TBXML_SCAN_AVX2: return "avx2";
+		default: return "scalar";
+	}
+}
+
+static void printTable(FILE* aFile, const std::vector<TBXMLBenchResult> &aResults) {
+	fprintf(aFile, "%-11s %8s %10s %9s %10s %9s %7s %9s %9s %9s %9s\n", "shape", "MB", "MB/s", "Melem/s",
+		"peak RSS", "allocs", "news", "child ns", "view ns", "attr ns", "view ns");
+
+	for (const TBXMLBenchResult &result : aResults) {
+		double megabytes = (double)result.bytes / (1024*1024);
+		fprintf(aFile, "%-11s %8.1f %10.1f %9.2f %7zu MB %9zu %7zu %9.1f %9.1f %9.1f %9.1f\n", result.shape, megabytes,
+			megabytes / result.parseSeconds, (double)result.elements / result.parseSeconds / 1e6, result.peakRSS / 1024,
+			result.documentAllocations, result.newCalls, result.childLookup, result.childLookupView,
+			result.attributeLookup, result.attributeLookupView);
+	}
+}
+
+static void printJSON(FILE* aFile, const std::vector<TBXMLBenchResult> &aResults, size_t aSize, size_t aRounds, uint64_t aSeed, bool aPeakReset) {
+	fprintf(aFile, "{\n");
+	fprintf(aFile, "  \"benchmark\": \"tbxml\",\n");
+	fprintf(aFile, "  \"size_mb\": %zu,\n", aSize);
+	fprintf(aFile, "  \"rounds\": %zu,\n", aRounds);
+	fprintf(aFile, "  \"seed\": %llu,\n", (unsigned long long)aSeed);
+	fprintf(aFile, "  \"scan_mode\": \"%s\",\n", scanModeName());
+	fprintf(aFile, "  \"peak_rss_per_shape\": %s,\n", aPeakReset ? "true" : "false");
+	fprintf(aFile, "  \"results\": [\n");
+
+	for (size_t i=0; i < aResults.size(); i++) {
+		const TBXMLBenchResult &result = aResults[i];
+		fprintf(aFile, "    {\n");
+		fprintf(aFile, "      \"shape\": \"%s\",\n", result.shape);
+		fprintf(aFile, "      \"bytes\": %zu,\n", result.bytes);
+		fprintf(aFile, "      \"elements\": %zu,\n", result.elements);
+		fprintf(aFile, "      \"attributes\": %zu,\n", result.attributes);
+		fprintf(aFile, "      \"max_depth\": %zu,\n", result.maxDepth);
+		fprintf(aFile, "      \"parse_seconds\": %.6f,\n", result.parseSeconds);
+		fprintf(aFile, "      \"mb_per_second\": %.2f,\n", (double)result.bytes / (1024*1024) / result.parseSeconds);
+		fprintf(aFile, "      \"elements_per_second\": %.0f,\n", (double)result.elements / result.parseSeconds);
+		fprintf(aFile, "      \"peak_rss_kb\": %zu,\n", result.peakRSS);
+		fprintf(aFile, "      \"document_allocations\": %zu,\n", result.documentAllocations);
+		fprintf(aFile, "      \"operator_new_calls\": %zu,\n", result.newCalls);
+		fprintf(aFile, "      \"child_element_named_ns\": %.2f,\n", result.childLookup);
+		fprintf(aFile, "      \"child_element_named_view_ns\": %.2f,\n", result.childLookupView);
+		fprintf(aFile, "      \"value_of_attribute_named_ns\": %.2f,\n", result.attributeLookup);
+		fprintf(aFile, "      \"value_of_attribute_named_view_ns\": %.2f%s\n", result.attributeLookupView, TBXMLStats::enabled() ? "," : "");
+		if (TBXMLStats::enabled()) {
+			// the statistics of the first parse, when the library collects them
+			const TBXMLParseStats &stats = result.stats;
+			fprintf(aFile, "      \"stats\": {\"cdata_sections\": %llu, \"comments\": %llu, \"max_depth\": %llu, \"element_buffers\": %llu, "
+				"\"attribute_buffers\": %llu, \"bytes_allocated\": %llu, \"scan_ns\": %llu, \"attribute_ns\": %llu, \"trim_ns\": %llu, \"parse_ns\": %llu}\n",
+				(unsigned long long)stats.CDATASections, (unsigned long long)stats.comments, (unsigned long long)stats.maxDepth,
+				(unsigned long long)stats.elementBuffers, (unsigned long long)stats.attributeBuffers, (unsigned long long)stats.bytesAllocated,
+				(unsigned long long)stats.scanNanoseconds, (unsigned long long)stats.attributeNanoseconds, (unsigned long long)stats.trimNanoseconds,
+				(unsigned long long)stats.parseNanoseconds);
+		}
+		fprintf(aFile, "    }%s\n", i+1 < aResults.size() ? "," : "");
+	}
+
+	fprintf(aFile, "  ]\n");
+	fprintf(aFile, "}\n");
+}
+
+static int usage() {
+	fprintf(stderr, "usage: tbxml_bench [--size MB] [--rounds n] [--seed n] [--shape name]... [--json file|-] [--corpus dir]\n");
+	fprintf(stderr, "shapes:");
+	for (int i=0; i < D_TBXML_CORPUS_SHAPE_COUNT; i++) fprintf(stderr, " %s", TBXMLCorpus::shapeName((TBXMLCorpusShape)i));
+	fprintf(stderr, "\n");
+	return 2;
+}
+
+int main(int argc, char** argv) {
+	size_t size = 16;
+	size_t rounds = 5;
+	uint64_t seed = 1;
+	std::vector<TBXMLCorpusShape> shapes;
+	const char * json = NULL;
+	const char * corpus = NULL;
+
+	for (int i=1; i < argc; i++) {
+		std::string_view option = argv[i];
+		if (i+1 >= argc) return usage();
+		const char * value = argv[++i];
+
+		if (option == "--size") size = strtoull(value, NULL, 10);
+		else if (option == "--rounds") rounds = strtoull(value, NULL, 10);
+		else if (option == "--seed") seed = strtoull(value, NULL, 10);
+		else if (option == "--json") json = value;
+		else if (option == "--corpus") corpus = value;
+		else if (option == "--shape") {
+			TBXMLCorpusShape shape;
+			if (!TBXMLCorpus::shapeNamed(value, shape)) return usage();
+			shapes.push_back(shape);
+		}
+		else return usage();
+	}
+	if (size == 0 || rounds == 0) return usage();
+	if (shapes.empty()) {
+		for (int i=0; i < D_TBXML_CORPUS_SHAPE_COUNT; i++) shapes.push_back((TBXMLCorpusShape)i);
+	}
+
+	// the table goes to stderr when the JSON is written to stdout
+	FILE * table = (json && strcmp(json, "-") == 0) ? stderr : stdout;
+	bool peakReset = resetPeakRSS();
+	std::vector<TBXMLBenchResult> results;
+
+	for (TBXMLCorpusShape shape : shapes) {
+		std::string xml = TBXMLCorpus::generate(shape, size*1024*1024, seed);
+
+		if (corpus) {
+			std::string path = std::string(corpus) + "/" + TBXMLCorpus::shapeName(shape) + ".xml";
+			FILE * file = fopen(path.c_str(), "wb");
+			bool written = file && fwrite(xml.data(), 1, xml.length(), file) == xml.length();
+			if (file && fclose(file) != 0) written = false;
+			if (!written) {
+				fprintf(stderr, "could not write %s\n", path.c_str());
+				return 1;
+			}
+			fprintf(table, "%s\n", path.c_str());
+			continue;
+		}
+
+		TBXMLBenchResult result;
+		if (!measure(shape, xml, rounds, seed, result)) return 1;
+		results.push_back(result);
+	}
+	if (corpus) return 0;
+
+	printTable(table, results);
+	if (!peakReset) fprintf(table, "peak RSS could not be reset, it is the peak of the whole run so far\n");
+
+	if (json) {
+		FILE * file = strcmp(json, "-") == 0 ? stdout : fopen(json, "w");
+		if (!file) {
+			fprintf(stderr, "could not write %s\n", json);
+			return 1;
+		}
+		printJSON(file, results, size, rounds, seed, peakReset);
+		if (file != stdout) fclose(file);
+	}
+	return 0;
+}
@@ -0,0 +1,97 @@
+// ================================================================================================
+//  TBXMLChildIndexBenchmark.cpp
+//  Linear childElementNamed against indexedChildElementNamed by number of children
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Looks up every child of an element with n uniquely named children, in random order, first by
+//  walking the children and then through the child index, and prints the time per lookup. The
+//  crossover is the smallest n at which the index is faster; TBXML_CHILD_INDEX_THRESHOLD is set
+//  from it.
+//
+//  c++ -O2 -std=c++17 -I../TBXML TBXMLChildIndexBenchmark.cpp ../TBXML/*.cpp -o childindex
+// ================================================================================================
+#include "TBXML.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// keeps the compiler from dropping lookups whose result is unused
+static volatile const void * sink;
+
+static double nanosecondsPerLookup(TBXML &aDocument, std::vector<std::string> &aNames, bool aIndexed) {
+	const TBXMLElement * root = aDocument.rootXMLElement;
+	size_t rounds = 2000000 / (aNames.size()*aNames.size()/8 + 1) + 1;
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t round=0; round < rounds; round++) {
+		for (size_t i=0; i < aNames.size(); i++) {
+			if (aIndexed)
+				sink = aDocument.indexedChildElementNamed(std::string_view(aNames[i]), root);
+			else
+				sink = TBXML::childElementNamed(std::string_view(aNames[i]), root);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / (double)(rounds*aNames.size());
+}
+
+int main() {
+	static const size_t counts[] = { 2, 4, 8, 16, 24, 32, 48, 64, 128, 256, 1024, 4096, 16384, 65536 };
+	size_t crossover = 0;
+
+	printf("%10s %14s %14s\n", "children", "walk ns", "index ns");
+
+	for (size_t c=0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+
+		// <catalog><entry0/><entry1/>...</catalog>, looked up in a shuffled order
+		std::string xml = "<catalog>";
+		std::vector<std::string> names;
+		for (size_t i=0; i < count; i++) {
+			names.push_back("entry" + std::to_string(i));
+			xml += "<" + names.back() + " id=\"" + std::to_string(i) + "\"/>";
+		}
+		xml += "</catalog>";
+
+		srand(1);
+		for (size_t i=count-1; i > 0; i--) std::swap(names[i], names[rand() % (i+1)]);
+
+		std::string error;
+		TBXML document;
+		document.setChildIndexThreshold(1);
+		if (!document.initWithXMLString(xml, error)) {
+			fprintf(stderr, "parse failed: %s\n", error.c_str());
+			return 1;
+		}
+
+		double walk = nanosecondsPerLookup(document, names, false);
+		double indexed = nanosecondsPerLookup(document, names, true);
+		if (!crossover && indexed < walk) crossover = count;
+
+		printf("%10zu %14.1f %14.1f\n", count, walk, indexed);
+	}
+
+	printf("crossover at %zu children\n", crossover);
+	return 0;
+}
@@ -0,0 +1,195 @@
+// ================================================================================================
+//  TBXMLCorpus.cpp
+//  Deterministic synthetic documents of distinct shapes for the benchmarks
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+#include "TBXMLCorpus.h"
+
+// levels of a chain in D_TBXML_CORPUS_DEEP
+#define TBXML_CORPUS_DEPTH 1024
+
+static const char * shapeNames[D_TBXML_CORPUS_SHAPE_COUNT] = {
+	"deep", "wide", "attributes", "cdata", "comments", "text", "feed"
+};
+
+static const char * words[] = {
+	"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "do",
+	"eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore", "magna", "aliqua", "enim",
+	"ad", "minim", "veniam", "quis", "nostrud", "exercitation", "ullamco", "laboris", "nisi", "aliquip",
+	"ex", "ea", "commodo", "consequat", "duis", "aute", "irure", "in", "reprehenderit", "voluptate"
+};
+
+static const char * names[] = {
+	"id", "name", "type", "class", "href", "lang", "version", "status", "created", "updated",
+	"owner", "group", "priority", "weight", "width", "height", "color", "source", "target", "ref",
+	"key", "value", "unit", "scale"
+};
+
+// ================================================================================================
+// Private Implementation
+// ================================================================================================
+
+// xorshift64*, the same sequence everywhere unlike the std distributions
+class TBXMLCorpusRandom {
+public:
+	uint64_t state;
+
+	TBXMLCorpusRandom(uint64_t aSeed) {
+		state = aSeed * 0x9E3779B97F4A7C15ull + 1;
+	}
+
+	uint64_t next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+
+	size_t below(size_t aLimit) {
+		return (size_t)(this->next() % aLimit);
+	}
+};
+
+static void appendWords(std::string &aXML, TBXMLCorpusRandom &aRandom, size_t aCount, bool aReferences) {
+	for (size_t i=0; i < aCount; i++) {
+		if (i) aXML += ' ';
+		aXML += words[aRandom.below(sizeof(words)/sizeof(words[0]))];
+		if (aReferences && aRandom.below(32) == 0) aXML += aRandom.below(2) ? " &amp;" : " &#8212;";
+	}
+}
+
+static void appendRecord(std::string &aXML, TBXMLCorpusRandom &aRandom, size_t aIndex) {
+	aXML += "<record id=\"";
+	aXML += std::to_string(aIndex);
+	aXML += "\"><name>";
+	appendWords(aXML, aRandom, 2 + aRandom.below(3), false);
+	aXML += "</name><amount>";
+	aXML += std::to_string(aRandom.below(100000));
+	aXML += "</amount></record>";
+}
+
+static void appendShape(std::string &aXML, TBXMLCorpusShape aShape, TBXMLCorpusRandom &aRandom, size_t aIndex) {
+	switch (aShape) {
+		case D_TBXML_CORPUS_DEEP:
+			for (size_t level=0; level < TBXML_CORPUS_DEPTH; level++) {
+				aXML += "<n d=\"";
+				aXML += std::to_string(level);
+				aXML += "\">";
+			}
+			aXML += "leaf";
+			for (size_t level=0; level < TBXML_CORPUS_DEPTH; level++) aXML += "</n>";
+			break;
+		case D_TBXML_CORPUS_WIDE:
+			aXML += "<i";
+			aXML += std::to_string(aIndex % 4096);
+			aXML += "/>";
+			break;
+		case D_TBXML_CORPUS_ATTRIBUTES: {
+			aXML += "<element";
+			size_t count = 8 + aRandom.below(17);
+			for (size_t i=0; i < count; i++) {
+				aXML += ' ';
+				aXML += names[i];
+				aXML += i % 2 ? "='" : "=\"";
+				aXML += words[aRandom.below(sizeof(words)/sizeof(words[0]))];
+				aXML += std::to_string(aRandom.below(1000));
+				aXML += i % 2 ? "'" : "\"";
+			}
+			aXML += "/>";
+			break;
+		}
+		case D_TBXML_CORPUS_CDATA:
+			aXML += "<script type=\"text/html\"><![CDATA[<div class=\"row\"><p>";
+			appendWords(aXML, aRandom, 8 + aRandom.below(24), false);
+			aXML += "</p> if (a < b && c > d) { return; } </div>]]></script>";
+			break;
+		case D_TBXML_CORPUS_COMMENTS:
+			aXML += "<!-- ";
+			appendWords(aXML, aRandom, 1 + aRandom.below(40), false);
+			aXML += " -->";
+			appendRecord(aXML, aRandom, aIndex);
+			break;
+		case D_TBXML_CORPUS_TEXT:
+			aXML += "<p>";
+			appendWords(aXML, aRandom, 40 + aRandom.below(160), true);
+			aXML += "</p>";
+			break;
+		case D_TBXML_CORPUS_FEED:
+			aXML += "<item><title>";
+			appendWords(aXML, aRandom, 4 + aRandom.below(8), true);
+			aXML += "</title><link>https://example.com/";
+			aXML += std::to_string(aIndex);
+			aXML += "</link><guid isPermaLink=\"false\">item-";
+			aXML += std::to_string(aRandom.next());
+			aXML += "</guid><pubDate>Mon, ";
+			aXML += std::to_string(1 + aRandom.below(28));
+			aXML += " Oct 2024 12:00:00 GMT</pubDate><category domain=\"tags\">";
+			aXML += words[aRandom.below(sizeof(words)/sizeof(words[0]))];
+			aXML += "</category><description><![CDATA[<p>";
+			appendWords(aXML, aRandom, 20 + aRandom.below(60), false);
+			aXML += "</p>]]></description>";
+			if (aRandom.below(4) == 0) aXML += "<!-- syndicated -->";
+			aXML += "<enclosure url=\"https://example.com/media/";
+			aXML += std::to_string(aIndex);
+			aXML += ".mp3\" length=\"";
+			aXML += std::to_string(aRandom.below(50000000));
+			aXML += "\" type=\"audio/mpeg\"/></item>";
+			break;
+		default:
+			break;
+	}
+}
+
+// ================================================================================================
+// Public Implementation
+// ================================================================================================
+
+std::string TBXMLCorpus::generate(TBXMLCorpusShape aShape, size_t aBytes, uint64_t aSeed) {
+	TBXMLCorpusRandom random(aSeed ^ ((uint64_t)aShape << 56));
+
+	std::string xml;
+	xml.reserve(aBytes + 64*1024);
+	xml += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	xml += aShape == D_TBXML_CORPUS_FEED ? "<rss version=\"2.0\"><channel><title>Benchmark feed</title>" : "<corpus>";
+
+	for (size_t i=0; xml.length() < aBytes; i++) {
+		appendShape(xml, aShape, random, i);
+		if (aShape != D_TBXML_CORPUS_WIDE) xml += '\n';
+	}
+
+	xml += aShape == D_TBXML_CORPUS_FEED ? "</channel></rss>" : "</corpus>";
+	return xml;
+}
+
+const char* TBXMLCorpus::shapeName(TBXMLCorpusShape aShape) {
+	if (aShape < 0 || aShape >= D_TBXML_CORPUS_SHAPE_COUNT) return "";
+	return shapeNames[aShape];
+}
+
+bool TBXMLCorpus::shapeNamed(std::string_view aName, TBXMLCorpusShape &aShape) {
+	for (int i=0; i < D_TBXML_CORPUS_SHAPE_COUNT; i++) {
+		if (aName == shapeNames[i]) {
+			aShape = (TBXMLCorpusShape)i;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,63 @@
+// ================================================================================================
+//  TBXMLCorpus.h
+//  Deterministic synthetic documents of distinct shapes for the benchmarks
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_CORPUS_H_
+#define _TBXML_CORPUS_H_
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+// ================================================================================================
+//  Corpus Shapes
+// ================================================================================================
+enum TBXMLCorpusShape {
+	D_TBXML_CORPUS_DEEP = 0,		// chains of nested elements 1024 levels deep
+	D_TBXML_CORPUS_WIDE,			// one element with a very large number of small children
+	D_TBXML_CORPUS_ATTRIBUTES,		// elements with 8 to 24 attributes and no text
+	D_TBXML_CORPUS_CDATA,			// text mostly in CDATA sections holding markup
+	D_TBXML_CORPUS_COMMENTS,		// records interleaved with comments of every length
+	D_TBXML_CORPUS_TEXT,			// paragraphs of prose with a reference now and then
+	D_TBXML_CORPUS_FEED,			// an RSS like feed of items mixing all of the above
+	D_TBXML_CORPUS_SHAPE_COUNT
+};
+
+/** TBXMLCorpus generates the documents the benchmark suite parses. A document depends only on its
+    shape, size and seed, the same arguments give the same bytes on every machine and run, so results
+    of different builds are comparable.
+ */
+class TBXMLCorpus {
+public:
+	/** A document of about aBytes bytes (never less) of the given shape, one root element.
+	 */
+	static std::string generate(TBXMLCorpusShape aShape, size_t aBytes, uint64_t aSeed);
+
+	static const char* shapeName(TBXMLCorpusShape aShape);
+
+	/** Sets aShape to the shape named aName, returns false for an unknown name.
+	 */
+	static bool shapeNamed(std::string_view aName, TBXMLCorpusShape &aShape);
+};
+
+#endif	//_TBXML_CORPUS_H_
@@ -0,0 +1,101 @@
+// ================================================================================================
+//  TBXMLElementsNamedBenchmark.cpp
+//  Finding every element of a name by following the links and by reading the element buffers
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses a generated catalog of about a million elements and finds every element of one name: with
+//  a recursive walk of firstChild/nextSibling, with TBXML::descendants, with forEachElementNamed
+//  reading the element buffers, and with forEachElementNamed comparing symbol table ids. Prints the
+//  time per walk and per element walked over.
+//
+//  c++ -O2 -std=c++17 -I../TBXML TBXMLElementsNamedBenchmark.cpp ../TBXML/*.cpp -o elementsnamed
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLSymbolTable.h"
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+#define ROUNDS 20
+
+static double millisecondsSince(std::chrono::steady_clock::time_point aStart) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+static void countNamed(const TBXMLElement* aXMLElement, std::string_view aName, size_t &aCount) {
+	for (; aXMLElement; aXMLElement = aXMLElement->nextSibling) {
+		if (TBXML::elementName(aXMLElement) == aName) aCount++;
+		countNamed(aXMLElement->firstChild, aName, aCount);
+	}
+}
+
+int main() {
+	std::string xml = "<catalog>";
+	for (size_t i=0; i < 100000; i++) {
+		std::string n = std::to_string(i);
+		xml += "<product sku=\"" + n + "\"><name>Product " + n + "</name><price currency=\"EUR\">" + std::to_string(i % 997) + ".99</price>";
+		xml += "<tags><tag>a</tag><tag>b</tag></tags><variants><variant><item>" + n + "-s</item></variant><variant><item>" + n + "-m</item></variant></variants></product>";
+	}
+	xml += "</catalog>";
+
+	TBXMLSymbolTable symbols;
+	TBXML document;
+	document.setSymbolTable(&symbols);
+	std::string error;
+	if (!document.initWithXMLString(xml, error)) {
+		fprintf(stderr, "parse failed: %s\n", error.c_str());
+		return 1;
+	}
+
+	size_t elements = 0;
+	for (const TBXMLElement * xmlElement : document.elements()) elements += xmlElement != NULL;
+	TBXMLName item = symbols.name("item");
+
+	printf("%10s %10s %24s %10s %12s %10s\n", "elements", "items", "walk", "ms", "ns/element", "speedup");
+
+	static const char* walks[] = { "firstChild/nextSibling", "descendants", "forEachElementNamed", "forEachElementNamed id" };
+	double linkedMilliseconds = 0;
+	for (size_t w=0; w < sizeof(walks)/sizeof(walks[0]); w++) {
+		double bestMilliseconds = 0;
+		size_t count = 0;
+		for (int round=0; round < ROUNDS; round++) {
+			count = 0;
+			auto start = std::chrono::steady_clock::now();
+			switch (w) {
+				case 0: countNamed(document.rootXMLElement, "item", count); break;
+				case 1:
+					for (const TBXMLElement * xmlElement : TBXML::descendants(document.rootXMLElement)) {
+						if (TBXML::elementName(xmlElement) == "item") count++;
+					}
+					break;
+				case 2: document.forEachElementNamed("item", [&](const TBXMLElement*) { count++; }); break;
+				case 3: document.forEachElementNamed(item, [&](const TBXMLElement*) { count++; }); break;
+			}
+			double milliseconds = millisecondsSince(start);
+			if (round == 0 || milliseconds < bestMilliseconds) bestMilliseconds = milliseconds;
+		}
+		if (w == 0) linkedMilliseconds = bestMilliseconds;
+
+		printf("%10zu %10zu %24s %10.3f %12.2f %9.1fx\n", elements, count, walks[w], bestMilliseconds,
+			bestMilliseconds * 1e6 / elements, linkedMilliseconds / bestMilliseconds);
+	}
+	return 0;
+}
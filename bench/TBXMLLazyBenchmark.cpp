@@ -0,0 +1,114 @@
+// ================================================================================================
+//  TBXMLLazyBenchmark.cpp
+//  Time to the first answer of eager and lazy parses
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses a generated feed of entries and reads the title of one entry, eagerly and with lazy
+//  depths of 1 and 2, and prints the time to that answer, the elements built by then and the time
+//  to expand the rest of the document.
+//
+//  c++ -O2 -std=c++17 -I../TBXML TBXMLLazyBenchmark.cpp ../TBXML/*.cpp -o lazy
+// ================================================================================================
+#include "TBXML.h"
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+#define ROUNDS 5
+
+static double millisecondsSince(std::chrono::steady_clock::time_point aStart) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+// the title of entry aIndex, following the children through the document so lazy elements expand
+static std::string_view titleOfEntry(TBXML &aXMLDocument, size_t aIndex) {
+	const TBXMLElement * entry = aXMLDocument.firstChild(aXMLDocument.rootXMLElement);
+	for (size_t i=0; entry && i < aIndex; i++) entry = entry->nextSibling;
+	if (!entry) return std::string_view();
+	for (const TBXMLElement * child = aXMLDocument.firstChild(entry); child; child = child->nextSibling) {
+		if (TBXML::elementName(child) == "title") return std::string_view(child->text, child->textLength);
+	}
+	return std::string_view();
+}
+
+static size_t countElements(TBXML &aXMLDocument, const TBXMLElement* aXMLElement) {
+	size_t count = 0;
+	for (; aXMLElement; aXMLElement = aXMLElement->nextSibling) count += 1 + countElements(aXMLDocument, aXMLElement->firstChild);
+	return count;
+}
+
+int main() {
+	static const size_t counts[] = { 10000, 100000 };
+	static const size_t depths[] = { 0, 1, 2 };
+
+	printf("%10s %8s %6s %14s %12s %12s %10s\n", "entries", "MB", "lazy", "first ms", "speedup", "expand ms", "elements");
+
+	for (size_t c=0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+		std::string xml = "<feed><title>Benchmark</title>";
+		for (size_t i=0; i < counts[c]; i++) {
+			std::string n = std::to_string(i);
+			xml += "<entry id=\"" + n + "\"><title>Entry " + n + "</title><author><name>Author " + std::to_string(i % 97) + "</name></author>";
+			xml += "<link href=\"https://example.com/e/" + n + "\"/><content type=\"html\"><![CDATA[<p>";
+			for (int w=0; w < 30; w++) xml += "lorem ipsum ";
+			xml += "</p>]]></content></entry>\n";
+		}
+		xml += "</feed>";
+		double megabytes = (double)xml.length() / (1024*1024);
+
+		// the title of the entry in the middle of the feed, the feed title comes first
+		size_t entry = counts[c] / 2 + 1;
+		std::string expected = "Entry " + std::to_string(entry - 1);
+
+		double eagerMilliseconds = 0;
+		for (size_t d=0; d < sizeof(depths)/sizeof(depths[0]); d++) {
+			double firstMilliseconds = 0, expandMilliseconds = 0;
+			size_t elements = 0;
+			TBXML document;
+			document.setLazyDepth(depths[d]);
+			for (int round=0; round < ROUNDS; round++) {
+				std::string copy = xml, error;
+				auto start = std::chrono::steady_clock::now();
+				if (!document.initWithXMLString(copy, error) || titleOfEntry(document, entry) != expected) {
+					fprintf(stderr, "lazy depth %zu failed: %s\n", depths[d], error.c_str());
+					return 1;
+				}
+				double milliseconds = millisecondsSince(start);
+				if (round == 0 || milliseconds < firstMilliseconds) {
+					firstMilliseconds = milliseconds;
+					elements = countElements(document, document.rootXMLElement);
+				}
+
+				start = std::chrono::steady_clock::now();
+				if (!document.expandAll(error)) {
+					fprintf(stderr, "expansion failed: %s\n", error.c_str());
+					return 1;
+				}
+				milliseconds = millisecondsSince(start);
+				if (round == 0 || milliseconds < expandMilliseconds) expandMilliseconds = milliseconds;
+			}
+			if (d == 0) eagerMilliseconds = firstMilliseconds;
+
+			printf("%10zu %8.1f %6zu %14.3f %11.1fx %12.3f %10zu\n", counts[c], megabytes, depths[d],
+				firstMilliseconds, eagerMilliseconds / firstMilliseconds, expandMilliseconds, elements);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,104 @@
+// ================================================================================================
+//  TBXMLParallelBenchmark.cpp
+//  Parse throughput of one large document by number of parse threads
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Builds a synthetic catalog of records with attributes, text, CDATA and comments (the size in MB is
+//  the first argument, 256 by default), parses it with 1, 2, 4, 8 and 16 threads and prints the best
+//  time of a few parses with the speedup over one thread. Every parse is checked against the serial
+//  one by counting elements and attributes.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML TBXMLParallelBenchmark.cpp ../TBXML/*.cpp -o parallel
+// ================================================================================================
+#include "TBXML.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+static void count(const TBXMLElement* aXMLElement, size_t &aElements, size_t &aAttributes) {
+	for (; aXMLElement; aXMLElement = aXMLElement->nextSibling) {
+		aElements++;
+		for (const TBXMLAttribute * attribute = aXMLElement->firstAttribute; attribute; attribute = attribute->next) aAttributes++;
+		count(aXMLElement->firstChild, aElements, aAttributes);
+	}
+}
+
+int main(int argc, char** argv) {
+	static const size_t threadCounts[] = { 1, 2, 4, 8, 16 };
+	size_t megabytes = argc > 1 ? (size_t)atol(argv[1]) : 256;
+
+	std::string corpus = "<?xml version=\"1.0\"?>\n<catalog>\n";
+	for (size_t i=0; corpus.length() < megabytes*1024*1024; i++) {
+		std::string id = std::to_string(i);
+		corpus += "  <record id=\"" + id + "\" type='item'>\n";
+		corpus += "    <name>Record " + id + "</name>\n";
+		corpus += "    <price currency=\"EUR\">" + std::to_string(i % 1000) + ".99</price>\n";
+		if (i % 7 == 0) corpus += "    <!-- <record> kept for reference -->\n";
+		corpus += "    <description><![CDATA[<b>bold</b> & " + id + "]]></description>\n";
+		corpus += "    <tags><tag>a</tag><tag>b</tag><tag value=\"c\"/></tags>\n";
+		corpus += "  </record>\n";
+	}
+	corpus += "</catalog>\n";
+
+	printf("%zu MB, %u hardware threads\n", corpus.length() >> 20, std::thread::hardware_concurrency());
+	printf("%8s %12s %12s %10s\n", "threads", "ms", "MB/s", "speedup");
+
+	size_t serialElements = 0, serialAttributes = 0;
+	double serial = 0;
+	TBXML document;
+
+	for (size_t t=0; t < sizeof(threadCounts)/sizeof(threadCounts[0]); t++) {
+		document.setParseThreadCount(threadCounts[t]);
+
+		double best = 0;
+		for (int round=0; round < 3; round++) {
+			// parsing rewrites the bytes, every round starts from a fresh copy
+			std::string xml = corpus;
+			std::string error;
+
+			auto start = std::chrono::steady_clock::now();
+			if (!document.initWithXMLString(xml, error)) {
+				fprintf(stderr, "parse failed: %s\n", error.c_str());
+				return 1;
+			}
+			auto end = std::chrono::steady_clock::now();
+
+			double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+			if (!round || milliseconds < best) best = milliseconds;
+		}
+
+		size_t elements = 0, attributes = 0;
+		count(document.rootXMLElement, elements, attributes);
+		if (t == 0) {
+			serialElements = elements;
+			serialAttributes = attributes;
+			serial = best;
+		} else if (elements != serialElements || attributes != serialAttributes) {
+			fprintf(stderr, "%zu threads: %zu elements, %zu attributes, serial parse found %zu, %zu\n", threadCounts[t], elements, attributes, serialElements, serialAttributes);
+			return 1;
+		}
+
+		printf("%8zu %12.1f %12.1f %9.2fx\n", threadCounts[t], best, (double)corpus.length() / 1048576.0 / (best / 1000.0), serial / best);
+	}
+	return 0;
+}
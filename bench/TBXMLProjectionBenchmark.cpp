@@ -0,0 +1,118 @@
+// ================================================================================================
+//  TBXMLProjectionBenchmark.cpp
+//  Full parses against parses projected onto a few paths
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses a generated feed of entries whole, projected onto the ids and timestamps of its entries
+//  (/feed/entry/id and /feed/entry/@updated) and projected onto its title alone, and prints the
+//  time, throughput and number of elements built of each.
+//
+//  c++ -O2 -std=c++17 -I../TBXML TBXMLProjectionBenchmark.cpp ../TBXML/*.cpp -o projection
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLProjection.h"
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+#define ROUNDS 5
+
+static double millisecondsSince(std::chrono::steady_clock::time_point aStart) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+static size_t countElements(const TBXMLElement* aXMLElement) {
+	size_t count = 0;
+	for (; aXMLElement; aXMLElement = aXMLElement->nextSibling) count += 1 + countElements(aXMLElement->firstChild);
+	return count;
+}
+
+// the best of ROUNDS parses of aXML into aXMLDocument, which holds the last one afterwards
+static double parse(TBXML &aXMLDocument, const std::string &aXML) {
+	double best = 0;
+	for (int round=0; round < ROUNDS; round++) {
+		std::string xml = aXML, error;
+		auto start = std::chrono::steady_clock::now();
+		if (!aXMLDocument.initWithXMLString(xml, error)) {
+			fprintf(stderr, "parse failed: %s\n", error.c_str());
+			return 0;
+		}
+		double milliseconds = millisecondsSince(start);
+		if (round == 0 || milliseconds < best) best = milliseconds;
+	}
+	return best;
+}
+
+int main() {
+	static const size_t counts[] = { 10000, 100000 };
+
+	std::string error;
+	TBXMLProjection entries, title;
+	if (!entries.addPath("/feed/entry/id", error) || !entries.addPath("/feed/entry/@updated", error) || !title.addPath("/feed/title", error)) {
+		fprintf(stderr, "projection failed: %s\n", error.c_str());
+		return 1;
+	}
+	static const struct { const char* name; const TBXMLProjection* projection; } parses[] = {
+		{ "full", NULL }, { "entry ids", &entries }, { "title", &title }
+	};
+
+	printf("%10s %8s %12s %12s %12s %10s %8s\n", "entries", "MB", "parse", "ms", "MB/s", "elements", "speedup");
+
+	for (size_t c=0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+		std::string xml = "<feed xmlns=\"http://www.w3.org/2005/Atom\"><title>Benchmark</title>";
+		for (size_t i=0; i < counts[c]; i++) {
+			std::string n = std::to_string(i);
+			xml += "<entry updated=\"2024-10-" + std::to_string(1 + i % 28) + "T12:00:00Z\"><id>urn:entry:" + n + "</id>";
+			xml += "<title type=\"text\">Entry " + n + "</title><author><name>Author " + std::to_string(i % 97) + "</name><uri>https://example.com/a/" + std::to_string(i % 97) + "</uri></author>";
+			xml += "<link rel=\"alternate\" href=\"https://example.com/e/" + n + "\"/><category term=\"c" + std::to_string(i % 13) + "\"/>";
+			xml += "<summary>A short summary of entry " + n + " with a few words in it.</summary><content type=\"html\"><![CDATA[<p>";
+			for (int w=0; w < 30; w++) xml += "lorem ipsum ";
+			xml += "</p>]]></content></entry>\n";
+		}
+		xml += "</feed>";
+		double megabytes = (double)xml.length() / (1024*1024);
+
+		double fullMilliseconds = 0;
+		for (size_t p=0; p < sizeof(parses)/sizeof(parses[0]); p++) {
+			TBXML document;
+			document.setProjection(parses[p].projection);
+			double milliseconds = parse(document, xml);
+			if (!milliseconds) return 1;
+			if (p == 0) fullMilliseconds = milliseconds;
+
+			// the entries projection found every entry with its id and timestamp
+			if (parses[p].projection == &entries) {
+				size_t ids = 0;
+				for (const TBXMLElement * entry = TBXML::childElementNamed("entry", document.rootXMLElement); entry; entry = TBXML::nextSiblingNamed("entry", entry)) {
+					if (TBXML::childElementNamed("id", entry) && !TBXML::valueOfAttributeNamed("updated", entry).empty()) ids++;
+				}
+				if (ids != counts[c]) {
+					fprintf(stderr, "projection found %zu of %zu entries\n", ids, counts[c]);
+					return 1;
+				}
+			}
+
+			printf("%10zu %8.1f %12s %12.3f %12.1f %10zu %7.1fx\n", counts[c], megabytes, parses[p].name,
+				milliseconds, megabytes / (milliseconds / 1000), countElements(document.rootXMLElement), fullMilliseconds / milliseconds);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+// ================================================================================================
+//  TBXMLSnapshotBenchmark.cpp
+//  Loading a snapshot against parsing the document it was saved from
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses a generated document of n records into a TBXMLCompact, saves it as a snapshot, and prints
+//  the time to parse the document again against the time to load the snapshot, with and without
+//  verifying its checksum. Pass a directory for the files, /tmp by default.
+//
+//  c++ -O2 -std=c++17 -I../TBXML TBXMLSnapshotBenchmark.cpp ../TBXML/*.cpp -o snapshot
+// ================================================================================================
+#include "TBXMLCompact.h"
+#include <stdio.h>
+#include <chrono>
+#include <fstream>
+#include <string>
+
+static double millisecondsSince(std::chrono::steady_clock::time_point aStart) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+int main(int argc, char** argv) {
+	static const size_t counts[] = { 10000, 1000000 };
+	std::string directory = argc > 1 ? argv[1] : "/tmp";
+	std::string xmlFile = directory + "/tbxml_snapshot_benchmark.xml";
+	std::string snapshotFile = directory + "/tbxml_snapshot_benchmark.snapshot";
+
+	printf("%10s %12s %12s %12s %12s\n", "records", "MB", "parse ms", "load ms", "verify ms");
+
+	for (size_t c=0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+
+		{
+			std::ofstream xml(xmlFile.c_str(), std::ios::binary);
+			xml << "<catalog>";
+			for (size_t i=0; i < count; i++) {
+				xml << "<item id=\"" << i << "\" kind=\"k" << (i % 7) << "\"><name>Item " << i << "</name><price>" << (i % 1000) << ".99</price></item>";
+			}
+			xml << "</catalog>";
+		}
+
+		std::string error;
+		TBXMLCompact parsed;
+		auto start = std::chrono::steady_clock::now();
+		if (!parsed.initWithXMLFile(xmlFile, D_TBXML_LOAD_MMAP, error)) {
+			fprintf(stderr, "parse failed: %s\n", error.c_str());
+			return 1;
+		}
+		double parse = millisecondsSince(start);
+
+		if (!parsed.saveSnapshot(snapshotFile, error)) {
+			fprintf(stderr, "save failed: %s\n", error.c_str());
+			return 1;
+		}
+
+		// the snapshot was just written, so its pages are in the page cache as they would be for a
+		// process starting after another one loaded it
+		TBXMLCompact loaded;
+		start = std::chrono::steady_clock::now();
+		bool ok = loaded.initWithSnapshotFile(snapshotFile, error);
+		double load = millisecondsSince(start);
+
+		TBXMLCompact verified;
+		start = std::chrono::steady_clock::now();
+		ok = ok && verified.initWithSnapshotFile(snapshotFile, true, error);
+		double verify = millisecondsSince(start);
+
+		if (!ok || loaded.elementCount() != parsed.elementCount()) {
+			fprintf(stderr, "load failed: %s\n", error.c_str());
+			return 1;
+		}
+
+		std::ifstream size(xmlFile.c_str(), std::ios::binary|std::ios::ate);
+		printf("%10zu %12.1f %12.3f %12.3f %12.3f\n", count, (double)size.tellg() / (1024*1024), parse, load, verify);
+	}
+
+	remove(xmlFile.c_str());
+	remove(snapshotFile.c_str());
+	return 0;
+}
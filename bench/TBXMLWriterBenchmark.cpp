@@ -0,0 +1,123 @@
+// ================================================================================================
+//  TBXMLWriterBenchmark.cpp
+//  TBXMLWriter against escaping into a std::string one character at a time
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Writes a parsed document of n records back to a string, first escaping text and values one
+//  character at a time into a std::string, then with TBXMLWriter, and prints the output rate.
+//
+//  c++ -O2 -std=c++17 -I../TBXML TBXMLWriterBenchmark.cpp ../TBXML/*.cpp -o writer
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLWriter.h"
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+static void appendEscaped(std::string &aOutput, const char* aValue, size_t aLength, bool aQuote) {
+	for (size_t i=0; i < aLength; i++) {
+		switch (aValue[i]) {
+			case '&': aOutput += "&amp;"; break;
+			case '<': aOutput += "&lt;"; break;
+			case '>': aOutput += "&gt;"; break;
+			case '"': if (aQuote) aOutput += "&quot;"; else aOutput += '"'; break;
+			default: aOutput += aValue[i]; break;
+		}
+	}
+}
+
+static void appendElement(std::string &aOutput, const TBXMLElement* aXMLElement) {
+	for (; aXMLElement; aXMLElement = aXMLElement->nextSibling) {
+		aOutput += '<';
+		aOutput.append(aXMLElement->name, aXMLElement->nameLength);
+		for (const TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+			aOutput += ' ';
+			aOutput.append(xmlAttribute->name, xmlAttribute->nameLength);
+			aOutput += "=\"";
+			appendEscaped(aOutput, xmlAttribute->value, xmlAttribute->valueLength, true);
+			aOutput += '"';
+		}
+		aOutput += '>';
+		if (aXMLElement->text) appendEscaped(aOutput, aXMLElement->text, aXMLElement->textLength, false);
+		appendElement(aOutput, aXMLElement->firstChild);
+		aOutput += "</";
+		aOutput.append(aXMLElement->name, aXMLElement->nameLength);
+		aOutput += '>';
+	}
+}
+
+static double megabytesPerSecond(TBXML &aDocument, size_t aRounds, bool aWriter) {
+	TBXMLWriter writer;
+	std::string output;
+	size_t bytes = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t round=0; round < aRounds; round++) {
+		output.clear();
+		if (aWriter) {
+			writer.initWithString(&output);
+			writer.element(aDocument.rootXMLElement);
+			writer.finish();
+		} else {
+			appendElement(output, aDocument.rootXMLElement);
+		}
+		bytes += output.size();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	return (double)bytes / std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+int main() {
+	static const size_t counts[] = { 1000, 100000 };
+
+	printf("%10s %14s %14s\n", "records", "string MB/s", "writer MB/s");
+
+	for (size_t c=0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+
+		// <records><record id="r17" title="...">...</record>...</records>, mostly prose with an
+		// occasional character to escape
+		std::string xml = "<records>";
+		for (size_t i=0; i < count; i++) {
+			xml += "<record id=\"r" + std::to_string(i) + "\" title=\"Record number " + std::to_string(i) + " of the benchmark\">";
+			xml += "<name>A name long enough to be worth scanning in blocks</name>";
+			xml += "<body>Some body text for record " + std::to_string(i) + ((i % 16) ? "" : " &amp; a reference") + ", written back out</body>";
+			xml += "</record>";
+		}
+		xml += "</records>";
+
+		std::string error;
+		TBXML document;
+		document.setEntityMode(D_TBXML_ENTITIES_EAGER);
+		if (!document.initWithXMLString(xml, error)) {
+			fprintf(stderr, "parse failed: %s\n", error.c_str());
+			return 1;
+		}
+
+		size_t rounds = 2000000 / count + 1;
+		double appended = megabytesPerSecond(document, rounds, false);
+		double written = megabytesPerSecond(document, rounds, true);
+
+		printf("%10zu %14.1f %14.1f\n", count, appended, written);
+	}
+	return 0;
+}
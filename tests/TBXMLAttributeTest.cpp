@@ -0,0 +1,153 @@
+// ================================================================================================
+//  TBXMLAttributeTest.cpp
+//  Contiguous attributes of TBXML elements and the lookups over them
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Checks that the attributes of every element are contiguous from firstAttribute with attributeCount
+//  of them, and linked through next in the same order, and that the lookups by string, std::string and
+//  TBXMLName find the first attribute of a name as a walk of the links does. Documents are parsed fresh,
+//  into the too small buffers of a previous document so the attributes of an element move to the next
+//  buffer, with several threads, lazily and with a symbol table.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLAttributeTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o attribute
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLSymbolTable.h"
+#include "TBXMLTest.h"
+
+static const char* documents[] = {
+	"<r/>",
+	"<r a='1'/>",
+	"<r a='1' b=\"2\" c=''><x a='3'/><y/><z b='4' a='5'>t</z></r>",
+	"<r x='1' x='2' y='3' x='4'/>",
+	"<r a='&lt;&amp;' b='<![CDATA[<x/>]]>'><x a='1'  b  =  '2'\n\tc='3'/></r>",
+};
+
+/** Elements with 0 to 36 attributes, and now and then one with hundreds, so elements straddle the
+    ends of attribute buffers.
+ */
+static std::string attributeDocument(size_t aBytes) {
+	std::string xml = "<r>";
+	for (size_t i=0; xml.size() < aBytes; i++) {
+		size_t count = i % 97 == 50 ? 300 + i % 200 : i % 37;
+		xml += "<e";
+		for (size_t j=0; j < count; j++) xml += " a" + std::to_string(j) + "='" + std::to_string(i*j) + "'";
+		xml += i % 3 ? "/>" : "><c k='v'/></e>";
+	}
+	return xml + "</r>";
+}
+
+// the attribute named aName found by following the links
+static const TBXMLAttribute* linkedAttribute(const TBXMLElement* aXMLElement, std::string_view aName) {
+	for (const TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) {
+		if (TBXML::attributeName(xmlAttribute) == aName) return xmlAttribute;
+	}
+	return NULL;
+}
+
+static void checkElement(const TBXMLElement* aXMLElement, const TBXMLSymbolTable* aSymbols, const std::string &aLabel) {
+	const TBXMLAttribute * linked = aXMLElement->firstAttribute;
+	for (uint32_t i=0; i < aXMLElement->attributeCount; i++) {
+		if (!TBXML_CHECK(linked == aXMLElement->firstAttribute + i, aLabel + " attribute " + std::to_string(i))) return;
+		linked = linked->next;
+	}
+	TBXML_CHECK(linked == NULL, aLabel + " links past the count");
+	if (!aXMLElement->attributeCount) TBXML_CHECK(aXMLElement->firstAttribute == NULL, aLabel + " no attributes");
+
+	for (uint32_t i=0; i < aXMLElement->attributeCount; i++) {
+		const TBXMLAttribute * xmlAttribute = aXMLElement->firstAttribute + i;
+		std::string_view name = TBXML::attributeName(xmlAttribute);
+		const TBXMLAttribute * expected = linkedAttribute(aXMLElement, name);
+		std::string_view value = TBXML::attributeValue(expected);
+		std::string label = aLabel + " " + std::string(name);
+
+		TBXML_CHECK(TBXML::valueOfAttributeNamed(name, aXMLElement) == value, label);
+		std::string nameString(name);
+		TBXML_CHECK(TBXML::valueOfAttributeNamed(nameString, (TBXMLElement*)aXMLElement) == value, label + " std::string");
+		TBXMLName bytes = { TBXML_NAME_NONE, name.data(), name.length() };
+		TBXML_CHECK(TBXML::valueOfAttributeNamed(bytes, aXMLElement) == value, label + " TBXMLName bytes");
+		if (aSymbols) TBXML_CHECK(TBXML::valueOfAttributeNamed(aSymbols->name(name), aXMLElement) == value, label + " TBXMLName id");
+	}
+
+	std::string missing = "missing";
+	std::string error;
+	TBXML_CHECK(TBXML::valueOfAttributeNamed(std::string_view("missing"), aXMLElement).empty(), aLabel + " missing");
+	TBXML::valueOfAttributeNamed(missing, (TBXMLElement*)aXMLElement, error);
+	TBXML_CHECK(error == "Attribute not found", aLabel + " missing " + error);
+}
+
+static void checkDocument(const TBXML &aDocument, const std::string &aExpected, const TBXMLSymbolTable* aSymbols, const std::string &aLabel) {
+	if (!TBXML_CHECK(tbxmlDumpDocument(aDocument) == aExpected, aLabel + " tree")) return;
+	size_t elements = 0;
+	for (const TBXMLElement * xmlElement : aDocument.elements()) {
+		checkElement(xmlElement, aSymbols, aLabel + " element " + std::to_string(elements));
+		elements++;
+	}
+	TBXML_CHECK(elements > 0, aLabel + " elements");
+}
+
+static void check(const std::string &aXML, const std::string &aLabel) {
+	TBXML fresh;
+	std::string expected = tbxmlParseAndDump(fresh, aXML);
+	if (!TBXML_CHECK(expected.compare(0, 7, "error: ") != 0, aLabel + " " + expected)) return;
+	checkDocument(fresh, expected, NULL, aLabel);
+
+	// a small document first leaves buffers the attributes outgrow
+	TBXML reused;
+	tbxmlParseAndDump(reused, "<r a='1' b='2'/>");
+	TBXML_CHECK(tbxmlParseAndDump(reused, aXML) == expected, aLabel + " reused");
+	checkDocument(reused, expected, NULL, aLabel + " reused");
+
+	TBXML parallel;
+	parallel.setParseThreadCount(4);
+	TBXML_CHECK(tbxmlParseAndDump(parallel, aXML) == expected, aLabel + " 4 threads");
+	checkDocument(parallel, expected, NULL, aLabel + " 4 threads");
+
+	TBXML lazy;
+	lazy.setLazyDepth(2);
+	std::string xml = aXML;
+	std::string error;
+	if (TBXML_CHECK(lazy.initWithXMLString(xml, error) && lazy.expandAll(error), aLabel + " lazy " + error))
+		checkDocument(lazy, expected, NULL, aLabel + " lazy");
+
+	TBXMLSymbolTable symbols;
+	TBXML interned;
+	interned.setSymbolTable(&symbols);
+	TBXML_CHECK(tbxmlParseAndDump(interned, aXML) == expected, aLabel + " symbols");
+	checkDocument(interned, expected, &symbols, aLabel + " symbols");
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], "document " + std::to_string(i));
+
+	// the first of several attributes of a name is found
+	TBXML duplicates;
+	tbxmlParseAndDump(duplicates, documents[3]);
+	TBXML_CHECK(duplicates.rootXMLElement && TBXML::valueOfAttributeNamed(std::string_view("x"), duplicates.rootXMLElement) == "1", "duplicates");
+
+	check(attributeDocument(64*1024), "attributes");
+	check(attributeDocument(3*TBXML_PARALLEL_MIN_BYTES), "large attributes");
+	check(TBXMLCorpus::generate(D_TBXML_CORPUS_ATTRIBUTES, 3*TBXML_PARALLEL_MIN_BYTES, 23), "corpus attributes");
+	check(TBXMLCorpus::generate(D_TBXML_CORPUS_FEED, 3*TBXML_PARALLEL_MIN_BYTES, 23), "corpus feed");
+
+	return tbxmlTestResult("attribute");
+}
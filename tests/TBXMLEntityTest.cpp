@@ -0,0 +1,199 @@
+// ================================================================================================
+//  TBXMLEntityTest.cpp
+//  Character and entity references decoded eagerly and lazily
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Decodes the predefined entities, decimal and hex character references and malformed references,
+//  which are kept as they are, in text and attribute values, eagerly while parsing and lazily on first
+//  use, from several threads at once for a lazy document. Corpus documents decoded lazily must give the
+//  tree of the eager parse.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLEntityTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o entity
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+#include <thread>
+#include <vector>
+
+typedef struct _TBXMLReferenceCase {
+	const char * written;
+	const char * decoded;
+} TBXMLReferenceCase;
+
+static const TBXMLReferenceCase cases[] = {
+	// predefined entities
+	{"&lt;&gt;&amp;&quot;&apos;",		"<>&\"'"},
+	{"a &lt;b&gt; c",					"a <b> c"},
+	{"&amp;lt;",						"&lt;"},
+
+	// character references, written as UTF-8
+	{"&#65;&#x42;&#x4a;",				"ABJ"},
+	{"&#233;&#x20AC;",					"\xC3\xA9\xE2\x82\xAC"},
+	{"&#x1F600;",						"\xF0\x9F\x98\x80"},
+	{"&#000065;",						"A"},
+
+	// malformed references are kept
+	{"&bogus;",							"&bogus;"},
+	{"&amp",							"&amp"},
+	{"a&b",								"a&b"},
+	{"&#;",								"&#;"},
+	{"&#x;",							"&#x;"},
+	{"&#xZZ;",							"&#xZZ;"},
+	{"&#X43;",							"&#X43;"},
+	{"&#65",							"&#65"},
+	{"&#1114112;",						"&#1114112;"},
+	{"&#xD800;",						"&#xD800;"},
+	{"&#99999999999999999999;",			"&#99999999999999999999;"},
+
+	// no character 0 in XML, the reference isn't decoded into a terminator
+	{"&#0;",							"&#0;"},
+	{"&#x0;",							"&#x0;"},
+	{"a&#0;b",							"a&#0;b"},
+};
+
+static std::string_view view(const char* aChars, size_t aLength) {
+	return aChars ? std::string_view(aChars, aLength) : std::string_view();
+}
+
+static void checkCase(const TBXMLReferenceCase &aCase, TBXMLEntityMode aEntityMode) {
+	std::string label = std::string(aEntityMode == D_TBXML_ENTITIES_EAGER ? "eager " : "lazy ") + aCase.written;
+	std::string xml = std::string("<r a='") + aCase.written + "' b=\"" + aCase.written + "\">" + aCase.written + "</r>", error;
+	TBXML document;
+	document.setEntityMode(aEntityMode);
+	if (!TBXML_CHECK(document.initWithXMLString(xml, error), label + " " + error)) return;
+
+	TBXMLElement * root = document.rootXMLElement;
+	TBXMLAttribute * attribute = root->firstAttribute;
+	if (aEntityMode == D_TBXML_ENTITIES_EAGER) {
+		// decoded in place while parsing
+		TBXML_CHECK(view(root->text, root->textLength) == aCase.decoded, label + " text");
+		TBXML_CHECK(view(attribute->value, attribute->valueLength) == aCase.decoded, label + " value");
+	} else {
+		// left as written until first used
+		TBXML_CHECK(view(root->text, root->textLength) == aCase.written, label + " text before");
+		TBXML_CHECK(view(attribute->value, attribute->valueLength) == aCase.written, label + " value before");
+	}
+
+	for (int pass=0; pass < 2; pass++) {
+		TBXML_CHECK(document.decodedText(root) == aCase.decoded, label + " decodedText");
+		TBXML_CHECK(document.decodedValue(attribute) == aCase.decoded, label + " decodedValue");
+		TBXML_CHECK(document.decodedValueOfAttributeNamed("b", root) == aCase.decoded, label + " decodedValueOfAttributeNamed");
+	}
+
+	// the fields see the decoded bytes once decoded
+	TBXML_CHECK(view(root->text, root->textLength) == aCase.decoded, label + " text after");
+	TBXML_CHECK(view(attribute->value, attribute->valueLength) == aCase.decoded, label + " value after");
+	TBXML_CHECK(TBXML::textForElement(root) == aCase.decoded, label + " textForElement");
+}
+
+/** References aren't decoded without an entity mode.
+ */
+static void checkNone() {
+	for (const TBXMLReferenceCase &referenceCase : cases) {
+		std::string xml = std::string("<r a='") + referenceCase.written + "'>" + referenceCase.written + "</r>", error;
+		TBXML document;
+		if (!TBXML_CHECK(document.initWithXMLString(xml, error), std::string("none ") + referenceCase.written)) continue;
+		TBXML_CHECK(document.decodedText(document.rootXMLElement) == referenceCase.written, std::string("none text ") + referenceCase.written);
+		TBXML_CHECK(document.decodedValue(document.rootXMLElement->firstAttribute) == referenceCase.written, std::string("none value ") + referenceCase.written);
+	}
+}
+
+/** CDATA sections are text as written, the references around them are decoded.
+ */
+static void checkCDATA(TBXMLEntityMode aEntityMode) {
+	static const TBXMLReferenceCase sections[] = {
+		{"&lt;<![CDATA[&lt;]]>&gt;",					"<&lt;>"},
+		{"x<![CDATA[&amp;]]>&amp;<![CDATA[]]>y",		"x&amp;&y"},
+		{"<![CDATA[&#65;]]>&#65;",						"&#65;A"},
+	};
+	for (const TBXMLReferenceCase &section : sections) {
+		std::string label = std::string(aEntityMode == D_TBXML_ENTITIES_EAGER ? "eager " : "lazy ") + section.written;
+		std::string xml = std::string("<r>") + section.written + "</r>", error;
+		TBXML document;
+		document.setEntityMode(aEntityMode);
+		if (!TBXML_CHECK(document.initWithXMLString(xml, error), label + " " + error)) continue;
+		TBXML_CHECK(document.decodedText(document.rootXMLElement) == section.decoded, label);
+	}
+}
+
+/** Threads decoding the elements of a lazy document at once get the text of the eager parse.
+ */
+static void checkThreads() {
+	std::string xml = "<r>";
+	for (int i=0; i < 2000; i++) xml += "<e v='&#" + std::to_string(65 + i % 26) + ";&amp;'>&lt;" + std::to_string(i) + "&gt;</e>";
+	xml += "</r>";
+
+	TBXML eager, lazy;
+	eager.setEntityMode(D_TBXML_ENTITIES_EAGER);
+	lazy.setEntityMode(D_TBXML_ENTITIES_LAZY);
+	std::string expected = tbxmlParseAndDump(eager, xml);
+	std::string parsed = tbxmlParseAndDump(lazy, xml);
+	if (!TBXML_CHECK(parsed.compare(0, 7, "error: ") != 0, "threads " + parsed)) return;
+
+	std::vector<std::thread> threads;
+	for (int i=0; i < 4; i++) {
+		threads.emplace_back([&lazy]() {
+			for (const TBXMLElement * xmlElement = lazy.rootXMLElement->firstChild; xmlElement; xmlElement = xmlElement->nextSibling) {
+				lazy.decodedText(xmlElement);
+				lazy.decodedValue(xmlElement->firstAttribute);
+			}
+		});
+	}
+	for (std::thread &thread : threads) thread.join();
+	TBXML_CHECK(tbxmlDumpDocument(lazy) == expected, "threads");
+}
+
+/** Every text and value of a corpus document decoded lazily gives the tree of the eager parse.
+ */
+static void checkCorpus(TBXMLCorpusShape aShape) {
+	std::string label = TBXMLCorpus::shapeName(aShape);
+	std::string xml = TBXMLCorpus::generate(aShape, 256*1024, 11);
+	TBXML eager, lazy;
+	eager.setEntityMode(D_TBXML_ENTITIES_EAGER);
+	lazy.setEntityMode(D_TBXML_ENTITIES_LAZY);
+	std::string expected = tbxmlParseAndDump(eager, xml);
+	std::string parsed = tbxmlParseAndDump(lazy, xml);
+	if (!TBXML_CHECK(parsed.compare(0, 7, "error: ") != 0, label + " " + parsed)) return;
+
+	std::vector<const TBXMLElement*> pending(1, lazy.rootXMLElement);
+	while (!pending.empty()) {
+		const TBXMLElement * xmlElement = pending.back();
+		pending.pop_back();
+		lazy.decodedText(xmlElement);
+		for (uint32_t i=0; i < xmlElement->attributeCount; i++) lazy.decodedValue(xmlElement->firstAttribute + i);
+		for (const TBXMLElement * child = xmlElement->firstChild; child; child = child->nextSibling) pending.push_back(child);
+	}
+	TBXML_CHECK(tbxmlDumpDocument(lazy) == expected, label);
+}
+
+int main() {
+	for (TBXMLEntityMode entityMode : {D_TBXML_ENTITIES_EAGER, D_TBXML_ENTITIES_LAZY}) {
+		for (const TBXMLReferenceCase &referenceCase : cases) checkCase(referenceCase, entityMode);
+		checkCDATA(entityMode);
+	}
+	checkNone();
+	checkThreads();
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) checkCorpus((TBXMLCorpusShape)shape);
+
+	return tbxmlTestResult("entity");
+}
@@ -0,0 +1,201 @@
+// ================================================================================================
+//  TBXMLIteratorTest.cpp
+//  Iterators and arena ranges over TBXML documents
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Compares what the child, attribute and descendant ranges and the arena ranges (elements,
+//  elementsNamed, descendantsNamed, forEachElementNamed) give with walks of the links: the same
+//  elements in document order. Documents are parsed fresh, into the buffers of a larger and a smaller
+//  document before them, with several threads so the elements are spread over the buffers of the
+//  parts, and lazily, before and after they are expanded.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLIteratorTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o iterator
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+
+static const char* documents[] = {
+	"<r/>",
+	"<r a='1' b='2'>text</r>",
+	"<r><a/><b></b><c>t</c></r>",
+	"<r a='1'><a b='2'><b c='3'><c>deep</c></b></a><a/><a>x<b/>y</a><b><a><a/></a></b></r>",
+	"<r><!-- <a> --><![CDATA[<b>]]><a><![CDATA[</a>]]></a><?pi <c>?></r>",
+};
+
+// elements of the sample the ranges below them are checked for, fewer in an expanded lazy document
+// where descendantsNamed checks the ancestors of every element it reads
+#define TBXML_TEST_SAMPLES 24
+#define TBXML_TEST_EXPANDED_SAMPLES 2
+
+typedef std::vector<const TBXMLElement*> TBXMLElementList;
+
+/** The elements below aXMLElement, and aXMLElement first when aInclusive, in document order following
+    the links.
+ */
+static TBXMLElementList linkedDescendants(const TBXMLElement* aXMLElement, bool aInclusive) {
+	TBXMLElementList list;
+	if (!aXMLElement) return list;
+	if (aInclusive) list.push_back(aXMLElement);
+
+	const TBXMLElement * xmlElement = aXMLElement->firstChild;
+	while (xmlElement) {
+		list.push_back(xmlElement);
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			continue;
+		}
+		while (xmlElement != aXMLElement && !xmlElement->nextSibling) xmlElement = xmlElement->parentElement;
+		xmlElement = xmlElement != aXMLElement ? xmlElement->nextSibling : NULL;
+	}
+	return list;
+}
+
+static TBXMLElementList named(const TBXMLElementList &aList, std::string_view aName) {
+	TBXMLElementList list;
+	for (const TBXMLElement * xmlElement : aList) {
+		if (std::string_view(xmlElement->name, xmlElement->nameLength) == aName) list.push_back(xmlElement);
+	}
+	return list;
+}
+
+template<typename Range> static TBXMLElementList listOf(const Range &aRange) {
+	return TBXMLElementList(aRange.begin(), aRange.end());
+}
+
+// the same elements in any order, for documents expanded after they were parsed
+static bool sameElements(TBXMLElementList aList, TBXMLElementList aOther) {
+	std::sort(aList.begin(), aList.end());
+	std::sort(aOther.begin(), aOther.end());
+	return aList == aOther;
+}
+
+static void checkLinks(const TBXMLElementList &aAll, const std::string &aLabel) {
+	for (const TBXMLElement * xmlElement : aAll) {
+		TBXMLElementList children;
+		for (const TBXMLElement * child = xmlElement->firstChild; child; child = child->nextSibling) children.push_back(child);
+		if (!TBXML_CHECK(listOf(TBXML::children(xmlElement)) == children, aLabel + " children")) return;
+
+		std::vector<const TBXMLAttribute*> attributes;
+		for (const TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute; xmlAttribute; xmlAttribute = xmlAttribute->next) attributes.push_back(xmlAttribute);
+		std::vector<const TBXMLAttribute*> ranged;
+		for (const TBXMLAttribute &xmlAttribute : TBXML::attributes(xmlElement)) ranged.push_back(&xmlAttribute);
+		if (!TBXML_CHECK(ranged == attributes, aLabel + " attributes")) return;
+	}
+}
+
+/** Checks the ranges of aDocument against the links. aDocumentOrder is false for a lazy document
+    expanded after it was parsed, whose arena holds the same elements in another order.
+ */
+static void checkDocument(const TBXML &aDocument, bool aDocumentOrder, const std::string &aLabel) {
+	TBXMLElementList all = linkedDescendants(aDocument.rootXMLElement, true);
+	auto matches = [&](const TBXMLElementList &aList, const TBXMLElementList &aExpected) {
+		return aDocumentOrder ? aList == aExpected : sameElements(aList, aExpected);
+	};
+
+	checkLinks(all, aLabel);
+	TBXML_CHECK(matches(listOf(aDocument.elements()), all), aLabel + " elements");
+	TBXMLArenaRange elements = aDocument.elements();
+	TBXML_CHECK((size_t)std::distance(elements.begin(), elements.end()) == all.size(), aLabel + " distance");
+
+	// the first names of the document and one that is in no document
+	std::set<std::string> names = { "missing" };
+	for (size_t i=0; i < all.size() && names.size() < 8; i++) names.insert(std::string(all[i]->name, all[i]->nameLength));
+
+	for (const std::string &name : names) {
+		TBXMLElementList expected = named(all, name);
+		TBXML_CHECK(matches(listOf(aDocument.elementsNamed(name)), expected), aLabel + " elementsNamed " + name);
+
+		TBXMLName bytes = { TBXML_NAME_NONE, name.data(), name.length() };
+		TBXML_CHECK(matches(listOf(aDocument.elementsNamed(bytes)), expected), aLabel + " elementsNamed TBXMLName " + name);
+
+		TBXMLElementList visited;
+		aDocument.forEachElementNamed(name, [&](const TBXMLElement* aXMLElement) { visited.push_back(aXMLElement); });
+		TBXML_CHECK(matches(visited, expected), aLabel + " forEachElementNamed " + name);
+	}
+
+	// the root, the last element and others spread over the document
+	size_t sampleCount = aDocumentOrder ? TBXML_TEST_SAMPLES : TBXML_TEST_EXPANDED_SAMPLES;
+	std::set<const TBXMLElement*> samples;
+	for (size_t i=0; i < sampleCount && !all.empty(); i++) samples.insert(all[(all.size()-1) * i / (sampleCount-1)]);
+
+	for (const TBXMLElement * sample : samples) {
+		TBXMLElementList below = linkedDescendants(sample, false);
+		std::string sampleLabel = aLabel + " below " + std::string(sample->name, sample->nameLength);
+		TBXML_CHECK(listOf(TBXML::descendants(sample)) == below, sampleLabel + " descendants");
+
+		// its own name, which nested elements repeat, that of its first child and one that is missing
+		std::vector<std::string> belowNames = { std::string(sample->name, sample->nameLength), "missing" };
+		if (sample->firstChild) belowNames.push_back(std::string(sample->firstChild->name, sample->firstChild->nameLength));
+		for (const std::string &name : belowNames) {
+			TBXML_CHECK(matches(listOf(aDocument.descendantsNamed(name, sample)), named(below, name)), sampleLabel + " descendantsNamed " + name);
+		}
+	}
+}
+
+static void check(const std::string &aXML, const std::string &aLarger, const std::string &aLabel) {
+	TBXML fresh;
+	std::string expected = tbxmlParseAndDump(fresh, aXML);
+	if (!TBXML_CHECK(expected.compare(0, 7, "error: ") != 0, aLabel + " " + expected)) return;
+	checkDocument(fresh, true, aLabel);
+
+	// the buffers of a larger document hold elements past the end of this one, those of a smaller one
+	// are outgrown
+	TBXML reused;
+	tbxmlParseAndDump(reused, aLarger);
+	TBXML_CHECK(tbxmlParseAndDump(reused, aXML) == expected, aLabel + " after larger");
+	checkDocument(reused, true, aLabel + " after larger");
+	tbxmlParseAndDump(reused, "<r><a/></r>");
+	TBXML_CHECK(tbxmlParseAndDump(reused, aXML) == expected, aLabel + " after smaller");
+	checkDocument(reused, true, aLabel + " after smaller");
+
+	TBXML parallel;
+	parallel.setParseThreadCount(4);
+	TBXML_CHECK(tbxmlParseAndDump(parallel, aXML) == expected, aLabel + " 4 threads");
+	checkDocument(parallel, true, aLabel + " 4 threads");
+
+	// the elements not built yet are not in any range
+	TBXML lazy;
+	lazy.setLazyDepth(2);
+	std::string xml = aXML;
+	std::string error;
+	if (!TBXML_CHECK(lazy.initWithXMLString(xml, error), aLabel + " lazy " + error)) return;
+	checkDocument(lazy, true, aLabel + " lazy");
+	if (!TBXML_CHECK(lazy.expandAll(error), aLabel + " lazy " + error)) return;
+	TBXML_CHECK(tbxmlDumpDocument(lazy) == expected, aLabel + " expanded");
+	checkDocument(lazy, false, aLabel + " expanded");
+}
+
+int main() {
+	std::string larger = TBXMLCorpus::generate(D_TBXML_CORPUS_FEED, 256*1024, 29);
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], larger, "document " + std::to_string(i));
+
+	larger = TBXMLCorpus::generate(D_TBXML_CORPUS_WIDE, 4*TBXML_PARALLEL_MIN_BYTES, 29);
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		check(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 3*TBXML_PARALLEL_MIN_BYTES, 29), larger, TBXMLCorpus::shapeName((TBXMLCorpusShape)shape));
+	}
+
+	return tbxmlTestResult("iterator");
+}
@@ -0,0 +1,101 @@
+// ================================================================================================
+//  TBXMLLazyTest.cpp
+//  Trees of lazy parses, once expanded, against those of eager ones
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses corpus documents and a few small ones lazily at depths 1 to 3, expands them with expandAll
+//  or by walking them through firstChild, and checks the trees against the eager parse, in each entity
+//  mode and namespace aware.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLLazyTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o lazy
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+#include <vector>
+
+static const char* documents[] = {
+	"<r/>",
+	"<r>text</r>",
+	"<r><a/><b></b><c>t</c></r>",
+	"<r a='1'><a b='2'><b c='3'><c>deep</c></b></a><a/><a>x<b/>y</a></r>",
+	"<r><!-- <a> --><![CDATA[<b>]]><a><![CDATA[</a>]]></a><?pi <c>?></r>",
+	"<r xmlns='urn:r' xmlns:p='urn:p'><p:a p:x='1'><b xmlns='urn:b'><p:c/></b></p:a></r>",
+	"<r><a>&lt;&amp;&#x41;</a><a t='&quot;&apos;'/></r>",
+};
+
+/** Visits every element of aDocument through firstChild, which expands them one at a time.
+ */
+static void walk(TBXML &aDocument) {
+	std::vector<const TBXMLElement*> pending;
+	if (aDocument.rootXMLElement) pending.push_back(aDocument.rootXMLElement);
+
+	while (!pending.empty()) {
+		const TBXMLElement * xmlElement = pending.back();
+		pending.pop_back();
+		for (const TBXMLElement * child = aDocument.firstChild(xmlElement); child; child = child->nextSibling) pending.push_back(child);
+	}
+}
+
+static void check(const std::string &aXML, const std::string &aLabel) {
+	for (int entityMode=D_TBXML_ENTITIES_NONE; entityMode <= D_TBXML_ENTITIES_EAGER; entityMode++) {
+		for (int namespaceAware=0; namespaceAware < 2; namespaceAware++) {
+			TBXML eager;
+			eager.setEntityMode((TBXMLEntityMode)entityMode);
+			eager.setNamespaceAware(namespaceAware);
+			std::string expected = tbxmlParseAndDump(eager, aXML);
+			std::string modeLabel = aLabel + (entityMode == D_TBXML_ENTITIES_EAGER ? " eager" : " none") + (namespaceAware ? " namespaces" : "");
+
+			for (size_t depth=1; depth <= 3; depth++) {
+				std::string depthLabel = modeLabel + " depth " + std::to_string(depth);
+
+				TBXML lazy;
+				lazy.setEntityMode((TBXMLEntityMode)entityMode);
+				lazy.setNamespaceAware(namespaceAware);
+				lazy.setLazyDepth(depth);
+				std::string xml = aXML;
+				std::string error;
+				if (!TBXML_CHECK(lazy.initWithXMLString(xml, error), depthLabel)) continue;
+				TBXML_CHECK(lazy.expandAll(error), depthLabel + " " + error);
+				TBXML_CHECK(tbxmlDumpDocument(lazy) == expected, depthLabel + " expandAll");
+
+				TBXML walked;
+				walked.setEntityMode((TBXMLEntityMode)entityMode);
+				walked.setNamespaceAware(namespaceAware);
+				walked.setLazyDepth(depth);
+				xml = aXML;
+				if (!TBXML_CHECK(walked.initWithXMLString(xml, error), depthLabel)) continue;
+				walk(walked);
+				TBXML_CHECK(tbxmlDumpDocument(walked) == expected, depthLabel + " firstChild");
+			}
+		}
+	}
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], "document " + std::to_string(i));
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		check(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 256*1024, 11), TBXMLCorpus::shapeName((TBXMLCorpusShape)shape));
+	}
+
+	return tbxmlTestResult("lazy");
+}
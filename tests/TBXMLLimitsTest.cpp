@@ -0,0 +1,171 @@
+// ================================================================================================
+//  TBXMLLimitsTest.cpp
+//  Parse limits and unterminated markup reported by TBXML
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Measures documents of the corpus, then parses them serially and with several threads with each
+//  limit set to what the document needs, which must parse to the same tree, and to one less, which
+//  must fail with the D_TBXML_LIMIT_* error and leave no tree. Documents ending inside a comment,
+//  CDATA section or tag must fail too.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLLimitsTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o limits
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+
+static const size_t threadCounts[] = {1, 4};
+
+static const char* unterminated[] = {
+	"<r><!-- open",
+	"<r><!-- open -",
+	"<r><![CDATA[ open",
+	"<r><![CDATA[ open ]]",
+	"<r><a",
+	"<r><a b='1'",
+	"<r><a b='1",
+	"<r></r",
+	"<r><?pi open",
+};
+
+// what a document needs of each limit
+typedef struct _TBXMLTestNeeds {
+	size_t bytes;
+	size_t depth;
+	size_t elements;
+	size_t attributes;
+	size_t nameLength;
+	size_t valueLength;
+} TBXMLTestNeeds;
+
+/** Walks the tree of aDocument, parsed without decoding entities so the values are as long as written.
+ */
+static TBXMLTestNeeds measure(const TBXML &aDocument) {
+	TBXMLTestNeeds needs = {};
+	const TBXMLElement * xmlElement = aDocument.rootXMLElement;
+	size_t depth = 1;
+
+	while (xmlElement) {
+		needs.elements++;
+		if (depth > needs.depth) needs.depth = depth;
+		if (xmlElement->attributeCount > needs.attributes) needs.attributes = xmlElement->attributeCount;
+		if (xmlElement->nameLength > needs.nameLength) needs.nameLength = xmlElement->nameLength;
+		for (uint32_t i=0; i < xmlElement->attributeCount; i++) {
+			const TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute + i;
+			if (xmlAttribute->nameLength > needs.nameLength) needs.nameLength = xmlAttribute->nameLength;
+			if (xmlAttribute->valueLength > needs.valueLength) needs.valueLength = xmlAttribute->valueLength;
+		}
+
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			depth++;
+			continue;
+		}
+		while (xmlElement && !xmlElement->nextSibling) {
+			xmlElement = xmlElement->parentElement;
+			depth--;
+		}
+		if (xmlElement) xmlElement = xmlElement->nextSibling;
+	}
+	return needs;
+}
+
+/** Parses aXML with aLimits and returns the dump of the tree, or "error: " and the message; checks a
+    failed parse left no tree.
+ */
+static std::string parseWithLimits(TBXML &aDocument, const std::string &aXML, const TBXMLLimits &aLimits, const std::string &aLabel) {
+	aDocument.setLimits(aLimits);
+	std::string dump = tbxmlParseAndDump(aDocument, aXML);
+	if (dump.compare(0, 7, "error: ") == 0) TBXML_CHECK(aDocument.rootXMLElement == NULL, aLabel + " tree left");
+	return dump;
+}
+
+/** Checks the limit at aField against aNeeded: enough parses to aExpected, one less fails with aError.
+    A limit of 0 is no limit, so a document needing 1 can't be made to fail.
+ */
+static void checkLimit(TBXML &aDocument, const std::string &aXML, size_t TBXMLLimits::*aField, size_t aNeeded, const char* aError, const std::string &aExpected, const std::string &aLabel) {
+	TBXMLLimits limits = {};
+	limits.*aField = aNeeded;
+	TBXML_CHECK(parseWithLimits(aDocument, aXML, limits, aLabel) == aExpected, aLabel + " at the limit");
+
+	if (aNeeded < 2) return;
+	limits.*aField = aNeeded - 1;
+	TBXML_CHECK(parseWithLimits(aDocument, aXML, limits, aLabel) == std::string("error: ") + aError, aLabel + " over the limit");
+}
+
+static void checkLimits(const std::string &aXML, const std::string &aLabel) {
+	TBXML serial;
+	std::string expected = tbxmlParseAndDump(serial, aXML);
+	if (!TBXML_CHECK(expected.compare(0, 7, "error: ") != 0, aLabel)) return;
+	TBXMLTestNeeds needs = measure(serial);
+	needs.bytes = aXML.size();
+
+	for (size_t threadCount : threadCounts) {
+		TBXML document;
+		document.setParseThreadCount(threadCount);
+		std::string label = aLabel + " " + std::to_string(threadCount) + " threads";
+
+		checkLimit(document, aXML, &TBXMLLimits::maxBytes, needs.bytes, "Document exceeds the byte limit", expected, label + " bytes");
+		checkLimit(document, aXML, &TBXMLLimits::maxDepth, needs.depth, "Element exceeds the depth limit", expected, label + " depth");
+		checkLimit(document, aXML, &TBXMLLimits::maxElements, needs.elements, "Document exceeds the element limit", expected, label + " elements");
+		checkLimit(document, aXML, &TBXMLLimits::maxAttributes, needs.attributes, "Element exceeds the attribute limit", expected, label + " attributes");
+		checkLimit(document, aXML, &TBXMLLimits::maxNameLength, needs.nameLength, "Name exceeds the length limit", expected, label + " name length");
+		checkLimit(document, aXML, &TBXMLLimits::maxValueLength, needs.valueLength, "Value exceeds the length limit", expected, label + " value length");
+
+		// the buffers needed depend on how they grow, so only far too little is checked
+		TBXMLLimits limits = {};
+		limits.maxBufferBytes = 4096;
+		TBXML_CHECK(parseWithLimits(document, aXML, limits, label) == "error: Document exceeds the memory limit", label + " memory");
+
+		// nothing is left over from the failed parses
+		TBXML_CHECK(parseWithLimits(document, aXML, TBXMLLimits(), label) == expected, label + " unlimited");
+	}
+}
+
+static void checkUnterminated(const std::string &aXML, const std::string &aLabel) {
+	for (size_t threadCount : threadCounts) {
+		TBXML document;
+		document.setParseThreadCount(threadCount);
+		TBXML_CHECK(tbxmlParseAndDump(document, aXML) == "error: Comment, cdata section or tag not terminated", aLabel + " " + std::to_string(threadCount) + " threads");
+		TBXML_CHECK(document.rootXMLElement == NULL, aLabel + " tree left");
+	}
+}
+
+int main() {
+	checkLimits("<r/>", "single element");
+	checkLimits("<r a='1' bb='22'><a b='&amp;&amp;'><b/></a><ccc>text</ccc></r>", "small document");
+
+	// large enough for the parallel parse to use all threads
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		checkLimits(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 4*TBXML_PARALLEL_MIN_BYTES, 13), TBXMLCorpus::shapeName((TBXMLCorpusShape)shape));
+	}
+
+	for (size_t i=0; i < sizeof(unterminated)/sizeof(unterminated[0]); i++) checkUnterminated(unterminated[i], unterminated[i]);
+
+	// the end of a large document, left to the last part of a parallel parse
+	std::string xml = TBXMLCorpus::generate(D_TBXML_CORPUS_FEED, 4*TBXML_PARALLEL_MIN_BYTES, 13);
+	std::string open = xml.substr(0, xml.rfind('<'));
+	checkUnterminated(open + "<!-- open", "large document comment");
+	checkUnterminated(open + "<![CDATA[ open", "large document cdata section");
+	checkUnterminated(open + "<item", "large document tag");
+
+	return tbxmlTestResult("limits");
+}
@@ -0,0 +1,174 @@
+// ================================================================================================
+//  TBXMLNamespaceTest.cpp
+//  Namespaces resolved by namespace aware TBXML documents
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Checks the namespace of every element and attribute against what the declarations in scope
+//  give: prefixes, the default namespace and its undeclaration, redeclared prefixes, the xml prefix
+//  and undeclared prefixes, which get none. Documents parsed without namespaces must keep the same
+//  names and give no ids. Then the lookups by namespace and local name, a large document parsed
+//  with several threads and a document reused for one without namespaces.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLNamespaceTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o namespace
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+
+#define XMLNS "{" TBXML_XMLNS_NAMESPACE "}"
+#define XML "{" TBXML_XML_NAMESPACE "}"
+
+typedef struct _TBXMLNamespaceCase {
+	const char * xml;
+	const char * dump;
+} TBXMLNamespaceCase;
+
+// dumps without text, the namespace URI of a name in braces before it
+static const TBXMLNamespaceCase cases[] = {
+	{"<r/>",
+		"<r>\n"},
+	{"<r xmlns='urn:r'><a/></r>",
+		"<{urn:r}r " XMLNS "xmlns=\"urn:r\">\n <{urn:r}a>\n"},
+	{"<p:r xmlns:p='urn:p' p:a='1' a='2'><p:b/><b/></p:r>",
+		"<{urn:p}p:r " XMLNS "xmlns:p=\"urn:p\" {urn:p}p:a=\"1\" a=\"2\">\n <{urn:p}p:b>\n <b>\n"},
+	{"<r xmlns='urn:r'><a xmlns=''><b/></a><c/></r>",
+		"<{urn:r}r " XMLNS "xmlns=\"urn:r\">\n <a " XMLNS "xmlns=\"\">\n  <b>\n <{urn:r}c>\n"},
+	{"<r xmlns:p='urn:1'><a xmlns:p='urn:2'><p:b/></a><p:c/></r>",
+		"<r " XMLNS "xmlns:p=\"urn:1\">\n <a " XMLNS "xmlns:p=\"urn:2\">\n  <{urn:2}p:b>\n <{urn:1}p:c>\n"},
+	{"<r><a xmlns:p='urn:p'/><p:b/></r>",
+		"<r>\n <a " XMLNS "xmlns:p=\"urn:p\">\n <p:b>\n"},
+	{"<q:r><q:a q:x='1'/></q:r>",
+		"<q:r>\n <q:a q:x=\"1\">\n"},
+	{"<r xml:lang='en'/>",
+		"<r " XML "xml:lang=\"en\">\n"},
+	{"<r xmlns='urn:r' xml:lang='en' a='1'/>",
+		"<{urn:r}r " XMLNS "xmlns=\"urn:r\" " XML "xml:lang=\"en\" a=\"1\">\n"},
+	{"<r xmlns='urn:same' xmlns:p='urn:same'><p:a/><a/></r>",
+		"<{urn:same}r " XMLNS "xmlns=\"urn:same\" " XMLNS "xmlns:p=\"urn:same\">\n <{urn:same}p:a>\n <{urn:same}a>\n"},
+};
+
+/** The dump of a document parsed without namespaces: the same names, and no URIs.
+ */
+static std::string withoutNamespaces(const std::string &aDump) {
+	std::string output;
+	bool inURI = false;
+	for (char c : aDump) {
+		if (c == '{') inURI = true;
+		else if (c == '}') inURI = false;
+		else if (!inURI) output += c;
+	}
+	return output;
+}
+
+static void checkCases() {
+	for (const TBXMLNamespaceCase &namespaceCase : cases) {
+		TBXML aware;
+		aware.setNamespaceAware(true);
+		TBXML_CHECK(tbxmlParseAndDump(aware, namespaceCase.xml, false) == namespaceCase.dump, namespaceCase.xml);
+
+		TBXML unaware;
+		TBXML_CHECK(tbxmlParseAndDump(unaware, namespaceCase.xml, false) == withoutNamespaces(namespaceCase.dump), std::string(namespaceCase.xml) + " unaware");
+	}
+}
+
+static void checkLookups() {
+	std::string xml = "<r xmlns='urn:r' xmlns:p='urn:p'><p:a p:x='1' x='2'/><a/><b xmlns=''/><p:a p:x='3'/></r>";
+	std::string error;
+	TBXML document;
+	document.setNamespaceAware(true);
+	if (!TBXML_CHECK(document.initWithXMLString(xml, error), "lookups " + error)) return;
+	const TBXMLElement * root = document.rootXMLElement;
+
+	uint32_t r = document.namespaceId("urn:r");
+	uint32_t p = document.namespaceId("urn:p");
+	TBXML_CHECK(r != TBXML_NAME_NONE && p != TBXML_NAME_NONE && r != p, "ids");
+	TBXML_CHECK(document.namespaceURI(r) == "urn:r" && document.namespaceURI(p) == "urn:p", "URIs");
+	TBXML_CHECK(document.namespaceId("urn:undeclared") == TBXML_NAME_NONE, "undeclared URI");
+	TBXML_CHECK(document.namespaceId(root) == r, "root");
+
+	const TBXMLElement * pa = document.childElementNamedNS("urn:p", "a", root);
+	const TBXMLElement * a = document.childElementNamedNS("urn:r", "a", root);
+	const TBXMLElement * b = document.childElementNamedNS("", "b", root);
+	if (!TBXML_CHECK(pa && a && b, "children")) return;
+	TBXML_CHECK(pa == root->firstChild && a == pa->nextSibling && b == a->nextSibling, "children");
+	TBXML_CHECK(document.childElementNamedNS(p, "a", root) == pa && document.childElementNamedNS(r, "a", root) == a, "children by id");
+	TBXML_CHECK(document.childElementNamedNS(TBXML_NAME_NONE, "b", root) == b, "child without a namespace");
+	TBXML_CHECK(document.childElementNamedNS("urn:r", "b", root) == NULL, "child in another namespace");
+	TBXML_CHECK(document.childElementNamedNS("urn:undeclared", "a", root) == NULL, "child in an undeclared namespace");
+	TBXML_CHECK(document.childElementNamedNS("urn:p", "p:a", root) == NULL, "child by qualified name");
+
+	const TBXMLElement * pa2 = document.nextSiblingNamedNS("urn:p", "a", pa);
+	TBXML_CHECK(pa2 && pa2 == b->nextSibling, "next sibling");
+	TBXML_CHECK(document.nextSiblingNamedNS(p, "a", pa) == pa2, "next sibling by id");
+	TBXML_CHECK(document.nextSiblingNamedNS("urn:r", "a", a) == NULL, "no next sibling");
+
+	TBXML_CHECK(document.valueOfAttributeNamedNS("urn:p", "x", pa) == "1", "attribute");
+	TBXML_CHECK(document.valueOfAttributeNamedNS(p, "x", pa) == "1", "attribute by id");
+	TBXML_CHECK(document.valueOfAttributeNamedNS("", "x", pa) == "2", "attribute without a namespace");
+	TBXML_CHECK(document.valueOfAttributeNamedNS("urn:r", "x", pa) == "", "attribute not in the default namespace");
+	TBXML_CHECK(pa2 && document.valueOfAttributeNamedNS("urn:p", "x", pa2) == "3", "attribute of the next sibling");
+
+	TBXML_CHECK(TBXML::localName(pa) == "a" && TBXML::localName(a) == "a", "local names");
+	TBXML_CHECK(TBXML::localName(pa->firstAttribute) == "x" && TBXML::localName(root->firstAttribute) == "xmlns", "local attribute names");
+	TBXML_CHECK(TBXML::localName(root->firstAttribute->next) == "p", "local name of a declaration");
+	TBXML_CHECK(document.namespaceId(pa->firstAttribute) == p && document.namespaceId(pa->firstAttribute->next) == TBXML_NAME_NONE, "attribute ids");
+
+	// a document without namespaces after this one keeps none of its ids
+	xml = "<r><a x='1'/></r>";
+	if (!TBXML_CHECK(document.initWithXMLString(xml, error), "reused " + error)) return;
+	TBXML_CHECK(document.namespaceId(document.rootXMLElement) == TBXML_NAME_NONE, "reused");
+	TBXML_CHECK(document.namespaceId(document.rootXMLElement->firstChild) == TBXML_NAME_NONE, "reused");
+	TBXML_CHECK(document.namespaceId(document.rootXMLElement->firstChild->firstAttribute) == TBXML_NAME_NONE, "reused");
+	TBXML_CHECK(document.namespaceId("urn:p") == TBXML_NAME_NONE, "reused");
+}
+
+/** A corpus document wrapped in elements declaring namespaces, with records of its own in them, so
+    the ids of many element and attribute buffers are set.
+ */
+static void checkLargeDocument() {
+	std::string records;
+	for (size_t i=0; records.size() < 2*TBXML_PARALLEL_MIN_BYTES; i++) {
+		records += "<p:item p:id='" + std::to_string(i) + "' kind='k'><name>n</name><q:price xmlns:q='urn:q" + std::to_string(i % 3) + "' q:currency='EUR'>1</q:price></p:item>";
+	}
+	std::string xml = "<r xmlns='urn:r' xmlns:p='urn:p'>" + records + "<plain xmlns=''>" + TBXMLCorpus::generate(D_TBXML_CORPUS_FEED, TBXML_PARALLEL_MIN_BYTES, 3) + "</plain>" + records + "</r>";
+
+	TBXML serial;
+	serial.setNamespaceAware(true);
+	std::string expected = tbxmlParseAndDump(serial, xml);
+	if (!TBXML_CHECK(expected.compare(0, 7, "error: ") != 0, "large document")) return;
+	TBXML_CHECK(expected.find("<{urn:r}name>") != std::string::npos && expected.find("{urn:q2}q:currency") != std::string::npos, "large document");
+
+	TBXML parallel;
+	parallel.setNamespaceAware(true);
+	parallel.setParseThreadCount(4);
+	TBXML_CHECK(tbxmlParseAndDump(parallel, xml) == expected, "large document 4 threads");
+
+	TBXML unaware;
+	TBXML_CHECK(tbxmlParseAndDump(unaware, xml) == withoutNamespaces(expected), "large document unaware");
+}
+
+int main() {
+	checkCases();
+	checkLookups();
+	checkLargeDocument();
+
+	return tbxmlTestResult("namespace");
+}
@@ -0,0 +1,82 @@
+// ================================================================================================
+//  TBXMLParallelTest.cpp
+//  Trees of parallel parses against those of serial ones
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses corpus documents large enough to be split between threads with 1 to 8 threads, in each
+//  entity mode, and checks every tree and element count against the serial parse. A document is
+//  parsed again by the same TBXML so the buffers kept from a larger parse are reused.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLParallelTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o parallel
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+#include <iterator>
+
+static const size_t threadCounts[] = {2, 3, 4, 8};
+static const TBXMLEntityMode entityModes[] = {D_TBXML_ENTITIES_NONE, D_TBXML_ENTITIES_EAGER};
+
+static size_t countLines(const std::string &aDump) {
+	size_t lines = 0;
+	for (char c : aDump) if (c == '\n') lines++;
+	return lines;
+}
+
+int main() {
+	TBXML parallel;
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		std::string xml = TBXMLCorpus::generate((TBXMLCorpusShape)shape, 3*TBXML_PARALLEL_MIN_BYTES, 7);
+
+		for (TBXMLEntityMode entityMode : entityModes) {
+			TBXML serial;
+			serial.setEntityMode(entityMode);
+			std::string expected = tbxmlParseAndDump(serial, xml);
+			std::string label = std::string(TBXMLCorpus::shapeName((TBXMLCorpusShape)shape)) + (entityMode == D_TBXML_ENTITIES_EAGER ? " eager" : " none");
+			if (!TBXML_CHECK(expected.compare(0, 7, "error: ") != 0, label)) continue;
+
+			for (size_t threadCount : threadCounts) {
+				parallel.setParseThreadCount(threadCount);
+				parallel.setEntityMode(entityMode);
+				std::string threadLabel = label + " " + std::to_string(threadCount) + " threads";
+
+				std::string dump = tbxmlParseAndDump(parallel, xml);
+				TBXML_CHECK(dump == expected, threadLabel);
+
+				TBXMLArenaRange elements = parallel.elements();
+				TBXML_CHECK((size_t)std::distance(elements.begin(), elements.end()) == countLines(expected), threadLabel);
+			}
+		}
+	}
+
+	// a small document after the large ones, parsed serially with the buffers of the parallel parses
+	std::string xml = TBXMLCorpus::generate(D_TBXML_CORPUS_FEED, 64*1024, 7);
+	TBXML serial;
+	std::string expected = tbxmlParseAndDump(serial, xml);
+	parallel.setParseThreadCount(1);
+	parallel.setEntityMode(D_TBXML_ENTITIES_NONE);
+	TBXML_CHECK(tbxmlParseAndDump(parallel, xml) == expected, "feed after parallel parses");
+	TBXMLArenaRange elements = parallel.elements();
+	TBXML_CHECK((size_t)std::distance(elements.begin(), elements.end()) == countLines(expected), "feed after parallel parses");
+
+	return tbxmlTestResult("parallel");
+}
@@ -0,0 +1,177 @@
+// ================================================================================================
+//  TBXMLProjectionTest.cpp
+//  Documents parsed by TBXML for the paths of a TBXMLProjection
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses documents with projections and checks the tree against the full tree restricted to the
+//  paths: elements on a path with their text, attributes only for paths ending in @name, and whole
+//  subtrees for paths ending in an element. Paths that are not absolute element paths must be
+//  refused.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLProjectionTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o projection
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLProjection.h"
+#include "TBXMLTest.h"
+#include <vector>
+
+static const char* documents[] = {
+	"<r/>",
+	"<r a='1'>t<z>q</z>u</r>",
+	"<r a='1'>t<z/></r>",
+	"<r a='1'>t<x b='2'>u<y c='3'>v</y></x>w<z d='4'>z</z><x/></r>",
+	"<r><x><x><x a='1'>deep</x></x></x><y><x/></y></r>",
+	"<r><!-- <x> --><![CDATA[<x>]]><x a='&lt;'><![CDATA[</x>]]></x><?pi <x>?></r>",
+	"<r xmlns:p='urn:p'><p:x p:a='1'/><x/></r>",
+};
+
+// each set is used on every document, most of it matches nothing in some of them
+static const std::vector<std::vector<const char*>> pathSets = {
+	{"/r"},
+	{"/r/x"},
+	{"/r/@a"},
+	{"/r/x/y"},
+	{"/r/@a", "/r/x/y"},
+	{"/r/x/@b", "/r/z"},
+	{"/r/x/x/x", "/r/y/@q"},
+	{"/r/p:x/@p:a"},
+	{"/q"},
+	{"/corpus"},
+	{"/corpus/n/n/n", "/corpus/n/@d"},
+	{"/corpus/n/n/n/n/n/@d"},
+	{"/corpus/i5", "/corpus/i7/@x"},
+	{"/corpus/element/@id"},
+	{"/corpus/script"},
+	{"/corpus/record/name", "/corpus/record/@id"},
+	{"/corpus/p"},
+	{"/rss/@version", "/rss/channel/item/title", "/rss/channel/item/guid/@isPermaLink"},
+};
+
+static const char* invalidPaths[] = { "", "r", "/", "/r/", "//r", "/r//x", "/r/@", "/r/@a/b", "/r/@a/@b" };
+
+static bool startsWith(const std::string &aString, const std::string &aPrefix) {
+	return aString.compare(0, aPrefix.length(), aPrefix) == 0;
+}
+
+/** Dumps the tree of aDocument as tbxmlDumpDocument does, leaving out what a parse for aPaths leaves
+    out.
+ */
+static std::string dumpRestricted(const TBXML &aDocument, const std::vector<const char*> &aPaths) {
+	std::string output;
+	std::vector<std::string> parentPaths;
+	std::vector<bool> parentSubtrees;
+	const TBXMLElement * xmlElement = aDocument.rootXMLElement;
+
+	while (xmlElement) {
+		std::string path = (parentPaths.empty() ? "" : parentPaths.back()) + "/" + std::string(xmlElement->name, xmlElement->nameLength);
+		bool subtree = !parentSubtrees.empty() && parentSubtrees.back();
+		bool onPath = false, attributes = false;
+		for (const char * projectionPath : aPaths) {
+			if (path == projectionPath) subtree = true;
+			if (startsWith(projectionPath, path + "/")) onPath = true;
+			if (startsWith(projectionPath, path + "/@")) attributes = true;
+		}
+
+		if (subtree || onPath) {
+			output.append(parentPaths.size(), ' ');
+			output += '<';
+			output.append(xmlElement->name, xmlElement->nameLength);
+			for (uint32_t i=0; (subtree || attributes) && i < xmlElement->attributeCount; i++) {
+				const TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute + i;
+				output += ' ';
+				output.append(xmlAttribute->name, xmlAttribute->nameLength);
+				output += "=\"";
+				output.append(xmlAttribute->value, xmlAttribute->valueLength);
+				output += '"';
+			}
+			output += '>';
+			if (xmlElement->text) {
+				output += '[';
+				output.append(xmlElement->text, xmlElement->textLength);
+				output += ']';
+			} else {
+				output += '-';
+			}
+			output += '\n';
+
+			if (xmlElement->firstChild) {
+				parentPaths.push_back(path);
+				parentSubtrees.push_back(subtree);
+				xmlElement = xmlElement->firstChild;
+				continue;
+			}
+		}
+
+		// climb to the next sibling of the element or of its closest parent that has one
+		while (xmlElement && !xmlElement->nextSibling) {
+			if (parentPaths.empty()) return output;
+			xmlElement = xmlElement->parentElement;
+			parentPaths.pop_back();
+			parentSubtrees.pop_back();
+		}
+		if (xmlElement) xmlElement = xmlElement->nextSibling;
+	}
+	return output;
+}
+
+static void check(const std::string &aXML, const std::string &aLabel) {
+	TBXML full;
+	if (!TBXML_CHECK(tbxmlParseAndDump(full, aXML).compare(0, 7, "error: ") != 0, aLabel)) return;
+
+	// one document for every projection, parsing on the calling thread whatever it is set to
+	TBXML projected;
+	projected.setParseThreadCount(4);
+
+	for (const std::vector<const char*> &paths : pathSets) {
+		std::string label = aLabel;
+		TBXMLProjection projection;
+		std::string error;
+		for (const char * path : paths) {
+			TBXML_CHECK(projection.addPath(path, error), label + " " + path + " " + error);
+			label = label + " " + path;
+		}
+		TBXML_CHECK(projection.pathCount() == paths.size(), label);
+
+		projected.setProjection(&projection);
+		TBXML_CHECK(tbxmlParseAndDump(projected, aXML) == dumpRestricted(full, paths), label);
+	}
+
+	projected.setProjection(NULL);
+	TBXML_CHECK(tbxmlParseAndDump(projected, aXML) == tbxmlDumpDocument(full), aLabel + " without projection");
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], "document " + std::to_string(i));
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		check(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 3*TBXML_PARALLEL_MIN_BYTES, 19), TBXMLCorpus::shapeName((TBXMLCorpusShape)shape));
+	}
+
+	for (const char * path : invalidPaths) {
+		TBXMLProjection projection;
+		std::string error;
+		TBXML_CHECK(!projection.addPath(path, error) && error == "Invalid query", std::string("invalid path ") + path);
+		TBXML_CHECK(projection.pathCount() == 0, std::string("invalid path ") + path);
+	}
+
+	return tbxmlTestResult("projection");
+}
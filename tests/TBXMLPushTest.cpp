@@ -0,0 +1,135 @@
+// ================================================================================================
+//  TBXMLPushTest.cpp
+//  Trees pushed from a socket against those of initWithXMLString
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Sends documents through a socketpair from a second thread, a byte at a time and in random pieces,
+//  feeds TBXMLPushParser whatever each read returns and checks the tree against initWithXMLString.
+//  Also checks the start tag TBXMLPush.h documents as read differently from decodeBytes. Skipped where
+//  there is no socketpair.
+//
+//  c++ -O2 -std=c++17 -pthread -I../TBXML -I../bench TBXMLPushTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o push
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLPush.h"
+#include "TBXMLTest.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+static const char* documents[] = {
+	"<r/>",
+	"<r>text</r>",
+	"<r>  a <b/> c <d>e</d> f </r>",
+	"<r a = '1'  b=\"2\"\n>\n  spaced \t text\t</r >",
+	"<r><![CDATA[<a>]]><!-- <b> --><a><![CDATA[</a>]]></a><?pi <c>?></r>",
+	"<?xml version='1.0'?><!DOCTYPE r><r><a q='&amp;&lt;'>&#65;&#x42;</a><a/><a></a></r>",
+};
+
+static size_t nextLength(uint64_t &aState, size_t aMaxLength) {
+	aState = aState*6364136223846793005ULL + 1442695040888963407ULL;
+	return 1 + (aState >> 33) % aMaxLength;
+}
+
+/** Writes aXML to aSocket in pieces of at most aMaxLength bytes and closes it.
+ */
+static void sendPieces(int aSocket, const std::string &aXML, size_t aMaxLength, uint64_t aSeed) {
+	uint64_t state = aSeed;
+	for (size_t offset=0; offset < aXML.length();) {
+		size_t length = std::min(aXML.length() - offset, nextLength(state, aMaxLength));
+		ssize_t written = write(aSocket, aXML.data() + offset, length);
+		if (written <= 0) break;
+		offset += written;
+	}
+	close(aSocket);
+}
+
+/** Pushes what arrives on a socket, reading at most aMaxLength bytes at a time, and returns the dump
+    of the tree.
+ */
+static std::string push(const std::string &aXML, size_t aMaxLength, uint64_t aSeed) {
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) return "error: socketpair";
+	std::thread sender(sendPieces, sockets[1], std::cref(aXML), aMaxLength, aSeed);
+
+	TBXMLPushParser parser;
+	std::string result;
+	char buffer[4096];
+	uint64_t state = aSeed + 1;
+	for (;;) {
+		ssize_t length = read(sockets[0], buffer, std::min(sizeof(buffer), nextLength(state, aMaxLength)));
+		if (length <= 0) break;
+		if (!parser.feed(buffer, length)) {
+			result = "error: " + parser.error();
+			break;
+		}
+	}
+	// the sender is left to finish even after an error, the rest of the input is drained
+	while (!result.empty() && read(sockets[0], buffer, sizeof(buffer)) > 0);
+	sender.join();
+	close(sockets[0]);
+
+	if (!result.empty()) return result;
+	if (!parser.finish()) return "error: " + parser.error();
+	return tbxmlDumpDocument(parser.document());
+}
+
+static void check(const std::string &aXML, const std::string &aLabel) {
+	TBXML document;
+	std::string expected = tbxmlParseAndDump(document, aXML);
+
+	if (aXML.length() <= 64*1024) TBXML_CHECK(push(aXML, 1, aXML.length()) == expected, aLabel + " bytes");
+	for (uint64_t seed=1; seed <= 4; seed++) {
+		TBXML_CHECK(push(aXML, 4096, seed) == expected, aLabel + " pieces " + std::to_string(seed));
+	}
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], "document " + std::to_string(i));
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		TBXMLCorpusShape corpusShape = (TBXMLCorpusShape)shape;
+		check(TBXMLCorpus::generate(corpusShape, 16*1024, 13), std::string(TBXMLCorpus::shapeName(corpusShape)) + " 16k");
+		check(TBXMLCorpus::generate(corpusShape, 1024*1024, 13), std::string(TBXMLCorpus::shapeName(corpusShape)) + " 1M");
+	}
+
+	// a '>' in a quoted value ends the start tag for decodeBytes only
+	std::string xml = "<r b='x>y'>hello</r>";
+	TBXML document;
+	TBXML_CHECK(tbxmlParseAndDump(document, xml) == "<r>[y'>hello]\n", "quoted '>' parsed");
+	TBXML_CHECK(push(xml, 1, 1) == "<r b=\"x>y\">[hello]\n", "quoted '>' pushed");
+
+	return tbxmlTestResult("push");
+}
+
+#else
+
+int main() {
+	printf("push: no socketpair, skipped\n");
+	return 0;
+}
+
+#endif
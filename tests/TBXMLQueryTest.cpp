@@ -0,0 +1,218 @@
+// ================================================================================================
+//  TBXMLQueryTest.cpp
+//  Paths evaluated by TBXMLQuery checked against the elements and values they select
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Evaluates child, descendant and absolute paths, predicates in both orders, text() and @name on a
+//  small document, compiled plain and against the symbol table the document was parsed with, checks
+//  that malformed paths are rejected and counts //name over corpus documents against a walk of the
+//  tree.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLQueryTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o query
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLQuery.h"
+#include "TBXMLTest.h"
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+// every element has an id, the results are written as the ids of the elements or the values selected
+static const char* document =
+	"<r>"
+		"<a id='a'>"
+			"<b id='b1' k='v'><c id='c1'>one</c></b>"
+			"<b id='b2'><d id='d1'><c id='c2'>two</c></d></b>"
+			"<b id='b3' k='v'><c id='c3'/></b>"
+			"<b id='b4' k='w'/>"
+			"<c id='c4'>top</c>"
+		"</a>"
+	"</r>";
+
+typedef struct _TBXMLQueryCase {
+	const char * path;
+	const char * results;
+} TBXMLQueryCase;
+
+// evaluated from the root element r
+static const TBXMLQueryCase cases[] = {
+	{"/r/a/b",				"b1 b2 b3 b4"},
+	{"/r/a/c",				"c4"},
+	{"a/b/d/c",				"c2"},
+	{"a/*",					"b1 b2 b3 b4 c4"},
+	{"*",					"a"},
+	{"//c",					"c1 c2 c3 c4"},
+	{"a//c",				"c1 c2 c3 c4"},
+	{"//b//c",				"c1 c2 c3"},
+	{"a/b[@k]",				"b1 b3 b4"},
+	{"a/b[@k='v']",			"b1 b3"},
+	{"a/b[@k=\"w\"]",		"b4"},
+	{"a/b[3]",				"b3"},
+	{"a/b[99]",				""},
+	{"a/b[@k='v'][2]",		"b3"},
+	{"a/b[2][@k='v']",		""},
+	{"a//c[1]",				"c1 c2 c3 c4"},
+	{"a//c[2]",				""},
+	{"a/b/c/text()",		"[one]"},
+	{"//c/text()",			"[one] [two] [top]"},
+	{"a/b/@id",				"[b1] [b2] [b3] [b4]"},
+	{"a/b/@k",				"[v] [v] [w]"},
+	{"a/b[@k='v']/@id",		"[b1] [b3]"},
+	{"a/zz",				""},
+	{"//zz/@id",			""},
+};
+
+static const char* malformed[] = {
+	"", "/", "//", "a/", "a//", "a b", "a[", "a[1", "a[0]", "a[x]", "a[@]", "a[@k='v]", "a[@k=v]",
+	"a/text()/b", "a/@k/b",
+};
+
+static std::string results(const TBXMLQuery &aQuery, const TBXMLElement* aXMLElement) {
+	std::string rev;
+	if (aQuery.resultType() == D_TBXML_QUERY_ELEMENTS) {
+		std::vector<const TBXMLElement*> elements;
+		aQuery.elements(aXMLElement, std::back_inserter(elements));
+		for (const TBXMLElement * xmlElement : elements) {
+			if (!rev.empty()) rev += " ";
+			rev += TBXML::valueOfAttributeNamed("id", xmlElement);
+		}
+	} else {
+		std::vector<std::string_view> values;
+		aQuery.values(aXMLElement, std::back_inserter(values));
+		for (std::string_view value : values) {
+			if (!rev.empty()) rev += " ";
+			rev += "[" + std::string(value) + "]";
+		}
+	}
+	return rev;
+}
+
+static void checkCases(const TBXML &aDocument, const TBXMLSymbolTable *aSymbolTable, const std::string &aLabel) {
+	for (const TBXMLQueryCase &queryCase : cases) {
+		std::string label = aLabel + " " + queryCase.path;
+		TBXMLQuery query;
+		std::string error;
+		bool compiled = aSymbolTable ? query.initWithPath(queryCase.path, aSymbolTable, error) : query.initWithPath(queryCase.path, error);
+		if (!TBXML_CHECK(compiled, label + " " + error)) continue;
+
+		std::string found = results(query, aDocument.rootXMLElement);
+		TBXML_CHECK(found == queryCase.results, label + " selected " + found);
+
+		// count, first and firstValue agree with evaluate
+		size_t expected = 0;
+		if (*queryCase.results) expected = 1 + std::count(queryCase.results, queryCase.results + strlen(queryCase.results), ' ');
+		TBXML_CHECK(query.count(aDocument.rootXMLElement) == expected, label + " count");
+		if (query.resultType() == D_TBXML_QUERY_ELEMENTS) {
+			const TBXMLElement * first = query.first(aDocument.rootXMLElement);
+			TBXML_CHECK(expected ? first != NULL : first == NULL, label + " first");
+		} else {
+			std::string_view first = query.firstValue(aDocument.rootXMLElement);
+			TBXML_CHECK(expected ? first.data() != NULL : first.data() == NULL, label + " firstValue");
+		}
+	}
+}
+
+/** Absolute paths start at the root whatever the context, relative ones at the context.
+ */
+static void checkContext(const TBXML &aDocument) {
+	TBXMLQuery find, absolute, relative;
+	std::string error;
+	find.initWithPath("//d/c", error);
+	const TBXMLElement * c2 = find.first(aDocument.rootXMLElement);
+	if (!TBXML_CHECK(c2 != NULL, "context //d/c")) return;
+
+	absolute.initWithPath("/r/a/c", error);
+	TBXML_CHECK(results(absolute, c2) == "c4", "context absolute");
+	relative.initWithPath("text()", error);
+	TBXML_CHECK(results(relative, c2) == "[two]", "context text()");
+	relative.initWithPath("@id", error);
+	TBXML_CHECK(results(relative, c2) == "[c2]", "context @id");
+	relative.initWithPath("c", error);
+	TBXML_CHECK(results(relative, c2) == "", "context relative");
+}
+
+static void checkMalformed() {
+	for (const char * path : malformed) {
+		TBXMLQuery query;
+		std::string error;
+		TBXML_CHECK(!query.initWithPath(path, error), std::string("malformed '") + path + "'");
+		TBXML_CHECK(error == "Invalid query", std::string("malformed '") + path + "' " + error);
+	}
+}
+
+/** //name counted over a corpus document against a walk of its tree, for the name of the first child
+    of the root element.
+ */
+static void checkCorpus(TBXMLCorpusShape aShape) {
+	std::string label = TBXMLCorpus::shapeName(aShape);
+	std::string xml = TBXMLCorpus::generate(aShape, 256*1024, 5), error;
+	TBXMLSymbolTable symbols;
+	TBXML document;
+	document.setSymbolTable(&symbols);
+	if (!TBXML_CHECK(document.initWithXMLString(xml, error), label + " " + error)) return;
+	symbols.freeze();
+
+	const TBXMLElement * root = document.rootXMLElement;
+	if (!root->firstChild) return;
+	std::string name = TBXML::elementName(root->firstChild);
+
+	size_t expected = 0;
+	std::vector<const TBXMLElement*> pending(1, root);
+	while (!pending.empty()) {
+		const TBXMLElement * xmlElement = pending.back();
+		pending.pop_back();
+		if (TBXML::elementName(xmlElement) == name) expected++;
+		for (const TBXMLElement * child = xmlElement->firstChild; child; child = child->nextSibling) pending.push_back(child);
+	}
+
+	TBXMLQuery plain, interned;
+	plain.initWithPath("//" + name, error);
+	interned.initWithPath("//" + name, &symbols, error);
+	TBXML_CHECK(plain.count(root) == expected, label + " //" + name);
+	TBXML_CHECK(interned.count(root) == expected, label + " //" + name + " interned");
+}
+
+int main() {
+	std::string xml = document, error;
+	TBXML plain;
+	if (TBXML_CHECK(plain.initWithXMLString(xml, error), "document " + error)) {
+		checkCases(plain, NULL, "plain");
+		checkContext(plain);
+	}
+
+	// names compared by id, a name the table doesn't know matches nothing
+	xml = document;
+	TBXMLSymbolTable symbols;
+	TBXML interned;
+	interned.setSymbolTable(&symbols);
+	if (TBXML_CHECK(interned.initWithXMLString(xml, error), "interned document " + error)) {
+		symbols.freeze();
+		checkCases(interned, &symbols, "interned");
+	}
+
+	checkMalformed();
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) checkCorpus((TBXMLCorpusShape)shape);
+
+	return tbxmlTestResult("query");
+}
@@ -0,0 +1,139 @@
+// ================================================================================================
+//  TBXMLScannerTest.cpp
+//  Scalar, SSE2 and AVX2 scanners against each other
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Checks every scanner the CPU supports against plain loops over random buffers, for every start and
+//  end within them so the vector heads and tails are covered, classifies aligned blocks against the
+//  scalar scanner, then checks the trees parsed with each scanner against the scalar ones. Modes the
+//  CPU or the build lacks are skipped.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLScannerTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o scanner
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLScanner.h"
+#include "TBXMLTest.h"
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+static const TBXMLScanMode scanModes[] = {D_TBXML_SCAN_SCALAR, D_TBXML_SCAN_SSE2, D_TBXML_SCAN_AVX2};
+static const char* scanModeNames[] = {"auto", "scalar", "sse2", "avx2"};
+
+// bytes the random buffers are made of, weighted towards what the scanners look for
+static const char alphabet[] = "<<>>''\"\"==&& \t\n\r\v\fab]]--?!x\x80\xff";
+
+static const char* documents[] = {
+	"<r/>",
+	"<r\ta\n=\r'1'\tb = \"2\" >  spaced  text\t</r\n>",
+	"<r><![CDATA[<a>]]]]><![CDATA[>]]></r>",
+	"<r><!----><!-- - -- --><a><!--x--></a></r>",
+	"<?xml version='1.0'?><!DOCTYPE r><r><?pi x?><a q='&amp;&lt;'>&#65;&#x42;</a></r>",
+	"<r a='>' b=\"'\" c='\"'>t</r>",
+};
+
+static char* findFirstOfLoop(const char* aStart, const char* aEnd, const char* aSet) {
+	for (const char * c = aStart; c < aEnd; c++) if (*c && strchr(aSet, *c)) return (char*)c;
+	return NULL;
+}
+
+static char* skipWhitespaceLoop(const char* aStart, const char* aEnd) {
+	for (const char * c = aStart; c < aEnd; c++) if (!TBXMLScanner::isWhitespace(*c)) return (char*)c;
+	return NULL;
+}
+
+static char* findStringLoop(const char* aStart, const char* aEnd, const char* aNeedle) {
+	size_t needleLength = strlen(aNeedle);
+	for (const char * c = aStart; c + needleLength <= aEnd; c++) if (memcmp(c, aNeedle, needleLength) == 0) return (char*)c;
+	return NULL;
+}
+
+static void checkFunctions(const std::string &aLabel) {
+	// 64 byte aligned so classifyBlock can be given whole blocks of the buffer
+	alignas(64) char buffer[256];
+	uint64_t state = 1;
+
+	for (int round=0; round < 64; round++) {
+		for (size_t i=0; i < sizeof(buffer); i++) {
+			state = state*6364136223846793005ULL + 1442695040888963407ULL;
+			buffer[i] = alphabet[(state >> 33) % (sizeof(alphabet) - 1)];
+		}
+
+		for (size_t start=0; start < 80; start++) {
+			for (size_t end=start; end <= sizeof(buffer); end += (end < start + 80 ? 1 : 7)) {
+				const char * from = buffer + start;
+				const char * to = buffer + end;
+				TBXML_CHECK(TBXMLScanner::findChar(from, to, '<') == findFirstOfLoop(from, to, "<"), aLabel + " findChar");
+				TBXML_CHECK(TBXMLScanner::findChar(from, to, '\x80') == findFirstOfLoop(from, to, "\x80"), aLabel + " findChar");
+				TBXML_CHECK(TBXMLScanner::findFirstOf(from, to, "<&") == findFirstOfLoop(from, to, "<&"), aLabel + " findFirstOf");
+				TBXML_CHECK(TBXMLScanner::findFirstOf(from, to, "'\"=>") == findFirstOfLoop(from, to, "'\"=>"), aLabel + " findFirstOf");
+				TBXML_CHECK(TBXMLScanner::skipWhitespace(from, to) == skipWhitespaceLoop(from, to), aLabel + " skipWhitespace");
+				TBXML_CHECK(TBXMLScanner::findString(from, to, "]]>") == findStringLoop(from, to, "]]>"), aLabel + " findString");
+				TBXML_CHECK(TBXMLScanner::findString(from, to, "--") == findStringLoop(from, to, "--"), aLabel + " findString");
+			}
+		}
+
+		TBXMLScanMode scanMode = TBXMLScanner::scanMode();
+		for (size_t block=0; block < sizeof(buffer); block += 64) {
+			TBXMLBlockMasks masks;
+			TBXMLBlockMasks expected;
+			TBXMLScanner::classifyBlock(buffer + block, &masks);
+			TBXMLScanner::setScanMode(D_TBXML_SCAN_SCALAR);
+			TBXMLScanner::classifyBlock(buffer + block, &expected);
+			TBXMLScanner::setScanMode(scanMode);
+			TBXML_CHECK(memcmp(&masks, &expected, sizeof(masks)) == 0, aLabel + " classifyBlock");
+		}
+	}
+}
+
+int main() {
+	std::vector<std::pair<std::string, std::string>> inputs;
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) inputs.push_back({"document " + std::to_string(i), documents[i]});
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		inputs.push_back({TBXMLCorpus::shapeName((TBXMLCorpusShape)shape), TBXMLCorpus::generate((TBXMLCorpusShape)shape, 256*1024, 3)});
+	}
+	std::vector<std::string> expected(inputs.size());
+
+	for (TBXMLScanMode scanMode : scanModes) {
+		TBXMLScanner::setScanMode(scanMode);
+		if (TBXMLScanner::scanMode() != scanMode) {
+			printf("scanner: %s not supported, skipped\n", scanModeNames[scanMode]);
+			continue;
+		}
+		std::string label = scanModeNames[scanMode];
+
+		checkFunctions(label);
+
+		// the scalar scanner runs first and sets the trees the others are held to
+		for (size_t i=0; i < inputs.size(); i++) {
+			TBXML document;
+			document.setEntityMode(D_TBXML_ENTITIES_EAGER);
+			std::string dump = tbxmlParseAndDump(document, inputs[i].second);
+			if (scanMode == D_TBXML_SCAN_SCALAR) expected[i] = dump;
+			else TBXML_CHECK(dump == expected[i], label + " " + inputs[i].first);
+		}
+	}
+
+	TBXMLScanner::setScanMode(D_TBXML_SCAN_AUTO);
+	return tbxmlTestResult("scanner");
+}
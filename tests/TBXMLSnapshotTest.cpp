@@ -0,0 +1,234 @@
+// ================================================================================================
+//  TBXMLSnapshotTest.cpp
+//  Snapshots of TBXMLCompact documents written and mapped back
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Converts documents to TBXMLCompact and checks the compact tree against the TBXML one, then saves
+//  it as a snapshot and checks the tree loaded back, with and without the checksum verified, including
+//  names and text long enough for the lengths table. Damaged snapshots must fail with their error:
+//  truncated files, a wrong magic, version or byte order, and a changed byte with the checksum verified.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLSnapshotTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o snapshot
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCompact.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+// header fields overwritten to damage a snapshot, at their offsets in the 64 byte header
+#define TBXML_TEST_MAGIC_OFFSET 0
+#define TBXML_TEST_VERSION_OFFSET 8
+#define TBXML_TEST_BYTE_ORDER_OFFSET 12
+#define TBXML_TEST_HEADER_LENGTH 64
+
+static const char* snapshotFile = "TBXMLSnapshotTest.snapshot";
+static const char* damagedFile = "TBXMLSnapshotTest.damaged";
+
+static const char* documents[] = {
+	"<r/>",
+	"<r>text</r>",
+	"<r><a/><b></b><c>t</c></r>",
+	"<r a='1'><a b='2' c=''><b c='3'><c>deep</c></b></a><a/><a>x<b/>y</a></r>",
+	"<r><!-- <a> --><![CDATA[<b>]]><a><![CDATA[</a>]]></a><?pi <c>?></r>",
+	"<r xmlns='urn:r' xmlns:p='urn:p'><p:a p:x='1'><b xmlns='urn:b'><p:c/></b></p:a></r>",
+	"<r><a>&lt;&amp;&#x41;</a><a t='&quot;&apos;'/></r>",
+};
+
+/** Dumps aDocument in the format of tbxmlDumpDocument, walking it through the navigation methods of
+    TBXMLCompact so the two dumps are equal when the trees are.
+ */
+static std::string dumpCompact(TBXMLCompact &aDocument) {
+	std::string output;
+	const TBXMLCompactElement * xmlElement = aDocument.rootXMLElement;
+	size_t depth = 0;
+
+	while (xmlElement) {
+		output.append(depth, ' ');
+		output += '<';
+		output += aDocument.elementName(xmlElement);
+		for (const TBXMLCompactAttribute * xmlAttribute = aDocument.firstAttribute(xmlElement); xmlAttribute; xmlAttribute = aDocument.nextAttribute(xmlAttribute, xmlElement)) {
+			output += ' ';
+			output += aDocument.attributeName(xmlAttribute);
+			output += "=\"";
+			output += aDocument.attributeValue(xmlAttribute);
+			output += '"';
+		}
+		output += '>';
+		if (xmlElement->text != TBXML_COMPACT_NONE) {
+			output += '[';
+			output += aDocument.textForElement(xmlElement);
+			output += ']';
+		} else {
+			output += '-';
+		}
+		output += '\n';
+
+		if (aDocument.firstChild(xmlElement)) {
+			xmlElement = aDocument.firstChild(xmlElement);
+			depth++;
+			continue;
+		}
+
+		// climb to the next sibling of the element or of its closest parent that has one
+		while (xmlElement && !aDocument.nextSibling(xmlElement)) {
+			if (!depth) return output;
+			xmlElement = aDocument.parentElement(xmlElement);
+			depth--;
+		}
+		if (xmlElement) xmlElement = aDocument.nextSibling(xmlElement);
+	}
+	return output;
+}
+
+static std::string readFile(const char* aFile) {
+	std::ifstream file(aFile, std::ios::binary);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+static void writeFile(const char* aFile, const std::string &aContents) {
+	std::ofstream file(aFile, std::ios::binary|std::ios::trunc);
+	file.write(aContents.data(), (std::streamsize)aContents.size());
+}
+
+/** Loads aFile into a new TBXMLCompact and returns the error, empty when it loaded.
+ */
+static std::string loadError(const char* aFile, bool aVerifyChecksum) {
+	TBXMLCompact loaded;
+	std::string file = aFile;
+	std::string error;
+	if (loaded.initWithSnapshotFile(file, aVerifyChecksum, error)) return "";
+	return error;
+}
+
+static void checkRoundTrip(const std::string &aXML, const std::string &aLabel) {
+	TBXML document;
+	std::string expected = tbxmlParseAndDump(document, aXML);
+
+	TBXMLCompact parsed;
+	std::string xml = aXML;
+	std::string error;
+	if (!TBXML_CHECK(parsed.initWithXMLString(xml, error), aLabel + " " + error)) return;
+	TBXML_CHECK(dumpCompact(parsed) == expected, aLabel + " parsed");
+
+	std::string file = snapshotFile;
+	if (!TBXML_CHECK(parsed.saveSnapshot(file, error), aLabel + " " + error)) return;
+
+	for (int verify=0; verify < 2; verify++) {
+		std::string verifyLabel = aLabel + (verify ? " verified" : " mapped");
+		TBXMLCompact loaded;
+		if (!TBXML_CHECK(loaded.initWithSnapshotFile(file, verify, error), verifyLabel + " " + error)) continue;
+		TBXML_CHECK(loaded.elementCount() == parsed.elementCount(), verifyLabel);
+		TBXML_CHECK(loaded.attributeCount() == parsed.attributeCount(), verifyLabel);
+		TBXML_CHECK(dumpCompact(loaded) == expected, verifyLabel);
+	}
+}
+
+static void checkLongNames() {
+	std::string longName(70000, 'n');
+	std::string longText(TBXML_COMPACT_LONG, 't');
+	std::string longValue(80000, 'v');
+	std::string xml = "<r><" + longName + " a='" + longValue + "'>" + longText + "</" + longName + "><b>short</b><c>" + longText + "x</c></r>";
+	checkRoundTrip(xml, "long names");
+
+	TBXMLCompact loaded;
+	std::string file = snapshotFile;
+	std::string error;
+	if (!TBXML_CHECK(loaded.initWithSnapshotFile(file, true, error), "long names " + error)) return;
+	const TBXMLCompactElement * child = loaded.firstChild(loaded.rootXMLElement);
+	if (!TBXML_CHECK(child, "long names")) return;
+	TBXML_CHECK(child->nameLength == TBXML_COMPACT_LONG && child->textLength == TBXML_COMPACT_LONG, "long names table");
+	TBXML_CHECK(loaded.elementName(child) == longName, "long names");
+	TBXML_CHECK(loaded.textForElement(child) == longText, "long names");
+	std::string attributeName = "a";
+	TBXML_CHECK(loaded.valueOfAttributeNamed(attributeName, child) == longValue, "long names");
+	TBXML_CHECK(loaded.childElementNamed(longName, loaded.rootXMLElement) == child, "long names");
+}
+
+static void checkDamaged() {
+	std::string xml = TBXMLCorpus::generate(D_TBXML_CORPUS_FEED, 64*1024, 5);
+	TBXMLCompact parsed;
+	std::string file = snapshotFile;
+	std::string error;
+	if (!TBXML_CHECK(parsed.initWithXMLString(xml, error), "damaged " + error)) return;
+	if (!TBXML_CHECK(parsed.saveSnapshot(file, error), "damaged " + error)) return;
+
+	std::string snapshot = readFile(snapshotFile);
+	if (!TBXML_CHECK(snapshot.size() > TBXML_TEST_HEADER_LENGTH, "damaged")) return;
+	TBXML_CHECK(loadError(snapshotFile, true) == "", "damaged intact");
+
+	// too short for the header, cut inside the arrays and just before the end
+	static const size_t truncated[] = { 0, 10, TBXML_TEST_HEADER_LENGTH-1, TBXML_TEST_HEADER_LENGTH, TBXML_TEST_HEADER_LENGTH+24 };
+	for (size_t i=0; i < sizeof(truncated)/sizeof(truncated[0]); i++) {
+		writeFile(damagedFile, snapshot.substr(0, truncated[i]));
+		TBXML_CHECK(loadError(damagedFile, false) == "Snapshot invalid", "truncated to " + std::to_string(truncated[i]));
+	}
+	writeFile(damagedFile, snapshot.substr(0, snapshot.size()-1));
+	TBXML_CHECK(loadError(damagedFile, false) == "Snapshot invalid", "truncated by one byte");
+	writeFile(damagedFile, snapshot + "x");
+	TBXML_CHECK(loadError(damagedFile, false) == "Snapshot invalid", "one byte appended");
+
+	std::string damaged = snapshot;
+	damaged[TBXML_TEST_MAGIC_OFFSET] = 'X';
+	writeFile(damagedFile, damaged);
+	TBXML_CHECK(loadError(damagedFile, false) == "Snapshot invalid", "magic");
+
+	damaged = snapshot;
+	uint32_t version = TBXML_SNAPSHOT_VERSION + 1;
+	memcpy(&damaged[TBXML_TEST_VERSION_OFFSET], &version, sizeof(version));
+	writeFile(damagedFile, damaged);
+	TBXML_CHECK(loadError(damagedFile, false) == "Snapshot version not supported", "version");
+
+	damaged = snapshot;
+	uint32_t byteOrder = 0x04030201u;
+	memcpy(&damaged[TBXML_TEST_BYTE_ORDER_OFFSET], &byteOrder, sizeof(byteOrder));
+	writeFile(damagedFile, damaged);
+	TBXML_CHECK(loadError(damagedFile, false) == "Snapshot version not supported", "byte order");
+
+	// a changed byte of the text still loads unverified, only the checksum tells
+	damaged = snapshot;
+	damaged[damaged.size()-2] ^= 1;
+	writeFile(damagedFile, damaged);
+	TBXML_CHECK(loadError(damagedFile, false) == "", "changed byte mapped");
+	TBXML_CHECK(loadError(damagedFile, true) == "Snapshot checksum mismatch", "changed byte verified");
+
+	remove(damagedFile);
+	TBXML_CHECK(loadError(damagedFile, false) == "File not found in bundle", "missing file");
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) checkRoundTrip(documents[i], "document " + std::to_string(i));
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		checkRoundTrip(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 256*1024, 17), TBXMLCorpus::shapeName((TBXMLCorpusShape)shape));
+	}
+
+	checkLongNames();
+	checkDamaged();
+
+	remove(snapshotFile);
+	return tbxmlTestResult("snapshot");
+}
@@ -0,0 +1,154 @@
+// ================================================================================================
+//  TBXMLStreamTest.cpp
+//  Stream events and pushed trees against the trees of decodeBytes
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Feeds corpus documents and a few small ones to TBXMLStreamParser and TBXMLPushParser whole, a byte
+//  at a time and in random pieces, and checks the elements and attributes of the events, and the trees
+//  pushed, against the tree initWithXMLString builds.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLStreamTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o stream
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLPush.h"
+#include "TBXMLStream.h"
+#include "TBXMLTest.h"
+#include <algorithm>
+#include <vector>
+
+static const char* documents[] = {
+	"<r/>",
+	"<r>text</r>",
+	"<r>  a <b/> c <d>e</d> f </r>",
+	"<r a = '1'  b=\"2\"\n>\n  spaced \t text\t</r >",
+	"<r><![CDATA[<a>]]><!-- <b> --><a><![CDATA[</a>]]></a><?pi <c>?></r>",
+	"<?xml version='1.0'?><!DOCTYPE r><r><a q='&amp;&lt;'>&#65;&#x42;</a><a/><a></a></r>",
+	"<r xmlns='urn:r' xmlns:p='urn:p'><p:a p:x='1'><b xmlns='urn:b'><p:c/></b></p:a></r>",
+};
+
+/** Piece lengths to feed a document in: the whole of it, single bytes, and random lengths up to 4k.
+ */
+static std::vector<size_t> pieces(size_t aLength, int aSplit, uint64_t &aState) {
+	std::vector<size_t> lengths;
+	for (size_t offset=0; offset < aLength;) {
+		size_t length = aLength - offset;
+		if (aSplit == 1) {
+			length = 1;
+		} else if (aSplit == 2) {
+			aState = aState*6364136223846793005ULL + 1442695040888963407ULL;
+			length = std::min(length, (size_t)(1 + (aState >> 33) % 4096));
+		}
+		lengths.push_back(length);
+		offset += length;
+	}
+	return lengths;
+}
+
+/** The dump of the elements and attributes of the stream events, in the format of tbxmlDumpTree
+    without text.
+ */
+static std::string streamDump(const std::string &aXML, const std::vector<size_t> &aPieces, std::string &error) {
+	TBXMLStreamParser stream;
+	std::string output;
+	size_t offset = 0;
+	size_t piece = 0;
+
+	for (;;) {
+		TBXMLStreamEvent event = stream.next();
+		switch (event) {
+			case D_TBXML_STREAM_START_ELEMENT:
+				output.append(stream.depth() - 1, ' ');
+				output += '<';
+				output += stream.name();
+				for (size_t i=0; i < stream.attributeCount(); i++) {
+					output += ' ';
+					output += stream.attributes()[i].name;
+					output += "=\"";
+					output += stream.attributes()[i].value;
+					output += '"';
+				}
+				output += ">\n";
+				break;
+			case D_TBXML_STREAM_NEED_DATA:
+				if (piece == aPieces.size()) {
+					stream.finish();
+				} else {
+					stream.feed(aXML.data() + offset, aPieces[piece]);
+					offset += aPieces[piece++];
+				}
+				break;
+			case D_TBXML_STREAM_END_DOCUMENT:
+				return output;
+			case D_TBXML_STREAM_ERROR:
+				error = stream.error();
+				return "error: " + error;
+			default:
+				break;
+		}
+	}
+}
+
+static std::string pushDump(const std::string &aXML, const std::vector<size_t> &aPieces, bool aNamespaceAware) {
+	TBXMLPushParser push;
+	push.document().setNamespaceAware(aNamespaceAware);
+
+	size_t offset = 0;
+	for (size_t length : aPieces) {
+		if (!push.feed(aXML.data() + offset, length)) return "error: " + push.error();
+		offset += length;
+	}
+	if (!push.finish()) return "error: " + push.error();
+	return tbxmlDumpDocument(push.document());
+}
+
+static void check(const std::string &aXML, const std::string &aLabel) {
+	uint64_t state = aXML.length();
+
+	TBXML document;
+	std::string expected = tbxmlParseAndDump(document, aXML, false);
+	TBXML namespaceDocument;
+	namespaceDocument.setNamespaceAware(true);
+	std::string expectedText[2] = {tbxmlParseAndDump(document, aXML), tbxmlParseAndDump(namespaceDocument, aXML)};
+
+	for (int split=0; split < 3; split++) {
+		// a byte at a time is slow for the large documents and finds nothing the small ones don't
+		if (split == 1 && aXML.length() > 64*1024) continue;
+		std::vector<size_t> lengths = pieces(aXML.length(), split, state);
+		std::string label = aLabel + (split == 0 ? " whole" : split == 1 ? " bytes" : " pieces");
+
+		std::string error;
+		TBXML_CHECK(streamDump(aXML, lengths, error) == expected, label + " stream " + error);
+		for (int namespaceAware=0; namespaceAware < 2; namespaceAware++) {
+			TBXML_CHECK(pushDump(aXML, lengths, namespaceAware) == expectedText[namespaceAware], label + (namespaceAware ? " push namespaces" : " push"));
+		}
+	}
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], "document " + std::to_string(i));
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		check(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 256*1024, 5), TBXMLCorpus::shapeName((TBXMLCorpusShape)shape));
+	}
+
+	return tbxmlTestResult("stream");
+}
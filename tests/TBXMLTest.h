@@ -0,0 +1,135 @@
+// ================================================================================================
+//  TBXMLTest.h
+//  Checks and tree dumps shared by the tests
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+
+#ifndef _TBXML_TEST_H_
+#define _TBXML_TEST_H_
+
+#include "TBXML.h"
+#include <stdio.h>
+#include <string>
+
+// ================================================================================================
+//  Checks
+// ================================================================================================
+
+static int tbxmlTestFailures = 0;
+
+/** Reports a failed check with where it is and what was checked, and counts it. The test goes on so
+    one run shows every failure; main returns tbxmlTestResult().
+ */
+#define TBXML_CHECK(condition, label) tbxmlCheck((condition), #condition, (label), __FILE__, __LINE__)
+
+static inline bool tbxmlCheck(bool aPassed, const char* aCondition, const std::string &aLabel, const char* aFile, int aLine) {
+	if (!aPassed) {
+		fprintf(stderr, "%s:%d: %s: failed %s\n", aFile, aLine, aLabel.c_str(), aCondition);
+		tbxmlTestFailures++;
+	}
+	return aPassed;
+}
+
+static inline int tbxmlTestResult(const char* aName) {
+	if (tbxmlTestFailures) fprintf(stderr, "%s: %d checks failed\n", aName, tbxmlTestFailures);
+	else printf("%s: passed\n", aName);
+	return tbxmlTestFailures ? 1 : 0;
+}
+
+// ================================================================================================
+//  Tree Dumps
+// ================================================================================================
+
+/** Appends the names, namespaces, attributes and text of aXMLElement, its following siblings and
+    everything below them to aOutput, one element per line, so two trees are equal when their dumps
+    are. Text missing and text empty are told apart. The walk follows the links without recursing, the
+    deep corpus documents nest 1024 levels.
+ */
+static inline void tbxmlDumpTree(const TBXML &aDocument, const TBXMLElement* aXMLElement, std::string &aOutput, bool aWithText = true) {
+	const TBXMLElement * xmlElement = aXMLElement;
+	size_t depth = 0;
+
+	while (xmlElement) {
+		aOutput.append(depth, ' ');
+		aOutput += '<';
+		if (aDocument.namespaceId(xmlElement) != TBXML_NAME_NONE) {
+			aOutput += '{';
+			aOutput += aDocument.namespaceURI(aDocument.namespaceId(xmlElement));
+			aOutput += '}';
+		}
+		aOutput.append(xmlElement->name, xmlElement->nameLength);
+		for (uint32_t i=0; i < xmlElement->attributeCount; i++) {
+			const TBXMLAttribute * xmlAttribute = xmlElement->firstAttribute + i;
+			aOutput += ' ';
+			if (aDocument.namespaceId(xmlAttribute) != TBXML_NAME_NONE) {
+				aOutput += '{';
+				aOutput += aDocument.namespaceURI(aDocument.namespaceId(xmlAttribute));
+				aOutput += '}';
+			}
+			aOutput.append(xmlAttribute->name, xmlAttribute->nameLength);
+			aOutput += "=\"";
+			aOutput.append(xmlAttribute->value, xmlAttribute->valueLength);
+			aOutput += '"';
+		}
+		aOutput += '>';
+		if (aWithText) {
+			if (xmlElement->text) {
+				aOutput += '[';
+				aOutput.append(xmlElement->text, xmlElement->textLength);
+				aOutput += ']';
+			} else {
+				aOutput += '-';
+			}
+		}
+		aOutput += '\n';
+
+		if (xmlElement->firstChild) {
+			xmlElement = xmlElement->firstChild;
+			depth++;
+			continue;
+		}
+
+		// climb to the next sibling of the element or of its closest parent that has one
+		while (xmlElement && !xmlElement->nextSibling) {
+			if (!depth) return;
+			xmlElement = xmlElement->parentElement;
+			depth--;
+		}
+		if (xmlElement) xmlElement = xmlElement->nextSibling;
+	}
+}
+
+static inline std::string tbxmlDumpDocument(const TBXML &aDocument, bool aWithText = true) {
+	std::string output;
+	tbxmlDumpTree(aDocument, aDocument.rootXMLElement, output, aWithText);
+	return output;
+}
+
+/** Parses aXML into aDocument and returns the dump of the tree, or "error: " and the message.
+ */
+static inline std::string tbxmlParseAndDump(TBXML &aDocument, const std::string &aXML, bool aWithText = true) {
+	std::string xml = aXML;
+	std::string error;
+	if (!aDocument.initWithXMLString(xml, error)) return "error: " + error;
+	return tbxmlDumpDocument(aDocument, aWithText);
+}
+
+#endif	//_TBXML_TEST_H_
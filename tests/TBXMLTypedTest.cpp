@@ -0,0 +1,163 @@
+// ================================================================================================
+//  TBXMLTypedTest.cpp
+//  Typed attribute and text values converted by TBXML
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Converts values to int, int64_t, double and bool from attributes, looked up by string and by
+//  TBXMLName, and from text, checking the value or default returned and the error code: values out of
+//  the range of the type, trailing garbage, missing elements, attributes and text.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLTypedTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o typed
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLTest.h"
+
+typedef struct _TBXMLTypedCase {
+	const char * written;
+	TBXMLErrorCodes intCode;
+	int intValue;
+	TBXMLErrorCodes int64Code;
+	int64_t int64Value;
+	TBXMLErrorCodes doubleCode;
+	double doubleValue;
+	TBXMLErrorCodes boolCode;
+	bool boolValue;
+} TBXMLTypedCase;
+
+// short names keeping the table readable
+static const TBXMLErrorCodes OK = D_TBXML_SUCCESS;
+static const TBXMLErrorCodes NUMBER = D_TBXML_VALUE_NOT_A_NUMBER;
+static const TBXMLErrorCodes RANGE = D_TBXML_VALUE_OUT_OF_RANGE;
+static const TBXMLErrorCodes BOOLEAN = D_TBXML_VALUE_NOT_A_BOOLEAN;
+
+// the value expected when the code is D_TBXML_SUCCESS, the default otherwise
+static const TBXMLTypedCase cases[] = {
+	{"12",					OK, 12,			OK, 12,				OK, 12,						BOOLEAN, false},
+	{" 12\t",				OK, 12,			OK, 12,				OK, 12,						BOOLEAN, false},
+	{"+7",					OK, 7,			OK, 7,				OK, 7,						BOOLEAN, false},
+	{"-42",					OK, -42,		OK, -42,			OK, -42,					BOOLEAN, false},
+	{"01",					OK, 1,			OK, 1,				OK, 1,						BOOLEAN, false},
+	{"0",					OK, 0,			OK, 0,				OK, 0,						OK, false},
+	{"1",					OK, 1,			OK, 1,				OK, 1,						OK, true},
+	{"-2.5",				NUMBER, 0,		NUMBER, 0,			OK, -2.5,					BOOLEAN, false},
+	{"1.5e3",				NUMBER, 0,		NUMBER, 0,			OK, 1500,					BOOLEAN, false},
+	{".5",					NUMBER, 0,		NUMBER, 0,			OK, 0.5,					BOOLEAN, false},
+
+	// limits of the types
+	{"2147483647",			OK, 2147483647,	OK, 2147483647,		OK, 2147483647,				BOOLEAN, false},
+	{"-2147483648",			OK, INT32_MIN,	OK, INT32_MIN,		OK, -2147483648.0,			BOOLEAN, false},
+	{"2147483648",			RANGE, 0,		OK, 2147483648LL,	OK, 2147483648.0,			BOOLEAN, false},
+	{"-2147483649",			RANGE, 0,		OK, -2147483649LL,	OK, -2147483649.0,			BOOLEAN, false},
+	{"9223372036854775807",	RANGE, 0,		OK, INT64_MAX,		OK, 9223372036854775807.0,	BOOLEAN, false},
+	{"9223372036854775808",	RANGE, 0,		RANGE, 0,			OK, 9223372036854775808.0,	BOOLEAN, false},
+	{"1e999",				NUMBER, 0,		NUMBER, 0,			RANGE, 0,					BOOLEAN, false},
+
+	// trailing garbage and other malformed numbers
+	{"12abc",				NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"0x10",				NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"1 2",					NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"+",					NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"+-1",					NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"--1",					NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+
+	// booleans
+	{"true",				NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					OK, true},
+	{" false ",				NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					OK, false},
+	{"TRUE",				NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"yes",					NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+	{"truex",				NUMBER, 0,		NUMBER, 0,			NUMBER, 0,					BOOLEAN, false},
+};
+
+static const int intDefault = -99;
+static const int64_t int64Default = -99;
+static const double doubleDefault = -99.5;
+
+/** Checks a conversion against the case, the default being returned when it fails.
+ */
+template<typename T> static void checkValue(T aFound, TBXMLErrorCodes aFoundCode, TBXMLErrorCodes aCode, T aValue, T aDefault, const std::string &aLabel) {
+	TBXML_CHECK(aFoundCode == aCode, aLabel + " code " + std::to_string(aFoundCode));
+	TBXML_CHECK(aFound == (aCode == D_TBXML_SUCCESS ? aValue : aDefault), aLabel + " value");
+}
+
+static void checkCase(const TBXMLTypedCase &aCase) {
+	std::string xml = std::string("<r v='") + aCase.written + "'>" + aCase.written + "</r>", error;
+	TBXML document;
+	if (!TBXML_CHECK(document.initWithXMLString(xml, error), std::string(aCase.written) + " " + error)) return;
+	const TBXMLElement * root = document.rootXMLElement;
+
+	TBXMLSymbolTable symbols;
+	TBXMLName name = symbols.name("v");
+
+	// the text is trimmed by the parser, the attribute value only by the conversion
+	for (int source=0; source < 3; source++) {
+		std::string label = std::string(source == 0 ? "attribute '" : source == 1 ? "named attribute '" : "text '") + aCase.written + "'";
+		TBXMLErrorCodes code = D_TBXML_SUCCESS;
+		int intValue = source == 0 ? TBXML::intAttribute("v", root, intDefault, &code) : source == 1 ? TBXML::intAttribute(name, root, intDefault, &code) : TBXML::intText(root, intDefault, &code);
+		checkValue(intValue, code, aCase.intCode, aCase.intValue, intDefault, label + " int");
+		int64_t int64Value = source == 0 ? TBXML::int64Attribute("v", root, int64Default, &code) : source == 1 ? TBXML::int64Attribute(name, root, int64Default, &code) : TBXML::int64Text(root, int64Default, &code);
+		checkValue(int64Value, code, aCase.int64Code, aCase.int64Value, int64Default, label + " int64");
+		double doubleValue = source == 0 ? TBXML::doubleAttribute("v", root, doubleDefault, &code) : source == 1 ? TBXML::doubleAttribute(name, root, doubleDefault, &code) : TBXML::doubleText(root, doubleDefault, &code);
+		checkValue(doubleValue, code, aCase.doubleCode, aCase.doubleValue, doubleDefault, label + " double");
+
+		// both defaults, so a failed conversion can't pass for the value
+		for (bool boolDefault : {false, true}) {
+			bool boolValue = source == 0 ? TBXML::boolAttribute("v", root, boolDefault, &code) : source == 1 ? TBXML::boolAttribute(name, root, boolDefault, &code) : TBXML::boolText(root, boolDefault, &code);
+			checkValue(boolValue, code, aCase.boolCode, aCase.boolValue, boolDefault, label + " bool");
+		}
+	}
+}
+
+/** Missing elements, attributes and text give the default and say which was missing, an empty
+    attribute value is not a value of any type.
+ */
+static void checkMissing() {
+	std::string xml = "<r e=''><empty/><blank></blank><spaces>  </spaces></r>", error;
+	TBXML document;
+	if (!TBXML_CHECK(document.initWithXMLString(xml, error), "missing " + error)) return;
+	const TBXMLElement * root = document.rootXMLElement;
+	TBXMLErrorCodes code = D_TBXML_SUCCESS;
+
+	TBXML_CHECK(TBXML::intAttribute("v", NULL, 5, &code) == 5 && code == D_TBXML_ELEMENT_IS_NIL, "no element attribute");
+	TBXML_CHECK(TBXML::intText(NULL, 5, &code) == 5 && code == D_TBXML_ELEMENT_IS_NIL, "no element text");
+	TBXML_CHECK(TBXML::intAttribute("v", root, 5, &code) == 5 && code == D_TBXML_ATTRIBUTE_NOT_FOUND, "no attribute");
+	TBXML_CHECK(TBXML::boolAttribute("v", root, true, &code) == true && code == D_TBXML_ATTRIBUTE_NOT_FOUND, "no bool attribute");
+	TBXML_CHECK(TBXML::intAttribute("e", root, 5, &code) == 5 && code == D_TBXML_VALUE_NOT_A_NUMBER, "empty attribute");
+	TBXML_CHECK(TBXML::boolAttribute("e", root, true, &code) == true && code == D_TBXML_VALUE_NOT_A_BOOLEAN, "empty bool attribute");
+	TBXML_CHECK(TBXML::doubleAttribute("e", root, 0.5, &code) == 0.5 && code == D_TBXML_VALUE_NOT_A_NUMBER, "empty double attribute");
+
+	for (const char * name : {"empty", "blank", "spaces"}) {
+		const TBXMLElement * xmlElement = TBXML::childElementNamed(name, root);
+		if (!TBXML_CHECK(xmlElement != NULL, name)) continue;
+		TBXML_CHECK(TBXML::intText(xmlElement, 5, &code) == 5 && code == D_TBXML_ELEMENT_TEXT_IS_NIL, std::string(name) + " int text");
+		TBXML_CHECK(TBXML::boolText(xmlElement, true, &code) == true && code == D_TBXML_ELEMENT_TEXT_IS_NIL, std::string(name) + " bool text");
+	}
+
+	// the error code is optional
+	TBXML_CHECK(TBXML::int64Attribute("v", root, 7) == 7, "no error code");
+	TBXML_CHECK(TBXML::doubleText(TBXML::childElementNamed("empty", root), 0.25) == 0.25, "no error code text");
+}
+
+int main() {
+	for (const TBXMLTypedCase &typedCase : cases) checkCase(typedCase);
+	checkMissing();
+
+	return tbxmlTestResult("typed");
+}
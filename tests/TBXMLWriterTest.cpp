@@ -0,0 +1,141 @@
+// ================================================================================================
+//  TBXMLWriterTest.cpp
+//  Documents written by TBXMLWriter parsed back into the trees they came from
+//
+// ================================================================================================
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+// ================================================================================================
+//  Parses documents and corpus documents, writes the trees compact and pretty and checks the trees
+//  parsed from the output against the first ones, decoded eagerly and, for documents without CDATA
+//  sections, with the references kept. Also
+//  writes generated documents whose text and values hold every character to escape and reads them
+//  back.
+//
+//  c++ -O2 -std=c++17 -I../TBXML -I../bench TBXMLWriterTest.cpp ../bench/TBXMLCorpus.cpp ../TBXML/*.cpp -o writer
+// ================================================================================================
+#include "TBXML.h"
+#include "TBXMLCorpus.h"
+#include "TBXMLTest.h"
+#include "TBXMLWriter.h"
+
+static const char* documents[] = {
+	"<r/>",
+	"<r></r>",
+	"<r><a/><b></b><c>t</c><d> </d></r>",
+	"<r><![CDATA[a & b < c > d]]></r>",
+	"<r><a><![CDATA[<b>&amp;</b>]]></a><a>x <![CDATA[&]]> y</a></r>",
+	"<r a='&quot;' b=\"say &quot;hi&quot;\" c='&apos;&amp;&lt;&gt;'>&quot;&#65;&#x42;&lt;</r>",
+	"<r a=\"'\" b='\"'>it's \"quoted\"</r>",
+	"<r xmlns:p='urn:p'><p:a p:x='1'>text<b/>more</p:a><!-- comment --></r>",
+};
+
+// documents whose trees with the references kept are written back as they are, see TBXMLWriter.h
+static const char* referenceDocuments[] = {
+	"<r><a/><b></b><c>t</c><d> </d></r>",
+	"<r a='&quot;' b=\"say &quot;hi&quot;\" c='&apos;&amp;&lt;&gt;'>&quot;&#65;&#x42;&lt;</r>",
+	"<r xmlns:p='urn:p'><p:a p:x='1'>text<b/>more</p:a><!-- comment --></r>",
+};
+
+static const TBXMLWriterFormat formats[] = {D_TBXML_WRITE_COMPACT, D_TBXML_WRITE_PRETTY};
+
+/** Writes the tree of aDocument and returns the dump of the tree parsed from the output.
+ */
+static std::string roundTrip(const TBXML &aDocument, TBXMLEntityMode aEntityMode, TBXMLWriterFormat aFormat, std::string &aOutput) {
+	TBXMLWriter writer;
+	aOutput.clear();
+	writer.initWithString(&aOutput);
+	writer.setFormat(aFormat);
+	if (!writer.element(aDocument.rootXMLElement) || !writer.finish()) return "error: " + writer.error();
+
+	TBXML document;
+	document.setEntityMode(aEntityMode);
+	return tbxmlParseAndDump(document, aOutput);
+}
+
+static void check(const std::string &aXML, const std::string &aLabel, TBXMLEntityMode aEntityMode) {
+	TBXML document;
+	document.setEntityMode(aEntityMode);
+	std::string expected = tbxmlParseAndDump(document, aXML);
+	std::string label = aLabel + (aEntityMode == D_TBXML_ENTITIES_EAGER ? " eager" : " none");
+	if (!TBXML_CHECK(expected.compare(0, 7, "error: ") != 0, label + " " + expected)) return;
+
+	for (TBXMLWriterFormat format : formats) {
+		std::string output;
+		std::string dump = roundTrip(document, aEntityMode, format, output);
+		TBXML_CHECK(dump == expected, label + (format == D_TBXML_WRITE_PRETTY ? " pretty" : " compact") + (aXML.length() < 256 ? " wrote " + output : ""));
+	}
+}
+
+/** Self closing elements have no text and empty ones empty text, the writer keeps them apart.
+ */
+static void checkEmptyElements() {
+	std::string xml = "<r><a/><b></b><c x='1'/><d x='1'></d></r>";
+	TBXML document;
+	document.setEntityMode(D_TBXML_ENTITIES_EAGER);
+	std::string output;
+	TBXML_CHECK(tbxmlParseAndDump(document, xml).compare(0, 7, "error: ") != 0, "empty elements");
+	roundTrip(document, D_TBXML_ENTITIES_EAGER, D_TBXML_WRITE_COMPACT, output);
+	TBXML_CHECK(output == "<r><a/><b></b><c x=\"1\"/><d x=\"1\"></d></r>", "empty elements wrote " + output);
+}
+
+/** Generates a document with startElement/attribute/text/endElement and checks what the eager parse
+    of it reads back.
+ */
+static void checkGenerated() {
+	const std::string value = "\"quoted\" 'single' & <tag> ]]> &amp;";
+	std::string output;
+	TBXMLWriter writer;
+	writer.initWithString(&output);
+	writer.startElement("r");
+	writer.attribute("v", value);
+	writer.startElement("empty");
+	writer.endElement();
+	writer.startElement("text");
+	writer.text(value);
+	writer.endElement();
+	TBXML_CHECK(writer.finish(), "generated");
+
+	TBXML document;
+	document.setEntityMode(D_TBXML_ENTITIES_EAGER);
+	std::string error;
+	if (!TBXML_CHECK(document.initWithXMLString(output, error), "generated " + output)) return;
+
+	const TBXMLElement * root = document.rootXMLElement;
+	TBXML_CHECK(TBXML::valueOfAttributeNamed("v", root) == value, "generated value " + output);
+	const TBXMLElement * empty = TBXML::childElementNamed("empty", root);
+	TBXML_CHECK(empty && !empty->text && !empty->firstChild, "generated empty " + output);
+	const TBXMLElement * text = TBXML::childElementNamed("text", root);
+	TBXML_CHECK(text && TBXML::textForElement(text) == value, "generated text " + output);
+}
+
+int main() {
+	for (size_t i=0; i < sizeof(documents)/sizeof(documents[0]); i++) check(documents[i], "document " + std::to_string(i), D_TBXML_ENTITIES_EAGER);
+	for (size_t i=0; i < sizeof(referenceDocuments)/sizeof(referenceDocuments[0]); i++) {
+		check(referenceDocuments[i], "reference document " + std::to_string(i), D_TBXML_ENTITIES_NONE);
+	}
+
+	for (int shape=0; shape < D_TBXML_CORPUS_SHAPE_COUNT; shape++) {
+		check(TBXMLCorpus::generate((TBXMLCorpusShape)shape, 256*1024, 9), TBXMLCorpus::shapeName((TBXMLCorpusShape)shape), D_TBXML_ENTITIES_EAGER);
+	}
+
+	checkEmptyElements();
+	checkGenerated();
+
+	return tbxmlTestResult("writer");
+}